@@ -1,10 +1,15 @@
 package main
 
 import (
+	"bufio"
 	"encoding/binary"
+	"encoding/json"
 	"fmt"
 	"io"
 	"os"
+	"strconv"
+	"strings"
+	"time"
 
 	"github.com/jimsmart/grobotstxt"
 )
@@ -37,9 +42,67 @@ func loadRobotsFiles(filename string) ([]string, error) {
 	return files, nil
 }
 
+type check struct {
+	file int
+	url  string
+}
+
+// loadWorkload reads "<file index>\t<url>" lines, skipping comments and
+// indexes out of range like tests/robots_benchmark.cc.
+func loadWorkload(filename string, numFiles int) ([]check, error) {
+	f, err := os.Open(filename)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	var checks []check
+	scanner := bufio.NewScanner(f)
+	scanner.Buffer(make([]byte, 1<<16), 1<<20)
+	for scanner.Scan() {
+		line := scanner.Text()
+		if line == "" || line[0] == '#' {
+			continue
+		}
+		index, url, ok := strings.Cut(line, "\t")
+		if !ok {
+			continue
+		}
+		file, err := strconv.Atoi(index)
+		if err != nil || file < 0 || file >= numFiles {
+			continue
+		}
+		checks = append(checks, check{file, url})
+	}
+	return checks, scanner.Err()
+}
+
+// runWorkload checks every URL of the workload against its robots.txt and
+// prints the timing as JSON, for benchmark-utils/results.py.
+func runWorkload(files []string, checks []check) {
+	allowed := 0
+	start := time.Now()
+	for _, c := range checks {
+		if grobotstxt.AgentAllowed(files[c.file], "Googlebot", c.url) {
+			allowed++
+		}
+	}
+	seconds := time.Since(start).Seconds()
+
+	result, _ := json.Marshal(map[string]interface{}{
+		"implementation":    "go/grobotstxt",
+		"files":             len(files),
+		"checks":            len(checks),
+		"allowed":           allowed,
+		"seconds":           seconds,
+		"checks_per_second": float64(len(checks)) / seconds,
+	})
+	fmt.Println(string(result))
+}
+
 func main() {
 	if len(os.Args) < 2 {
-		fmt.Fprintln(os.Stderr, "Usage: go-bench <robots_all.bin>")
+		fmt.Fprintln(os.Stderr, "Usage: go-bench <robots_all.bin> [robots_urls.tsv]")
 		os.Exit(1)
 	}
 
@@ -49,6 +112,16 @@ func main() {
 		os.Exit(1)
 	}
 
+	if len(os.Args) > 2 {
+		checks, err := loadWorkload(os.Args[2], len(files))
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "Error loading workload: %v\n", err)
+			os.Exit(1)
+		}
+		runWorkload(files, checks)
+		return
+	}
+
 	// Parse and match all files
 	allowed := 0
 	for _, content := range files {
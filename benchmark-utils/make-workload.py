@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Generates a synthetic URL workload for robots_all.bin.
+
+The benchmarks read "<file index>\t<url>" lines from robots_files/robots_urls.tsv,
+next to robots_all.bin. A workload taken from a crawl log is best; without one,
+this script derives URLs from the rules of each file, so that a good share of
+them hits an Allow or Disallow pattern, mixed with paths that hit none. The
+output is the same for the same input and seed.
+
+Usage: make-workload.py [robots_all.bin] [robots_urls.tsv] [--urls-per-file N]
+"""
+
+import argparse
+import random
+import re
+import struct
+import sys
+
+RULE_RE = re.compile(rb"^\s*(allow|disallow)\s*:\s*(\S+)", re.IGNORECASE | re.MULTILINE)
+GENERIC_PATHS = [
+    "/",
+    "/index.html",
+    "/robots.txt",
+    "/search?q=robots",
+    "/products/{n}",
+    "/products/{n}?ref=home&sort=price",
+    "/blog/{y}/{m}/post-{n}.html",
+    "/static/js/app.{n}.js",
+    "/user/{n}/profile",
+    "/en-us/category/{n}/page/{m}",
+]
+
+
+def load_robots_files(filename):
+    """Loads [uint32_le length][content] records."""
+    files = []
+    with open(filename, "rb") as f:
+        while True:
+            header = f.read(4)
+            if len(header) < 4:
+                break
+            (length,) = struct.unpack("<I", header)
+            files.append(f.read(length))
+    return files
+
+
+def fill(template, rng):
+    return template.format(n=rng.randrange(1, 100000), y=rng.randrange(2010, 2027),
+                           m=rng.randrange(1, 13))
+
+
+def path_from_pattern(pattern, rng):
+    """Turns an Allow/Disallow pattern into a path at or near what it matches."""
+    path = pattern.decode("latin-1")
+    if not path.startswith("/"):
+        path = "/" + path
+    path = path.rstrip("$")
+    path = re.sub(r"\*+", lambda _: "s%d" % rng.randrange(1000), path)
+    # Some URLs go one level below the pattern, some stop short of it.
+    choice = rng.random()
+    if choice < 0.4:
+        path += fill("{n}", rng)
+    elif choice < 0.55 and len(path) > 2:
+        path = path[: rng.randrange(1, len(path))]
+    # Only printable ASCII, %-encoded otherwise, as URLs in a crawl frontier.
+    return "".join(c if 0x21 <= ord(c) < 0x7f else "%%%02X" % ord(c) for c in path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("robots", nargs="?", default="robots_files/robots_all.bin")
+    parser.add_argument("output", nargs="?", default="robots_files/robots_urls.tsv")
+    parser.add_argument("--urls-per-file", type=int, default=16)
+    parser.add_argument("--seed", type=int, default=9309)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    files = load_robots_files(args.robots)
+    num_urls = 0
+    with open(args.output, "w", encoding="ascii", newline="\n") as out:
+        out.write("# Synthetic workload: make-workload.py --urls-per-file %d --seed %d\n"
+                  % (args.urls_per_file, args.seed))
+        for index, body in enumerate(files):
+            host = "https://host%d.example" % index
+            # Values end at a comment.
+            patterns = [p for p in (m.group(2).split(b"#")[0]
+                                    for m in RULE_RE.finditer(body)) if p]
+            for _ in range(args.urls_per_file):
+                if patterns and rng.random() < 0.7:
+                    path = path_from_pattern(rng.choice(patterns), rng)
+                else:
+                    path = fill(rng.choice(GENERIC_PATHS), rng)
+                out.write("%d\t%s%s\n" % (index, host, path))
+                num_urls += 1
+    print("Wrote %d URLs for %d files to %s" % (num_urls, len(files), args.output),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
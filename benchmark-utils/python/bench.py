@@ -1,8 +1,10 @@
 #!/usr/bin/env python3
 """Benchmark wrapper for gpyrobotstxt (Python port of Google's robots.txt parser)."""
 
+import json
 import struct
 import sys
+import time
 from gpyrobotstxt.robots_cc import RobotsMatcher
 
 
@@ -22,13 +24,53 @@ def load_robots_files(filename: str) -> list[bytes]:
     return files
 
 
+def load_workload(filename: str, num_files: int) -> list[tuple[int, str]]:
+    """Load "<file index>\\t<url>" lines, like tests/robots_benchmark.cc."""
+    checks = []
+    with open(filename, encoding='ascii', errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if not line or line.startswith('#') or '\t' not in line:
+                continue
+            index, url = line.split('\t', 1)
+            if index.isdigit() and int(index) < num_files:
+                checks.append((int(index), url))
+    return checks
+
+
+def run_workload(files: list[bytes], checks: list[tuple[int, str]]) -> None:
+    """Check every URL of the workload and print the timing as JSON."""
+    allowed = 0
+    start = time.perf_counter()
+    for file, url in checks:
+        try:
+            matcher = RobotsMatcher()
+            if matcher.allowed_by_robots(files[file], ["Googlebot"], url):
+                allowed += 1
+        except Exception:
+            allowed += 1  # Same as below.
+    seconds = time.perf_counter() - start
+    print(json.dumps({
+        "implementation": "python/gpyrobotstxt",
+        "files": len(files),
+        "checks": len(checks),
+        "allowed": allowed,
+        "seconds": seconds,
+        "checks_per_second": len(checks) / seconds,
+    }))
+
+
 def main():
     if len(sys.argv) < 2:
-        print("Usage: python bench.py <robots_all.bin>", file=sys.stderr)
+        print("Usage: python bench.py <robots_all.bin> [robots_urls.tsv]", file=sys.stderr)
         sys.exit(1)
 
     files = load_robots_files(sys.argv[1])
 
+    if len(sys.argv) > 2:
+        run_workload(files, load_workload(sys.argv[2], len(files)))
+        return
+
     allowed = 0
 
     for content in files:
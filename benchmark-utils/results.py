@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Renders benchmark results as the Markdown tables of BENCHMARK_RESULTS.
+
+Takes any number of result files:
+  - JSON written by robots-benchmark or robots-benchmark-fallback with
+    --benchmark_out=<file> --benchmark_out_format=json, and
+  - JSON lines printed by the harnesses in benchmark-utils/ for a workload
+    (go-bench, rust-bench and bench.py with a robots_urls.tsv argument).
+
+Usage: results.py cpp.json [cpp-fallback.json] [harness.jsonl ...] > results.md
+"""
+
+import json
+import sys
+
+# The C++ benchmark that does what the harnesses do: parse the robots.txt
+# again for every URL of the workload, for one agent.
+CPP_HARNESS_EQUIVALENT = "BM_WorkloadReparse/agents:1"
+
+TIME_UNITS = {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}
+
+
+def load(filename):
+    """Returns ("benchmark", data) or ("harness", [results])."""
+    with open(filename, encoding="utf-8") as f:
+        text = f.read()
+    try:
+        data = json.loads(text)
+        if isinstance(data, dict) and "benchmarks" in data:
+            return "benchmark", data
+        if isinstance(data, dict):
+            return "harness", [data]
+    except json.JSONDecodeError:
+        pass
+    return "harness", [json.loads(line) for line in text.splitlines() if line.strip()]
+
+
+def format_time(seconds):
+    for unit, scale in (("s", 1.0), ("ms", 1e-3), ("us", 1e-6)):
+        if seconds >= scale:
+            return "%.3g %s" % (seconds / scale, unit)
+    return "%.3g ns" % (seconds / 1e-9)
+
+
+def format_rate(rate, unit):
+    for prefix, scale in (("G", 1e9), ("M", 1e6), ("k", 1e3)):
+        if rate >= scale:
+            return "%.3g%s %s/s" % (rate / scale, prefix, unit)
+    return "%.3g %s/s" % (rate, unit)
+
+
+def runs(data):
+    """The runs of a benchmark file: medians if it has repetitions."""
+    benchmarks = [b for b in data["benchmarks"] if not b.get("error_occurred")]
+    medians = [b for b in benchmarks if b.get("aggregate_name") == "median"]
+    if medians:
+        for b in medians:
+            b["name"] = b["run_name"]
+        return medians
+    return [b for b in benchmarks if b.get("run_type", "iteration") == "iteration"]
+
+
+def print_context(data):
+    context = data["context"]
+    caches = ", ".join("L%d%s %d KiB" % (c["level"], {"Data": "D", "Instruction": "I"}.get(
+        c["type"], ""), c["size"] // 1024) for c in context.get("caches", []))
+    print("**Date:** %s" % context.get("date", "?"))
+    print("**Host:** %s" % context.get("host_name", "?"))
+    print("**CPU:** %d cores @ %d MHz%s" % (context.get("num_cpus", 0),
+                                            context.get("mhz_per_cpu", 0),
+                                            ", " + caches if caches else ""))
+    print("**Build:** %s" % context.get("library_build_type", "?"))
+    print()
+
+
+def print_benchmarks(data):
+    url_parser = data["context"].get("url_parser", "unknown")
+    print("## C++ benchmarks (%s URL parser)" % url_parser)
+    print()
+    print("| Benchmark | Time | Throughput | Allowed |")
+    print("|-----------|------|------------|---------|")
+    for b in runs(data):
+        seconds = b["real_time"] * TIME_UNITS[b.get("time_unit", "ns")]
+        throughput = []
+        if "items_per_second" in b:
+            throughput.append(format_rate(b["items_per_second"], "items"))
+        if "bytes_per_second" in b:
+            throughput.append(format_rate(b["bytes_per_second"], "B"))
+        allowed = "%.1f%%" % (100 * b["allowed"]) if "allowed" in b else ""
+        print("| %s | %s | %s | %s |" % (b["name"], format_time(seconds),
+                                         ", ".join(throughput), allowed))
+    print()
+
+
+def print_comparison(benchmark_files, harness_results):
+    rows = []
+    for data in benchmark_files:
+        for b in runs(data):
+            if b["name"] == CPP_HARNESS_EQUIVALENT:
+                rows.append(("C++ (this repo, %s)" % data["context"].get("url_parser", "?"),
+                             b["items_per_second"], b.get("allowed")))
+    for result in harness_results:
+        rows.append((result["implementation"], result["checks_per_second"],
+                     result["allowed"] / result["checks"] if result["checks"] else None))
+    if not rows:
+        return
+    rows.sort(key=lambda row: -row[1])
+    fastest = rows[0][1]
+    print("## Cross-language comparison (same workload, one agent, re-parse per URL)")
+    print()
+    print("| Implementation | Checks/s | Relative | Allowed |")
+    print("|----------------|----------|----------|---------|")
+    for name, rate, allowed in rows:
+        print("| %s | %s | %.2fx | %s |" % (
+            name, format_rate(rate, "checks"), rate / fastest,
+            "%.1f%%" % (100 * allowed) if allowed is not None else ""))
+    print()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__, file=sys.stderr)
+        sys.exit(1)
+    benchmark_files = []
+    harness_results = []
+    for filename in sys.argv[1:]:
+        kind, data = load(filename)
+        if kind == "benchmark":
+            benchmark_files.append(data)
+        else:
+            harness_results.extend(data)
+
+    if benchmark_files:
+        print_context(benchmark_files[0])
+    for data in benchmark_files:
+        print_benchmarks(data)
+    print_comparison(benchmark_files, harness_results)
+
+
+if __name__ == "__main__":
+    main()
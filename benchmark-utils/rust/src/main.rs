@@ -1,7 +1,8 @@
 use robotstxt::DefaultMatcher;
 use std::env;
 use std::fs::File;
-use std::io::{BufReader, Read};
+use std::io::{BufRead, BufReader, Read};
+use std::time::Instant;
 
 fn load_robots_files(filename: &str) -> std::io::Result<Vec<String>> {
     let file = File::open(filename)?;
@@ -25,10 +26,53 @@ fn load_robots_files(filename: &str) -> std::io::Result<Vec<String>> {
     Ok(files)
 }
 
+/// Loads "<file index>\t<url>" lines, skipping comments and indexes out of
+/// range like tests/robots_benchmark.cc.
+fn load_workload(filename: &str, num_files: usize) -> std::io::Result<Vec<(usize, String)>> {
+    let reader = BufReader::new(File::open(filename)?);
+    let mut checks = Vec::new();
+    for line in reader.lines() {
+        let line = line?;
+        if line.is_empty() || line.starts_with('#') {
+            continue;
+        }
+        if let Some((index, url)) = line.split_once('\t') {
+            if let Ok(file) = index.parse::<usize>() {
+                if file < num_files {
+                    checks.push((file, url.to_string()));
+                }
+            }
+        }
+    }
+    Ok(checks)
+}
+
+/// Checks every URL of the workload and prints the timing as JSON, for
+/// benchmark-utils/results.py.
+fn run_workload(files: &[String], checks: &[(usize, String)]) {
+    let mut matcher = DefaultMatcher::default();
+    let mut allowed = 0;
+    let start = Instant::now();
+    for (file, url) in checks {
+        if matcher.one_agent_allowed_by_robots(&files[*file], "Googlebot", url) {
+            allowed += 1;
+        }
+    }
+    let seconds = start.elapsed().as_secs_f64();
+    println!(
+        "{{\"implementation\":\"rust/robotstxt\",\"files\":{},\"checks\":{},\"allowed\":{},\"seconds\":{},\"checks_per_second\":{}}}",
+        files.len(),
+        checks.len(),
+        allowed,
+        seconds,
+        checks.len() as f64 / seconds
+    );
+}
+
 fn main() {
     let args: Vec<String> = env::args().collect();
     if args.len() < 2 {
-        eprintln!("Usage: rust-bench <robots_all.bin>");
+        eprintln!("Usage: rust-bench <robots_all.bin> [robots_urls.tsv]");
         std::process::exit(1);
     }
 
@@ -40,6 +84,17 @@ fn main() {
         }
     };
 
+    if args.len() > 2 {
+        match load_workload(&args[2], files.len()) {
+            Ok(checks) => run_workload(&files, &checks),
+            Err(e) => {
+                eprintln!("Error loading workload: {}", e);
+                std::process::exit(1);
+            }
+        }
+        return;
+    }
+
     let mut matcher = DefaultMatcher::default();
     let mut allowed = 0;
 
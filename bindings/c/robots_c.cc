@@ -20,7 +20,11 @@
 
 #include "robots_c.h"
 #include "robots.h"
+#include "robots_cache.h"
 
+#include <chrono>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -35,6 +39,19 @@ struct robots_matcher_s {
   googlebot::RobotsMatcher matcher;
 };
 
+struct robots_compiled_s {
+  googlebot::CompiledRobots robots;
+};
+
+struct robots_cache_s {
+  googlebot::RobotsCache* cache;
+  bool owned;  // False for the shared cache.
+};
+
+struct robots_cache_body_s {
+  std::string data;
+};
+
 // =============================================================================
 // Matcher lifecycle
 // =============================================================================
@@ -51,6 +68,11 @@ extern "C" void robots_matcher_free(robots_matcher_t* matcher) {
   delete matcher;
 }
 
+extern "C" void robots_matcher_set_collect_sitemaps(robots_matcher_t* matcher,
+                                                    bool collect) {
+  if (matcher) matcher->matcher.set_collect_sitemaps(collect);
+}
+
 // =============================================================================
 // URL checking
 // =============================================================================
@@ -64,11 +86,10 @@ extern "C" bool robots_allowed_by_robots(
     return true;  // Allow on invalid input
   }
 
-  std::string_view robots_body(robots_txt, robots_txt_len);
-  std::string agent(user_agent, user_agent_len);
-  std::string target_url(url, url_len);
-
-  return matcher->matcher.OneAgentAllowedByRobots(robots_body, agent, target_url);
+  return matcher->matcher.OneAgentAllowedByRobots(
+      std::string_view(robots_txt, robots_txt_len),
+      std::string_view(user_agent, user_agent_len),
+      std::string_view(url, url_len));
 }
 
 extern "C" bool robots_allowed_by_robots_multi(
@@ -81,15 +102,257 @@ extern "C" bool robots_allowed_by_robots_multi(
     return true;  // Allow on invalid input
   }
 
-  std::string_view robots_body(robots_txt, robots_txt_len);
-  std::vector<std::string> agents;
-  agents.reserve(num_user_agents);
+  // The agents are passed as views, on the stack unless there are many.
+  constexpr size_t kMaxStackAgents = 8;
+  std::string_view stack_agents[kMaxStackAgents];
+  std::vector<std::string_view> heap_agents;
+  std::string_view* agents = stack_agents;
+  if (num_user_agents > kMaxStackAgents) {
+    heap_agents.resize(num_user_agents);
+    agents = heap_agents.data();
+  }
   for (size_t i = 0; i < num_user_agents; ++i) {
-    agents.emplace_back(user_agents[i], user_agent_lens[i]);
+    agents[i] = std::string_view(user_agents[i], user_agent_lens[i]);
+  }
+
+  return matcher->matcher.AllowedByRobots(
+      std::string_view(robots_txt, robots_txt_len), agents, num_user_agents,
+      std::string_view(url, url_len));
+}
+
+namespace {
+// Copies the user agents of a batch call, as CompiledRobots takes a vector.
+// Returns false if one of them is NULL.
+bool CopyUserAgents(const char* const* user_agents,
+                    const size_t* user_agent_lens, size_t num_user_agents,
+                    std::vector<std::string>* agents) {
+  agents->reserve(num_user_agents);
+  for (size_t i = 0; i < num_user_agents; ++i) {
+    if (!user_agents[i]) return false;
+    const size_t len =
+        user_agent_lens ? user_agent_lens[i] : strlen(user_agents[i]);
+    agents->emplace_back(user_agents[i], len);
+  }
+  return true;
+}
+
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+int8_t ToCSignal(const std::optional<bool>& value) {
+  return value.has_value() ? (*value ? 1 : 0) : -1;
+}
+
+// All fields are -1 if 'signal' is not set.
+robots_content_signal_t ToCContentSignal(
+    const std::optional<googlebot::ContentSignal>& signal) {
+  robots_content_signal_t result = {-1, -1, -1};
+  if (signal.has_value()) {
+    result.ai_train = ToCSignal(signal->ai_train);
+    result.ai_input = ToCSignal(signal->ai_input);
+    result.search = ToCSignal(signal->search);
   }
-  std::string target_url(url, url_len);
+  return result;
+}
+#endif
+
+void SetAllowed(robots_match_result_t* results, size_t num_urls) {
+  for (size_t i = 0; i < num_urls; ++i) {
+    results[i].allowed = true;  // Allow on invalid input
+    results[i].matching_line = 0;
+  }
+}
+}  // namespace
 
-  return matcher->matcher.AllowedByRobots(robots_body, &agents, target_url);
+extern "C" bool robots_allowed_by_robots_batch(
+    const char* robots_txt, size_t robots_txt_len,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* const* urls, const size_t* url_lens, size_t num_urls,
+    robots_match_result_t* results) {
+  if (!results) return false;
+  SetAllowed(results, num_urls);
+  if (!robots_txt || !user_agents || !urls) return false;
+
+  try {
+    std::vector<std::string> agents;
+    if (!CopyUserAgents(user_agents, user_agent_lens, num_user_agents,
+                        &agents)) {
+      return false;
+    }
+    std::vector<std::string_view> target_urls(num_urls);
+    for (size_t i = 0; i < num_urls; ++i) {
+      if (!urls[i]) return false;
+      target_urls[i] = url_lens ? std::string_view(urls[i], url_lens[i])
+                                : std::string_view(urls[i]);
+    }
+
+    const googlebot::CompiledRobots compiled(
+        std::string_view(robots_txt, robots_txt_len));
+    std::vector<googlebot::CompiledRobots::MatchResult> matches(num_urls);
+    compiled.MatchBatch(&agents, target_urls.data(), num_urls, matches.data());
+    for (size_t i = 0; i < num_urls; ++i) {
+      results[i].allowed = matches[i].allowed;
+      results[i].matching_line = matches[i].matching_line;
+    }
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+// =============================================================================
+// Compiled robots.txt
+// =============================================================================
+
+extern "C" robots_compiled_t* robots_compiled_create(const char* robots_txt,
+                                                     size_t robots_txt_len) {
+  if (!robots_txt) return nullptr;
+  try {
+    return new robots_compiled_t{googlebot::CompiledRobots(
+        std::string_view(robots_txt, robots_txt_len))};
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+extern "C" void robots_compiled_free(robots_compiled_t* compiled) {
+  delete compiled;
+}
+
+extern "C" size_t robots_compiled_memory_usage(
+    const robots_compiled_t* compiled) {
+  if (!compiled) return 0;
+  return compiled->robots.MemoryUsage();
+}
+
+extern "C" bool robots_compiled_allowed(
+    const robots_compiled_t* compiled,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* url, size_t url_len) {
+  if (!compiled || !user_agents || !url) {
+    return true;  // Allow on invalid input
+  }
+  try {
+    if (num_user_agents == 1 && user_agents[0]) {
+      const size_t len =
+          user_agent_lens ? user_agent_lens[0] : strlen(user_agents[0]);
+      return compiled->robots.OneAgentAllowed(
+          std::string_view(user_agents[0], len),
+          std::string_view(url, url_len));
+    }
+    std::vector<std::string> agents;
+    if (!CopyUserAgents(user_agents, user_agent_lens, num_user_agents,
+                        &agents)) {
+      return true;
+    }
+    return compiled->robots.Allowed(&agents, std::string_view(url, url_len));
+  } catch (...) {
+    return true;
+  }
+}
+
+extern "C" bool robots_compiled_match_batch(
+    const robots_compiled_t* compiled,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* urls, const size_t* url_offsets, size_t num_urls,
+    robots_match_result_t* results) {
+  if (!results) return false;
+  SetAllowed(results, num_urls);
+  if (!compiled || !user_agents || !url_offsets) return false;
+  if (!urls && url_offsets[num_urls] != 0) return false;
+
+  try {
+    std::vector<std::string> agents;
+    if (!CopyUserAgents(user_agents, user_agent_lens, num_user_agents,
+                        &agents)) {
+      return false;
+    }
+    std::vector<std::string_view> target_urls(num_urls);
+    for (size_t i = 0; i < num_urls; ++i) {
+      if (url_offsets[i + 1] < url_offsets[i]) return false;
+      target_urls[i] = std::string_view(urls + url_offsets[i],
+                                        url_offsets[i + 1] - url_offsets[i]);
+    }
+
+    std::vector<googlebot::CompiledRobots::MatchResult> matches(num_urls);
+    compiled->robots.MatchBatch(&agents, target_urls.data(), num_urls,
+                                matches.data());
+    for (size_t i = 0; i < num_urls; ++i) {
+      results[i].allowed = matches[i].allowed;
+      results[i].matching_line = matches[i].matching_line;
+    }
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+extern "C" bool robots_compiled_match_agents(
+    const robots_compiled_t* compiled,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* url, size_t url_len,
+    robots_agent_verdict_t* verdicts) {
+  if (!verdicts) return false;
+  for (size_t i = 0; i < num_user_agents; ++i) {
+    verdicts[i] = robots_agent_verdict_t();
+    verdicts[i].allowed = true;  // Allow on invalid input
+    verdicts[i].content_signal = {-1, -1, -1};
+  }
+  if (!compiled || !user_agents || !url) return false;
+
+  try {
+    std::vector<std::string_view> agents(num_user_agents);
+    for (size_t i = 0; i < num_user_agents; ++i) {
+      if (!user_agents[i]) return false;
+      const size_t len =
+          user_agent_lens ? user_agent_lens[i] : strlen(user_agents[i]);
+      agents[i] = std::string_view(user_agents[i], len);
+    }
+    std::vector<googlebot::CompiledRobots::AgentVerdict> answers(
+        num_user_agents);
+    compiled->robots.MatchAgents(agents.data(), num_user_agents,
+                                 std::string_view(url, url_len),
+                                 answers.data());
+    for (size_t i = 0; i < num_user_agents; ++i) {
+      const googlebot::CompiledRobots::AgentVerdict& answer = answers[i];
+      robots_agent_verdict_t& verdict = verdicts[i];
+      verdict.allowed = answer.match.allowed;
+      verdict.matching_line = answer.match.matching_line;
+      verdict.ever_seen_specific_agent = answer.match.ever_seen_specific_agent;
+      verdict.has_crawl_delay = answer.crawl_delay.has_value();
+      verdict.crawl_delay = answer.crawl_delay.value_or(0.0);
+      verdict.has_request_rate = answer.request_rate.has_value();
+      if (answer.request_rate.has_value()) {
+        verdict.request_rate.requests = answer.request_rate->requests;
+        verdict.request_rate.seconds = answer.request_rate->seconds;
+      }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+      verdict.has_content_signal = answer.content_signal.has_value();
+      verdict.content_signal = ToCContentSignal(answer.content_signal);
+#endif
+    }
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+extern "C" size_t robots_compiled_num_sitemaps(
+    const robots_compiled_t* compiled) {
+  if (!compiled) return 0;
+  return compiled->robots.num_sitemaps();
+}
+
+extern "C" const char* robots_compiled_sitemap(
+    const robots_compiled_t* compiled, size_t index, size_t* len) {
+  if (!compiled || !len || index >= compiled->robots.num_sitemaps()) {
+    return nullptr;
+  }
+  const std::string_view sitemap = compiled->robots.sitemap(index);
+  *len = sitemap.size();
+  return sitemap.data();
 }
 
 // =============================================================================
@@ -106,6 +369,21 @@ extern "C" bool robots_ever_seen_specific_agent(const robots_matcher_t* matcher)
   return matcher->matcher.ever_seen_specific_agent();
 }
 
+extern "C" size_t robots_num_sitemaps(const robots_matcher_t* matcher) {
+  if (!matcher) return 0;
+  return matcher->matcher.sitemaps().size();
+}
+
+extern "C" const char* robots_get_sitemap(const robots_matcher_t* matcher,
+                                          size_t index, size_t* len) {
+  if (!matcher || !len || index >= matcher->matcher.sitemaps().size()) {
+    return nullptr;
+  }
+  const std::string_view sitemap = matcher->matcher.sitemaps()[index];
+  *len = sitemap.size();
+  return sitemap.data();
+}
+
 // =============================================================================
 // Crawl-delay support
 // =============================================================================
@@ -168,16 +446,7 @@ extern "C" bool robots_get_content_signal(const robots_matcher_t* matcher,
   if (!matcher || !signal) return false;
   auto opt_signal = matcher->matcher.GetContentSignal();
   if (!opt_signal.has_value()) return false;
-
-  signal->ai_train = opt_signal->ai_train.has_value()
-                         ? (opt_signal->ai_train.value() ? 1 : 0)
-                         : -1;
-  signal->ai_input = opt_signal->ai_input.has_value()
-                         ? (opt_signal->ai_input.value() ? 1 : 0)
-                         : -1;
-  signal->search = opt_signal->search.has_value()
-                       ? (opt_signal->search.value() ? 1 : 0)
-                       : -1;
+  *signal = ToCContentSignal(opt_signal);
   return true;
 #else
   (void)matcher;
@@ -222,6 +491,146 @@ extern "C" bool robots_allows_search(const robots_matcher_t* matcher) {
 #endif
 }
 
+// =============================================================================
+// Per-host cache
+// =============================================================================
+
+namespace {
+googlebot::RobotsCache::Options CacheOptions(size_t max_bytes,
+                                             size_t num_shards) {
+  googlebot::RobotsCache::Options options;
+  if (max_bytes != 0) options.max_bytes = max_bytes;
+  if (num_shards != 0) options.num_shards = num_shards;
+  return options;
+}
+
+// Thrown through RobotsCache::GetOrCompile() when a fetch callback fails.
+struct FetchFailed {};
+}  // namespace
+
+extern "C" robots_cache_t* robots_cache_create(size_t max_bytes,
+                                               size_t num_shards) {
+  try {
+    return new robots_cache_t{
+        new googlebot::RobotsCache(CacheOptions(max_bytes, num_shards)), true};
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+extern "C" void robots_cache_free(robots_cache_t* cache) {
+  if (!cache || !cache->owned) return;
+  delete cache->cache;
+  delete cache;
+}
+
+extern "C" bool robots_cache_init_shared(size_t max_bytes, size_t num_shards) {
+  return googlebot::RobotsCache::InitShared(
+      CacheOptions(max_bytes, num_shards));
+}
+
+extern "C" robots_cache_t* robots_cache_shared(void) {
+  static robots_cache_t shared{&googlebot::RobotsCache::Shared(), false};
+  return &shared;
+}
+
+extern "C" bool robots_cache_insert(robots_cache_t* cache,
+                                    const char* host, size_t host_len,
+                                    const char* robots_txt,
+                                    size_t robots_txt_len,
+                                    int64_t ttl_seconds) {
+  if (!cache || !host || !robots_txt) return false;
+  try {
+    const std::string_view key(host, host_len);
+    const std::string_view body(robots_txt, robots_txt_len);
+    if (ttl_seconds > 0) {
+      cache->cache->Insert(key, body, std::chrono::seconds(ttl_seconds));
+    } else {
+      cache->cache->Insert(key, body);
+    }
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+extern "C" bool robots_cache_fetch(robots_cache_t* cache,
+                                   const char* host, size_t host_len,
+                                   robots_cache_fetch_fn fetch,
+                                   void* user_data, int64_t ttl_seconds) {
+  if (!cache || !host || !fetch) return false;
+  try {
+    const std::string_view key(host, host_len);
+    const std::function<std::string()> fetch_body = [&]() {
+      robots_cache_body_t body;
+      if (!fetch(user_data, host, host_len, &body)) throw FetchFailed();
+      return std::move(body.data);
+    };
+    if (ttl_seconds > 0) {
+      cache->cache->GetOrCompile(key, fetch_body,
+                                 std::chrono::seconds(ttl_seconds));
+    } else {
+      cache->cache->GetOrCompile(key, fetch_body);
+    }
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+extern "C" void robots_cache_body_set(robots_cache_body_t* body,
+                                      const char* data, size_t len) {
+  if (!body) return;
+  if (!data) len = 0;
+  body->data.assign(data ? data : "", len);
+}
+
+extern "C" int robots_cache_allowed(robots_cache_t* cache,
+                                    const char* host, size_t host_len,
+                                    const char* user_agent,
+                                    size_t user_agent_len,
+                                    const char* url, size_t url_len) {
+  if (!cache || !host || !user_agent || !url) return -1;
+  try {
+    const googlebot::RobotsCache::Entry robots =
+        cache->cache->Lookup(std::string_view(host, host_len));
+    if (!robots) return -1;
+    return robots->OneAgentAllowed(std::string_view(user_agent, user_agent_len),
+                                   std::string_view(url, url_len))
+               ? 1
+               : 0;
+  } catch (...) {
+    return -1;
+  }
+}
+
+extern "C" void robots_cache_erase(robots_cache_t* cache,
+                                   const char* host, size_t host_len) {
+  if (!cache || !host) return;
+  cache->cache->Erase(std::string_view(host, host_len));
+}
+
+extern "C" void robots_cache_clear(robots_cache_t* cache) {
+  if (!cache) return;
+  cache->cache->Clear();
+}
+
+extern "C" bool robots_cache_get_stats(const robots_cache_t* cache,
+                                       robots_cache_stats_t* stats) {
+  if (!cache || !stats) return false;
+  const googlebot::RobotsCache::Stats s = cache->cache->GetStats();
+  stats->hits = s.hits;
+  stats->misses = s.misses;
+  stats->evictions = s.evictions;
+  stats->expirations = s.expirations;
+  stats->compilations = s.compilations;
+  stats->interned = s.interned;
+  stats->entries = s.entries;
+  stats->unique_robots = s.unique_robots;
+  stats->bytes = s.bytes;
+  return true;
+}
+
 // =============================================================================
 // Utility functions
 // =============================================================================
@@ -235,3 +644,33 @@ extern "C" bool robots_is_valid_user_agent(const char* user_agent, size_t len) {
 extern "C" const char* robots_version(void) {
   return ROBOTS_VERSION;
 }
+
+// =============================================================================
+// Work counters
+// =============================================================================
+
+extern "C" bool robots_stats_enabled(void) {
+  return googlebot::kRobotsStatsEnabled;
+}
+
+extern "C" bool robots_get_stats(robots_stats_t* stats) {
+  if (!stats) return false;
+  const googlebot::RobotsStats s = googlebot::GetRobotsStats();
+  stats->bytes = s.bytes;
+  stats->lines = s.lines;
+  stats->directives = s.directives;
+  stats->urls = s.urls;
+  stats->patterns_evaluated = s.patterns_evaluated;
+  stats->wildcard_expansions = s.wildcard_expansions;
+  stats->match_steps = s.match_steps;
+  stats->max_match_steps = s.max_match_steps;
+  stats->url_ns = s.url_ns;
+  stats->parse_ns = s.parse_ns;
+  stats->classify_ns = s.classify_ns;
+  stats->match_ns = s.match_ns;
+  return true;
+}
+
+extern "C" void robots_reset_stats(void) {
+  googlebot::ResetRobotsStats();
+}
@@ -71,6 +71,59 @@ typedef struct {
   int seconds;   // Time period in seconds
 } robots_request_rate_t;
 
+// Result of checking one URL, see robots_allowed_by_robots_batch().
+typedef struct {
+  bool allowed;       // Whether the URL may be fetched
+  int matching_line;  // Line of the rule that decided, or 0 if none matched
+} robots_match_result_t;
+
+// Opaque pointer to a compiled robots.txt, see robots_compiled_create().
+typedef struct robots_compiled_s robots_compiled_t;
+
+// Opaque pointer to a per-host cache of compiled robots.txt files.
+typedef struct robots_cache_s robots_cache_t;
+
+// Receives a robots.txt body in a robots_cache_fetch_fn.
+typedef struct robots_cache_body_s robots_cache_body_t;
+
+// Counters of a robots_cache_t.
+typedef struct {
+  uint64_t hits;          // Lookups that found a live entry
+  uint64_t misses;        // Lookups that didn't, including expired entries
+  uint64_t evictions;     // Entries dropped to stay within the memory budget
+  uint64_t expirations;   // Entries dropped because their TTL passed
+  uint64_t compilations;  // robots.txt bodies compiled
+  uint64_t interned;      // Bodies shared with another host instead
+  uint64_t entries;       // Entries in the cache
+  uint64_t unique_robots; // Distinct compiled robots.txt held by the entries
+  uint64_t bytes;         // Estimated memory held by the entries
+} robots_cache_stats_t;
+
+// Fetches the robots.txt of 'host' for robots_cache_fetch(). Stores the body
+// with robots_cache_body_set() and returns true, or returns false if the
+// robots.txt could not be fetched.
+typedef bool (*robots_cache_fetch_fn)(void* user_data,
+                                      const char* host, size_t host_len,
+                                      robots_cache_body_t* body);
+
+// Work counters of the calling thread, see robots_get_stats(). The *_ns
+// fields are nanoseconds; url_ns and classify_ns are included in the phase
+// that runs them.
+typedef struct {
+  uint64_t bytes;                // robots.txt bytes parsed
+  uint64_t lines;                // Lines parsed
+  uint64_t directives;           // Lines with a key, known or not
+  uint64_t urls;                 // URLs split into their path
+  uint64_t patterns_evaluated;   // Patterns matched against a path
+  uint64_t wildcard_expansions;  // Positions a '*' made a pattern try
+  uint64_t match_steps;          // Positions examined by all matches
+  uint64_t max_match_steps;      // Positions examined by the worst match
+  uint64_t url_ns;               // Extracting paths from URLs
+  uint64_t parse_ns;             // Parsing robots.txt
+  uint64_t classify_ns;          // Classifying directive keys
+  uint64_t match_ns;             // Matching paths against patterns
+} robots_stats_t;
+
 // Content-Signal values for AI content preferences.
 // Each field uses a tri-state: -1 = not set, 0 = no, 1 = yes.
 typedef struct {
@@ -79,6 +132,21 @@ typedef struct {
   int8_t search;    // search: Building search indexes and providing results
 } robots_content_signal_t;
 
+// Answers for one user-agent, see robots_compiled_match_agents(). The values
+// are those the robots_get_*() accessors return after checking that agent
+// alone.
+typedef struct {
+  bool allowed;                           // Whether the URL may be fetched
+  int matching_line;                      // Line that decided, or 0 if none
+  bool ever_seen_specific_agent;          // The file has a group for the agent
+  bool has_crawl_delay;                   // Whether crawl_delay is set
+  double crawl_delay;                     // Crawl-delay in seconds
+  bool has_request_rate;                  // Whether request_rate is set
+  robots_request_rate_t request_rate;     // Request-rate
+  bool has_content_signal;                // Whether content_signal is set
+  robots_content_signal_t content_signal; // Content-Signal values
+} robots_agent_verdict_t;
+
 // =============================================================================
 // Matcher lifecycle
 // =============================================================================
@@ -92,6 +160,12 @@ ROBOTS_API robots_matcher_t* robots_matcher_create(void);
 // Safe to call with NULL.
 ROBOTS_API void robots_matcher_free(robots_matcher_t* matcher);
 
+// Sets whether the checks of 'matcher' collect the Sitemap lines of the
+// robots.txt, for robots_num_sitemaps() and robots_get_sitemap(). Off by
+// default, so that checks make no allocation for them.
+ROBOTS_API void robots_matcher_set_collect_sitemaps(robots_matcher_t* matcher,
+                                                    bool collect);
+
 // =============================================================================
 // URL checking
 // =============================================================================
@@ -135,6 +209,114 @@ ROBOTS_API bool robots_allowed_by_robots_multi(
     size_t num_user_agents,
     const char* url, size_t url_len);
 
+// Checks many URLs against one robots.txt for the same user-agents. The
+// robots.txt is parsed once and URLs with the same path are matched once, so
+// this is much cheaper than calling robots_allowed_by_robots() per URL.
+// Does not need a matcher instance and can be called from any thread.
+//
+// Parameters:
+//   robots_txt:       robots.txt content
+//   robots_txt_len:   length of robots_txt
+//   user_agents:      array of user-agent strings
+//   user_agent_lens:  array of user-agent string lengths, or NULL if the
+//                     strings are null-terminated
+//   num_user_agents:  number of user-agents
+//   urls:             array of URLs (must be %-encoded per RFC3986)
+//   url_lens:         array of URL lengths, or NULL if null-terminated
+//   num_urls:         number of URLs
+//   results:          array of num_urls results; results[i] is for urls[i]
+//
+// Returns false on invalid input, in which case all URLs are reported as
+// allowed.
+ROBOTS_API bool robots_allowed_by_robots_batch(
+    const char* robots_txt, size_t robots_txt_len,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* const* urls, const size_t* url_lens, size_t num_urls,
+    robots_match_result_t* results);
+
+// =============================================================================
+// Compiled robots.txt
+// =============================================================================
+//
+// A robots_compiled_t holds a robots.txt in compiled form, so that it crosses
+// the API once and is not parsed again for every check. It is immutable: all
+// functions taking a const robots_compiled_t* can be called from any thread.
+
+// Compiles 'robots_txt'. Returns NULL on invalid input or allocation failure.
+// Caller must free with robots_compiled_free().
+ROBOTS_API robots_compiled_t* robots_compiled_create(const char* robots_txt,
+                                                     size_t robots_txt_len);
+
+// Frees a compiled robots.txt. Safe to call with NULL.
+ROBOTS_API void robots_compiled_free(robots_compiled_t* compiled);
+
+// Returns the approximate number of bytes held by 'compiled'.
+ROBOTS_API size_t robots_compiled_memory_usage(
+    const robots_compiled_t* compiled);
+
+// Checks if a URL is allowed for the combined rules of the user-agents, like
+// robots_allowed_by_robots_multi(). 'user_agent_lens' may be NULL if the
+// strings are null-terminated.
+//
+// Returns true if the URL is allowed, false if disallowed.
+ROBOTS_API bool robots_compiled_allowed(
+    const robots_compiled_t* compiled,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* url, size_t url_len);
+
+// Checks many URLs for the same user-agents. The URLs are passed in a single
+// buffer: URL i is urls[url_offsets[i]] up to urls[url_offsets[i + 1]], so
+// 'url_offsets' has num_urls + 1 non-decreasing entries. The rules are
+// resolved for the user-agents once and URLs with the same path are matched
+// once, see robots_allowed_by_robots_batch().
+//
+// Parameters:
+//   compiled:         compiled robots.txt
+//   user_agents:      array of user-agent strings
+//   user_agent_lens:  array of user-agent string lengths, or NULL if the
+//                     strings are null-terminated
+//   num_user_agents:  number of user-agents
+//   urls:             buffer of all URLs (must be %-encoded per RFC3986)
+//   url_offsets:      array of num_urls + 1 offsets into 'urls'
+//   num_urls:         number of URLs
+//   results:          array of num_urls results; results[i] is for URL i
+//
+// Returns false on invalid input, in which case all URLs are reported as
+// allowed.
+ROBOTS_API bool robots_compiled_match_batch(
+    const robots_compiled_t* compiled,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* urls, const size_t* url_offsets, size_t num_urls,
+    robots_match_result_t* results);
+
+// Checks a URL for each of the user-agents on its own, not for their combined
+// rules, in a single lookup, and fills verdicts[i] for user_agents[i]. This
+// costs about as much as checking one agent. 'user_agent_lens' may be NULL if
+// the strings are null-terminated.
+//
+// Returns false on invalid input, in which case all agents are reported as
+// allowed with no other values.
+ROBOTS_API bool robots_compiled_match_agents(
+    const robots_compiled_t* compiled,
+    const char* const* user_agents, const size_t* user_agent_lens,
+    size_t num_user_agents,
+    const char* url, size_t url_len,
+    robots_agent_verdict_t* verdicts);
+
+// Returns the number of non-empty Sitemap lines of 'compiled'.
+ROBOTS_API size_t robots_compiled_num_sitemaps(
+    const robots_compiled_t* compiled);
+
+// Returns the value of the Sitemap line 'index' of 'compiled', in file order,
+// and stores its length in '*len'. The value points into 'compiled' and is not
+// null-terminated. Returns NULL if 'index' is out of range or on invalid
+// input.
+ROBOTS_API const char* robots_compiled_sitemap(
+    const robots_compiled_t* compiled, size_t index, size_t* len);
+
 // =============================================================================
 // Matcher state accessors (call after robots_allowed_by_robots)
 // =============================================================================
@@ -145,6 +327,20 @@ ROBOTS_API int robots_matching_line(const robots_matcher_t* matcher);
 // Returns true if a specific user-agent block was found (not just '*').
 ROBOTS_API bool robots_ever_seen_specific_agent(const robots_matcher_t* matcher);
 
+// Returns the number of non-empty Sitemap lines of the robots.txt of the last
+// check, or 0 unless the matcher collects them, see
+// robots_matcher_set_collect_sitemaps(). Sitemap lines apply whatever the
+// user-agents, and are collected in the same pass as the check.
+ROBOTS_API size_t robots_num_sitemaps(const robots_matcher_t* matcher);
+
+// Returns the value of the Sitemap line 'index' of the last check, in file
+// order, and stores its length in '*len'. The value points into the
+// robots_txt passed to that check, which must still be valid, and is not
+// null-terminated. Returns NULL if 'index' is out of range or on invalid
+// input.
+ROBOTS_API const char* robots_get_sitemap(const robots_matcher_t* matcher,
+                                          size_t index, size_t* len);
+
 // =============================================================================
 // Crawl-delay support (non-standard directive)
 // =============================================================================
@@ -189,6 +385,71 @@ ROBOTS_API bool robots_allows_ai_train(const robots_matcher_t* matcher);
 ROBOTS_API bool robots_allows_ai_input(const robots_matcher_t* matcher);
 ROBOTS_API bool robots_allows_search(const robots_matcher_t* matcher);
 
+// =============================================================================
+// Per-host cache
+// =============================================================================
+//
+// A thread-safe cache mapping hosts (any key, e.g. "https://example.com") to
+// compiled robots.txt files, bounded in memory with LRU eviction and with a
+// time to live per entry. All functions can be called from any thread.
+
+// Creates a cache. Pass 0 for the default memory budget (1 GiB) or number of
+// shards (64). Free with robots_cache_free().
+ROBOTS_API robots_cache_t* robots_cache_create(size_t max_bytes,
+                                               size_t num_shards);
+
+// Frees a cache from robots_cache_create(). Does nothing for the shared cache.
+ROBOTS_API void robots_cache_free(robots_cache_t* cache);
+
+// Sets the memory budget and number of shards of the shared cache (0 for the
+// default). Returns false if the shared cache is already in use.
+ROBOTS_API bool robots_cache_init_shared(size_t max_bytes, size_t num_shards);
+
+// Returns the process-wide cache, which is shared with the C++ API
+// (RobotsCache::Shared()) and all language bindings in the process.
+ROBOTS_API robots_cache_t* robots_cache_shared(void);
+
+// Compiles 'robots_txt' and stores it for 'host', replacing any previous
+// entry. 'ttl_seconds' is the time to live, or 0 for the default of the
+// cache (24 hours).
+// Returns false on invalid input.
+ROBOTS_API bool robots_cache_insert(robots_cache_t* cache,
+                                    const char* host, size_t host_len,
+                                    const char* robots_txt,
+                                    size_t robots_txt_len,
+                                    int64_t ttl_seconds);
+
+// Makes sure 'host' is cached, calling 'fetch' for its robots.txt if it is
+// not. Concurrent calls for the same host fetch and compile only once.
+// Returns false if the fetch failed or on invalid input.
+ROBOTS_API bool robots_cache_fetch(robots_cache_t* cache,
+                                   const char* host, size_t host_len,
+                                   robots_cache_fetch_fn fetch,
+                                   void* user_data, int64_t ttl_seconds);
+
+// Stores a robots.txt body in a robots_cache_fetch_fn. The data is copied.
+ROBOTS_API void robots_cache_body_set(robots_cache_body_t* body,
+                                      const char* data, size_t len);
+
+// Checks 'url' against the cached robots.txt of 'host'. Returns 1 if allowed,
+// 0 if disallowed, and -1 if 'host' is not cached (or on invalid input).
+ROBOTS_API int robots_cache_allowed(robots_cache_t* cache,
+                                    const char* host, size_t host_len,
+                                    const char* user_agent,
+                                    size_t user_agent_len,
+                                    const char* url, size_t url_len);
+
+// Removes 'host' from the cache.
+ROBOTS_API void robots_cache_erase(robots_cache_t* cache,
+                                   const char* host, size_t host_len);
+
+// Removes all entries from the cache. Counters are kept.
+ROBOTS_API void robots_cache_clear(robots_cache_t* cache);
+
+// Fills 'stats' with the counters of 'cache'. Returns false on invalid input.
+ROBOTS_API bool robots_cache_get_stats(const robots_cache_t* cache,
+                                       robots_cache_stats_t* stats);
+
 // =============================================================================
 // Utility functions
 // =============================================================================
@@ -199,6 +460,22 @@ ROBOTS_API bool robots_is_valid_user_agent(const char* user_agent, size_t len);
 // Returns the library version string.
 ROBOTS_API const char* robots_version(void);
 
+// =============================================================================
+// Work counters
+// =============================================================================
+// The library counts its work only when built with ROBOTS_ENABLE_STATS=1.
+// Otherwise the counters stay zero and cost nothing.
+
+// Returns true if the library was built with ROBOTS_ENABLE_STATS=1.
+ROBOTS_API bool robots_stats_enabled(void);
+
+// Fills 'stats' with the counters of the calling thread since it started or
+// last called robots_reset_stats(). Returns false on invalid input.
+ROBOTS_API bool robots_get_stats(robots_stats_t* stats);
+
+// Zeroes the counters of the calling thread.
+ROBOTS_API void robots_reset_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@ package robotstxt
 import "C"
 import (
 	"runtime"
+	"time"
 	"unsafe"
 )
 
@@ -48,6 +49,12 @@ type ContentSignal struct {
 	Search  *bool
 }
 
+// MatchResult is the result of checking one URL with an IsAllowedBatch method.
+type MatchResult struct {
+	Allowed      bool
+	MatchingLine int // Line of the rule that decided, or 0 if none matched
+}
+
 // Matcher is a robots.txt matcher that checks if URLs are allowed for given user-agents.
 type Matcher struct {
 	ptr *C.struct_robots_matcher_s
@@ -112,6 +119,75 @@ func (m *Matcher) IsAllowedMulti(robotsTxt string, userAgents []string, url stri
 	))
 }
 
+// IsAllowedBatch checks many URLs against one robots.txt in a single call.
+// The rules of all given user-agents are combined, like in IsAllowedMulti.
+// The robots.txt is parsed once and all URLs are passed to C together, which is
+// much faster than calling IsAllowed for each URL. The matcher state
+// (MatchingLine, CrawlDelay, ...) is not changed.
+func (m *Matcher) IsAllowedBatch(robotsTxt string, userAgents []string, urls []string) []MatchResult {
+	results := make([]MatchResult, len(urls))
+	if len(urls) == 0 {
+		return results
+	}
+
+	cRobots := C.CString(robotsTxt)
+	defer C.free(unsafe.Pointer(cRobots))
+	cUAs, cUALens, freeUAs := cStringArray(userAgents)
+	defer freeUAs()
+	cURLs, cURLLens, freeURLs := cStringArray(urls)
+	defer freeURLs()
+
+	cResults := (*C.robots_match_result_t)(C.malloc(
+		C.size_t(len(urls)) * C.size_t(unsafe.Sizeof(C.robots_match_result_t{}))))
+	defer C.free(unsafe.Pointer(cResults))
+
+	C.robots_allowed_by_robots_batch(
+		cRobots, C.size_t(len(robotsTxt)),
+		cUAs, cUALens, C.size_t(len(userAgents)),
+		cURLs, cURLLens, C.size_t(len(urls)),
+		cResults,
+	)
+	for i, r := range unsafe.Slice(cResults, len(urls)) {
+		results[i] = MatchResult{
+			Allowed:      bool(r.allowed),
+			MatchingLine: int(r.matching_line),
+		}
+	}
+	return results
+}
+
+// cStringArray copies strs into a single C buffer and returns C arrays with
+// the address and the length of each string, and a function that frees them.
+func cStringArray(strs []string) (**C.char, *C.size_t, func()) {
+	total := 0
+	for _, s := range strs {
+		total += len(s)
+	}
+	n := len(strs)
+	if n == 0 {
+		n = 1 // Never pass NULL arrays.
+	}
+	buf := (*C.char)(C.malloc(C.size_t(total + 1)))
+	ptrs := (**C.char)(C.malloc(C.size_t(n) * C.size_t(unsafe.Sizeof(buf))))
+	lens := (*C.size_t)(C.malloc(C.size_t(n) * C.size_t(unsafe.Sizeof(C.size_t(0)))))
+
+	bufSlice := unsafe.Slice((*byte)(unsafe.Pointer(buf)), total+1)
+	ptrSlice := unsafe.Slice(ptrs, n)
+	lenSlice := unsafe.Slice(lens, n)
+	offset := 0
+	for i, s := range strs {
+		copy(bufSlice[offset:], s)
+		ptrSlice[i] = (*C.char)(unsafe.Pointer(&bufSlice[offset]))
+		lenSlice[i] = C.size_t(len(s))
+		offset += len(s)
+	}
+	return ptrs, lens, func() {
+		C.free(unsafe.Pointer(buf))
+		C.free(unsafe.Pointer(ptrs))
+		C.free(unsafe.Pointer(lens))
+	}
+}
+
 // MatchingLine returns the line number that matched, or 0 if no match.
 func (m *Matcher) MatchingLine() int {
 	return int(C.robots_matching_line(m.ptr))
@@ -187,3 +263,252 @@ func (m *Matcher) AllowsAIInput() bool {
 func (m *Matcher) AllowsSearch() bool {
 	return bool(C.robots_allows_search(m.ptr))
 }
+
+// Compiled is a robots.txt compiled once and checked against any number of
+// URLs, so that checks only pass the user-agents and URLs to C. It is
+// immutable and can be used from several goroutines.
+type Compiled struct {
+	ptr *C.struct_robots_compiled_s
+}
+
+// Compile compiles robotsTxt. Returns nil on allocation failure.
+// The caller must call Free() when done.
+func Compile(robotsTxt string) *Compiled {
+	cRobots := C.CString(robotsTxt)
+	defer C.free(unsafe.Pointer(cRobots))
+
+	ptr := C.robots_compiled_create(cRobots, C.size_t(len(robotsTxt)))
+	if ptr == nil {
+		return nil
+	}
+	c := &Compiled{ptr: ptr}
+	runtime.SetFinalizer(c, (*Compiled).Free)
+	return c
+}
+
+// Free releases the compiled robots.txt.
+func (c *Compiled) Free() {
+	if c.ptr != nil {
+		C.robots_compiled_free(c.ptr)
+		c.ptr = nil
+	}
+}
+
+// MemoryUsage returns the approximate number of bytes held by c.
+func (c *Compiled) MemoryUsage() int {
+	defer runtime.KeepAlive(c)
+	return int(C.robots_compiled_memory_usage(c.ptr))
+}
+
+// Sitemaps returns the sitemap URLs of the robots.txt, in file order.
+func (c *Compiled) Sitemaps() []string {
+	defer runtime.KeepAlive(c)
+	n := int(C.robots_compiled_num_sitemaps(c.ptr))
+	sitemaps := make([]string, 0, n)
+	for i := 0; i < n; i++ {
+		var length C.size_t
+		data := C.robots_compiled_sitemap(c.ptr, C.size_t(i), &length)
+		sitemaps = append(sitemaps, C.GoStringN(data, C.int(length)))
+	}
+	return sitemaps
+}
+
+// IsAllowed checks if a URL is allowed for the combined rules of userAgents.
+func (c *Compiled) IsAllowed(userAgents []string, url string) bool {
+	defer runtime.KeepAlive(c)
+	cUAs, cUALens, freeUAs := cStringArray(userAgents)
+	defer freeUAs()
+	cURL := C.CString(url)
+	defer C.free(unsafe.Pointer(cURL))
+
+	return bool(C.robots_compiled_allowed(
+		c.ptr,
+		cUAs, cUALens, C.size_t(len(userAgents)),
+		cURL, C.size_t(len(url)),
+	))
+}
+
+// IsAllowedBatch checks many URLs for the combined rules of userAgents in a
+// single call.
+func (c *Compiled) IsAllowedBatch(userAgents []string, urls []string) []MatchResult {
+	buf, offsets := PackURLs(urls)
+	return c.IsAllowedBuffer(userAgents, buf, offsets)
+}
+
+// IsAllowedBuffer checks the URLs packed in buf: URL i is
+// buf[offsets[i]:offsets[i+1]], so offsets has one more entry than there are
+// URLs, see PackURLs. buf is passed to C without a copy. Returns nil if the
+// offsets are out of order or exceed buf.
+func (c *Compiled) IsAllowedBuffer(userAgents []string, buf []byte, offsets []uint) []MatchResult {
+	defer runtime.KeepAlive(c)
+	if len(offsets) == 0 || offsets[len(offsets)-1] > uint(len(buf)) {
+		return nil
+	}
+	numURLs := len(offsets) - 1
+	results := make([]MatchResult, numURLs)
+	if numURLs == 0 {
+		return results
+	}
+
+	cUAs, cUALens, freeUAs := cStringArray(userAgents)
+	defer freeUAs()
+	var cBuf *C.char
+	if len(buf) > 0 {
+		cBuf = (*C.char)(unsafe.Pointer(&buf[0]))
+	}
+	// uint has the size of size_t on all platforms supported by cgo.
+	cOffsets := (*C.size_t)(unsafe.Pointer(&offsets[0]))
+	cResults := make([]C.robots_match_result_t, numURLs)
+
+	if !C.robots_compiled_match_batch(
+		c.ptr,
+		cUAs, cUALens, C.size_t(len(userAgents)),
+		cBuf, cOffsets, C.size_t(numURLs),
+		&cResults[0],
+	) {
+		return nil
+	}
+	for i, r := range cResults {
+		results[i] = MatchResult{
+			Allowed:      bool(r.allowed),
+			MatchingLine: int(r.matching_line),
+		}
+	}
+	return results
+}
+
+// PackURLs packs urls into one buffer and returns it with the offsets of the
+// URLs for IsAllowedBuffer.
+func PackURLs(urls []string) ([]byte, []uint) {
+	total := 0
+	for _, url := range urls {
+		total += len(url)
+	}
+	buf := make([]byte, 0, total)
+	offsets := make([]uint, 1, len(urls)+1)
+	for _, url := range urls {
+		buf = append(buf, url...)
+		offsets = append(offsets, uint(len(buf)))
+	}
+	return buf, offsets
+}
+
+// CacheStats holds the counters of a Cache.
+type CacheStats struct {
+	Hits         uint64
+	Misses       uint64 // Lookups that found no live entry, including expired ones
+	Evictions    uint64 // Entries dropped to stay within the memory budget
+	Expirations  uint64 // Entries dropped because their TTL passed
+	Compilations uint64
+	Interned     uint64 // Bodies shared with another host instead of compiled again
+	Entries      uint64
+	UniqueRobots uint64 // Distinct compiled robots.txt held by the entries
+	Bytes        uint64
+}
+
+// Cache is a thread-safe, memory-bounded cache of compiled robots.txt files
+// keyed by host. SharedCache returns the process-wide cache, which is shared
+// with the C API and the other bindings loaded in the process.
+type Cache struct {
+	ptr *C.struct_robots_cache_s
+}
+
+// NewCache creates a private cache. Zero selects the defaults (1 GiB, 64 shards).
+// The caller must call Free() when done.
+func NewCache(maxBytes, numShards int) *Cache {
+	c := &Cache{
+		ptr: C.robots_cache_create(C.size_t(maxBytes), C.size_t(numShards)),
+	}
+	runtime.SetFinalizer(c, (*Cache).Free)
+	return c
+}
+
+// SharedCache returns the process-wide cache. Freeing it is a no-op.
+func SharedCache() *Cache {
+	return &Cache{ptr: C.robots_cache_shared()}
+}
+
+// InitSharedCache configures the shared cache before its first use.
+// Returns false if it is already in use.
+func InitSharedCache(maxBytes, numShards int) bool {
+	return bool(C.robots_cache_init_shared(C.size_t(maxBytes), C.size_t(numShards)))
+}
+
+// Free releases the cache resources.
+func (c *Cache) Free() {
+	if c.ptr != nil {
+		C.robots_cache_free(c.ptr)
+		c.ptr = nil
+	}
+}
+
+// Insert compiles robotsTxt and caches it for host for ttl (zero: 24 hours).
+func (c *Cache) Insert(host, robotsTxt string, ttl time.Duration) bool {
+	defer runtime.KeepAlive(c)
+	cHost := C.CString(host)
+	defer C.free(unsafe.Pointer(cHost))
+	cRobots := C.CString(robotsTxt)
+	defer C.free(unsafe.Pointer(cRobots))
+
+	return bool(C.robots_cache_insert(
+		c.ptr,
+		cHost, C.size_t(len(host)),
+		cRobots, C.size_t(len(robotsTxt)),
+		C.int64_t(ttl/time.Second),
+	))
+}
+
+// IsAllowed checks url against the cached robots.txt of host.
+// ok is false if host is not cached.
+func (c *Cache) IsAllowed(host, userAgent, url string) (allowed, ok bool) {
+	defer runtime.KeepAlive(c)
+	cHost := C.CString(host)
+	defer C.free(unsafe.Pointer(cHost))
+	cUA := C.CString(userAgent)
+	defer C.free(unsafe.Pointer(cUA))
+	cURL := C.CString(url)
+	defer C.free(unsafe.Pointer(cURL))
+
+	result := C.robots_cache_allowed(
+		c.ptr,
+		cHost, C.size_t(len(host)),
+		cUA, C.size_t(len(userAgent)),
+		cURL, C.size_t(len(url)),
+	)
+	if result < 0 {
+		return false, false
+	}
+	return result == 1, true
+}
+
+// Erase removes host from the cache.
+func (c *Cache) Erase(host string) {
+	defer runtime.KeepAlive(c)
+	cHost := C.CString(host)
+	defer C.free(unsafe.Pointer(cHost))
+	C.robots_cache_erase(c.ptr, cHost, C.size_t(len(host)))
+}
+
+// Clear removes all entries. Counters are kept.
+func (c *Cache) Clear() {
+	defer runtime.KeepAlive(c)
+	C.robots_cache_clear(c.ptr)
+}
+
+// Stats returns the hit, miss, eviction and size counters.
+func (c *Cache) Stats() CacheStats {
+	defer runtime.KeepAlive(c)
+	var stats C.robots_cache_stats_t
+	C.robots_cache_get_stats(c.ptr, &stats)
+	return CacheStats{
+		Hits:         uint64(stats.hits),
+		Misses:       uint64(stats.misses),
+		Evictions:    uint64(stats.evictions),
+		Expirations:  uint64(stats.expirations),
+		Compilations: uint64(stats.compilations),
+		Interned:     uint64(stats.interned),
+		Entries:      uint64(stats.entries),
+		UniqueRobots: uint64(stats.unique_robots),
+		Bytes:        uint64(stats.bytes),
+	}
+}
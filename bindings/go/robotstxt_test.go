@@ -2,6 +2,7 @@ package robotstxt
 
 import (
 	"testing"
+	"time"
 )
 
 func TestVersion(t *testing.T) {
@@ -133,3 +134,162 @@ func TestContentSignal(t *testing.T) {
 		t.Error("Expected ai-input to be unset")
 	}
 }
+
+func TestIsAllowedBatch(t *testing.T) {
+	m := NewMatcher()
+	defer m.Free()
+
+	robotsTxt := "User-agent: *\nDisallow: /admin/\nAllow: /admin/public/\n"
+	urls := []string{
+		"https://example.com/page",
+		"https://example.com/admin/secret",
+		"https://example.com/admin/public/x",
+		"https://example.com/admin/secret",
+	}
+	expected := []MatchResult{{true, 0}, {false, 2}, {true, 3}, {false, 2}}
+
+	results := m.IsAllowedBatch(robotsTxt, []string{"Googlebot"}, urls)
+	if len(results) != len(urls) {
+		t.Fatalf("Expected %d results, got %d", len(urls), len(results))
+	}
+	for i, url := range urls {
+		if results[i] != expected[i] {
+			t.Errorf("%s: expected %+v, got %+v", url, expected[i], results[i])
+		}
+		if results[i].Allowed != m.IsAllowed(robotsTxt, "Googlebot", url) {
+			t.Errorf("%s: batch and single check disagree", url)
+		}
+	}
+
+	if len(m.IsAllowedBatch(robotsTxt, nil, nil)) != 0 {
+		t.Error("Expected no results for no URLs")
+	}
+}
+
+func TestCompiled(t *testing.T) {
+	robotsTxt := "User-agent: *\nDisallow: /admin/\nAllow: /admin/public/\n\n" +
+		"User-agent: Bingbot\nDisallow: /\n"
+	c := Compile(robotsTxt)
+	defer c.Free()
+	if c.MemoryUsage() <= 0 {
+		t.Error("Expected a positive memory usage")
+	}
+
+	m := NewMatcher()
+	defer m.Free()
+	urls := []string{
+		"https://example.com/page",
+		"https://example.com/admin/secret",
+		"https://example.com/admin/public/x",
+		"https://example.com/admin/secret",
+	}
+	for _, agent := range []string{"Googlebot", "Bingbot"} {
+		for _, url := range urls {
+			if c.IsAllowed([]string{agent}, url) != m.IsAllowed(robotsTxt, agent, url) {
+				t.Errorf("%s %s: compiled and matcher disagree", agent, url)
+			}
+		}
+	}
+
+	buf, offsets := PackURLs(urls)
+	if len(offsets) != len(urls)+1 {
+		t.Fatalf("Expected %d offsets, got %d", len(urls)+1, len(offsets))
+	}
+	expected := []MatchResult{{true, 0}, {false, 2}, {true, 3}, {false, 2}}
+	results := c.IsAllowedBuffer([]string{"Googlebot"}, buf, offsets)
+	if len(results) != len(urls) {
+		t.Fatalf("Expected %d results, got %d", len(urls), len(results))
+	}
+	for i, url := range urls {
+		if results[i] != expected[i] {
+			t.Errorf("%s: expected %+v, got %+v", url, expected[i], results[i])
+		}
+	}
+	batch := c.IsAllowedBatch([]string{"Googlebot"}, urls)
+	for i := range urls {
+		if batch[i] != results[i] {
+			t.Errorf("%s: batch and buffer checks disagree", urls[i])
+		}
+	}
+
+	if results := c.IsAllowedBuffer([]string{"Googlebot"}, nil, []uint{0}); len(results) != 0 {
+		t.Error("Expected no results for no URLs")
+	}
+	if c.IsAllowedBuffer([]string{"Googlebot"}, buf, []uint{0, uint(len(buf)) + 1}) != nil {
+		t.Error("Expected nil for offsets past the buffer")
+	}
+	if c.IsAllowedBuffer([]string{"Googlebot"}, buf, []uint{4, 2}) != nil {
+		t.Error("Expected nil for decreasing offsets")
+	}
+}
+
+func TestCompiledSitemaps(t *testing.T) {
+	c := Compile("Sitemap: https://example.com/a.xml\nUser-agent: Bingbot\n" +
+		"Disallow: /\nSitemap: https://example.com/b.xml\n")
+	defer c.Free()
+	sitemaps := c.Sitemaps()
+	expected := []string{"https://example.com/a.xml", "https://example.com/b.xml"}
+	if len(sitemaps) != len(expected) {
+		t.Fatalf("Expected %d sitemaps, got %v", len(expected), sitemaps)
+	}
+	for i := range expected {
+		if sitemaps[i] != expected[i] {
+			t.Errorf("Expected %s, got %s", expected[i], sitemaps[i])
+		}
+	}
+
+	empty := Compile("User-agent: *\n")
+	defer empty.Free()
+	if len(empty.Sitemaps()) != 0 {
+		t.Error("Expected no sitemaps")
+	}
+}
+
+func TestCache(t *testing.T) {
+	c := NewCache(0, 4)
+	defer c.Free()
+
+	host := "https://example.com"
+	if _, ok := c.IsAllowed(host, "Googlebot", host+"/admin"); ok {
+		t.Error("Expected a miss before insert")
+	}
+	if !c.Insert(host, "User-agent: *\nDisallow: /admin\n", time.Hour) {
+		t.Fatal("Insert failed")
+	}
+	if allowed, ok := c.IsAllowed(host, "Googlebot", host+"/admin"); !ok || allowed {
+		t.Errorf("Expected /admin to be disallowed, got allowed=%v ok=%v", allowed, ok)
+	}
+	if allowed, ok := c.IsAllowed(host, "Googlebot", host+"/page"); !ok || !allowed {
+		t.Errorf("Expected /page to be allowed, got allowed=%v ok=%v", allowed, ok)
+	}
+
+	stats := c.Stats()
+	if stats.Hits != 2 || stats.Misses != 1 || stats.Entries != 1 {
+		t.Errorf("Unexpected stats %+v", stats)
+	}
+
+	c.Erase(host)
+	if _, ok := c.IsAllowed(host, "Googlebot", host+"/page"); ok {
+		t.Error("Expected a miss after erase")
+	}
+
+	// Identical bodies are compiled once.
+	c.Insert("https://a.example", "User-agent: *\nDisallow: /\n", time.Hour)
+	c.Insert("https://b.example", "User-agent: *\nDisallow: /\n", time.Hour)
+	stats = c.Stats()
+	if stats.Interned != 1 || stats.UniqueRobots != 1 || stats.Entries != 2 {
+		t.Errorf("Unexpected stats after interning %+v", stats)
+	}
+}
+
+func TestSharedCache(t *testing.T) {
+	host := "https://shared.example"
+	SharedCache().Insert(host, "User-agent: *\nDisallow: /\n", 0)
+	if allowed, ok := SharedCache().IsAllowed(host, "bot", host+"/x"); !ok || allowed {
+		t.Errorf("Expected the shared cache to disallow, got allowed=%v ok=%v", allowed, ok)
+	}
+	if InitSharedCache(0, 0) {
+		t.Error("Expected InitSharedCache to fail once the cache is in use")
+	}
+	SharedCache().Clear()
+}
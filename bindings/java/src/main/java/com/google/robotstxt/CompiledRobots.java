@@ -0,0 +1,173 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.google.robotstxt;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * A robots.txt compiled once and checked against any number of URLs.
+ *
+ * <p>The body crosses the JNI boundary only when it is compiled, so checks
+ * only pass the user-agent and the URLs. Many URLs can be passed in one
+ * direct {@link ByteBuffer}, which is read in place. A CompiledRobots is
+ * immutable and can be used from several threads until it is closed.
+ *
+ * <p>Example usage:
+ * <pre>{@code
+ * try (CompiledRobots robots = new CompiledRobots(robotsTxt)) {
+ *     boolean allowed = robots.isAllowed("Googlebot", "https://example.com/page");
+ *     MatchResult[] results = robots.isAllowedBatch("Googlebot", urls);
+ * }
+ * }</pre>
+ */
+public class CompiledRobots implements AutoCloseable {
+    static {
+        RobotsMatcher.loadNativeLibrary();
+    }
+
+    private long nativeHandle;
+
+    /** Compiles a robots.txt given as UTF-8 bytes. */
+    public CompiledRobots(byte[] robotsTxt) {
+        nativeHandle = nativeCreate(robotsTxt);
+        if (nativeHandle == 0) {
+            throw new OutOfMemoryError("Failed to compile robots.txt");
+        }
+    }
+
+    /** Compiles a robots.txt. */
+    public CompiledRobots(String robotsTxt) {
+        this(robotsTxt.getBytes(StandardCharsets.UTF_8));
+    }
+
+    /** Returns the approximate number of native bytes held. */
+    public long getMemoryUsage() {
+        checkOpen();
+        return nativeMemoryUsage(nativeHandle);
+    }
+
+    /** Returns the sitemap URLs of the robots.txt, in file order. */
+    public String[] getSitemaps() {
+        checkOpen();
+        byte[][] sitemaps = nativeSitemaps(nativeHandle);
+        String[] result = new String[sitemaps.length];
+        for (int i = 0; i < sitemaps.length; i++) {
+            result[i] = new String(sitemaps[i], StandardCharsets.UTF_8);
+        }
+        return result;
+    }
+
+    /**
+     * Checks if a URL is allowed for a single user-agent.
+     *
+     * @param userAgent The user-agent string to check
+     * @param url       The URL to check (should be %-encoded per RFC3986)
+     * @return true if the URL is allowed, false otherwise
+     */
+    public boolean isAllowed(String userAgent, String url) {
+        checkOpen();
+        return nativeIsAllowed(nativeHandle,
+            userAgent.getBytes(StandardCharsets.UTF_8),
+            url.getBytes(StandardCharsets.UTF_8));
+    }
+
+    /**
+     * Checks many URLs in a single native call.
+     *
+     * @param userAgent The user-agent string to check
+     * @param urls      The URLs to check (should be %-encoded per RFC3986)
+     * @return one result per URL, in the order of urls
+     */
+    public MatchResult[] isAllowedBatch(String userAgent, String[] urls) {
+        checkOpen();
+        // All URLs go into one array; URL i is urlBytes[offsets[i], offsets[i + 1]).
+        byte[][] encoded = new byte[urls.length][];
+        int[] offsets = new int[urls.length + 1];
+        for (int i = 0; i < urls.length; i++) {
+            encoded[i] = urls[i].getBytes(StandardCharsets.UTF_8);
+            offsets[i + 1] = offsets[i] + encoded[i].length;
+        }
+        byte[] urlBytes = new byte[offsets[urls.length]];
+        for (int i = 0; i < urls.length; i++) {
+            System.arraycopy(encoded[i], 0, urlBytes, offsets[i], encoded[i].length);
+        }
+
+        boolean[] allowed = new boolean[urls.length];
+        int[] matchingLines = new int[urls.length];
+        nativeIsAllowedBatch(nativeHandle, userAgent.getBytes(StandardCharsets.UTF_8),
+            urlBytes, offsets, allowed, matchingLines);
+
+        MatchResult[] results = new MatchResult[urls.length];
+        for (int i = 0; i < urls.length; i++) {
+            results[i] = new MatchResult(allowed[i], matchingLines[i]);
+        }
+        return results;
+    }
+
+    /**
+     * Checks the URLs packed in a direct buffer, without copying it.
+     *
+     * <p>URL i spans the bytes from {@code offsets[i]} to {@code offsets[i + 1]},
+     * counted from the start of the buffer regardless of its position. The
+     * results for URL i are stored in {@code allowed[i]} and
+     * {@code matchingLines[i]}, so the arrays can be reused across calls.
+     *
+     * @param userAgent     The user-agent string to check
+     * @param urls          A direct buffer holding the URLs
+     * @param offsets       allowed.length + 1 non-decreasing offsets into urls
+     * @param allowed       Receives whether each URL is allowed
+     * @param matchingLines Receives the line that decided each URL, or 0
+     * @throws IllegalArgumentException if urls is not direct or the offsets are invalid
+     */
+    public void isAllowedDirect(String userAgent, ByteBuffer urls, int[] offsets,
+                                boolean[] allowed, int[] matchingLines) {
+        checkOpen();
+        if (!urls.isDirect()) {
+            throw new IllegalArgumentException("urls must be a direct ByteBuffer");
+        }
+        if (!nativeIsAllowedDirect(nativeHandle, userAgent.getBytes(StandardCharsets.UTF_8),
+                urls, offsets, allowed, matchingLines)) {
+            throw new IllegalArgumentException("Invalid URL offsets");
+        }
+    }
+
+    @Override
+    public void close() {
+        if (nativeHandle != 0) {
+            nativeFree(nativeHandle);
+            nativeHandle = 0;
+        }
+    }
+
+    private void checkOpen() {
+        if (nativeHandle == 0) {
+            throw new IllegalStateException("CompiledRobots has been closed");
+        }
+    }
+
+    // Native methods
+    private static native long nativeCreate(byte[] robotsTxt);
+    private static native void nativeFree(long handle);
+    private static native long nativeMemoryUsage(long handle);
+    private static native byte[][] nativeSitemaps(long handle);
+    private static native boolean nativeIsAllowed(long handle, byte[] userAgent, byte[] url);
+    private static native boolean nativeIsAllowedBatch(long handle, byte[] userAgent, byte[] urls,
+        int[] urlOffsets, boolean[] allowed, int[] matchingLines);
+    private static native boolean nativeIsAllowedDirect(long handle, byte[] userAgent, ByteBuffer urls,
+        int[] urlOffsets, boolean[] allowed, int[] matchingLines);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.google.robotstxt;
+
+/**
+ * Result of checking one URL with {@link RobotsMatcher#isAllowedBatch} or
+ * {@link CompiledRobots#isAllowedBatch}.
+ */
+public class MatchResult {
+    private final boolean allowed;
+    private final int matchingLine;
+
+    public MatchResult(boolean allowed, int matchingLine) {
+        this.allowed = allowed;
+        this.matchingLine = matchingLine;
+    }
+
+    /**
+     * Returns true if the URL may be fetched.
+     */
+    public boolean isAllowed() {
+        return allowed;
+    }
+
+    /**
+     * Returns the line of the rule that decided, or 0 if no rule matched.
+     */
+    public int getMatchingLine() {
+        return matchingLine;
+    }
+
+    @Override
+    public String toString() {
+        return "MatchResult{allowed=" + allowed + ", matchingLine=" + matchingLine + "}";
+    }
+}
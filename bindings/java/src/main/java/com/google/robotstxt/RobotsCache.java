@@ -0,0 +1,162 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.google.robotstxt;
+
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Thread-safe, memory-bounded cache of compiled robots.txt files keyed by host.
+ *
+ * <p>{@link #shared()} is the process-wide cache, shared with the C API and
+ * the other bindings loaded in the process.
+ *
+ * <p>Example usage:
+ * <pre>{@code
+ * RobotsCache cache = RobotsCache.shared();
+ * cache.insert("https://example.com", robotsTxt, 3600);
+ * Boolean allowed = cache.isAllowed("https://example.com", "Googlebot", "https://example.com/page");
+ * }</pre>
+ */
+public class RobotsCache implements AutoCloseable {
+    static {
+        RobotsMatcher.loadNativeLibrary();
+    }
+
+    private static RobotsCache sharedCache;
+
+    private long nativeHandle;
+    private final boolean owned;
+
+    /**
+     * Creates a private cache.
+     *
+     * @param maxBytes memory budget, or 0 for the default of 1 GiB
+     * @param numShards number of independently locked shards, or 0 for the default of 64
+     */
+    public RobotsCache(long maxBytes, int numShards) {
+        this(nativeCreate(maxBytes, numShards), true);
+        if (nativeHandle == 0) {
+            throw new OutOfMemoryError("Failed to create RobotsCache");
+        }
+    }
+
+    /** Creates a private cache with the default budget and shards. */
+    public RobotsCache() {
+        this(0, 0);
+    }
+
+    private RobotsCache(long handle, boolean owned) {
+        this.nativeHandle = handle;
+        this.owned = owned;
+    }
+
+    /** Returns the process-wide cache. Closing it is a no-op. */
+    public static synchronized RobotsCache shared() {
+        if (sharedCache == null) {
+            sharedCache = new RobotsCache(nativeShared(), false);
+        }
+        return sharedCache;
+    }
+
+    /**
+     * Configures the shared cache before its first use.
+     *
+     * @return false if the shared cache is already in use
+     */
+    public static boolean initShared(long maxBytes, int numShards) {
+        return nativeInitShared(maxBytes, numShards);
+    }
+
+    /**
+     * Compiles robotsTxt and caches it for host.
+     *
+     * @param ttlSeconds time to live, or 0 for the default of 24 hours
+     */
+    public void insert(String host, String robotsTxt, long ttlSeconds) {
+        checkOpen();
+        byte[] hostBytes = host.getBytes(StandardCharsets.UTF_8);
+        byte[] robotsBytes = robotsTxt.getBytes(StandardCharsets.UTF_8);
+        if (!nativeInsert(nativeHandle, hostBytes, robotsBytes, ttlSeconds)) {
+            throw new OutOfMemoryError("Failed to compile robots.txt");
+        }
+    }
+
+    /** Compiles robotsTxt and caches it for host for the default time to live. */
+    public void insert(String host, String robotsTxt) {
+        insert(host, robotsTxt, 0);
+    }
+
+    /**
+     * Checks url against the cached robots.txt of host.
+     *
+     * @return whether url is allowed, or null if host is not cached
+     */
+    public Boolean isAllowed(String host, String userAgent, String url) {
+        checkOpen();
+        int result = nativeIsAllowed(nativeHandle,
+            host.getBytes(StandardCharsets.UTF_8),
+            userAgent.getBytes(StandardCharsets.UTF_8),
+            url.getBytes(StandardCharsets.UTF_8));
+        return result < 0 ? null : Boolean.valueOf(result == 1);
+    }
+
+    /** Removes host from the cache. */
+    public void erase(String host) {
+        checkOpen();
+        nativeErase(nativeHandle, host.getBytes(StandardCharsets.UTF_8));
+    }
+
+    /** Removes all entries. Counters are kept. */
+    public void clear() {
+        checkOpen();
+        nativeClear(nativeHandle);
+    }
+
+    /**
+     * Returns the counters of the cache: hits, misses, evictions, expirations,
+     * compilations, interned, entries, unique robots and bytes, in that order.
+     */
+    public long[] getStats() {
+        checkOpen();
+        return nativeGetStats(nativeHandle);
+    }
+
+    @Override
+    public void close() {
+        if (owned && nativeHandle != 0) {
+            nativeFree(nativeHandle);
+            nativeHandle = 0;
+        }
+    }
+
+    private void checkOpen() {
+        if (nativeHandle == 0) {
+            throw new IllegalStateException("RobotsCache has been closed");
+        }
+    }
+
+    // Native methods
+    private static native long nativeCreate(long maxBytes, int numShards);
+    private static native void nativeFree(long handle);
+    private static native long nativeShared();
+    private static native boolean nativeInitShared(long maxBytes, int numShards);
+    private static native boolean nativeInsert(long handle, byte[] host, byte[] robotsTxt, long ttlSeconds);
+    private static native int nativeIsAllowed(long handle, byte[] host, byte[] userAgent, byte[] url);
+    private static native void nativeErase(long handle, byte[] host);
+    private static native void nativeClear(long handle);
+    private static native long[] nativeGetStats(long handle);
+}
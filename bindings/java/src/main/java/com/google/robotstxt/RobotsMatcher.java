@@ -75,6 +75,10 @@ public class RobotsMatcher implements AutoCloseable {
         }
     }
 
+    /** Loads the native library, by initializing this class, for the other classes of the package. */
+    static void loadNativeLibrary() {
+    }
+
     private long nativeHandle;
 
     /**
@@ -105,6 +109,48 @@ public class RobotsMatcher implements AutoCloseable {
         return nativeIsAllowed(nativeHandle, robotsBytes, uaBytes, urlBytes);
     }
 
+    /**
+     * Checks many URLs against one robots.txt in a single native call.
+     *
+     * <p>The robots.txt is parsed once and all URLs cross the JNI boundary in
+     * one buffer, which is much faster than calling {@link #isAllowed} per URL.
+     * The matcher state ({@link #getMatchingLine()}, ...) is not changed.
+     *
+     * @param robotsTxt The robots.txt content
+     * @param userAgent The user-agent string to check
+     * @param urls      The URLs to check (should be %-encoded per RFC3986)
+     * @return one result per URL, in the order of urls
+     */
+    public MatchResult[] isAllowedBatch(String robotsTxt, String userAgent, String[] urls) {
+        if (nativeHandle == 0) {
+            throw new IllegalStateException("RobotsMatcher has been closed");
+        }
+        byte[] robotsBytes = robotsTxt.getBytes(StandardCharsets.UTF_8);
+        byte[] uaBytes = userAgent.getBytes(StandardCharsets.UTF_8);
+
+        // All URLs go into one array; URL i is urlBytes[offsets[i], offsets[i + 1]).
+        byte[][] encoded = new byte[urls.length][];
+        int[] offsets = new int[urls.length + 1];
+        for (int i = 0; i < urls.length; i++) {
+            encoded[i] = urls[i].getBytes(StandardCharsets.UTF_8);
+            offsets[i + 1] = offsets[i] + encoded[i].length;
+        }
+        byte[] urlBytes = new byte[offsets[urls.length]];
+        for (int i = 0; i < urls.length; i++) {
+            System.arraycopy(encoded[i], 0, urlBytes, offsets[i], encoded[i].length);
+        }
+
+        boolean[] allowed = new boolean[urls.length];
+        int[] matchingLines = new int[urls.length];
+        nativeIsAllowedBatch(robotsBytes, uaBytes, urlBytes, offsets, allowed, matchingLines);
+
+        MatchResult[] results = new MatchResult[urls.length];
+        for (int i = 0; i < urls.length; i++) {
+            results[i] = new MatchResult(allowed[i], matchingLines[i]);
+        }
+        return results;
+    }
+
     /**
      * Returns the line number that matched, or 0 if no match.
      */
@@ -246,6 +292,8 @@ public class RobotsMatcher implements AutoCloseable {
     private static native long nativeCreate();
     private static native void nativeFree(long handle);
     private static native boolean nativeIsAllowed(long handle, byte[] robotsTxt, byte[] userAgent, byte[] url);
+    private static native void nativeIsAllowedBatch(byte[] robotsTxt, byte[] userAgent, byte[] urls,
+                                                    int[] urlOffsets, boolean[] allowed, int[] matchingLines);
     private static native int nativeGetMatchingLine(long handle);
     private static native boolean nativeEverSeenSpecificAgent(long handle);
     private static native boolean nativeHasCrawlDelay(long handle);
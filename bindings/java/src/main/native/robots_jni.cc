@@ -16,6 +16,7 @@
 
 #include <jni.h>
 #include <cstring>
+#include <vector>
 #include "robots_c.h"
 
 extern "C" {
@@ -62,6 +63,56 @@ Java_com_google_robotstxt_RobotsMatcher_nativeIsAllowed(
     return result ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT void JNICALL
+Java_com_google_robotstxt_RobotsMatcher_nativeIsAllowedBatch(
+    JNIEnv* env, jclass clazz,
+    jbyteArray robotsTxt, jbyteArray userAgent, jbyteArray urls,
+    jintArray urlOffsets, jbooleanArray allowed, jintArray matchingLines) {
+
+    const jsize num_urls = env->GetArrayLength(allowed);
+    if (num_urls == 0) return;
+
+    jbyte* robots_bytes = env->GetByteArrayElements(robotsTxt, nullptr);
+    jsize robots_len = env->GetArrayLength(robotsTxt);
+
+    jbyte* ua_bytes = env->GetByteArrayElements(userAgent, nullptr);
+    jsize ua_len = env->GetArrayLength(userAgent);
+
+    jbyte* url_bytes = env->GetByteArrayElements(urls, nullptr);
+    jint* offsets = env->GetIntArrayElements(urlOffsets, nullptr);
+
+    std::vector<const char*> url_ptrs(num_urls);
+    std::vector<size_t> url_lens(num_urls);
+    for (jsize i = 0; i < num_urls; ++i) {
+        url_ptrs[i] = reinterpret_cast<const char*>(url_bytes) + offsets[i];
+        url_lens[i] = offsets[i + 1] - offsets[i];
+    }
+
+    const char* ua_ptr = reinterpret_cast<const char*>(ua_bytes);
+    const size_t ua_size = ua_len;
+    std::vector<robots_match_result_t> results(num_urls);
+    robots_allowed_by_robots_batch(
+        reinterpret_cast<const char*>(robots_bytes), robots_len,
+        &ua_ptr, &ua_size, 1,
+        url_ptrs.data(), url_lens.data(), num_urls,
+        results.data()
+    );
+
+    env->ReleaseByteArrayElements(robotsTxt, robots_bytes, JNI_ABORT);
+    env->ReleaseByteArrayElements(userAgent, ua_bytes, JNI_ABORT);
+    env->ReleaseByteArrayElements(urls, url_bytes, JNI_ABORT);
+    env->ReleaseIntArrayElements(urlOffsets, offsets, JNI_ABORT);
+
+    std::vector<jboolean> allowed_values(num_urls);
+    std::vector<jint> line_values(num_urls);
+    for (jsize i = 0; i < num_urls; ++i) {
+        allowed_values[i] = results[i].allowed ? JNI_TRUE : JNI_FALSE;
+        line_values[i] = results[i].matching_line;
+    }
+    env->SetBooleanArrayRegion(allowed, 0, num_urls, allowed_values.data());
+    env->SetIntArrayRegion(matchingLines, 0, num_urls, line_values.data());
+}
+
 JNIEXPORT jint JNICALL
 Java_com_google_robotstxt_RobotsMatcher_nativeGetMatchingLine(JNIEnv* env, jclass clazz, jlong handle) {
     if (handle == 0) return 0;
@@ -162,4 +213,295 @@ Java_com_google_robotstxt_RobotsMatcher_nativeIsValidUserAgent(JNIEnv* env, jcla
     return result ? JNI_TRUE : JNI_FALSE;
 }
 
+// CompiledRobots
+
+namespace {
+// Matches the URLs at url_bytes + offsets[i] for one user agent and stores
+// the results in the Java arrays. Returns false if the offsets are invalid.
+bool CompiledMatchBatch(JNIEnv* env, jlong handle, jbyteArray userAgent,
+                        const char* url_bytes, jlong url_capacity,
+                        jintArray urlOffsets, jbooleanArray allowed,
+                        jintArray matchingLines) {
+    const jsize num_urls = env->GetArrayLength(allowed);
+    if (env->GetArrayLength(urlOffsets) < num_urls + 1 ||
+        env->GetArrayLength(matchingLines) < num_urls) {
+        return false;
+    }
+
+    jint* offsets = env->GetIntArrayElements(urlOffsets, nullptr);
+    std::vector<size_t> url_offsets(num_urls + 1);
+    bool valid = true;
+    for (jsize i = 0; i <= num_urls; ++i) {
+        if (offsets[i] < 0 || offsets[i] > url_capacity) valid = false;
+        url_offsets[i] = static_cast<size_t>(offsets[i]);
+    }
+    env->ReleaseIntArrayElements(urlOffsets, offsets, JNI_ABORT);
+    if (!valid) return false;
+    if (num_urls == 0) return true;
+
+    jbyte* ua_bytes = env->GetByteArrayElements(userAgent, nullptr);
+    const char* ua_ptr = reinterpret_cast<const char*>(ua_bytes);
+    const size_t ua_size = env->GetArrayLength(userAgent);
+
+    std::vector<robots_match_result_t> results(num_urls);
+    valid = robots_compiled_match_batch(
+        reinterpret_cast<const robots_compiled_t*>(handle),
+        &ua_ptr, &ua_size, 1,
+        url_bytes, url_offsets.data(), num_urls,
+        results.data()
+    );
+    env->ReleaseByteArrayElements(userAgent, ua_bytes, JNI_ABORT);
+    if (!valid) return false;
+
+    std::vector<jboolean> allowed_values(num_urls);
+    std::vector<jint> line_values(num_urls);
+    for (jsize i = 0; i < num_urls; ++i) {
+        allowed_values[i] = results[i].allowed ? JNI_TRUE : JNI_FALSE;
+        line_values[i] = results[i].matching_line;
+    }
+    env->SetBooleanArrayRegion(allowed, 0, num_urls, allowed_values.data());
+    env->SetIntArrayRegion(matchingLines, 0, num_urls, line_values.data());
+    return true;
+}
+}  // namespace
+
+JNIEXPORT jlong JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeCreate(
+    JNIEnv* env, jclass clazz, jbyteArray robotsTxt) {
+
+    jbyte* robots_bytes = env->GetByteArrayElements(robotsTxt, nullptr);
+    jsize robots_len = env->GetArrayLength(robotsTxt);
+
+    robots_compiled_t* compiled = robots_compiled_create(
+        reinterpret_cast<const char*>(robots_bytes), robots_len);
+
+    env->ReleaseByteArrayElements(robotsTxt, robots_bytes, JNI_ABORT);
+    return reinterpret_cast<jlong>(compiled);
+}
+
+JNIEXPORT void JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeFree(JNIEnv* env, jclass clazz, jlong handle) {
+    if (handle != 0) {
+        robots_compiled_free(reinterpret_cast<robots_compiled_t*>(handle));
+    }
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeMemoryUsage(JNIEnv* env, jclass clazz, jlong handle) {
+    return static_cast<jlong>(robots_compiled_memory_usage(
+        reinterpret_cast<const robots_compiled_t*>(handle)));
+}
+
+// Returns the sitemaps as byte arrays, which Java decodes as UTF-8.
+JNIEXPORT jobjectArray JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeSitemaps(JNIEnv* env, jclass clazz, jlong handle) {
+    const robots_compiled_t* compiled = reinterpret_cast<const robots_compiled_t*>(handle);
+    const size_t count = robots_compiled_num_sitemaps(compiled);
+    jclass byte_array_class = env->FindClass("[B");
+    if (byte_array_class == nullptr) return nullptr;
+    jobjectArray sitemaps = env->NewObjectArray(static_cast<jsize>(count), byte_array_class, nullptr);
+    if (sitemaps == nullptr) return nullptr;
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = 0;
+        const char* data = robots_compiled_sitemap(compiled, i, &len);
+        jbyteArray sitemap = env->NewByteArray(static_cast<jsize>(len));
+        if (sitemap == nullptr) return nullptr;
+        env->SetByteArrayRegion(sitemap, 0, static_cast<jsize>(len),
+                                reinterpret_cast<const jbyte*>(data));
+        env->SetObjectArrayElement(sitemaps, static_cast<jsize>(i), sitemap);
+        env->DeleteLocalRef(sitemap);
+    }
+    return sitemaps;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeIsAllowed(
+    JNIEnv* env, jclass clazz, jlong handle, jbyteArray userAgent, jbyteArray url) {
+
+    if (handle == 0) return JNI_TRUE;
+
+    jbyte* ua_bytes = env->GetByteArrayElements(userAgent, nullptr);
+    const char* ua_ptr = reinterpret_cast<const char*>(ua_bytes);
+    const size_t ua_size = env->GetArrayLength(userAgent);
+
+    jbyte* url_bytes = env->GetByteArrayElements(url, nullptr);
+    jsize url_len = env->GetArrayLength(url);
+
+    bool result = robots_compiled_allowed(
+        reinterpret_cast<const robots_compiled_t*>(handle),
+        &ua_ptr, &ua_size, 1,
+        reinterpret_cast<const char*>(url_bytes), url_len
+    );
+
+    env->ReleaseByteArrayElements(userAgent, ua_bytes, JNI_ABORT);
+    env->ReleaseByteArrayElements(url, url_bytes, JNI_ABORT);
+
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeIsAllowedBatch(
+    JNIEnv* env, jclass clazz, jlong handle, jbyteArray userAgent,
+    jbyteArray urls, jintArray urlOffsets, jbooleanArray allowed,
+    jintArray matchingLines) {
+
+    if (handle == 0) return JNI_FALSE;
+
+    jbyte* url_bytes = env->GetByteArrayElements(urls, nullptr);
+    bool result = CompiledMatchBatch(
+        env, handle, userAgent, reinterpret_cast<const char*>(url_bytes),
+        env->GetArrayLength(urls), urlOffsets, allowed, matchingLines);
+    env->ReleaseByteArrayElements(urls, url_bytes, JNI_ABORT);
+
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_google_robotstxt_CompiledRobots_nativeIsAllowedDirect(
+    JNIEnv* env, jclass clazz, jlong handle, jbyteArray userAgent,
+    jobject urls, jintArray urlOffsets, jbooleanArray allowed,
+    jintArray matchingLines) {
+
+    if (handle == 0) return JNI_FALSE;
+
+    // The URLs are read in place, without copying the buffer.
+    const char* url_bytes = static_cast<const char*>(env->GetDirectBufferAddress(urls));
+    const jlong url_capacity = env->GetDirectBufferCapacity(urls);
+    if (url_bytes == nullptr || url_capacity < 0) return JNI_FALSE;
+
+    return CompiledMatchBatch(env, handle, userAgent, url_bytes, url_capacity,
+                              urlOffsets, allowed, matchingLines)
+        ? JNI_TRUE : JNI_FALSE;
+}
+
+// RobotsCache
+
+JNIEXPORT jlong JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeCreate(
+    JNIEnv* env, jclass clazz, jlong maxBytes, jint numShards) {
+    return reinterpret_cast<jlong>(robots_cache_create(
+        static_cast<size_t>(maxBytes), static_cast<size_t>(numShards)));
+}
+
+JNIEXPORT void JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeFree(JNIEnv* env, jclass clazz, jlong handle) {
+    if (handle != 0) {
+        robots_cache_free(reinterpret_cast<robots_cache_t*>(handle));
+    }
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeShared(JNIEnv* env, jclass clazz) {
+    return reinterpret_cast<jlong>(robots_cache_shared());
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeInitShared(
+    JNIEnv* env, jclass clazz, jlong maxBytes, jint numShards) {
+    return robots_cache_init_shared(static_cast<size_t>(maxBytes),
+                                    static_cast<size_t>(numShards))
+        ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeInsert(
+    JNIEnv* env, jclass clazz, jlong handle,
+    jbyteArray host, jbyteArray robotsTxt, jlong ttlSeconds) {
+
+    if (handle == 0) return JNI_FALSE;
+
+    jbyte* host_bytes = env->GetByteArrayElements(host, nullptr);
+    jsize host_len = env->GetArrayLength(host);
+
+    jbyte* robots_bytes = env->GetByteArrayElements(robotsTxt, nullptr);
+    jsize robots_len = env->GetArrayLength(robotsTxt);
+
+    bool result = robots_cache_insert(
+        reinterpret_cast<robots_cache_t*>(handle),
+        reinterpret_cast<const char*>(host_bytes), host_len,
+        reinterpret_cast<const char*>(robots_bytes), robots_len,
+        ttlSeconds
+    );
+
+    env->ReleaseByteArrayElements(host, host_bytes, JNI_ABORT);
+    env->ReleaseByteArrayElements(robotsTxt, robots_bytes, JNI_ABORT);
+
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeIsAllowed(
+    JNIEnv* env, jclass clazz, jlong handle,
+    jbyteArray host, jbyteArray userAgent, jbyteArray url) {
+
+    if (handle == 0) return -1;
+
+    jbyte* host_bytes = env->GetByteArrayElements(host, nullptr);
+    jsize host_len = env->GetArrayLength(host);
+
+    jbyte* ua_bytes = env->GetByteArrayElements(userAgent, nullptr);
+    jsize ua_len = env->GetArrayLength(userAgent);
+
+    jbyte* url_bytes = env->GetByteArrayElements(url, nullptr);
+    jsize url_len = env->GetArrayLength(url);
+
+    int result = robots_cache_allowed(
+        reinterpret_cast<robots_cache_t*>(handle),
+        reinterpret_cast<const char*>(host_bytes), host_len,
+        reinterpret_cast<const char*>(ua_bytes), ua_len,
+        reinterpret_cast<const char*>(url_bytes), url_len
+    );
+
+    env->ReleaseByteArrayElements(host, host_bytes, JNI_ABORT);
+    env->ReleaseByteArrayElements(userAgent, ua_bytes, JNI_ABORT);
+    env->ReleaseByteArrayElements(url, url_bytes, JNI_ABORT);
+
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeErase(
+    JNIEnv* env, jclass clazz, jlong handle, jbyteArray host) {
+
+    if (handle == 0) return;
+
+    jbyte* host_bytes = env->GetByteArrayElements(host, nullptr);
+    jsize host_len = env->GetArrayLength(host);
+
+    robots_cache_erase(reinterpret_cast<robots_cache_t*>(handle),
+                       reinterpret_cast<const char*>(host_bytes), host_len);
+
+    env->ReleaseByteArrayElements(host, host_bytes, JNI_ABORT);
+}
+
+JNIEXPORT void JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeClear(JNIEnv* env, jclass clazz, jlong handle) {
+    if (handle != 0) {
+        robots_cache_clear(reinterpret_cast<robots_cache_t*>(handle));
+    }
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_google_robotstxt_RobotsCache_nativeGetStats(JNIEnv* env, jclass clazz, jlong handle) {
+    robots_cache_stats_t stats;
+    if (!robots_cache_get_stats(reinterpret_cast<const robots_cache_t*>(handle), &stats)) {
+        return nullptr;
+    }
+
+    jlong values[9] = {
+        static_cast<jlong>(stats.hits),
+        static_cast<jlong>(stats.misses),
+        static_cast<jlong>(stats.evictions),
+        static_cast<jlong>(stats.expirations),
+        static_cast<jlong>(stats.compilations),
+        static_cast<jlong>(stats.interned),
+        static_cast<jlong>(stats.entries),
+        static_cast<jlong>(stats.unique_robots),
+        static_cast<jlong>(stats.bytes),
+    };
+    jlongArray result = env->NewLongArray(9);
+    env->SetLongArrayRegion(result, 0, 9, values);
+    return result;
+}
+
 }  // extern "C"
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.google.robotstxt;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import org.junit.Test;
+import static org.junit.Assert.*;
+
+public class CompiledRobotsTest {
+    private static final String ROBOTS_TXT =
+        "User-agent: *\nDisallow: /admin/\nAllow: /admin/public/\n\n"
+        + "User-agent: Bingbot\nDisallow: /\n";
+
+    private static final String[] URLS = {
+        "https://example.com/page",
+        "https://example.com/admin/secret",
+        "https://example.com/admin/public/x",
+        "https://example.com/admin/secret",
+    };
+
+    @Test
+    public void testMatchesMatcher() {
+        try (CompiledRobots robots = new CompiledRobots(ROBOTS_TXT);
+             RobotsMatcher matcher = new RobotsMatcher()) {
+            assertTrue(robots.getMemoryUsage() > 0);
+            for (String agent : new String[] {"Googlebot", "Bingbot"}) {
+                for (String url : URLS) {
+                    assertEquals(matcher.isAllowed(ROBOTS_TXT, agent, url),
+                                 robots.isAllowed(agent, url));
+                }
+            }
+        }
+    }
+
+    @Test
+    public void testSitemaps() {
+        String robotsTxt = "Sitemap: https://example.com/a.xml\nUser-agent: Bingbot\n"
+            + "Disallow: /\nSitemap: https://example.com/b.xml\n";
+        try (CompiledRobots robots = new CompiledRobots(robotsTxt)) {
+            assertArrayEquals(
+                new String[] {"https://example.com/a.xml", "https://example.com/b.xml"},
+                robots.getSitemaps());
+        }
+        try (CompiledRobots robots = new CompiledRobots(ROBOTS_TXT)) {
+            assertEquals(0, robots.getSitemaps().length);
+        }
+    }
+
+    @Test
+    public void testBatch() {
+        try (CompiledRobots robots = new CompiledRobots(ROBOTS_TXT)) {
+            MatchResult[] results = robots.isAllowedBatch("Googlebot", URLS);
+            assertEquals(4, results.length);
+            assertTrue(results[0].isAllowed());
+            assertEquals(0, results[0].getMatchingLine());
+            assertFalse(results[1].isAllowed());
+            assertEquals(2, results[1].getMatchingLine());
+            assertTrue(results[2].isAllowed());
+            assertEquals(3, results[2].getMatchingLine());
+            assertFalse(results[3].isAllowed());
+            assertEquals(0, robots.isAllowedBatch("Googlebot", new String[0]).length);
+        }
+    }
+
+    @Test
+    public void testDirectBuffer() {
+        ByteBuffer urls = ByteBuffer.allocateDirect(256);
+        int[] offsets = new int[URLS.length + 1];
+        for (int i = 0; i < URLS.length; i++) {
+            urls.put(URLS[i].getBytes(StandardCharsets.UTF_8));
+            offsets[i + 1] = urls.position();
+        }
+        boolean[] allowed = new boolean[URLS.length];
+        int[] matchingLines = new int[URLS.length];
+        try (CompiledRobots robots = new CompiledRobots(ROBOTS_TXT)) {
+            robots.isAllowedDirect("Googlebot", urls, offsets, allowed, matchingLines);
+            assertArrayEquals(new boolean[] {true, false, true, false}, allowed);
+            assertArrayEquals(new int[] {0, 2, 3, 2}, matchingLines);
+
+            try {
+                robots.isAllowedDirect("Googlebot", urls, new int[] {0, 257},
+                                       new boolean[1], new int[1]);
+                fail("Expected offsets past the buffer to be rejected");
+            } catch (IllegalArgumentException expected) {
+            }
+            try {
+                robots.isAllowedDirect("Googlebot", ByteBuffer.allocate(8), new int[] {0, 1},
+                                       new boolean[1], new int[1]);
+                fail("Expected a heap buffer to be rejected");
+            } catch (IllegalArgumentException expected) {
+            }
+        }
+    }
+
+    @Test(expected = IllegalStateException.class)
+    public void testClosed() {
+        CompiledRobots robots = new CompiledRobots(ROBOTS_TXT);
+        robots.close();
+        robots.isAllowed("Googlebot", "https://example.com/");
+    }
+}
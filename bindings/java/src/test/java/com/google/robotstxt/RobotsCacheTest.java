@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.google.robotstxt;
+
+import org.junit.Test;
+import static org.junit.Assert.*;
+
+public class RobotsCacheTest {
+
+    @Test
+    public void testInsertAndLookup() {
+        try (RobotsCache cache = new RobotsCache(0, 4)) {
+            String host = "https://example.com";
+            assertNull(cache.isAllowed(host, "Googlebot", host + "/admin"));
+            cache.insert(host, "User-agent: *\nDisallow: /admin\n", 3600);
+            assertEquals(Boolean.FALSE, cache.isAllowed(host, "Googlebot", host + "/admin"));
+            assertEquals(Boolean.TRUE, cache.isAllowed(host, "Googlebot", host + "/page"));
+
+            long[] stats = cache.getStats();
+            assertEquals(2, stats[0]);  // hits
+            assertEquals(1, stats[1]);  // misses
+            assertEquals(1, stats[6]);  // entries
+
+            cache.erase(host);
+            assertNull(cache.isAllowed(host, "Googlebot", host + "/page"));
+
+            // Identical bodies are compiled once.
+            cache.insert("https://a.example", "User-agent: *\nDisallow: /\n", 3600);
+            cache.insert("https://b.example", "User-agent: *\nDisallow: /\n", 3600);
+            stats = cache.getStats();
+            assertEquals(1, stats[5]);  // interned
+            assertEquals(1, stats[7]);  // unique robots
+        }
+    }
+
+    @Test
+    public void testShared() {
+        String host = "https://shared.example";
+        RobotsCache.shared().insert(host, "User-agent: *\nDisallow: /\n");
+        assertSame(RobotsCache.shared(), RobotsCache.shared());
+        assertEquals(Boolean.FALSE, RobotsCache.shared().isAllowed(host, "bot", host + "/x"));
+        assertFalse(RobotsCache.initShared(0, 0));
+        RobotsCache.shared().close();  // No-op for the shared cache.
+        RobotsCache.shared().clear();
+    }
+}
@@ -133,6 +133,32 @@ public class RobotsMatcherTest {
         }
     }
 
+    @Test
+    public void testIsAllowedBatch() {
+        try (RobotsMatcher matcher = new RobotsMatcher()) {
+            String robotsTxt = "User-agent: *\nDisallow: /admin/\nAllow: /admin/public/\n";
+            String[] urls = {
+                "https://example.com/page",
+                "https://example.com/admin/secret",
+                "https://example.com/admin/public/x",
+                "https://example.com/admin/secret",
+            };
+            MatchResult[] results = matcher.isAllowedBatch(robotsTxt, "Googlebot", urls);
+            assertEquals(4, results.length);
+            assertTrue(results[0].isAllowed());
+            assertEquals(0, results[0].getMatchingLine());
+            assertFalse(results[1].isAllowed());
+            assertEquals(2, results[1].getMatchingLine());
+            assertTrue(results[2].isAllowed());
+            assertEquals(3, results[2].getMatchingLine());
+            assertFalse(results[3].isAllowed());
+            for (int i = 0; i < urls.length; i++) {
+                assertEquals(matcher.isAllowed(robotsTxt, "Googlebot", urls[i]), results[i].isAllowed());
+            }
+            assertEquals(0, matcher.isAllowedBatch(robotsTxt, "Googlebot", new String[0]).length);
+        }
+    }
+
     @Test
     public void testEmptyRobotsTxt() {
         try (RobotsMatcher matcher = new RobotsMatcher()) {
@@ -15,7 +15,25 @@ Example usage:
     print(f"Access: {'allowed' if allowed else 'disallowed'}")
 """
 
-from .robots import RobotsMatcher, is_valid_user_agent, get_version
+from .robots import (
+    CacheStats,
+    CompiledRobots,
+    MatchResult,
+    RobotsCache,
+    RobotsMatcher,
+    is_valid_user_agent,
+    get_version,
+    pack_urls,
+)
 
-__all__ = ["RobotsMatcher", "is_valid_user_agent", "get_version"]
+__all__ = [
+    "CacheStats",
+    "CompiledRobots",
+    "MatchResult",
+    "RobotsCache",
+    "RobotsMatcher",
+    "is_valid_user_agent",
+    "get_version",
+    "pack_urls",
+]
 __version__ = "1.1.0"
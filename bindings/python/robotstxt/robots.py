@@ -5,9 +5,9 @@ Low-level ctypes bindings for the robots.txt C API.
 import ctypes
 import os
 import sys
-from ctypes import c_bool, c_char_p, c_double, c_int, c_int8, c_size_t, c_void_p, POINTER, Structure
+from ctypes import c_bool, c_char_p, c_double, c_int, c_int8, c_int64, c_size_t, c_uint64, c_void_p, CFUNCTYPE, POINTER, Structure
 from pathlib import Path
-from typing import List, Optional, Tuple
+from typing import Callable, List, NamedTuple, Optional, Sequence, Tuple, Union
 
 
 def _find_library() -> str:
@@ -84,6 +84,33 @@ class RequestRate(Structure):
     ]
 
 
+class _MatchResult(Structure):
+    """Result of checking one URL in a batch."""
+    _fields_ = [
+        ("allowed", c_bool),
+        ("matching_line", c_int),
+    ]
+
+
+class _CacheStats(Structure):
+    """Counters of a robots_cache_t."""
+    _fields_ = [
+        ("hits", c_uint64),
+        ("misses", c_uint64),
+        ("evictions", c_uint64),
+        ("expirations", c_uint64),
+        ("compilations", c_uint64),
+        ("interned", c_uint64),
+        ("entries", c_uint64),
+        ("unique_robots", c_uint64),
+        ("bytes", c_uint64),
+    ]
+
+
+# bool (*)(void* user_data, const char* host, size_t host_len, robots_cache_body_t* body)
+_CacheFetchFn = CFUNCTYPE(c_bool, c_void_p, c_void_p, c_size_t, c_void_p)
+
+
 class ContentSignal(Structure):
     """Content-Signal values for AI content preferences.
 
@@ -107,6 +134,9 @@ _lib.robots_matcher_create.restype = c_void_p
 _lib.robots_matcher_free.argtypes = [c_void_p]
 _lib.robots_matcher_free.restype = None
 
+_lib.robots_matcher_set_collect_sitemaps.argtypes = [c_void_p, c_bool]
+_lib.robots_matcher_set_collect_sitemaps.restype = None
+
 # URL checking
 _lib.robots_allowed_by_robots.argtypes = [
     c_void_p, c_char_p, c_size_t, c_char_p, c_size_t, c_char_p, c_size_t
@@ -120,6 +150,43 @@ _lib.robots_allowed_by_robots_multi.argtypes = [
 ]
 _lib.robots_allowed_by_robots_multi.restype = c_bool
 
+_lib.robots_allowed_by_robots_batch.argtypes = [
+    c_char_p, c_size_t,
+    POINTER(c_char_p), POINTER(c_size_t), c_size_t,
+    POINTER(c_char_p), POINTER(c_size_t), c_size_t,
+    POINTER(_MatchResult)
+]
+_lib.robots_allowed_by_robots_batch.restype = c_bool
+
+# Compiled robots.txt
+_lib.robots_compiled_create.argtypes = [c_char_p, c_size_t]
+_lib.robots_compiled_create.restype = c_void_p
+
+_lib.robots_compiled_free.argtypes = [c_void_p]
+_lib.robots_compiled_free.restype = None
+
+_lib.robots_compiled_memory_usage.argtypes = [c_void_p]
+_lib.robots_compiled_memory_usage.restype = c_size_t
+
+_lib.robots_compiled_allowed.argtypes = [
+    c_void_p, POINTER(c_char_p), POINTER(c_size_t), c_size_t,
+    c_char_p, c_size_t
+]
+_lib.robots_compiled_allowed.restype = c_bool
+
+_lib.robots_compiled_match_batch.argtypes = [
+    c_void_p, POINTER(c_char_p), POINTER(c_size_t), c_size_t,
+    c_char_p, POINTER(c_size_t), c_size_t,
+    POINTER(_MatchResult)
+]
+_lib.robots_compiled_match_batch.restype = c_bool
+
+_lib.robots_compiled_num_sitemaps.argtypes = [c_void_p]
+_lib.robots_compiled_num_sitemaps.restype = c_size_t
+
+_lib.robots_compiled_sitemap.argtypes = [c_void_p, c_size_t, POINTER(c_size_t)]
+_lib.robots_compiled_sitemap.restype = c_void_p
+
 # Matcher state accessors
 _lib.robots_matching_line.argtypes = [c_void_p]
 _lib.robots_matching_line.restype = c_int
@@ -127,6 +194,12 @@ _lib.robots_matching_line.restype = c_int
 _lib.robots_ever_seen_specific_agent.argtypes = [c_void_p]
 _lib.robots_ever_seen_specific_agent.restype = c_bool
 
+_lib.robots_num_sitemaps.argtypes = [c_void_p]
+_lib.robots_num_sitemaps.restype = c_size_t
+
+_lib.robots_get_sitemap.argtypes = [c_void_p, c_size_t, POINTER(c_size_t)]
+_lib.robots_get_sitemap.restype = c_void_p
+
 # Crawl-delay
 _lib.robots_has_crawl_delay.argtypes = [c_void_p]
 _lib.robots_has_crawl_delay.restype = c_bool
@@ -160,6 +233,46 @@ _lib.robots_allows_ai_input.restype = c_bool
 _lib.robots_allows_search.argtypes = [c_void_p]
 _lib.robots_allows_search.restype = c_bool
 
+# Per-host cache
+_lib.robots_cache_create.argtypes = [c_size_t, c_size_t]
+_lib.robots_cache_create.restype = c_void_p
+
+_lib.robots_cache_free.argtypes = [c_void_p]
+_lib.robots_cache_free.restype = None
+
+_lib.robots_cache_init_shared.argtypes = [c_size_t, c_size_t]
+_lib.robots_cache_init_shared.restype = c_bool
+
+_lib.robots_cache_shared.argtypes = []
+_lib.robots_cache_shared.restype = c_void_p
+
+_lib.robots_cache_insert.argtypes = [
+    c_void_p, c_char_p, c_size_t, c_char_p, c_size_t, c_int64
+]
+_lib.robots_cache_insert.restype = c_bool
+
+_lib.robots_cache_fetch.argtypes = [
+    c_void_p, c_char_p, c_size_t, _CacheFetchFn, c_void_p, c_int64
+]
+_lib.robots_cache_fetch.restype = c_bool
+
+_lib.robots_cache_body_set.argtypes = [c_void_p, c_char_p, c_size_t]
+_lib.robots_cache_body_set.restype = None
+
+_lib.robots_cache_allowed.argtypes = [
+    c_void_p, c_char_p, c_size_t, c_char_p, c_size_t, c_char_p, c_size_t
+]
+_lib.robots_cache_allowed.restype = c_int
+
+_lib.robots_cache_erase.argtypes = [c_void_p, c_char_p, c_size_t]
+_lib.robots_cache_erase.restype = None
+
+_lib.robots_cache_clear.argtypes = [c_void_p]
+_lib.robots_cache_clear.restype = None
+
+_lib.robots_cache_get_stats.argtypes = [c_void_p, POINTER(_CacheStats)]
+_lib.robots_cache_get_stats.restype = c_bool
+
 # Utility functions
 _lib.robots_is_valid_user_agent.argtypes = [c_char_p, c_size_t]
 _lib.robots_is_valid_user_agent.restype = c_bool
@@ -172,6 +285,59 @@ _lib.robots_version.restype = c_char_p
 # Python API
 # =============================================================================
 
+class MatchResult(NamedTuple):
+    """Result of checking one URL with an is_allowed_batch() method."""
+    allowed: bool
+    # Line of the rule that decided, or 0 if no rule matched.
+    matching_line: int
+
+
+class CacheStats(NamedTuple):
+    """Counters of a RobotsCache."""
+    hits: int
+    # Lookups that found no live entry, including expired ones.
+    misses: int
+    # Entries dropped to stay within the memory budget.
+    evictions: int
+    # Entries dropped because their TTL passed.
+    expirations: int
+    compilations: int
+    # Bodies shared with another host instead of compiled again.
+    interned: int
+    entries: int
+    # Distinct compiled robots.txt held by the entries.
+    unique_robots: int
+    bytes: int
+
+
+def _to_bytes(text: Union[str, bytes]) -> bytes:
+    return text if isinstance(text, bytes) else text.encode("utf-8")
+
+
+def _read_sitemaps(num_sitemaps, get_sitemap, ptr) -> List[str]:
+    """Copies the sitemap URLs the C library points to."""
+    length = c_size_t()
+    sitemaps = []
+    for i in range(num_sitemaps(ptr)):
+        data = get_sitemap(ptr, i, ctypes.byref(length))
+        sitemaps.append(ctypes.string_at(data, length.value).decode("utf-8", "replace"))
+    return sitemaps
+
+
+def pack_urls(urls: Sequence[Union[str, bytes]]) -> Tuple[bytes, List[int]]:
+    """
+    Pack URLs into one buffer for CompiledRobots.is_allowed_buffer().
+
+    Returns the buffer and num_urls + 1 offsets; URL i is
+    buffer[offsets[i]:offsets[i + 1]].
+    """
+    encoded = [_to_bytes(url) for url in urls]
+    offsets = [0]
+    for url in encoded:
+        offsets.append(offsets[-1] + len(url))
+    return b"".join(encoded), offsets
+
+
 def get_version() -> str:
     """Get the library version string."""
     return _lib.robots_version().decode("utf-8")
@@ -204,10 +370,18 @@ class RobotsMatcher:
             print(f"Crawl delay: {delay}s")
     """
 
-    def __init__(self):
+    def __init__(self, collect_sitemaps: bool = False):
+        """
+        Args:
+            collect_sitemaps: Collect the Sitemap lines of each checked
+                robots.txt, returned by the sitemaps property. Off by default,
+                so that checks do not allocate for them.
+        """
         self._ptr = _lib.robots_matcher_create()
         if not self._ptr:
             raise MemoryError("Failed to create RobotsMatcher")
+        if collect_sitemaps:
+            _lib.robots_matcher_set_collect_sitemaps(self._ptr, True)
 
     def __del__(self):
         if hasattr(self, "_ptr") and self._ptr:
@@ -243,6 +417,8 @@ class RobotsMatcher:
         robots_bytes = robots_txt.encode("utf-8")
         ua_bytes = user_agent.encode("utf-8")
         url_bytes = url.encode("utf-8")
+        # The sitemaps of the check point into the body.
+        self._robots_bytes = robots_bytes
 
         return _lib.robots_allowed_by_robots(
             self._ptr,
@@ -271,6 +447,7 @@ class RobotsMatcher:
         """
         robots_bytes = robots_txt.encode("utf-8")
         url_bytes = url.encode("utf-8")
+        self._robots_bytes = robots_bytes
 
         # Prepare user-agent arrays
         ua_bytes_list = [ua.encode("utf-8") for ua in user_agents]
@@ -284,6 +461,49 @@ class RobotsMatcher:
             url_bytes, len(url_bytes),
         )
 
+    def is_allowed_batch(
+        self,
+        robots_txt: str,
+        user_agents: Union[str, Sequence[str]],
+        urls: Sequence[str],
+    ) -> List[MatchResult]:
+        """
+        Check many URLs against one robots.txt in a single call.
+
+        The robots.txt is parsed once and all URLs are checked in one call into
+        the C library, which is much faster than calling is_allowed() per URL.
+        The matcher state (matching_line, crawl_delay, ...) is not changed.
+
+        Args:
+            robots_txt: The robots.txt content.
+            user_agents: A user-agent string, or a list of them whose rules
+                are combined like in is_allowed_multi().
+            urls: The URLs to check (should be %-encoded per RFC3986).
+
+        Returns:
+            One MatchResult per URL, in the order of urls.
+        """
+        if isinstance(user_agents, str):
+            user_agents = [user_agents]
+        robots_bytes = robots_txt.encode("utf-8")
+
+        ua_bytes_list = [ua.encode("utf-8") for ua in user_agents]
+        ua_array = (c_char_p * len(ua_bytes_list))(*ua_bytes_list)
+        ua_lens = (c_size_t * len(ua_bytes_list))(*[len(ua) for ua in ua_bytes_list])
+
+        url_bytes_list = [url.encode("utf-8") for url in urls]
+        url_array = (c_char_p * len(url_bytes_list))(*url_bytes_list)
+        url_lens = (c_size_t * len(url_bytes_list))(*[len(url) for url in url_bytes_list])
+
+        results = (_MatchResult * len(url_bytes_list))()
+        _lib.robots_allowed_by_robots_batch(
+            robots_bytes, len(robots_bytes),
+            ua_array, ua_lens, len(ua_bytes_list),
+            url_array, url_lens, len(url_bytes_list),
+            results,
+        )
+        return [MatchResult(r.allowed, r.matching_line) for r in results]
+
     @property
     def matching_line(self) -> int:
         """Get the line number that matched, or 0 if no match."""
@@ -294,6 +514,18 @@ class RobotsMatcher:
         """Check if a specific user-agent block was found (not just '*')."""
         return _lib.robots_ever_seen_specific_agent(self._ptr)
 
+    @property
+    def sitemaps(self) -> List[str]:
+        """Sitemap URLs of the last checked robots.txt, in file order.
+
+        They are collected in the same pass as the check, whatever the
+        user-agent, if the matcher was created with collect_sitemaps=True.
+        Otherwise the list is empty.
+        """
+        if getattr(self, "_robots_bytes", None) is None:
+            return []
+        return _read_sitemaps(_lib.robots_num_sitemaps, _lib.robots_get_sitemap, self._ptr)
+
     @property
     def crawl_delay(self) -> Optional[float]:
         """Get the crawl-delay in seconds, or None if not specified."""
@@ -353,3 +585,206 @@ class RobotsMatcher:
     def allows_search(self) -> bool:
         """Check if search indexing is allowed (defaults to True if not specified)."""
         return _lib.robots_allows_search(self._ptr)
+
+
+class CompiledRobots:
+    """
+    A robots.txt compiled once and checked against any number of URLs.
+
+    The body crosses into the C library only when it is compiled, so checks
+    only pass the user-agents and URLs. A CompiledRobots is immutable and can
+    be used from several threads.
+
+    Example:
+        robots = CompiledRobots(robots_txt)
+        robots.is_allowed("Googlebot", "https://example.com/page")
+
+        buffer, offsets = pack_urls(urls)
+        results = robots.is_allowed_buffer("Googlebot", buffer, offsets)
+    """
+
+    def __init__(self, robots_txt: Union[str, bytes]):
+        robots_bytes = _to_bytes(robots_txt)
+        self._ptr = _lib.robots_compiled_create(robots_bytes, len(robots_bytes))
+        if not self._ptr:
+            raise MemoryError("Failed to compile robots.txt")
+
+    def __del__(self):
+        if getattr(self, "_ptr", None):
+            _lib.robots_compiled_free(self._ptr)
+            self._ptr = None
+
+    @staticmethod
+    def _agents(user_agents: Union[str, Sequence[str]]):
+        if isinstance(user_agents, (str, bytes)):
+            user_agents = [user_agents]
+        ua_bytes_list = [_to_bytes(ua) for ua in user_agents]
+        ua_array = (c_char_p * len(ua_bytes_list))(*ua_bytes_list)
+        ua_lens = (c_size_t * len(ua_bytes_list))(*[len(ua) for ua in ua_bytes_list])
+        return ua_array, ua_lens, len(ua_bytes_list)
+
+    @property
+    def memory_usage(self) -> int:
+        """Approximate number of bytes held by the compiled robots.txt."""
+        return _lib.robots_compiled_memory_usage(self._ptr)
+
+    @property
+    def sitemaps(self) -> List[str]:
+        """Sitemap URLs of the robots.txt, in file order."""
+        return _read_sitemaps(
+            _lib.robots_compiled_num_sitemaps, _lib.robots_compiled_sitemap, self._ptr
+        )
+
+    def is_allowed(self, user_agents: Union[str, Sequence[str]], url: str) -> bool:
+        """Check a URL for a user-agent, or for the combined rules of several."""
+        ua_array, ua_lens, num_agents = self._agents(user_agents)
+        url_bytes = _to_bytes(url)
+        return _lib.robots_compiled_allowed(
+            self._ptr, ua_array, ua_lens, num_agents, url_bytes, len(url_bytes)
+        )
+
+    def is_allowed_batch(
+        self,
+        user_agents: Union[str, Sequence[str]],
+        urls: Sequence[Union[str, bytes]],
+    ) -> List[MatchResult]:
+        """Check many URLs in one call; one MatchResult per URL, in order."""
+        buffer, offsets = pack_urls(urls)
+        return self.is_allowed_buffer(user_agents, buffer, offsets)
+
+    def is_allowed_buffer(
+        self,
+        user_agents: Union[str, Sequence[str]],
+        urls: bytes,
+        offsets: Sequence[int],
+    ) -> List[MatchResult]:
+        """
+        Check the URLs packed in one buffer, see pack_urls().
+
+        URL i is urls[offsets[i]:offsets[i + 1]], so offsets has one more
+        entry than there are URLs. The buffer is passed without a copy.
+        """
+        num_urls = len(offsets) - 1
+        if num_urls < 0:
+            raise ValueError("offsets must have at least one entry")
+        if offsets[-1] > len(urls):
+            raise ValueError("offsets exceed the URL buffer")
+        ua_array, ua_lens, num_agents = self._agents(user_agents)
+        url_offsets = (c_size_t * len(offsets))(*offsets)
+        results = (_MatchResult * num_urls)()
+        if not _lib.robots_compiled_match_batch(
+            self._ptr, ua_array, ua_lens, num_agents,
+            urls, url_offsets, num_urls, results,
+        ):
+            raise ValueError("offsets must not decrease")
+        return [MatchResult(r.allowed, r.matching_line) for r in results]
+
+
+class RobotsCache:
+    """
+    Thread-safe, memory-bounded cache of compiled robots.txt files by host.
+
+    RobotsCache.shared() is the process-wide cache, shared with the C and C++
+    APIs and the other bindings loaded in the process.
+
+    Example:
+        cache = RobotsCache.shared()
+        cache.insert("https://example.com", robots_txt, ttl=3600)
+        allowed = cache.is_allowed("https://example.com", "Googlebot",
+                                   "https://example.com/page")
+    """
+
+    def __init__(self, max_bytes: int = 0, num_shards: int = 0):
+        """Create a private cache; 0 selects the defaults (1 GiB, 64 shards)."""
+        self._ptr = _lib.robots_cache_create(max_bytes, num_shards)
+        if not self._ptr:
+            raise MemoryError("Failed to create RobotsCache")
+        self._owned = True
+
+    @classmethod
+    def shared(cls) -> "RobotsCache":
+        """Return the process-wide cache."""
+        cache = cls.__new__(cls)
+        cache._ptr = _lib.robots_cache_shared()
+        cache._owned = False
+        return cache
+
+    @staticmethod
+    def init_shared(max_bytes: int = 0, num_shards: int = 0) -> bool:
+        """Configure the shared cache. Returns False if it is already in use."""
+        return _lib.robots_cache_init_shared(max_bytes, num_shards)
+
+    def __del__(self):
+        if getattr(self, "_owned", False) and self._ptr:
+            _lib.robots_cache_free(self._ptr)
+            self._ptr = None
+
+    def insert(self, host: str, robots_txt: str, ttl: int = 0) -> None:
+        """Compile robots_txt and cache it for host for ttl seconds (0: 24h)."""
+        host_bytes = host.encode("utf-8")
+        robots_bytes = robots_txt.encode("utf-8")
+        if not _lib.robots_cache_insert(
+            self._ptr, host_bytes, len(host_bytes),
+            robots_bytes, len(robots_bytes), ttl,
+        ):
+            raise MemoryError("Failed to compile robots.txt")
+
+    def fetch(
+        self,
+        host: str,
+        fetch: Callable[[str], Optional[str]],
+        ttl: int = 0,
+    ) -> bool:
+        """
+        Make sure host is cached, calling fetch(host) for its robots.txt if not.
+
+        Concurrent calls for the same host call fetch only once. fetch returns
+        the body, or None if it could not be fetched. Returns whether host is
+        cached now.
+        """
+        def callback(user_data, host_ptr, host_len, body):
+            try:
+                text = fetch(ctypes.string_at(host_ptr, host_len).decode("utf-8"))
+            except Exception:
+                return False
+            if text is None:
+                return False
+            data = text.encode("utf-8")
+            _lib.robots_cache_body_set(body, data, len(data))
+            return True
+
+        host_bytes = host.encode("utf-8")
+        return _lib.robots_cache_fetch(
+            self._ptr, host_bytes, len(host_bytes),
+            _CacheFetchFn(callback), None, ttl,
+        )
+
+    def is_allowed(self, host: str, user_agent: str, url: str) -> Optional[bool]:
+        """Check url against the cached robots.txt of host; None if not cached."""
+        host_bytes = host.encode("utf-8")
+        ua_bytes = user_agent.encode("utf-8")
+        url_bytes = url.encode("utf-8")
+        result = _lib.robots_cache_allowed(
+            self._ptr, host_bytes, len(host_bytes),
+            ua_bytes, len(ua_bytes), url_bytes, len(url_bytes),
+        )
+        return None if result < 0 else result == 1
+
+    def erase(self, host: str) -> None:
+        """Remove host from the cache."""
+        host_bytes = host.encode("utf-8")
+        _lib.robots_cache_erase(self._ptr, host_bytes, len(host_bytes))
+
+    def clear(self) -> None:
+        """Remove all entries. Counters are kept."""
+        _lib.robots_cache_clear(self._ptr)
+
+    @property
+    def stats(self) -> CacheStats:
+        """Hit, miss, eviction and size counters."""
+        stats = _CacheStats()
+        _lib.robots_cache_get_stats(self._ptr, ctypes.byref(stats))
+        return CacheStats(stats.hits, stats.misses, stats.evictions,
+                          stats.expirations, stats.compilations,
+                          stats.interned, stats.entries,
+                          stats.unique_robots, stats.bytes)
@@ -2,7 +2,14 @@
 """Tests for robotstxt Python bindings."""
 
 import unittest
-from robotstxt import RobotsMatcher, get_version, is_valid_user_agent
+from robotstxt import (
+    CompiledRobots,
+    RobotsCache,
+    RobotsMatcher,
+    get_version,
+    is_valid_user_agent,
+    pack_urls,
+)
 
 
 class TestRobotsMatcher(unittest.TestCase):
@@ -95,6 +102,28 @@ Allow: /allowed/
             )
         )
 
+    def test_batch(self):
+        robots_txt = """
+User-agent: *
+Disallow: /admin/
+Allow: /admin/public/
+"""
+        urls = [
+            "https://example.com/page",
+            "https://example.com/admin/secret",
+            "https://example.com/admin/public/x",
+            "https://example.com/admin/secret",
+        ]
+        results = self.matcher.is_allowed_batch(robots_txt, "Googlebot", urls)
+        self.assertEqual([r.allowed for r in results], [True, False, True, False])
+        self.assertEqual([r.matching_line for r in results], [0, 3, 4, 3])
+        for url, result in zip(urls, results):
+            self.assertEqual(
+                result.allowed,
+                self.matcher.is_allowed(robots_txt, "Googlebot", url),
+            )
+        self.assertEqual(self.matcher.is_allowed_batch(robots_txt, ["a", "b"], []), [])
+
     def test_context_manager(self):
         robots_txt = "User-agent: *\nAllow: /\n"
         with RobotsMatcher() as m:
@@ -102,5 +131,131 @@ Allow: /allowed/
             self.assertTrue(result)
 
 
+class TestSitemaps(unittest.TestCase):
+    ROBOTS_TXT = """
+Sitemap: https://example.com/sitemap.xml
+User-agent: Bingbot
+Disallow: /
+Sitemap: https://example.com/news.xml
+"""
+    SITEMAPS = ["https://example.com/sitemap.xml", "https://example.com/news.xml"]
+
+    def test_matcher(self):
+        m = RobotsMatcher(collect_sitemaps=True)
+        self.assertEqual([], m.sitemaps)
+        self.assertTrue(m.is_allowed(self.ROBOTS_TXT, "Googlebot", "https://example.com/"))
+        self.assertEqual(self.SITEMAPS, m.sitemaps)
+        m.is_allowed("User-agent: *\nDisallow: /\n", "Googlebot", "https://example.com/")
+        self.assertEqual([], m.sitemaps)
+
+    def test_matcher_not_collecting(self):
+        m = RobotsMatcher()
+        self.assertTrue(m.is_allowed(self.ROBOTS_TXT, "Googlebot", "https://example.com/"))
+        self.assertEqual([], m.sitemaps)
+
+    def test_compiled(self):
+        self.assertEqual(self.SITEMAPS, CompiledRobots(self.ROBOTS_TXT).sitemaps)
+        self.assertEqual([], CompiledRobots("").sitemaps)
+
+
+class TestCompiledRobots(unittest.TestCase):
+    ROBOTS_TXT = """
+User-agent: *
+Disallow: /admin/
+Allow: /admin/public/
+
+User-agent: Bingbot
+Disallow: /
+"""
+
+    def test_matches_matcher(self):
+        robots = CompiledRobots(self.ROBOTS_TXT)
+        self.assertGreater(robots.memory_usage, 0)
+        matcher = RobotsMatcher()
+        urls = [
+            "https://example.com/page",
+            "https://example.com/admin/secret",
+            "https://example.com/admin/public/x",
+        ]
+        for agent in ["Googlebot", "Bingbot"]:
+            for url in urls:
+                self.assertEqual(
+                    robots.is_allowed(agent, url),
+                    matcher.is_allowed(self.ROBOTS_TXT, agent, url),
+                )
+        self.assertFalse(
+            robots.is_allowed(["Googlebot", "Bingbot"], "https://example.com/page")
+        )
+
+    def test_buffer(self):
+        robots = CompiledRobots(self.ROBOTS_TXT.encode("utf-8"))
+        urls = [
+            "https://example.com/page",
+            "https://example.com/admin/secret",
+            "https://example.com/admin/public/x",
+            "https://example.com/admin/secret",
+        ]
+        buffer, offsets = pack_urls(urls)
+        self.assertEqual(len(offsets), len(urls) + 1)
+        results = robots.is_allowed_buffer("Googlebot", buffer, offsets)
+        self.assertEqual([r.allowed for r in results], [True, False, True, False])
+        self.assertEqual([r.matching_line for r in results], [0, 3, 4, 3])
+        self.assertEqual(robots.is_allowed_batch("Googlebot", urls), results)
+        self.assertEqual(robots.is_allowed_buffer("Googlebot", b"", [0]), [])
+        with self.assertRaises(ValueError):
+            robots.is_allowed_buffer("Googlebot", buffer, [0, len(buffer) + 1])
+        with self.assertRaises(ValueError):
+            robots.is_allowed_buffer("Googlebot", buffer, [4, 2])
+
+
+class TestRobotsCache(unittest.TestCase):
+    def test_insert_and_lookup(self):
+        cache = RobotsCache(num_shards=4)
+        host = "https://example.com"
+        self.assertIsNone(cache.is_allowed(host, "Googlebot", host + "/admin"))
+        cache.insert(host, "User-agent: *\nDisallow: /admin\n")
+        self.assertFalse(cache.is_allowed(host, "Googlebot", host + "/admin"))
+        self.assertTrue(cache.is_allowed(host, "Googlebot", host + "/page"))
+        stats = cache.stats
+        self.assertEqual(stats.hits, 2)
+        self.assertEqual(stats.misses, 1)
+        self.assertEqual(stats.entries, 1)
+        cache.erase(host)
+        self.assertIsNone(cache.is_allowed(host, "Googlebot", host + "/page"))
+
+    def test_interning(self):
+        cache = RobotsCache()
+        cache.insert("https://a.example", "User-agent: *\nDisallow: /\n")
+        cache.insert("https://b.example", "User-agent: *\nDisallow: /\n")
+        stats = cache.stats
+        self.assertEqual(stats.compilations, 1)
+        self.assertEqual(stats.interned, 1)
+        self.assertEqual(stats.entries, 2)
+        self.assertEqual(stats.unique_robots, 1)
+
+    def test_fetch(self):
+        cache = RobotsCache()
+        fetched = []
+
+        def fetch(host):
+            fetched.append(host)
+            return "User-agent: *\nDisallow: /\n"
+
+        self.assertTrue(cache.fetch("https://a.com", fetch))
+        self.assertTrue(cache.fetch("https://a.com", fetch))
+        self.assertEqual(fetched, ["https://a.com"])
+        self.assertFalse(cache.is_allowed("https://a.com", "bot", "https://a.com/"))
+        self.assertFalse(cache.fetch("https://b.com", lambda host: None))
+        self.assertIsNone(cache.is_allowed("https://b.com", "bot", "https://b.com/"))
+
+    def test_shared(self):
+        shared = RobotsCache.shared()
+        shared.insert("https://shared.example", "")
+        self.assertTrue(RobotsCache.shared().is_allowed(
+            "https://shared.example", "bot", "https://shared.example/x"))
+        self.assertFalse(RobotsCache.init_shared())
+        shared.clear()
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -11,6 +11,7 @@
 //! println!("Access: {}", if allowed { "allowed" } else { "disallowed" });
 //! ```
 
+use std::borrow::Cow;
 use std::ffi::{CStr, CString};
 use std::os::raw::{c_char, c_double, c_int, c_void};
 
@@ -20,6 +21,11 @@ struct RobotsMatcherOpaque {
     _private: [u8; 0],
 }
 
+#[repr(C)]
+struct RobotsCompiledOpaque {
+    _private: [u8; 0],
+}
+
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
 pub struct RequestRate {
@@ -35,6 +41,16 @@ pub struct ContentSignal {
     pub search: i8,
 }
 
+/// Result of checking one URL with [`CompiledRobots::match_batch`].
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct MatchResult {
+    /// Whether the URL may be fetched.
+    pub allowed: bool,
+    /// Line of the rule that decided, or 0 if no rule matched.
+    pub matching_line: c_int,
+}
+
 extern "C" {
     fn robots_matcher_create() -> *mut RobotsMatcherOpaque;
     fn robots_matcher_free(matcher: *mut RobotsMatcherOpaque);
@@ -49,6 +65,35 @@ extern "C" {
         url_len: usize,
     ) -> bool;
 
+    fn robots_compiled_create(robots_txt: *const c_char, robots_txt_len: usize)
+        -> *mut RobotsCompiledOpaque;
+    fn robots_compiled_free(compiled: *mut RobotsCompiledOpaque);
+    fn robots_compiled_memory_usage(compiled: *const RobotsCompiledOpaque) -> usize;
+    fn robots_compiled_num_sitemaps(compiled: *const RobotsCompiledOpaque) -> usize;
+    fn robots_compiled_sitemap(
+        compiled: *const RobotsCompiledOpaque,
+        index: usize,
+        len: *mut usize,
+    ) -> *const c_char;
+    fn robots_compiled_allowed(
+        compiled: *const RobotsCompiledOpaque,
+        user_agents: *const *const c_char,
+        user_agent_lens: *const usize,
+        num_user_agents: usize,
+        url: *const c_char,
+        url_len: usize,
+    ) -> bool;
+    fn robots_compiled_match_batch(
+        compiled: *const RobotsCompiledOpaque,
+        user_agents: *const *const c_char,
+        user_agent_lens: *const usize,
+        num_user_agents: usize,
+        urls: *const c_char,
+        url_offsets: *const usize,
+        num_urls: usize,
+        results: *mut MatchResult,
+    ) -> bool;
+
     fn robots_matching_line(matcher: *const RobotsMatcherOpaque) -> c_int;
     fn robots_ever_seen_specific_agent(matcher: *const RobotsMatcherOpaque) -> bool;
 
@@ -218,6 +263,149 @@ impl Drop for RobotsMatcher {
 unsafe impl Send for RobotsMatcher {}
 unsafe impl Sync for RobotsMatcher {}
 
+/// A robots.txt compiled once and checked against any number of URLs.
+///
+/// The body crosses the FFI boundary only in [`CompiledRobots::new`]; checks
+/// pass the user-agents and URLs as borrowed slices, without copies.
+pub struct CompiledRobots {
+    ptr: *mut RobotsCompiledOpaque,
+}
+
+impl CompiledRobots {
+    /// Compiles a robots.txt.
+    pub fn new(robots_txt: impl AsRef<[u8]>) -> Self {
+        let body = robots_txt.as_ref();
+        let ptr = unsafe { robots_compiled_create(body.as_ptr() as *const c_char, body.len()) };
+        assert!(!ptr.is_null(), "Failed to compile robots.txt");
+        Self { ptr }
+    }
+
+    /// Returns the approximate number of bytes held by the compiled robots.txt.
+    pub fn memory_usage(&self) -> usize {
+        unsafe { robots_compiled_memory_usage(self.ptr) }
+    }
+
+    /// Returns the sitemap URLs of the robots.txt, in file order. They borrow
+    /// from the compiled robots.txt and are only copied if not valid UTF-8.
+    pub fn sitemaps(&self) -> Vec<Cow<'_, str>> {
+        let count = unsafe { robots_compiled_num_sitemaps(self.ptr) };
+        (0..count)
+            .map(|i| {
+                let mut len = 0usize;
+                let bytes = unsafe {
+                    let data = robots_compiled_sitemap(self.ptr, i, &mut len);
+                    std::slice::from_raw_parts(data as *const u8, len)
+                };
+                String::from_utf8_lossy(bytes)
+            })
+            .collect()
+    }
+
+    /// Checks if a URL is allowed for a single user-agent.
+    pub fn is_allowed(&self, user_agent: &str, url: &str) -> bool {
+        self.is_allowed_multi(&[user_agent], url)
+    }
+
+    /// Checks if a URL is allowed for the combined rules of several user-agents.
+    pub fn is_allowed_multi(&self, user_agents: &[&str], url: &str) -> bool {
+        let (agents, agent_lens) = agent_arrays(user_agents);
+        unsafe {
+            robots_compiled_allowed(
+                self.ptr,
+                agents.as_ptr(),
+                agent_lens.as_ptr(),
+                agents.len(),
+                url.as_ptr() as *const c_char,
+                url.len(),
+            )
+        }
+    }
+
+    /// Checks many URLs for the same user-agents in a single call.
+    pub fn match_batch<S: AsRef<str>>(&self, user_agents: &[&str], urls: &[S]) -> Vec<MatchResult> {
+        let (buffer, offsets) = pack_urls(urls);
+        self.match_buffer(user_agents, &buffer, &offsets)
+            .expect("packed offsets are valid")
+    }
+
+    /// Checks the URLs packed in `urls`: URL `i` is `urls[offsets[i]..offsets[i + 1]]`,
+    /// see [`pack_urls`]. The buffer is passed without a copy.
+    ///
+    /// Returns `None` if `offsets` is empty, decreases or exceeds `urls`.
+    pub fn match_buffer(
+        &self,
+        user_agents: &[&str],
+        urls: &[u8],
+        offsets: &[usize],
+    ) -> Option<Vec<MatchResult>> {
+        let num_urls = offsets.len().checked_sub(1)?;
+        if offsets[num_urls] > urls.len() {
+            return None;
+        }
+        let (agents, agent_lens) = agent_arrays(user_agents);
+        let mut results = vec![
+            MatchResult {
+                allowed: true,
+                matching_line: 0,
+            };
+            num_urls
+        ];
+        let valid = unsafe {
+            robots_compiled_match_batch(
+                self.ptr,
+                agents.as_ptr(),
+                agent_lens.as_ptr(),
+                agents.len(),
+                urls.as_ptr() as *const c_char,
+                offsets.as_ptr(),
+                num_urls,
+                results.as_mut_ptr(),
+            )
+        };
+        if valid {
+            Some(results)
+        } else {
+            None
+        }
+    }
+}
+
+impl Drop for CompiledRobots {
+    fn drop(&mut self) {
+        if !self.ptr.is_null() {
+            unsafe {
+                robots_compiled_free(self.ptr);
+            }
+        }
+    }
+}
+
+// A compiled robots.txt is immutable, so it can be shared by threads.
+unsafe impl Send for CompiledRobots {}
+unsafe impl Sync for CompiledRobots {}
+
+/// Packs URLs into one buffer for [`CompiledRobots::match_buffer`].
+///
+/// Returns the buffer and `urls.len() + 1` offsets into it.
+pub fn pack_urls<S: AsRef<str>>(urls: &[S]) -> (Vec<u8>, Vec<usize>) {
+    let total = urls.iter().map(|url| url.as_ref().len()).sum();
+    let mut buffer = Vec::with_capacity(total);
+    let mut offsets = Vec::with_capacity(urls.len() + 1);
+    offsets.push(0);
+    for url in urls {
+        buffer.extend_from_slice(url.as_ref().as_bytes());
+        offsets.push(buffer.len());
+    }
+    (buffer, offsets)
+}
+
+fn agent_arrays(user_agents: &[&str]) -> (Vec<*const c_char>, Vec<usize>) {
+    (
+        user_agents.iter().map(|ua| ua.as_ptr() as *const c_char).collect(),
+        user_agents.iter().map(|ua| ua.len()).collect(),
+    )
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -257,4 +445,53 @@ mod tests {
         m.is_allowed(robots, "Googlebot", "https://example.com/");
         assert_eq!(m.crawl_delay(), Some(2.5));
     }
+
+    const COMPILED_ROBOTS: &str =
+        "User-agent: *\nDisallow: /admin/\nAllow: /admin/public/\n\nUser-agent: Bingbot\nDisallow: /\n";
+    const COMPILED_URLS: [&str; 4] = [
+        "https://example.com/page",
+        "https://example.com/admin/secret",
+        "https://example.com/admin/public/x",
+        "https://example.com/admin/secret",
+    ];
+
+    #[test]
+    fn test_compiled_matches_matcher() {
+        let compiled = CompiledRobots::new(COMPILED_ROBOTS);
+        assert!(compiled.memory_usage() > 0);
+        let m = RobotsMatcher::new();
+        for agent in ["Googlebot", "Bingbot"] {
+            for url in COMPILED_URLS {
+                assert_eq!(compiled.is_allowed(agent, url), m.is_allowed(COMPILED_ROBOTS, agent, url));
+            }
+        }
+        assert!(!compiled.is_allowed_multi(&["Googlebot", "Bingbot"], "https://example.com/page"));
+    }
+
+    #[test]
+    fn test_compiled_sitemaps() {
+        let compiled = CompiledRobots::new(
+            "Sitemap: https://example.com/a.xml\nUser-agent: Bingbot\nDisallow: /\nSitemap: https://example.com/b.xml\n",
+        );
+        assert_eq!(compiled.sitemaps(), ["https://example.com/a.xml", "https://example.com/b.xml"]);
+        assert!(CompiledRobots::new("User-agent: *\n").sitemaps().is_empty());
+    }
+
+    #[test]
+    fn test_compiled_buffer() {
+        let compiled = CompiledRobots::new(COMPILED_ROBOTS.as_bytes());
+        let (buffer, offsets) = pack_urls(&COMPILED_URLS);
+        assert_eq!(offsets.len(), COMPILED_URLS.len() + 1);
+        let results = compiled.match_buffer(&["Googlebot"], &buffer, &offsets).unwrap();
+        let allowed: Vec<bool> = results.iter().map(|r| r.allowed).collect();
+        let lines: Vec<i32> = results.iter().map(|r| r.matching_line).collect();
+        assert_eq!(allowed, [true, false, true, false]);
+        assert_eq!(lines, [0, 2, 3, 2]);
+        assert_eq!(compiled.match_batch(&["Googlebot"], &COMPILED_URLS), results);
+
+        assert_eq!(compiled.match_buffer(&["Googlebot"], &[], &[0]), Some(vec![]));
+        assert_eq!(compiled.match_buffer(&["Googlebot"], &buffer, &[]), None);
+        assert_eq!(compiled.match_buffer(&["Googlebot"], &buffer, &[0, buffer.len() + 1]), None);
+        assert_eq!(compiled.match_buffer(&["Googlebot"], &buffer, &[4, 2]), None);
+    }
 }
@@ -38,7 +38,7 @@ static const std::vector<std::string> kUnsupportedTags = {
     // Other
     "license"};
 
-void RobotsParsingReporter::Digest(int line_num,
+void RobotsParsingReporterBase::Digest(int line_num,
                                    RobotsParsedLine::RobotsTagName parsed_tag) {
   if (line_num > last_line_seen_) {
     last_line_seen_ = line_num;
@@ -48,58 +48,55 @@ void RobotsParsingReporter::Digest(int line_num,
     ++valid_directives_;
   }
 
-  RobotsParsedLine& line = robots_parse_results_[line_num];
-  line.line_num = line_num;
-  line.tag_name = parsed_tag;
+  Line(line_num).tag_name = parsed_tag;
 }
 
-void RobotsParsingReporter::ReportLineMetadata(int line_num,
+void RobotsParsingReporterBase::ReportLineMetadata(int line_num,
                                                const LineMetadata& metadata) {
   if (line_num > last_line_seen_) {
     last_line_seen_ = line_num;
   }
-  RobotsParsedLine& line = robots_parse_results_[line_num];
-  line.line_num = line_num;
+  RobotsParsedLine& line = Line(line_num);
   line.is_typo = metadata.is_acceptable_typo;
   line.metadata = metadata;
 }
 
-void RobotsParsingReporter::HandleRobotsStart() {
+void RobotsParsingReporterBase::HandleRobotsStart() {
   last_line_seen_ = 0;
   valid_directives_ = 0;
   unused_directives_ = 0;
 }
-void RobotsParsingReporter::HandleRobotsEnd() {}
-void RobotsParsingReporter::HandleUserAgent(int line_num,
+void RobotsParsingReporterBase::HandleRobotsEnd() {}
+void RobotsParsingReporterBase::HandleUserAgent(int line_num,
                                             std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kUserAgent);
 }
-void RobotsParsingReporter::HandleAllow(int line_num,
+void RobotsParsingReporterBase::HandleAllow(int line_num,
                                         std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kAllow);
 }
-void RobotsParsingReporter::HandleDisallow(int line_num,
+void RobotsParsingReporterBase::HandleDisallow(int line_num,
                                            std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kDisallow);
 }
-void RobotsParsingReporter::HandleSitemap(int line_num,
+void RobotsParsingReporterBase::HandleSitemap(int line_num,
                                           std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kSitemap);
 }
-void RobotsParsingReporter::HandleCrawlDelay(int line_num, double value) {
+void RobotsParsingReporterBase::HandleCrawlDelay(int line_num, double value) {
   Digest(line_num, RobotsParsedLine::kCrawlDelay);
 }
-void RobotsParsingReporter::HandleRequestRate(int line_num,
+void RobotsParsingReporterBase::HandleRequestRate(int line_num,
                                               const RequestRate& rate) {
   Digest(line_num, RobotsParsedLine::kRequestRate);
 }
 #if ROBOTS_SUPPORT_CONTENT_SIGNAL
-void RobotsParsingReporter::HandleContentSignal(int line_num,
+void RobotsParsingReporterBase::HandleContentSignal(int line_num,
                                                 const ContentSignal& signal) {
   Digest(line_num, RobotsParsedLine::kContentSignal);
 }
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
-void RobotsParsingReporter::HandleUnknownAction(int line_num,
+void RobotsParsingReporterBase::HandleUnknownAction(int line_num,
                                                 std::string_view action,
                                                 std::string_view line_value) {
   RobotsParsedLine::RobotsTagName rtn =
@@ -111,4 +108,33 @@ void RobotsParsingReporter::HandleUnknownAction(int line_num,
   Digest(line_num, rtn);
 }
 
+RobotsParsedLine& RobotsParsingReporter::Line(int line_num) {
+  RobotsParsedLine& line = robots_parse_results_[line_num];
+  line.line_num = line_num;
+  return line;
+}
+
+void FlatRobotsParsingReporter::HandleRobotsStart() {
+  RobotsParsingReporterBase::HandleRobotsStart();
+  lines_.clear();
+}
+
+RobotsParsedLine& FlatRobotsParsingReporter::Line(int line_num) {
+  if (lines_.empty() || lines_.back().line_num < line_num) {
+    lines_.emplace_back().line_num = line_num;
+    return lines_.back();
+  }
+  if (lines_.back().line_num == line_num) return lines_.back();
+  // Lines reported out of order, which the parsers don't do.
+  auto it = std::lower_bound(lines_.begin(), lines_.end(), line_num,
+                             [](const RobotsParsedLine& line, int num) {
+                               return line.line_num < num;
+                             });
+  if (it == lines_.end() || it->line_num != line_num) {
+    it = lines_.insert(it, RobotsParsedLine());
+    it->line_num = line_num;
+  }
+  return *it;
+}
+
 }  // namespace googlebot
@@ -1,6 +1,7 @@
 #ifndef THIRD_PARTY_ROBOTSTXT_REPORTING_ROBOTS_H_
 #define THIRD_PARTY_ROBOTSTXT_REPORTING_ROBOTS_H_
 
+#include <cstddef>
 #include <map>
 #include <string_view>
 #include <vector>
@@ -42,7 +43,31 @@ struct RobotsParsedLine {
   RobotsParseHandler::LineMetadata metadata;
 };
 
-class RobotsParsingReporter : public googlebot::RobotsParseHandler {
+#ifdef ROBOTS_HAVE_SPAN
+using RobotsParsedLines = std::span<const RobotsParsedLine>;
+#else
+// A view of consecutive RobotsParsedLine, std::span before C++20.
+class RobotsParsedLines {
+ public:
+  RobotsParsedLines(const RobotsParsedLine* data, size_t size)
+      : data_(data), size_(size) {}
+
+  const RobotsParsedLine* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const RobotsParsedLine* begin() const { return data_; }
+  const RobotsParsedLine* end() const { return data_ + size_; }
+  const RobotsParsedLine& operator[](size_t i) const { return data_[i]; }
+
+ private:
+  const RobotsParsedLine* data_;
+  size_t size_;
+};
+#endif  // ROBOTS_HAVE_SPAN
+
+// Classifies the lines of a robots.txt into RobotsParsedLine. The reporters
+// below differ only in how they store the lines.
+class RobotsParsingReporterBase : public googlebot::RobotsParseHandler {
  public:
   void HandleRobotsStart() override;
   void HandleRobotsEnd() override;
@@ -62,6 +87,23 @@ class RobotsParsingReporter : public googlebot::RobotsParseHandler {
   int last_line_seen() const { return last_line_seen_; }
   int valid_directives() const { return valid_directives_; }
   int unused_directives() const { return unused_directives_; }
+
+ protected:
+  // Returns the stored line numbered 'line_num', adding it if needed.
+  virtual RobotsParsedLine& Line(int line_num) = 0;
+
+ private:
+  void Digest(int line_num, RobotsParsedLine::RobotsTagName parsed_tag);
+
+  int last_line_seen_ = 0;
+  int valid_directives_ = 0;
+  int unused_directives_ = 0;
+};
+
+// Keeps the lines in a map. Results of earlier parses are kept and merged
+// with the lines of later ones.
+class RobotsParsingReporter : public RobotsParsingReporterBase {
+ public:
   std::vector<RobotsParsedLine> parse_results() const {
     std::vector<RobotsParsedLine> vec;
     for (const auto& entry : robots_parse_results_) {
@@ -70,14 +112,32 @@ class RobotsParsingReporter : public googlebot::RobotsParseHandler {
     return vec;
   }
 
- private:
-  void Digest(int line_num, RobotsParsedLine::RobotsTagName parsed_tag);
+ protected:
+  RobotsParsedLine& Line(int line_num) override;
 
+ private:
   // Indexed and sorted by line number.
   std::map<int, RobotsParsedLine> robots_parse_results_;
-  int last_line_seen_ = 0;
-  int valid_directives_ = 0;
-  int unused_directives_ = 0;
+};
+
+// Keeps the lines of the last parse in one flat buffer sorted by line number,
+// which is how the parser reports them. A new parse drops the lines of the
+// previous one but keeps the buffer, so reusing one reporter for many files
+// doesn't allocate once the buffer has grown to the longest of them.
+class FlatRobotsParsingReporter : public RobotsParsingReporterBase {
+ public:
+  void HandleRobotsStart() override;
+
+  // Valid until the next parse, not copied.
+  RobotsParsedLines parse_results() const {
+    return RobotsParsedLines(lines_.data(), lines_.size());
+  }
+
+ protected:
+  RobotsParsedLine& Line(int line_num) override;
+
+ private:
+  std::vector<RobotsParsedLine> lines_;
 };
 }  // namespace googlebot
 #endif  // THIRD_PARTY_ROBOTSTXT_REPORTING_ROBOTS_H_
@@ -29,21 +29,68 @@
 //   https://developers.google.com/search/docs/crawling-indexing/robots/robots_txt
 //
 // This library provides a low-level parser for robots.txt (ParseRobotsTxt()),
-// and a matcher for URLs against a robots.txt (class RobotsMatcher).
+// a matcher for URLs against a robots.txt (class RobotsMatcher), and a
+// pre-parsed robots.txt for matching many URLs (class CompiledRobots).
 
 #ifndef THIRD_PARTY_ROBOTSTXT_ROBOTS_H__
 #define THIRD_PARTY_ROBOTSTXT_ROBOTS_H__
 
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+// std::span overloads are only offered to C++20 callers, the library itself
+// builds as C++17.
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#include <span>
+#define ROBOTS_HAVE_SPAN 1
+#endif
+
+// Matching behaviour beyond RFC 9309. Each switch defaults to 1, the behaviour
+// of Google's parser. Defining it to 0 compiles the code path out, for builds
+// that only need the standard and a leaner parser and matcher:
+//   ROBOTS_ALLOW_FREQUENT_TYPOS: keys with frequent typos, like "disalow" or
+//     "useragent", count as the directive they misspell.
+//   ROBOTS_DECODE_PERCENT_ESCAPES: a %XX escape in a path or pattern matches
+//     the byte it encodes, so "/a%2Fb" matches "/a/b". With 0, escapes only
+//     match themselves, with case-insensitive hex digits.
+//   ROBOTS_NORMALIZE_INDEX_HTML: "Allow: /dir/index.htm" and ".../index.html"
+//     also allow "/dir/".
+//   ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES: parse Crawl-delay and Request-rate.
+//     With 0 they are unknown directives, and the default of
+//     ROBOTS_SUPPORT_CONTENT_SIGNAL below.
+// The URL parser is chosen at build time too: ada-url with ROBOTS_USE_ADA,
+// a built-in parser otherwise.
+#ifndef ROBOTS_ALLOW_FREQUENT_TYPOS
+#define ROBOTS_ALLOW_FREQUENT_TYPOS 1
+#endif
+#ifndef ROBOTS_DECODE_PERCENT_ESCAPES
+#define ROBOTS_DECODE_PERCENT_ESCAPES 1
+#endif
+#ifndef ROBOTS_NORMALIZE_INDEX_HTML
+#define ROBOTS_NORMALIZE_INDEX_HTML 1
+#endif
+#ifndef ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+#define ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES 1
+#endif
+
 // Content-Signal directive support (proposed for AI content preferences).
 // Define ROBOTS_SUPPORT_CONTENT_SIGNAL=0 to disable for smaller binary/faster parsing.
-// Default: enabled (1)
+// Default: ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES, enabled (1)
 #ifndef ROBOTS_SUPPORT_CONTENT_SIGNAL
-#define ROBOTS_SUPPORT_CONTENT_SIGNAL 1
+#define ROBOTS_SUPPORT_CONTENT_SIGNAL ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+#endif
+
+// Hot-path statistics, see RobotsStats. Define ROBOTS_ENABLE_STATS=1 to count
+// and time the work of the parser and matchers. Default: disabled (0), which
+// compiles the counters out.
+#ifndef ROBOTS_ENABLE_STATS
+#define ROBOTS_ENABLE_STATS 0
 #endif
 
 namespace googlebot {
@@ -155,6 +202,18 @@ class RobotsParseHandler {
   };
 
   virtual void ReportLineMetadata(int line_num, const LineMetadata& metadata) {}
+
+  // Asked after each line. Returning true tells the parser that no later line
+  // can change what the handler computes: the rest of the body is skipped and
+  // HandleRobotsEnd() is called right away.
+  virtual bool CanStopParsing() const { return false; }
+
+  // Asked after each line, like CanStopParsing(). Returning true tells the
+  // parser that no line before the next user-agent line can change what the
+  // handler computes, except sitemap lines, which belong to no group: the
+  // parser may skip the other lines without any callback, ReportLineMetadata()
+  // included. Line numbers still count them.
+  virtual bool CanSkipToNextUserAgent() const { return false; }
 };
 
 // Parses body of a robots.txt and emits parse callbacks. This will accept
@@ -165,6 +224,150 @@ class RobotsParseHandler {
 void ParseRobotsTxt(std::string_view robots_body,
                     RobotsParseHandler* parse_callback);
 
+// SHA-256 digest of a robots.txt body. A digest identifies a body without
+// keeping it: RobotsCache shares the CompiledRobots of bodies with the same
+// digest.
+using BodyDigest = std::array<uint8_t, 32>;
+BodyDigest DigestBody(std::string_view body);
+
+// RobotsTxtStreamParser - ParseRobotsTxt() for a body received in chunks.
+//
+// The chunks are passed to Feed() in order, then Finish() ends the body. The
+// handler gets the same callbacks as from ParseRobotsTxt() on the whole body,
+// wherever the chunks are split: inside a line, between the CR and LF of a
+// line ending or inside the byte order mark. Lines are parsed from the chunks
+// in place, only a line spanning chunks is copied, up to the length at which
+// lines are truncated.
+//
+// Example:
+//   RobotsTxtStreamParser parser(&handler);
+//   while (ReadChunk(&chunk) && parser.Feed(chunk)) {}
+//   parser.Finish();
+class RobotsTxtStreamParser {
+ public:
+  explicit RobotsTxtStreamParser(RobotsParseHandler* handler);
+
+  // Disallow copying and assignment.
+  RobotsTxtStreamParser(const RobotsTxtStreamParser&) = delete;
+  RobotsTxtStreamParser& operator=(const RobotsTxtStreamParser&) = delete;
+
+  // Parses the lines completed by 'chunk'. Returns false once the handler can
+  // stop parsing (RobotsParseHandler::CanStopParsing()): the rest of the body
+  // is not needed and further chunks are ignored.
+  bool Feed(std::string_view chunk);
+
+  // Parses the last line and calls HandleRobotsEnd(). Call it once, after the
+  // last chunk, even if parsing stopped early.
+  void Finish();
+
+  // True once the handler stopped parsing.
+  bool stopped() const { return stopped_; }
+
+ private:
+  // Calls HandleRobotsStart() on the first chunk.
+  void Start();
+  // Parses the pending line, completed with 'tail'.
+  void EmitLine(std::string_view tail);
+
+  RobotsParseHandler* const handler_;
+  // Start of a line spanning chunks, truncated like lines are.
+  std::string line_;
+  // Length of that line before truncation.
+  size_t line_length_ = 0;
+  int line_num_ = 0;
+  // Bytes of the byte order mark skipped so far.
+  int bom_bytes_ = 0;
+  bool started_ = false;
+  bool in_bom_ = true;
+  bool last_was_carriage_return_ = false;
+  bool stopped_ = false;
+  // The handler can skip to the next user-agent line.
+  bool skip_to_user_agent_ = false;
+};
+
+// Counters of the work done by the parser and the matchers of the calling
+// thread, to find out where the time goes for a slow robots.txt and to flag
+// adversarial ones. They are only collected when built with
+// ROBOTS_ENABLE_STATS=1; otherwise GetRobotsStats() returns zeros.
+//
+// The phases nest: parse_ns includes classify_ns and, for RobotsMatcher, which
+// matches while it parses, match_ns. Timing a phase costs two clock reads, so
+// collecting stats slows down matching noticeably.
+struct RobotsStats {
+  // Bytes of robots.txt bodies given to the parsers.
+  uint64_t bytes = 0;
+  // Lines of those bodies, including lines skipped without being parsed.
+  uint64_t lines = 0;
+  // Lines with a key and a value.
+  uint64_t directives = 0;
+  // URLs whose path was extracted for matching.
+  uint64_t urls = 0;
+  // Allow/Disallow patterns matched against a path one by one. The literal
+  // patterns that ResolvedRobots matches in its trie are not counted.
+  uint64_t patterns_evaluated = 0;
+  // Path positions added to the position set by a '*' of a pattern.
+  uint64_t wildcard_expansions = 0;
+  // Positions examined by the wildcard matcher, its total work, and the most
+  // for a single pattern: large values flag a pathological robots.txt.
+  uint64_t match_steps = 0;
+  uint64_t max_match_steps = 0;
+
+  // Nanoseconds spent extracting paths from URLs (GetPathParamsQuery()),
+  // parsing, classifying keys and matching patterns.
+  uint64_t url_ns = 0;
+  uint64_t parse_ns = 0;
+  uint64_t classify_ns = 0;
+  uint64_t match_ns = 0;
+
+  // Adds the counters of 'other', e.g. from another thread.
+  void Merge(const RobotsStats& other);
+};
+
+// True iff the library collects RobotsStats.
+constexpr bool kRobotsStatsEnabled = ROBOTS_ENABLE_STATS;
+
+// Returns the counters of the calling thread since it started or since the
+// last ResetRobotsStats().
+RobotsStats GetRobotsStats();
+
+// Sets the counters of the calling thread to zero.
+void ResetRobotsStats();
+
+// Limits on the work of matching one URL, for robots.txt files of unknown
+// origin. Allow/Disallow patterns with '*' are matched against a set of path
+// positions, so a pattern like "/*a*a*a*a*b" costs up to the length of the
+// path for each of its characters, and a hostile file can repeat it on
+// thousands of lines. A check that would go over these limits stops matching
+// and returns the 'allow_on_exceeded' verdict instead, and reports that it did.
+//
+// The caps apply to each pattern that the check evaluates, the steps to all of
+// them together. By default there are no limits, which is what the reference
+// matcher does.
+struct MatchBudget {
+  // Longest pattern, in bytes, and most '*' in a pattern.
+  size_t max_pattern_length = std::numeric_limits<size_t>::max();
+  size_t max_wildcards = std::numeric_limits<size_t>::max();
+  // Path positions that the wildcard matcher may examine, summed over the
+  // patterns of a check. Counted like RobotsStats::match_steps: plain prefix
+  // patterns that need no position set cost nothing.
+  uint64_t max_steps = std::numeric_limits<uint64_t>::max();
+  // Verdict of a check that went over the budget. Not crawling is the
+  // conservative choice, as nothing is known about the rules left unmatched.
+  bool allow_on_exceeded = false;
+};
+
+// How the matchers below get the path to match from a URL.
+enum class UrlMode {
+  // Parses the URL, with ada-url when built with ROBOTS_USE_ADA. This is the
+  // default and the right choice for URLs of unknown origin.
+  kParse,
+  // Trusts the URL to be absolute and canonical, e.g. as normalized by a crawl
+  // frontier ("https://example.com/path?query"). The path and query are sliced
+  // out with a single scan instead of being parsed. Results for URLs that
+  // are not canonical are unspecified.
+  kTrustedCanonical,
+};
+
 // RobotsMatcher - matches robots.txt against URLs.
 //
 // The Matcher uses a default match strategy for Allow/Disallow patterns which
@@ -209,13 +412,50 @@ class RobotsMatcher : protected RobotsParseHandler {
   // according to RFC3986.
   bool AllowedByRobots(std::string_view robots_body,
                        const std::vector<std::string>* user_agents,
-                       const std::string& url);
+                       std::string_view url);
+
+  // Same as above for the "num_user_agents" agents at 'user_agents'. None of
+  // the arguments are copied: a check only allocates if the path of 'url'
+  // contains '*' or '$', which have to be %-encoded for matching.
+  bool AllowedByRobots(std::string_view robots_body,
+                       const std::string_view* user_agents,
+                       size_t num_user_agents, std::string_view url);
+
+#ifdef ROBOTS_HAVE_SPAN
+  bool AllowedByRobots(std::string_view robots_body,
+                       std::span<const std::string_view> user_agents,
+                       std::string_view url) {
+    return AllowedByRobots(robots_body, user_agents.data(), user_agents.size(),
+                           url);
+  }
+#endif
 
   // Do robots check for 'url' when there is only one user agent. 'url' must
   // be %-encoded according to RFC3986.
   bool OneAgentAllowedByRobots(std::string_view robots_txt,
-                               const std::string& user_agent,
-                               const std::string& url);
+                               std::string_view user_agent,
+                               std::string_view url);
+
+  // Sets how the *AllowedByRobots() methods extract the path from their 'url'.
+  void set_url_mode(UrlMode mode) { url_mode_ = mode; }
+  UrlMode url_mode() const { return url_mode_; }
+
+  // Sets whether the lines of groups for other user agents are skipped up to
+  // the next user-agent line instead of being parsed. Skipped lines cannot
+  // change any result, so this is on by default; turn it off for subclasses
+  // that need the callbacks of every line.
+  void set_skip_other_groups(bool skip) { skip_other_groups_ = skip; }
+  bool skip_other_groups() const { return skip_other_groups_; }
+
+  // Sets the limits on the work of each check. They only apply to the default
+  // match strategy.
+  void set_match_budget(const MatchBudget& budget) { match_budget_ = budget; }
+  const MatchBudget& match_budget() const { return match_budget_; }
+
+  // Sets whether checks collect the Sitemap lines of the robots.txt, which
+  // apply to the whole file whatever the user agents. Off by default.
+  void set_collect_sitemaps(bool collect) { collect_sitemaps_ = collect; }
+  bool collect_sitemaps() const { return collect_sitemaps_; }
 
   // Returns true if we are disallowed from crawling a matching URI.
   bool disallow() const;
@@ -232,6 +472,10 @@ class RobotsMatcher : protected RobotsParseHandler {
   // Returns the line that matched or 0 if none matched.
   int matching_line() const;
 
+  // Returns true iff the last check went over the match budget. disallow()
+  // then returns the verdict of the budget and matching_line() returns 0.
+  bool budget_exceeded() const { return budget_exceeded_; }
+
   // Returns the crawl-delay value in seconds for the matched user-agent.
   // Returns std::nullopt if no crawl-delay was specified.
   // Note: This is a non-standard directive that Google ignores, but other
@@ -250,6 +494,11 @@ class RobotsMatcher : protected RobotsParseHandler {
   std::optional<ContentSignal> GetContentSignal() const;
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
 
+  // Returns the non-empty values of the Sitemap lines of the last checked
+  // robots.txt, in file order, if set_collect_sitemaps(true) was called. They
+  // point into that robots.txt, which must outlive them: nothing is copied.
+  const std::vector<std::string_view>& sitemaps() const { return sitemaps_; }
+
  protected:
   // Parse callbacks.
   // Protected because used in unittest. Never override RobotsMatcher, implement
@@ -269,6 +518,7 @@ class RobotsMatcher : protected RobotsParseHandler {
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
   void HandleUnknownAction(int line_num, std::string_view action,
                            std::string_view value) override;
+  bool CanSkipToNextUserAgent() const override;
 
  protected:
   // Extract the matchable part of a user agent string, essentially stopping at
@@ -279,7 +529,9 @@ class RobotsMatcher : protected RobotsParseHandler {
   // Initialize next path and user-agents to check. Path must contain only the
   // path, params, and query (if any) of the url and must start with a '/'.
   void InitUserAgentsAndPath(const std::vector<std::string>* user_agents,
-                             const char* path);
+                             std::string_view path);
+  void InitUserAgentsAndPath(const std::string_view* user_agents,
+                             size_t num_user_agents, std::string_view path);
 
   // Returns true if any user-agent was seen.
   bool seen_any_agent() const {
@@ -348,13 +600,39 @@ class RobotsMatcher : protected RobotsParseHandler {
   // Used to implement "most specific wins" rule per Google's documentation.
   size_t best_specific_agent_length_;
 
-  // The path we want to pattern match. Not owned and only a valid pointer
-  // during the lifetime of *AllowedByRobots calls.
-  const char* path_;
-  // The User-Agents we are interested in. Not owned and only a valid
-  // pointer during the lifetime of *AllowedByRobots calls.
+  // Returns true if 'user_agent' is one of the User-Agents we are interested
+  // in, ignoring case.
+  bool IsQueriedAgent(std::string_view user_agent) const;
+
+  // Calls the handlers of RobotsMatcher without virtual dispatch. Defined in
+  // robots.cc.
+  class DirectHandler;
+  // Parses 'robots_body' into this matcher, through a DirectHandler unless
+  // this is an instance of a subclass.
+  void Parse(std::string_view robots_body);
+
+  // The path we want to pattern match. Not owned and only valid during the
+  // lifetime of *AllowedByRobots calls.
+  std::string_view path_;
+  // Holds the path when it can't point into the url, reused across calls.
+  std::string path_buffer_;
+  UrlMode url_mode_ = UrlMode::kParse;
+  bool skip_other_groups_ = true;
+  bool collect_sitemaps_ = false;
+  MatchBudget match_budget_;
+  // Steps of match_budget_ left for the current check, and whether the check
+  // went over the budget.
+  uint64_t budget_steps_left_ = 0;
+  bool budget_exceeded_ = false;
+  // The User-Agents we are interested in, either as a vector or as an array
+  // of 'num_user_agent_views_' views. Not owned and only valid during the
+  // lifetime of *AllowedByRobots calls.
   const std::vector<std::string>* user_agents_;
+  const std::string_view* user_agent_views_;
+  size_t num_user_agent_views_;
 
+  // nullptr for the default LongestMatchRobotsMatchStrategy, which is then
+  // called directly instead of through the RobotsMatchStrategy interface.
   RobotsMatchStrategy* match_strategy_;
 
   // Crawl-delay values for global (*) and specific user-agent groups.
@@ -371,6 +649,661 @@ class RobotsMatcher : protected RobotsParseHandler {
   std::optional<ContentSignal> content_signal_global_;
   std::optional<ContentSignal> content_signal_specific_;
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // Sitemap values seen so far if collect_sitemaps_.
+  std::vector<std::string_view> sitemaps_;
+
+  // Replays the matching logic above over pre-parsed rules.
+  friend class CompiledRobots;
+};
+
+class ResolvedRobots;
+
+// CompiledRobots - a robots.txt that is parsed once and matched many times.
+//
+// RobotsMatcher re-runs ParseRobotsTxt() over the whole body for every URL it
+// checks. CompiledRobots runs the parser once, in its constructor, and keeps
+// the user-agent groups, their Allow/Disallow patterns and the Crawl-delay,
+// Request-rate and Content-Signal values in flat tables. Queries replay the
+// group selection of RobotsMatcher ("most specific user-agent wins", global
+// fallback) over these tables, so they return exactly what disallow(),
+// matching_line() and the Get*() accessors of RobotsMatcher return after
+// AllowedByRobots() was called on the same body.
+//
+// A CompiledRobots owns copies of everything it needs and does not reference
+// the body it was built from. It cannot be modified after construction, and
+// all query methods are const and keep their match state on the stack, so a
+// single instance can be shared by any number of threads without locking.
+//
+// The tables are kept in a single position-independent image, which
+// Serialize() returns as is. FromSerialized() queries such an image in place,
+// e.g. from a memory-mapped file, without decoding or copying it.
+class CompiledRobots {
+ public:
+  explicit CompiledRobots(std::string_view robots_body);
+  // Same as above for a body whose DigestBody() the caller already has.
+  CompiledRobots(std::string_view robots_body, const BodyDigest& digest);
+
+  CompiledRobots(const CompiledRobots& other);
+  CompiledRobots& operator=(const CompiledRobots& other);
+  CompiledRobots(CompiledRobots&& other) noexcept;
+  CompiledRobots& operator=(CompiledRobots&& other) noexcept;
+
+  // Version of the image format written by Serialize(). Images of other
+  // versions are rejected by FromSerialized().
+  static constexpr uint32_t kSerializedVersion = 6;
+
+  // Returns the image of the compiled tables. It contains no pointers, so it
+  // can be written to a file and used from any address by FromSerialized().
+  // It is in the byte order of the host and records the matching switches of
+  // the build, like ROBOTS_ALLOW_FREQUENT_TYPOS, that its tables depend on.
+  std::string_view Serialize() const { return image_; }
+
+  // Returns a CompiledRobots that queries 'image', as returned by
+  // Serialize(), in place. 'image' is not copied and must outlive the result
+  // and its copies. Its address must be 8-byte aligned. Returns nullopt if
+  // 'image' is misaligned, of another version, byte order or set of matching
+  // switches, or corrupt: all offsets are bounds-checked, which takes a single
+  // pass over the tables.
+  static std::optional<CompiledRobots> FromSerialized(std::string_view image);
+
+  // Outcome of matching a single URL.
+  struct MatchResult {
+    // Same as !RobotsMatcher::disallow().
+    bool allowed = true;
+    // Same as RobotsMatcher::matching_line(): the line that decided the
+    // verdict, or 0 if no line matched.
+    int matching_line = 0;
+    // Same as RobotsMatcher::ever_seen_specific_agent().
+    bool ever_seen_specific_agent = false;
+    // Same as RobotsMatcher::budget_exceeded(). 'allowed' is then the verdict
+    // of the budget.
+    bool budget_exceeded = false;
+  };
+
+  // Matches 'url' for the collapsed rules of all "user_agents", like
+  // RobotsMatcher::AllowedByRobots(). 'url' must be %-encoded according to
+  // RFC3986. 'mode' tells how to extract its path, see UrlMode.
+  MatchResult Match(const std::vector<std::string>* user_agents,
+                    std::string_view url, UrlMode mode = UrlMode::kParse) const;
+  // Same as above within the limits of 'budget'.
+  MatchResult Match(const std::vector<std::string>* user_agents,
+                    std::string_view url, const MatchBudget& budget,
+                    UrlMode mode = UrlMode::kParse) const;
+
+  // Same as the two above for the "num_user_agents" agents at 'user_agents'.
+  // Neither the agents nor 'url' are copied: a match only allocates if the
+  // path of 'url' contains '*' or '$', which have to be %-encoded, or the
+  // first time a thread gets a path the URL parser had to normalize.
+  MatchResult Match(const std::string_view* user_agents,
+                    size_t num_user_agents, std::string_view url,
+                    UrlMode mode = UrlMode::kParse) const;
+  MatchResult Match(const std::string_view* user_agents,
+                    size_t num_user_agents, std::string_view url,
+                    const MatchBudget& budget,
+                    UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  MatchResult Match(std::span<const std::string_view> user_agents,
+                    std::string_view url,
+                    UrlMode mode = UrlMode::kParse) const {
+    return Match(user_agents.data(), user_agents.size(), url, mode);
+  }
+  MatchResult Match(std::span<const std::string_view> user_agents,
+                    std::string_view url, const MatchBudget& budget,
+                    UrlMode mode = UrlMode::kParse) const {
+    return Match(user_agents.data(), user_agents.size(), url, budget, mode);
+  }
+#endif
+
+  // Returns true iff 'url' is allowed to be fetched by any member of the
+  // "user_agents" vector.
+  bool Allowed(const std::vector<std::string>* user_agents,
+               std::string_view url, UrlMode mode = UrlMode::kParse) const;
+  // Same as above for the "num_user_agents" agents at 'user_agents'.
+  bool Allowed(const std::string_view* user_agents, size_t num_user_agents,
+               std::string_view url, UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  bool Allowed(std::span<const std::string_view> user_agents,
+               std::string_view url, UrlMode mode = UrlMode::kParse) const {
+    return Allowed(user_agents.data(), user_agents.size(), url, mode);
+  }
+#endif
+
+  // Do robots check for 'url' when there is only one user agent.
+  bool OneAgentAllowed(std::string_view user_agent, std::string_view url,
+                       UrlMode mode = UrlMode::kParse) const;
+
+  // Matches 'num_urls' URLs for the same "user_agents" and stores the result
+  // for urls[i] in results[i]. The rules are resolved for the user agents once
+  // and URLs with the same path are matched once, see
+  // ResolvedRobots::MatchBatch(). Batches within a MatchBudget go through
+  // Resolve().
+  void MatchBatch(const std::vector<std::string>* user_agents,
+                  const std::string* urls, size_t num_urls,
+                  MatchResult* results, UrlMode mode = UrlMode::kParse) const;
+  void MatchBatch(const std::vector<std::string>* user_agents,
+                  const std::string_view* urls, size_t num_urls,
+                  MatchResult* results, UrlMode mode = UrlMode::kParse) const;
+  void MatchBatch(const std::string_view* user_agents, size_t num_user_agents,
+                  const std::string_view* urls, size_t num_urls,
+                  MatchResult* results, UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  void MatchBatch(std::span<const std::string_view> user_agents,
+                  std::span<const std::string_view> urls,
+                  std::span<MatchResult> results,
+                  UrlMode mode = UrlMode::kParse) const {
+    const size_t n =
+        urls.size() < results.size() ? urls.size() : results.size();
+    MatchBatch(user_agents.data(), user_agents.size(), urls.data(), n,
+               results.data(), mode);
+  }
+#endif
+
+  // Answers of MatchAgents() for one user agent: what Match() and the Get*()
+  // methods below return for that agent alone.
+  struct AgentVerdict {
+    MatchResult match;
+    std::optional<double> crawl_delay;
+    std::optional<RequestRate> request_rate;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+    std::optional<ContentSignal> content_signal;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  };
+
+  // Matches 'url' for each of the 'num_user_agents' agents at 'user_agents'
+  // on its own, not for their collapsed rules, and stores the answers for
+  // user_agents[i] in verdicts[i]. The groups are walked once for all the
+  // agents and each rule that applies to any of them is matched once, so
+  // this costs about as much as a single Match(). A robots.txt checked only
+  // once is parsed once with CompiledRobots(robots_body).MatchAgents().
+  void MatchAgents(const std::string_view* user_agents, size_t num_user_agents,
+                   std::string_view url, AgentVerdict* verdicts,
+                   UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  void MatchAgents(std::span<const std::string_view> user_agents,
+                   std::string_view url, std::span<AgentVerdict> verdicts,
+                   UrlMode mode = UrlMode::kParse) const {
+    const size_t n = user_agents.size() < verdicts.size() ? user_agents.size()
+                                                          : verdicts.size();
+    MatchAgents(user_agents.data(), n, url, verdicts.data(), mode);
+  }
+#endif
+
+  // Return the values RobotsMatcher::Get*() would return for "user_agents".
+  // These do not depend on the URL.
+  std::optional<double> GetCrawlDelay(
+      const std::vector<std::string>* user_agents) const;
+  std::optional<RequestRate> GetRequestRate(
+      const std::vector<std::string>* user_agents) const;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> GetContentSignal(
+      const std::vector<std::string>* user_agents) const;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // Resolves the rules for a fixed list of user agents. The returned object
+  // has the group selection already applied and only has to match URLs, see
+  // ResolvedRobots. It does not reference this CompiledRobots.
+  ResolvedRobots Resolve(const std::vector<std::string>* user_agents) const;
+  // Same as above for queries within the limits of 'budget'. The caps are
+  // checked once here: if a rule for the agents goes over them, every query
+  // returns the verdict of the budget. Literal rules are matched in a trie
+  // and cost no steps, so queries may get further than RobotsMatcher would.
+  ResolvedRobots Resolve(const std::vector<std::string>* user_agents,
+                         const MatchBudget& budget) const;
+  // Same as the two above for the "num_user_agents" agents at 'user_agents'.
+  ResolvedRobots Resolve(const std::string_view* user_agents,
+                         size_t num_user_agents) const;
+  ResolvedRobots Resolve(const std::string_view* user_agents,
+                         size_t num_user_agents,
+                         const MatchBudget& budget) const;
+
+  // Number of non-empty Sitemap lines, and the value of the i-th of them in
+  // file order, for i < num_sitemaps(). Sitemap lines apply to the whole file,
+  // whatever group they are in. The value points into the image.
+  size_t num_sitemaps() const;
+  std::string_view sitemap(size_t i) const;
+
+  // Number of user-agent groups and Allow/Disallow rules that were compiled.
+  size_t num_groups() const;
+  size_t num_rules() const;
+
+  // DigestBody() of the body this was compiled from. It is kept in the image,
+  // so it survives Serialize() and FromSerialized().
+  BodyDigest body_digest() const;
+
+  // What changed in the Allow/Disallow rules of a robots.txt between two
+  // versions, see Recompile().
+  struct Diff {
+    // An Allow or Disallow rule, with its line number in the version that has
+    // it. Rules derived from an "index.html" Allow rule are included.
+    struct Rule {
+      bool is_allow = false;
+      std::string pattern;
+      int line = 0;
+    };
+    // The rules that the groups naming one user agent gained or lost. A rule
+    // that only moved to another line, within a group or to another group
+    // for the same agent, is not a change.
+    struct AgentChange {
+      // Lowercase product token of the user-agent lines, "*" for the global
+      // groups.
+      std::string user_agent;
+      // Whether the previous and the new version have a group for the agent.
+      // A group, even an empty one, hides the global rules from the agent.
+      bool had_group = false;
+      bool has_group = false;
+      std::vector<Rule> added;    // Line numbers of the new version.
+      std::vector<Rule> removed;  // Line numbers of the previous version.
+    };
+
+    // True if the new body has the SHA-256 digest of the previous one.
+    // Nothing was parsed and 'changes' is empty.
+    bool identical = false;
+    // In the order of 'user_agent'. Empty if no group gained or lost a rule,
+    // e.g. if only comments, Sitemap or Crawl-delay lines changed.
+    std::vector<AgentChange> changes;
+  };
+
+  // Compiles 'robots_body', typically a refetch of the robots.txt 'previous'
+  // was compiled from, and stores what changed in 'diff' if it is not null.
+  // A body with the body_digest() of 'previous' is taken to be the same body:
+  // it is not parsed and a copy of 'previous' is returned, which shares its
+  // image if 'previous' does not own it, see FromSerialized().
+  //
+  // This is a whole-file shortcut. Any other body, however small the edit, is
+  // parsed and compiled in full; no group of 'previous' is reused. The new
+  // rules are then compared group by group with 'previous' for 'diff'.
+  static CompiledRobots Recompile(const CompiledRobots& previous,
+                                  std::string_view robots_body,
+                                  Diff* diff = nullptr);
+
+  // Returns true if this and 'other' give the same verdict for every URL
+  // matched for "user_agents": the rules that can decide a verdict for them,
+  // see Resolve(), are the same. The matching lines may still differ. Lets a
+  // crawler keep the URLs it already filtered when a refetched robots.txt
+  // changed only for other agents.
+  bool SameVerdicts(const CompiledRobots& other,
+                    const std::vector<std::string>* user_agents) const;
+
+  // Approximate number of bytes this object holds, including itself. The
+  // image is not counted if it is not owned, see FromSerialized().
+  size_t MemoryUsage() const;
+
+ private:
+  // RobotsParseHandler filling the tables below. Defined in robots.cc.
+  class Builder;
+  // Per-query match state. Defined in robots.cc.
+  struct Evaluation;
+  // Start of the image, locating the tables. Defined in robots.cc.
+  struct ImageHeader;
+  // Pointers to the tables of an image.
+  struct Tables;
+  // A group and one of the agents it names, as compared by Recompile().
+  // Defined in robots.cc.
+  struct AgentGroup;
+
+  // The user agents of a query, either a vector or an array of
+  // 'num_views' views, like RobotsMatcher keeps them. Not owned.
+  struct AgentList {
+    explicit AgentList(const std::vector<std::string>* strings)
+        : strings(strings) {}
+    AgentList(const std::string_view* views, size_t num_views)
+        : views(views), num_views(num_views) {}
+
+    // Returns true if 'name' is one of the agents, ignoring case.
+    bool Contains(std::string_view name) const;
+
+    const std::vector<std::string>* strings = nullptr;
+    const std::string_view* views = nullptr;
+    size_t num_views = 0;
+  };
+
+  CompiledRobots() = default;
+
+  Tables GetTables() const;
+
+  // Implement the public overloads of the same name.
+  MatchResult Match(const AgentList& user_agents, std::string_view url,
+                    const MatchBudget& budget, UrlMode mode) const;
+  ResolvedRobots Resolve(const AgentList& user_agents,
+                         const MatchBudget& budget) const;
+
+  // Stores an AgentGroup for each distinct agent of each group in 'groups',
+  // sorted by agent.
+  void CollectAgentGroups(std::vector<AgentGroup>* groups) const;
+  // Appends the indexes of the rules that can decide a verdict for
+  // "user_agents", the rules Resolve() keeps, to 'rules'.
+  void SelectRules(const std::vector<std::string>& user_agents,
+                   std::vector<uint32_t>* rules) const;
+
+  // Runs the group selection of RobotsMatcher for "user_agents". When 'path'
+  // is non-null, the Allow/Disallow rules of the selected groups are matched
+  // against it as well. Otherwise, if the Evaluation asks for it, the indexes
+  // of these rules are collected.
+  void Evaluate(const AgentList& user_agents, const std::string_view* path,
+                Evaluation* eval) const;
+  // Runs Evaluate() with a path for each of the 'num_user_agents' agents on
+  // its own, at most kMaxAgentsPerPass of them, into evals[i].
+  static constexpr size_t kMaxAgentsPerPass = 64;
+  void EvaluateAgents(const std::string_view* user_agents,
+                      size_t num_user_agents, std::string_view path,
+                      Evaluation* evals) const;
+
+  // The records below are the tables of the image, so they have a fixed
+  // layout: fixed-width fields, no pointers, no implicit padding. Offsets
+  // index into the string table.
+
+  // A user-agent line. The product token is stored in the string table as
+  // returned by RobotsMatcher::ExtractUserAgent().
+  struct Agent {
+    uint32_t offset;
+    uint32_t length;
+    uint8_t is_global;  // 1 for '*'.
+    uint8_t padding[3];
+  };
+
+  // The Allow and Disallow lines are kept as parallel arrays with one entry
+  // per rule, so that a query only reads the arrays it needs and filters the
+  // rules of a group in a few cache lines before matching any pattern. The
+  // patterns are stored in the string table already escaped, as they were
+  // passed to the parse callbacks. The arrays are:
+  //   offsets, lengths  uint32_t  The pattern in the string table.
+  //   lines             int32_t   Its line number.
+  //   prefix_lengths    uint32_t  Bytes before its first '*', '%' or final
+  //                               '$', which a path without '%' must start
+  //                               with.
+  //   wildcards         uint32_t  Number of '*', for the caps of MatchBudget.
+  //   keys              uint8_t   pattern[1] if kRuleKeyed.
+  //   flags             uint8_t   RuleFlags.
+  enum RuleFlags : uint8_t {
+    kRuleAllow = 1 << 0,
+    kRuleWildcard = 1 << 1,  // Has a '*'.
+    kRuleAnchored = 1 << 2,  // Ends with '$'.
+    kRulePercent = 1 << 3,   // Has a '%' that is decoded when matching.
+    kRuleKeyed = 1 << 4,     // Literal prefix of at least 2 bytes.
+  };
+
+  // A Crawl-delay, Request-rate or Content-Signal line. These lines do not
+  // close a group, so they only apply to the 'agents_before' user-agent lines
+  // of their group that precede them.
+  struct Extension {
+    // Content-Signal records are kept in builds without Content-Signal
+    // support, so that images do not depend on ROBOTS_SUPPORT_CONTENT_SIGNAL.
+    enum Kind : uint8_t {
+      kCrawlDelay = 0,
+      kRequestRate = 1,
+      kContentSignal = 2,
+    };
+    Kind kind;
+    // Content-Signal values: -1 if not set, else 0 or 1.
+    int8_t ai_train;
+    int8_t ai_input;
+    int8_t search;
+    uint32_t agents_before;
+    double crawl_delay;
+    int32_t requests;
+    int32_t seconds;
+  };
+
+  // A Sitemap line.
+  struct Sitemap {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  // A run of user-agent lines followed by the rules that apply to them. Each
+  // field indexes into the corresponding table.
+  struct Group {
+    uint32_t first_agent;
+    uint32_t num_agents;
+    uint32_t first_rule;
+    uint32_t num_rules;
+    uint32_t first_extension;
+    uint32_t num_extensions;
+  };
+
+  // The image owned by this object, if it was compiled from a body. In
+  // uint64_t units so that the tables are aligned.
+  std::vector<uint64_t> buffer_;
+  // Either the bytes of buffer_, or an image owned by the caller.
+  std::string_view image_;
+};
+
+// RobotsPack - the serialized CompiledRobots of many hosts in one buffer.
+//
+// A pack is meant to be built once, shipped between machines and
+// memory-mapped, so that a freshly started process can query the robots.txt
+// files of a whole crawl without parsing any of them. Like the images of
+// CompiledRobots, a pack is position-independent and queried in place.
+//
+//   RobotsPack::Builder builder;
+//   builder.Add("https://example.com", robots_body);
+//   const std::string pack = builder.Finish();
+//   ...
+//   std::optional<RobotsPack> pack = RobotsPack::Open(mapped_file);
+//   std::optional<CompiledRobots> robots = pack->Find("https://example.com");
+//
+// Opening a pack checks its index; an image is checked when it is looked up,
+// so that only the pages of the hosts actually queried are touched.
+class RobotsPack {
+ public:
+  class Builder {
+   public:
+    // Adds the robots.txt of 'host'. The host key is used as given, see
+    // RobotsCache. A later entry for the same host replaces an earlier one.
+    void Add(std::string_view host, std::string_view robots_body);
+    void Add(std::string_view host, const CompiledRobots& robots);
+
+    size_t size() const { return entries_.size(); }
+
+    // Returns the pack of the entries added so far.
+    std::string Finish() const;
+
+   private:
+    std::vector<std::pair<std::string, std::string>> entries_;
+  };
+
+  // Version of the pack format written by Builder::Finish().
+  static constexpr uint32_t kVersion = 1;
+
+  // Returns a RobotsPack that reads 'data' in place. 'data' must outlive the
+  // result and everything returned by it, and be 8-byte aligned. Returns
+  // nullopt if 'data' is not a pack of this version and byte order, or its
+  // index is corrupt.
+  static std::optional<RobotsPack> Open(std::string_view data);
+
+  // Number of hosts in the pack.
+  size_t size() const { return num_entries_; }
+  // The i-th host, in lexicographic order.
+  std::string_view host(size_t i) const;
+  // The CompiledRobots of the i-th host, or nullopt if its image is corrupt.
+  std::optional<CompiledRobots> robots(size_t i) const;
+
+  // Returns the CompiledRobots of 'host', or nullopt if it is not in the pack
+  // or its image is corrupt.
+  std::optional<CompiledRobots> Find(std::string_view host) const;
+
+ private:
+  // Start of a pack and its index records. Defined in robots.cc.
+  struct PackHeader;
+  struct Entry;
+
+  RobotsPack() = default;
+
+  std::string_view data_;
+  const Entry* entries_ = nullptr;
+  size_t num_entries_ = 0;
+};
+
+// ResolvedRobots - the rules of a CompiledRobots for one fixed list of user
+// agents.
+//
+// CompiledRobots::Resolve() runs the user-agent matching and the "most
+// specific user-agent wins" selection once, and keeps only the rules that can
+// decide a verdict for those agents: the rules of the specific groups if the
+// file has any for them, the global rules otherwise. Queries only match the
+// URL against this flat list. Answers are the same as those of the
+// CompiledRobots it was resolved from, for the same user agents.
+//
+// The rules are indexed so that a query finds the longest Allow and Disallow
+// match in a single pass over the path, instead of matching every pattern in
+// turn. The results are those of the default longest-match strategy.
+//
+// Like CompiledRobots, a ResolvedRobots is immutable and can be shared by any
+// number of threads.
+class ResolvedRobots {
+ public:
+  // Matches 'url', which must be %-encoded according to RFC3986. 'mode'
+  // tells how to extract its path, see UrlMode.
+  CompiledRobots::MatchResult Match(std::string_view url,
+                                    UrlMode mode = UrlMode::kParse) const;
+
+  // Returns true iff 'url' is allowed.
+  bool Allowed(std::string_view url, UrlMode mode = UrlMode::kParse) const;
+
+  // Matches 'num_urls' URLs and stores the result for urls[i] in results[i].
+  // The paths are sorted first so that each distinct path is matched only
+  // once, which helps with the duplicates common in crawl frontier batches,
+  // and so that paths sharing a prefix share the walk along it.
+  void MatchBatch(const std::string* urls, size_t num_urls,
+                  CompiledRobots::MatchResult* results,
+                  UrlMode mode = UrlMode::kParse) const;
+  void MatchBatch(const std::string_view* urls, size_t num_urls,
+                  CompiledRobots::MatchResult* results,
+                  UrlMode mode = UrlMode::kParse) const;
+
+  // Matches URLs one after the other, reusing the walk of the previous path
+  // along the prefix it shares with the next one. See below.
+  class PrefixMatcher;
+
+  // Returns true iff the robots.txt has a group for one of the user agents.
+  bool ever_seen_specific_agent() const { return ever_seen_specific_agent_; }
+
+  std::optional<double> GetCrawlDelay() const { return crawl_delay_; }
+  std::optional<RequestRate> GetRequestRate() const { return request_rate_; }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> GetContentSignal() const {
+    return content_signal_;
+  }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // Number of Allow/Disallow rules that apply to the user agents.
+  size_t num_rules() const { return rules_.size(); }
+
+ private:
+  friend class CompiledRobots;
+  ResolvedRobots() = default;
+
+  // An Allow or Disallow pattern in strings_, in file order.
+  struct Rule {
+    uint32_t offset;
+    uint32_t length;
+    int line;
+    bool is_allow;
+  };
+
+  // Priority and line of the best match among a set of rules. Ties go to the
+  // rule that comes first in the file, like in RobotsMatcher.
+  struct Best {
+    int priority = -1;
+    int line = 0;
+    void Update(int p, int l) {
+      if (p > priority || (p == priority && l < line)) {
+        priority = p;
+        line = l;
+      }
+    }
+  };
+
+  // A node of the trie over the %-decoded literal prefixes of rules_. A rule
+  // without '*' ends at the node of its whole pattern and matches every path
+  // reaching that node; if it ends with '$' it only matches when the path ends
+  // there as well. A rule with '*' is attached to the node of the literal text
+  // before its first '*' and has to be matched in full when the path gets
+  // there.
+  struct TrieNode {
+    uint32_t first_edge = 0;
+    uint32_t num_edges = 0;
+    Best allow;
+    Best disallow;
+    Best allow_at_end;
+    Best disallow_at_end;
+    uint32_t first_wildcard = 0;
+    uint32_t num_wildcards = 0;
+  };
+  struct TrieEdge {
+    unsigned char byte;
+    uint32_t child;
+  };
+
+  // Builds nodes_, edges_ and wildcard_rules_ from rules_.
+  void BuildIndex();
+
+  // Matches a path as returned by GetPathParamsQuery().
+  CompiledRobots::MatchResult MatchPath(std::string_view path) const;
+  // MatchBatch() for the paths of the URLs.
+  void MatchPaths(const std::string_view* paths, size_t num_paths,
+                  CompiledRobots::MatchResult* results) const;
+
+  std::string strings_;
+  std::vector<Rule> rules_;
+  std::vector<TrieNode> nodes_;
+  std::vector<TrieEdge> edges_;
+  std::vector<uint32_t> wildcard_rules_;  // Indexes into rules_.
+  MatchBudget budget_;
+  // True if a rule goes over the caps of budget_.
+  bool over_budget_ = false;
+  bool ever_seen_specific_agent_ = false;
+  std::optional<double> crawl_delay_;
+  std::optional<RequestRate> request_rate_;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> content_signal_;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+};
+
+// ResolvedRobots::PrefixMatcher - matches a stream of URLs against a
+// ResolvedRobots and keeps the trie walk of the last path. The walk for the
+// next path resumes where the two paths stop sharing a prefix, so URLs in
+// sorted order, like those of a sitemap or of a sorted crawl frontier, cost
+// about their distinct suffixes instead of their whole paths. Rules with '*'
+// on the shared part still have to be matched against each whole path.
+//
+// Results are those of ResolvedRobots::Match(), in any order; only the speed
+// depends on the order. ResolvedRobots::MatchBatch() sorts its paths and uses
+// a PrefixMatcher. The ResolvedRobots must outlive the PrefixMatcher, which
+// is not thread-safe: use one per thread.
+class ResolvedRobots::PrefixMatcher {
+ public:
+  explicit PrefixMatcher(const ResolvedRobots& robots);
+
+  CompiledRobots::MatchResult Match(std::string_view url,
+                                    UrlMode mode = UrlMode::kParse);
+
+ private:
+  friend class ResolvedRobots;
+
+  // A step of the walk: the trie node reached at byte 'pos' of path_, and the
+  // best rules without '*' or '$' on the way. The walk up to this step looked
+  // at the bytes of path_ before 'examined', which a next path has to share
+  // for the step to hold.
+  struct Frame {
+    uint32_t node;
+    uint32_t pos;
+    uint32_t examined;
+    Best allow;
+    Best disallow;
+    // Size of wildcards_ once the rules with '*' of the node are added.
+    uint32_t num_wildcards;
+  };
+
+  CompiledRobots::MatchResult MatchPath(std::string_view path);
+
+  const ResolvedRobots* robots_;
+  std::string path_;
+  std::vector<Frame> frames_;
+  // Rules with '*' of the nodes on the walk, in walk order.
+  std::vector<uint32_t> wildcards_;
+  std::string buffer_;
 };
 
 }  // namespace googlebot
@@ -0,0 +1,296 @@
+#include "robots_bulk.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ROBOTS_BULK_HAVE_MMAP 1
+#endif
+
+#include "robots.h"
+
+namespace googlebot {
+
+namespace {
+// A range ends after this many files or once it holds this many bytes, so
+// that tasks are small enough to balance and large enough not to contend.
+constexpr size_t kFilesPerRange = 256;
+constexpr size_t kBytesPerRange = size_t{4} << 20;
+
+uint32_t DecodeLength(const char* data) {
+  unsigned char bytes[4];
+  std::memcpy(bytes, data, sizeof(bytes));
+  return uint32_t{bytes[0]} | uint32_t{bytes[1]} << 8 |
+         uint32_t{bytes[2]} << 16 | uint32_t{bytes[3]} << 24;
+}
+
+void SetError(std::string* error, std::string message) {
+  if (error != nullptr) *error = std::move(message);
+}
+
+// Ranges not started yet of one worker, [begin, end) in the range list. The
+// owner takes them from the front, idle workers steal the back half.
+struct WorkQueue {
+  std::mutex mu;
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+// Moves half of the ranges left in another queue to 'queues[self]'. Returns
+// false once all the queues are empty.
+bool Steal(std::vector<WorkQueue>& queues, size_t self) {
+  for (size_t i = 1; i < queues.size(); ++i) {
+    WorkQueue& victim = queues[(self + i) % queues.size()];
+    size_t begin;
+    size_t end;
+    {
+      std::lock_guard<std::mutex> lock(victim.mu);
+      if (victim.begin == victim.end) continue;
+      begin = victim.begin + (victim.end - victim.begin) / 2;
+      end = victim.end;
+      victim.end = begin;
+    }
+    std::lock_guard<std::mutex> lock(queues[self].mu);
+    queues[self].begin = begin;
+    queues[self].end = end;
+    return true;
+  }
+  return false;
+}
+
+void CountLines(const FlatRobotsParsingReporter& reporter,
+                RobotsCorpusStats* stats) {
+  bool has_typo = false;
+  for (const RobotsParsedLine& line : reporter.parse_results()) {
+    ++stats->tags[line.tag_name];
+    if (line.is_typo) {
+      ++stats->typos[line.tag_name];
+      has_typo = true;
+    }
+    if (line.metadata.is_empty) ++stats->empty_lines;
+    if (line.metadata.is_comment) ++stats->comment_lines;
+    if (line.metadata.is_line_too_long) ++stats->lines_too_long;
+    if (line.metadata.is_missing_colon_separator) {
+      ++stats->missing_colon_separator;
+    }
+  }
+  stats->lines += reporter.last_line_seen();
+  if (has_typo) ++stats->files_with_typos;
+}
+}  // namespace
+
+std::unique_ptr<RobotsCorpus> RobotsCorpus::Open(const std::string& path,
+                                                 std::string* error) {
+  std::unique_ptr<RobotsCorpus> corpus(new RobotsCorpus);
+#ifdef ROBOTS_BULK_HAVE_MMAP
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    SetError(error, "failed to open \"" + path + "\"");
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    SetError(error, "failed to stat \"" + path + "\"");
+    return nullptr;
+  }
+  const size_t size = st.st_size;
+  if (size > 0) {
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      SetError(error, "failed to map \"" + path + "\"");
+      return nullptr;
+    }
+    corpus->mapping_ = data;
+    corpus->mapping_size_ = size;
+    corpus->data_ = std::string_view(static_cast<const char*>(data), size);
+  }
+  close(fd);
+#else
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    SetError(error, "failed to open \"" + path + "\"");
+    return nullptr;
+  }
+  corpus->contents_.assign(std::istreambuf_iterator<char>(file),
+                           std::istreambuf_iterator<char>());
+  if (file.bad()) {
+    SetError(error, "failed to read \"" + path + "\"");
+    return nullptr;
+  }
+  corpus->data_ = corpus->contents_;
+#endif
+  if (!corpus->Index(error)) return nullptr;
+  return corpus;
+}
+
+std::unique_ptr<RobotsCorpus> RobotsCorpus::FromData(std::string_view data,
+                                                     std::string* error) {
+  std::unique_ptr<RobotsCorpus> corpus(new RobotsCorpus);
+  corpus->data_ = data;
+  if (!corpus->Index(error)) return nullptr;
+  return corpus;
+}
+
+RobotsCorpus::~RobotsCorpus() {
+#ifdef ROBOTS_BULK_HAVE_MMAP
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+#endif
+}
+
+bool RobotsCorpus::Index(std::string* error) {
+  // Records can only be found by following the lengths from the start, which
+  // only reads the length of each record, not its body.
+  size_t pos = 0;
+  while (pos < data_.size()) {
+    const size_t range_start = pos;
+    const size_t first_file = num_files_;
+    while (pos < data_.size() && num_files_ - first_file < kFilesPerRange &&
+           pos - range_start < kBytesPerRange) {
+      if (data_.size() - pos < sizeof(uint32_t) ||
+          data_.size() - pos - sizeof(uint32_t) <
+              DecodeLength(data_.data() + pos)) {
+        SetError(error,
+                 "truncated record at offset " + std::to_string(pos));
+        return false;
+      }
+      pos += sizeof(uint32_t) + DecodeLength(data_.data() + pos);
+      ++num_files_;
+    }
+    ranges_.push_back(Range{range_start, pos - range_start, first_file});
+  }
+  return true;
+}
+
+void RobotsCorpusStats::Merge(const RobotsCorpusStats& other) {
+  files += other.files;
+  bytes += other.bytes;
+  lines += other.lines;
+  for (int i = 0; i < kNumTagNames; ++i) {
+    tags[i] += other.tags[i];
+    typos[i] += other.typos[i];
+  }
+  empty_lines += other.empty_lines;
+  comment_lines += other.comment_lines;
+  lines_too_long += other.lines_too_long;
+  missing_colon_separator += other.missing_colon_separator;
+  files_with_typos += other.files_with_typos;
+}
+
+CorpusAnalysis AnalyzeCorpus(const RobotsCorpus& corpus,
+                             const CorpusAnalysisOptions& options) {
+  CorpusAnalysis analysis;
+  analysis.num_files = corpus.size();
+  analysis.num_user_agents = options.user_agents.size();
+  analysis.num_urls = options.urls.size();
+  const size_t checks_per_file = analysis.num_user_agents * analysis.num_urls;
+  analysis.allowed_files.assign(checks_per_file, 0);
+  if (options.keep_verdicts) {
+    analysis.verdicts.assign(corpus.size() * checks_per_file, 0);
+  }
+
+  // CompiledRobots::Resolve() takes the agents as vectors.
+  std::vector<std::vector<std::string>> agents;
+  for (const std::string& agent : options.user_agents) {
+    agents.push_back({agent});
+  }
+
+  size_t num_threads = options.num_threads;
+  if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+  num_threads = std::max<size_t>(
+      1, std::min(num_threads, corpus.ranges_.size()));
+
+  // Each worker starts with a contiguous share of the ranges.
+  std::vector<WorkQueue> queues(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    queues[i].begin = corpus.ranges_.size() * i / num_threads;
+    queues[i].end = corpus.ranges_.size() * (i + 1) / num_threads;
+  }
+
+  struct WorkerResult {
+    RobotsCorpusStats stats;
+    std::vector<uint64_t> allowed_files;
+    // Reused for all the files of the worker.
+    FlatRobotsParsingReporter reporter;
+  };
+  std::vector<WorkerResult> results(num_threads);
+
+  auto process_file = [&](size_t file, std::string_view body,
+                          WorkerResult* result) {
+    ++result->stats.files;
+    result->stats.bytes += body.size();
+    if (options.collect_stats) {
+      ParseRobotsTxt(body, &result->reporter);
+      CountLines(result->reporter, &result->stats);
+    }
+    if (checks_per_file == 0) return;
+    const CompiledRobots robots(body);
+    size_t check = 0;
+    for (size_t agent = 0; agent < agents.size(); ++agent) {
+      const ResolvedRobots resolved = robots.Resolve(&agents[agent]);
+      for (const std::string& url : options.urls) {
+        const bool allowed = resolved.Allowed(url);
+        result->allowed_files[check] += allowed;
+        if (options.keep_verdicts) {
+          analysis.verdicts[file * checks_per_file + check] = allowed;
+        }
+        ++check;
+      }
+    }
+  };
+
+  auto work = [&](size_t self) {
+    WorkerResult* result = &results[self];
+    result->allowed_files.assign(checks_per_file, 0);
+    WorkQueue& queue = queues[self];
+    while (true) {
+      size_t range_index = 0;
+      bool found = false;
+      {
+        std::lock_guard<std::mutex> lock(queue.mu);
+        if (queue.begin < queue.end) {
+          range_index = queue.begin++;
+          found = true;
+        }
+      }
+      if (!found) {
+        if (!Steal(queues, self)) return;
+        continue;
+      }
+      const RobotsCorpus::Range& range = corpus.ranges_[range_index];
+      size_t pos = range.offset;
+      for (size_t file = range.first_file; pos < range.offset + range.size;
+           ++file) {
+        const uint32_t length = DecodeLength(corpus.data_.data() + pos);
+        pos += sizeof(uint32_t);
+        process_file(file, corpus.data_.substr(pos, length), result);
+        pos += length;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) threads.emplace_back(work, i);
+  work(0);
+  for (std::thread& thread : threads) thread.join();
+
+  for (const WorkerResult& result : results) {
+    analysis.stats.Merge(result.stats);
+    for (size_t check = 0; check < checks_per_file; ++check) {
+      analysis.allowed_files[check] += result.allowed_files[check];
+    }
+  }
+  return analysis;
+}
+
+}  // namespace googlebot
@@ -0,0 +1,143 @@
+// -----------------------------------------------------------------------------
+// File: robots_bulk.h
+// -----------------------------------------------------------------------------
+//
+// Parallel processing of corpora of robots.txt files, e.g. for analytics over
+// a whole crawl. A corpus is a file of repeated records
+//   uint32_t length (little-endian); char body[length];
+// the format of the benchmark data, see benchmark-utils/.
+//
+// RobotsCorpus memory-maps a corpus and splits it into ranges of whole
+// records. AnalyzeCorpus() processes the ranges on a pool of threads that
+// steal ranges from each other once they run out, and aggregates per-file
+// verdicts for a list of user agents and URLs, directive counts and typo
+// counts.
+
+#ifndef THIRD_PARTY_ROBOTSTXT_ROBOTS_BULK_H_
+#define THIRD_PARTY_ROBOTSTXT_ROBOTS_BULK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "reporting_robots.h"
+
+namespace googlebot {
+
+struct CorpusAnalysis;
+struct CorpusAnalysisOptions;
+
+// The robots.txt files of a corpus, see above.
+class RobotsCorpus {
+ public:
+  // Maps the corpus in the file at 'path', or reads it where mmap is not
+  // available. Returns nullptr if the file can't be read or ends with a
+  // truncated record, with the reason in 'error' if given.
+  static std::unique_ptr<RobotsCorpus> Open(const std::string& path,
+                                            std::string* error = nullptr);
+
+  // A corpus over 'data', which must outlive it. Returns nullptr if 'data'
+  // ends with a truncated record.
+  static std::unique_ptr<RobotsCorpus> FromData(std::string_view data,
+                                                std::string* error = nullptr);
+
+  ~RobotsCorpus();
+
+  // Disallow copying and assignment.
+  RobotsCorpus(const RobotsCorpus&) = delete;
+  RobotsCorpus& operator=(const RobotsCorpus&) = delete;
+
+  // Number of files in the corpus.
+  size_t size() const { return num_files_; }
+  std::string_view data() const { return data_; }
+
+ private:
+  // Whole records of the corpus, processed as one task.
+  struct Range {
+    size_t offset;      // Of the length of the first record.
+    size_t size;        // In bytes.
+    size_t first_file;  // Index of the first record.
+  };
+
+  RobotsCorpus() = default;
+  // Splits 'data_' into ranges, returns false at a truncated record.
+  bool Index(std::string* error);
+
+  std::string_view data_;
+  // The mapping, or the contents where it was read instead.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  std::string contents_;
+  size_t num_files_ = 0;
+  std::vector<Range> ranges_;
+
+  friend CorpusAnalysis AnalyzeCorpus(const RobotsCorpus& corpus,
+                                      const CorpusAnalysisOptions& options);
+};
+
+// Counts over the lines of all the files of a corpus, from
+// FlatRobotsParsingReporter.
+struct RobotsCorpusStats {
+  static constexpr int kNumTagNames = RobotsParsedLine::kUnused + 1;
+
+  uint64_t files = 0;
+  uint64_t bytes = 0;
+  uint64_t lines = 0;
+  // Lines per RobotsParsedLine::RobotsTagName, kUnknown including empty and
+  // comment lines.
+  uint64_t tags[kNumTagNames] = {};
+  // Lines per RobotsParsedLine::RobotsTagName whose key is an accepted typo,
+  // like "disalow".
+  uint64_t typos[kNumTagNames] = {};
+  uint64_t empty_lines = 0;
+  uint64_t comment_lines = 0;
+  uint64_t lines_too_long = 0;
+  uint64_t missing_colon_separator = 0;
+  // Files with at least one line with an accepted typo.
+  uint64_t files_with_typos = 0;
+
+  void Merge(const RobotsCorpusStats& other);
+};
+
+struct CorpusAnalysisOptions {
+  // Each file is checked for each of these user agents on its own, against
+  // each of the URLs. The URLs are usually paths, like "/".
+  std::vector<std::string> user_agents;
+  std::vector<std::string> urls;
+  // Worker threads, 0 for one per hardware thread.
+  size_t num_threads = 0;
+  // Counts directives and typos. This parses each file once more, besides
+  // the parse for the checks.
+  bool collect_stats = true;
+  // Keeps the verdict of every check in CorpusAnalysis::verdicts, not only
+  // their counts.
+  bool keep_verdicts = true;
+};
+
+struct CorpusAnalysis {
+  RobotsCorpusStats stats;
+  size_t num_files = 0;
+  size_t num_user_agents = 0;
+  size_t num_urls = 0;
+  // Files allowing each user agent and URL, at [agent * num_urls + url].
+  std::vector<uint64_t> allowed_files;
+  // 1 where the check is allowed, at [(file * num_user_agents + agent) *
+  // num_urls + url]. Empty unless CorpusAnalysisOptions::keep_verdicts.
+  std::vector<uint8_t> verdicts;
+
+  bool allowed(size_t file, size_t agent, size_t url) const {
+    return verdicts[(file * num_user_agents + agent) * num_urls + url] != 0;
+  }
+};
+
+// Analyzes all the files of 'corpus' in parallel, see above. Each worker
+// compiles a file once for all of its checks.
+CorpusAnalysis AnalyzeCorpus(const RobotsCorpus& corpus,
+                             const CorpusAnalysisOptions& options);
+
+}  // namespace googlebot
+
+#endif  // THIRD_PARTY_ROBOTSTXT_ROBOTS_BULK_H_
@@ -0,0 +1,373 @@
+#include "robots_cache.h"
+
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace googlebot {
+
+namespace {
+std::string_view DigestBytes(const BodyDigest& digest) {
+  return std::string_view(reinterpret_cast<const char*>(digest.data()),
+                          digest.size());
+}
+}  // namespace
+
+struct RobotsCache::Interned {
+  Interned(RobotsCache* cache, const BodyDigest& digest, Entry compiled)
+      : cache(cache), digest(digest), robots(std::move(compiled)) {
+    // The CompiledRobots, this object and the control blocks of the shared
+    // pointers, roughly.
+    bytes = robots->MemoryUsage() + sizeof(*this) + 64;
+    cache->bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    cache->unique_robots_.fetch_add(1, std::memory_order_relaxed);
+  }
+  ~Interned();
+
+  RobotsCache* const cache;
+  // Of the body, unless not interning. Keys the intern table of its shard
+  // once indexed.
+  const BodyDigest digest;
+  const Entry robots;
+  size_t bytes;
+  bool indexed = false;
+};
+
+struct RobotsCache::Shard {
+  // Keys the intern table. The digest is uniformly distributed, so its first
+  // bytes are a good hash.
+  struct DigestHash {
+    size_t operator()(const BodyDigest& digest) const {
+      size_t hash;
+      std::memcpy(&hash, digest.data(), sizeof(hash));
+      return hash;
+    }
+  };
+
+  struct Node {
+    std::string host;
+    std::shared_ptr<Interned> robots;
+    Clock::time_point expiry;
+    // The key and the bookkeeping; the CompiledRobots is accounted in
+    // Interned, once for all the entries sharing it.
+    size_t bytes;
+  };
+
+  std::mutex mu;
+  // Most recently used first. List nodes don't move, so the index can key on
+  // views of Node::host.
+  std::list<Node> lru;
+  std::unordered_map<std::string_view, std::list<Node>::iterator> index;
+  // Compilations in progress for GetOrCompile().
+  std::unordered_map<std::string, std::shared_future<Entry>> in_flight;
+
+  // Compiled bodies of this shard, keyed by their digest. Has its own lock,
+  // which may be taken while holding 'mu' (an Interned is destroyed when the
+  // last entry holding it is removed) but not the other way around.
+  std::mutex intern_mu;
+  std::unordered_map<BodyDigest, std::weak_ptr<Interned>, DigestHash>
+      interned;
+
+  // Removes an entry, returns the bytes accounted for it.
+  size_t Remove(std::unordered_map<std::string_view,
+                                   std::list<Node>::iterator>::iterator it) {
+    const std::list<Node>::iterator node = it->second;
+    const size_t bytes = node->bytes;
+    index.erase(it);
+    lru.erase(node);
+    return bytes;
+  }
+};
+
+RobotsCache::Interned::~Interned() {
+  cache->bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  cache->unique_robots_.fetch_sub(1, std::memory_order_relaxed);
+  if (!indexed) return;
+  Shard& shard = cache->ShardFor(DigestBytes(digest));
+  std::lock_guard<std::mutex> lock(shard.intern_mu);
+  const auto it = shard.interned.find(digest);
+  // The slot may hold a newer Interned for the same body by now.
+  if (it != shard.interned.end() && it->second.expired()) {
+    shard.interned.erase(it);
+  }
+}
+
+namespace {
+std::mutex& SharedMutex() {
+  static std::mutex* mu = new std::mutex;
+  return *mu;
+}
+
+RobotsCache::Options& SharedOptions() {
+  static RobotsCache::Options* options = new RobotsCache::Options;
+  return *options;
+}
+
+std::atomic<RobotsCache*> shared_cache{nullptr};
+
+// The list node, the index node with its bucket, roughly.
+constexpr size_t kNodeBookkeepingBytes = 112;
+}  // namespace
+
+RobotsCache::RobotsCache() : RobotsCache(Options()) {}
+
+RobotsCache::RobotsCache(const Options& options)
+    : options_(options),
+      num_shards_(options.num_shards == 0 ? 1 : options.num_shards),
+      shards_(new Shard[num_shards_]) {}
+
+// Entries are dropped first: they unregister their Interned from the intern
+// tables of other shards, which must still exist.
+RobotsCache::~RobotsCache() { Clear(); }
+
+RobotsCache& RobotsCache::Shared() {
+  RobotsCache* cache = shared_cache.load(std::memory_order_acquire);
+  if (cache != nullptr) return *cache;
+  std::lock_guard<std::mutex> lock(SharedMutex());
+  cache = shared_cache.load(std::memory_order_relaxed);
+  if (cache == nullptr) {
+    cache = new RobotsCache(SharedOptions());
+    shared_cache.store(cache, std::memory_order_release);
+  }
+  return *cache;
+}
+
+bool RobotsCache::InitShared(const Options& options) {
+  std::lock_guard<std::mutex> lock(SharedMutex());
+  if (shared_cache.load(std::memory_order_relaxed) != nullptr) return false;
+  SharedOptions() = options;
+  return true;
+}
+
+RobotsCache::Shard& RobotsCache::ShardFor(std::string_view key) const {
+  return shards_[std::hash<std::string_view>()(key) % num_shards_];
+}
+
+std::shared_ptr<RobotsCache::Interned> RobotsCache::FindInterned(
+    const BodyDigest& digest) {
+  Shard& shard = ShardFor(DigestBytes(digest));
+  std::lock_guard<std::mutex> lock(shard.intern_mu);
+  const auto it = shard.interned.find(digest);
+  if (it == shard.interned.end()) return nullptr;
+  // Returned before it may be released, which must not happen with the lock
+  // held: releasing the last reference unregisters it.
+  return it->second.lock();
+}
+
+std::shared_ptr<RobotsCache::Interned> RobotsCache::Intern(
+    std::string_view robots_body) {
+  const BodyDigest digest =
+      options_.intern_bodies ? DigestBody(robots_body) : BodyDigest();
+  if (options_.intern_bodies) {
+    if (std::shared_ptr<Interned> found = FindInterned(digest)) {
+      interned_.fetch_add(1, std::memory_order_relaxed);
+      return found;
+    }
+  }
+
+  // Compiles outside of the locks.
+  auto compiled = std::make_shared<Interned>(
+      this, digest,
+      std::make_shared<const CompiledRobots>(robots_body, digest));
+  compilations_.fetch_add(1, std::memory_order_relaxed);
+  if (!options_.intern_bodies) return compiled;
+
+  std::shared_ptr<Interned> existing;
+  {
+    Shard& shard = ShardFor(DigestBytes(digest));
+    std::lock_guard<std::mutex> lock(shard.intern_mu);
+    auto it = shard.interned.find(digest);
+    if (it != shard.interned.end()) existing = it->second.lock();
+    if (existing == nullptr) {
+      compiled->indexed = true;
+      if (it != shard.interned.end()) {
+        it->second = compiled;
+      } else {
+        shard.interned.emplace(digest, compiled);
+      }
+    }
+  }
+  // Another thread compiled the same body meanwhile.
+  return existing != nullptr ? existing : compiled;
+}
+
+RobotsCache::Entry RobotsCache::LookupLocked(Shard* shard,
+                                             std::string_view host) {
+  const auto it = shard->index.find(host);
+  if (it == shard->index.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  if (options_.now() >= it->second->expiry) {
+    bytes_.fetch_sub(shard->Remove(it), std::memory_order_relaxed);
+    expirations_.fetch_add(1, std::memory_order_relaxed);
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return it->second->robots->robots;
+}
+
+void RobotsCache::InsertLocked(Shard* shard, std::string_view host,
+                               std::shared_ptr<Interned> robots,
+                               std::chrono::seconds ttl) {
+  const auto it = shard->index.find(host);
+  if (it != shard->index.end()) {
+    bytes_.fetch_sub(shard->Remove(it), std::memory_order_relaxed);
+  }
+
+  const size_t bytes = host.size() + kNodeBookkeepingBytes;
+  shard->lru.push_front(Shard::Node{std::string(host), std::move(robots),
+                                    options_.now() + ttl, bytes});
+  shard->index.emplace(shard->lru.front().host, shard->lru.begin());
+  bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RobotsCache::EvictLocked(Shard* shard, size_t keep) {
+  // Evicting an entry that shares its CompiledRobots frees little, so this may
+  // evict more entries than a cache without sharing would.
+  while (bytes_.load(std::memory_order_relaxed) > options_.max_bytes &&
+         shard->lru.size() > keep) {
+    bytes_.fetch_sub(shard->Remove(shard->index.find(shard->lru.back().host)),
+                     std::memory_order_relaxed);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void RobotsCache::EvictFromAllShards(const Shard& shard) {
+  // Ends with 'shard' itself, where an entry over the budget on its own is
+  // evicted right away.
+  const size_t start = &shard - shards_.get();
+  for (size_t i = 1; i <= num_shards_; ++i) {
+    if (bytes_.load(std::memory_order_relaxed) <= options_.max_bytes) return;
+    Shard& other = shards_[(start + i) % num_shards_];
+    std::lock_guard<std::mutex> lock(other.mu);
+    EvictLocked(&other, 0);
+  }
+}
+
+RobotsCache::Entry RobotsCache::Lookup(std::string_view host) {
+  Shard& shard = ShardFor(host);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  return LookupLocked(&shard, host);
+}
+
+RobotsCache::Entry RobotsCache::Insert(std::string_view host,
+                                       std::string_view robots_body) {
+  return Insert(host, robots_body, options_.default_ttl);
+}
+
+RobotsCache::Entry RobotsCache::Insert(std::string_view host,
+                                       std::string_view robots_body,
+                                       std::chrono::seconds ttl) {
+  std::shared_ptr<Interned> robots = Intern(robots_body);
+  const Entry entry = robots->robots;
+  Shard& shard = ShardFor(host);
+  {
+    std::lock_guard<std::mutex> lock(shard.mu);
+    InsertLocked(&shard, host, std::move(robots), ttl);
+    EvictLocked(&shard, 1);
+  }
+  EvictFromAllShards(shard);
+  return entry;
+}
+
+RobotsCache::Entry RobotsCache::GetOrCompile(
+    std::string_view host, const std::function<std::string()>& fetch) {
+  return GetOrCompile(host, fetch, options_.default_ttl);
+}
+
+RobotsCache::Entry RobotsCache::GetOrCompile(
+    std::string_view host, const std::function<std::string()>& fetch,
+    std::chrono::seconds ttl) {
+  Shard& shard = ShardFor(host);
+  std::unique_lock<std::mutex> lock(shard.mu);
+  if (Entry robots = LookupLocked(&shard, host)) return robots;
+
+  std::string key(host);
+  const auto in_flight = shard.in_flight.find(key);
+  if (in_flight != shard.in_flight.end()) {
+    std::shared_future<Entry> result = in_flight->second;
+    lock.unlock();
+    return result.get();
+  }
+
+  // This call fetches and compiles, the others for the host wait for it.
+  std::promise<Entry> promise;
+  shard.in_flight.emplace(key, promise.get_future().share());
+  lock.unlock();
+  try {
+    std::shared_ptr<Interned> robots = Intern(fetch());
+    const Entry entry = robots->robots;
+    lock.lock();
+    InsertLocked(&shard, host, std::move(robots), ttl);
+    EvictLocked(&shard, 1);
+    shard.in_flight.erase(key);
+    lock.unlock();
+    EvictFromAllShards(shard);
+    promise.set_value(entry);
+    return entry;
+  } catch (...) {
+    if (!lock.owns_lock()) lock.lock();
+    shard.in_flight.erase(key);
+    lock.unlock();
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+}
+
+RobotsCache::Entry RobotsCache::FindCompiled(std::string_view robots_body) {
+  if (!options_.intern_bodies) return nullptr;
+  const std::shared_ptr<Interned> found =
+      FindInterned(DigestBody(robots_body));
+  return found != nullptr ? found->robots : nullptr;
+}
+
+void RobotsCache::Erase(std::string_view host) {
+  Shard& shard = ShardFor(host);
+  std::lock_guard<std::mutex> lock(shard.mu);
+  const auto it = shard.index.find(host);
+  if (it != shard.index.end()) {
+    bytes_.fetch_sub(shard.Remove(it), std::memory_order_relaxed);
+  }
+}
+
+void RobotsCache::Clear() {
+  for (size_t i = 0; i < num_shards_; ++i) {
+    Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mu);
+    for (const Shard::Node& node : shard.lru) {
+      bytes_.fetch_sub(node.bytes, std::memory_order_relaxed);
+    }
+    shard.index.clear();
+    shard.lru.clear();
+  }
+}
+
+RobotsCache::Stats RobotsCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  stats.expirations = expirations_.load(std::memory_order_relaxed);
+  stats.compilations = compilations_.load(std::memory_order_relaxed);
+  stats.interned = interned_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < num_shards_; ++i) {
+    Shard& shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mu);
+    stats.entries += shard.lru.size();
+  }
+  stats.unique_robots = unique_robots_.load(std::memory_order_relaxed);
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace googlebot
@@ -0,0 +1,176 @@
+// -----------------------------------------------------------------------------
+// File: robots_cache.h
+// -----------------------------------------------------------------------------
+//
+// RobotsCache maps hosts to their CompiledRobots, so that a robots.txt is
+// parsed once per host instead of once per URL. It is meant to hold the
+// robots.txt files of a whole crawl: the cache is split into independently
+// locked shards, bounded in memory, and expires entries after a time to live.
+
+#ifndef THIRD_PARTY_ROBOTSTXT_ROBOTS_CACHE_H_
+#define THIRD_PARTY_ROBOTSTXT_ROBOTS_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "robots.h"
+
+namespace googlebot {
+
+// A thread-safe cache of CompiledRobots keyed by host.
+//
+// The key is any string identifying a robots.txt, typically the scheme, host
+// and port of the URLs it applies to, e.g. "https://example.com:443". It is
+// used as given, callers should normalize it.
+//
+// Identical bodies are compiled once: hosts serving byte-identical robots.txt
+// files, like CDN defaults or parked domains, share one CompiledRobots.
+// Bodies are told apart by their SHA-256 digest, see DigestBody(), which is
+// kept next to the CompiledRobots instead of the body itself, see
+// FindCompiled().
+//
+// Memory is bounded by Options::max_bytes, as estimated from
+// CompiledRobots::MemoryUsage(), with each shared CompiledRobots counted
+// once. When the cache goes over, the shard being inserted into evicts its
+// least recently used entries first, then the other shards do. Entries also
+// expire once their time to live has passed; expired entries count as misses
+// and are dropped when looked up.
+//
+// Entries are handed out as shared pointers, so they stay valid after being
+// evicted or replaced.
+class RobotsCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Entry = std::shared_ptr<const CompiledRobots>;
+
+  struct Options {
+    // Upper bound for the memory held by the cached entries.
+    size_t max_bytes = size_t{1} << 30;
+    // Number of independently locked parts of the cache.
+    size_t num_shards = 64;
+    // Time to live of the entries inserted without one.
+    std::chrono::seconds default_ttl = std::chrono::hours(24);
+    // Source of the current time, replaceable for tests.
+    Clock::time_point (*now)() = &Clock::now;
+    // Share one CompiledRobots between the hosts with identical bodies.
+    bool intern_bodies = true;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    // Lookups that found no live entry, including expired ones.
+    uint64_t misses = 0;
+    // Entries dropped to stay within max_bytes.
+    uint64_t evictions = 0;
+    // Entries dropped because their time to live had passed.
+    uint64_t expirations = 0;
+    // Bodies compiled by Insert() and GetOrCompile().
+    uint64_t compilations = 0;
+    // Bodies that were already compiled for another host, so not parsed.
+    uint64_t interned = 0;
+    size_t entries = 0;
+    // Distinct CompiledRobots held by the entries.
+    size_t unique_robots = 0;
+    size_t bytes = 0;
+  };
+
+  RobotsCache();
+  explicit RobotsCache(const Options& options);
+  ~RobotsCache();
+
+  // Disallow copying and assignment.
+  RobotsCache(const RobotsCache&) = delete;
+  RobotsCache& operator=(const RobotsCache&) = delete;
+
+  // Returns the process-wide cache that the C API and the language bindings
+  // share. It is created on first use, with the options given to InitShared()
+  // if it was called before, and never destroyed.
+  static RobotsCache& Shared();
+
+  // Sets the options of the shared cache. Returns false if the shared cache
+  // already exists, in which case its options are left unchanged.
+  static bool InitShared(const Options& options);
+
+  // Returns the live entry for 'host', or nullptr.
+  Entry Lookup(std::string_view host);
+
+  // Compiles 'robots_body' and stores it for 'host', replacing any previous
+  // entry. Returns the new entry.
+  Entry Insert(std::string_view host, std::string_view robots_body);
+  Entry Insert(std::string_view host, std::string_view robots_body,
+               std::chrono::seconds ttl);
+
+  // Returns the live entry for 'host'. If there is none, calls 'fetch' for the
+  // robots.txt body, then compiles and stores it. Concurrent calls for the same
+  // host wait for the first one instead of fetching and compiling again. If
+  // 'fetch' throws, the exception is rethrown to all of them and nothing is
+  // stored.
+  Entry GetOrCompile(std::string_view host,
+                     const std::function<std::string()>& fetch);
+  Entry GetOrCompile(std::string_view host,
+                     const std::function<std::string()>& fetch,
+                     std::chrono::seconds ttl);
+
+  // Returns the CompiledRobots of 'robots_body' if the cache already holds it
+  // for some host, or nullptr. Only digests the body, nothing is parsed.
+  Entry FindCompiled(std::string_view robots_body);
+
+  // Removes the entry for 'host', if any.
+  void Erase(std::string_view host);
+
+  // Removes all entries. Counters are kept.
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  // A part of the cache with its own lock. Defined in robots_cache.cc.
+  struct Shard;
+  // A CompiledRobots held by entries, with the memory accounted for it.
+  // Defined in robots_cache.cc.
+  struct Interned;
+  // Returns the shard of a host, or of the digest of a body for interning.
+  Shard& ShardFor(std::string_view key) const;
+  // Returns the live entry for 'host' in 'shard', its lock held.
+  Entry LookupLocked(Shard* shard, std::string_view host);
+  // Stores 'robots' in 'shard', its lock held.
+  void InsertLocked(Shard* shard, std::string_view host,
+                    std::shared_ptr<Interned> robots,
+                    std::chrono::seconds ttl);
+  // Evicts the least recently used entries of 'shard' while the cache is over
+  // budget, except for the 'keep' most recently used ones. The lock of 'shard'
+  // is held.
+  void EvictLocked(Shard* shard, size_t keep);
+  // Evicts from all shards while the cache is over budget, starting after
+  // 'shard'. No lock is held.
+  void EvictFromAllShards(const Shard& shard);
+  // Returns the Interned for 'robots_body', compiling it unless an entry
+  // already holds it.
+  std::shared_ptr<Interned> Intern(std::string_view robots_body);
+  // Returns the Interned of the body with 'digest' if an entry holds it, or
+  // nullptr.
+  std::shared_ptr<Interned> FindInterned(const BodyDigest& digest);
+
+  const Options options_;
+  const size_t num_shards_;
+  std::unique_ptr<Shard[]> shards_;
+
+  std::atomic<size_t> bytes_{0};
+  std::atomic<size_t> unique_robots_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> expirations_{0};
+  std::atomic<uint64_t> compilations_{0};
+  std::atomic<uint64_t> interned_{0};
+};
+
+}  // namespace googlebot
+
+#endif  // THIRD_PARTY_ROBOTSTXT_ROBOTS_CACHE_H_
@@ -40,13 +40,75 @@
 //   2 when --help is requested or if there is something invalid in the flags
 //   passed.
 //
+// Pack modes, see googlebot::RobotsPack:
+//     robots_main --convert <robots_all.bin> <pack>
+//   compiles the robots.txt files of a corpus in the format of the benchmark
+//   data (repeated "uint32_t length; char body[length]" records, see
+//   benchmark-utils/) into the pack file 'pack'. The key of each file in the
+//   pack is its zero-based index in the corpus, as a decimal string.
+//     robots_main --pack <pack> <key> <user_agent> <url>
+//   checks 'url' against the robots.txt stored under 'key' in 'pack', which is
+//   memory-mapped and queried in place. The return code is as above, or 2 if
+//   'key' is not in the pack.
+//
+// Corpus analysis, see googlebot::AnalyzeCorpus():
+//     robots_main --analyze [--threads=N] [--verdicts] <robots_all.bin>
+//         <user_agent> [<url>...]
+//   memory-maps a corpus in the same format and processes it on N threads (one
+//   per hardware thread by default). Prints directive and typo counts over all
+//   files, then how many files allow each of the comma-separated user agents,
+//   each checked on its own, to access each url. With --verdicts, also prints
+//   one line per file with its index and a 0/1 verdict per check. The elapsed
+//   time goes to stderr.
+//
+// Batch checks:
+//     robots_main --batch [--threads=N] <local_path_to_robotstxt> <user_agent>
+//         [<urls>]
+//   memory-maps and compiles the robots.txt once, then checks each line of
+//   the file 'urls', or of the standard input if it is omitted or "-", as a
+//   URL. Prints "<verdict>\t<matching line>\t<input line>" per URL, where
+//   verdict is ALLOWED or DISALLOWED and the matching line is 0 if no line
+//   matched.
+//     robots_main --batch [--threads=N] --corpus=<robots_all.bin> <user_agent>
+//         [<urls>]
+//     robots_main --batch [--threads=N] --robots-dir=<dir> <user_agent>
+//         [<urls>]
+//   same, for "<key>\t<url>" lines such as those of the benchmark workloads,
+//   where key is the index of a file in the memory-mapped corpus, or the
+//   name of a file in 'dir', like a host name. Lines of unknown keys get the
+//   verdict UNKNOWN. Consecutive lines of the same key share one compilation,
+//   so they are best kept together. Empty lines and lines starting with '#'
+//   are skipped. Input is checked in blocks of 4 MiB, split between N threads
+//   (one per hardware thread by default) when large enough, and the output
+//   keeps the order of the input. The count of checks and the elapsed time go
+//   to stderr. The return code is 0, or 2 if a file can't be read.
+//
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ROBOTS_MAIN_HAVE_MMAP 1
+#endif
+
 #include "robots.h"
+#include "robots_bulk.h"
 
 namespace {
 std::vector<std::string> SplitString(const std::string& s, char delim) {
@@ -64,17 +126,494 @@ bool LoadFile(const std::string& filename, std::string* result) {
   std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
   if (file.is_open()) {
     size_t size = file.tellg();
-    std::vector<char> buffer(size);
+    result->resize(size);
     file.seekg(0, std::ios::beg);
-    file.read(buffer.data(), size);
+    file.read(&(*result)[0], size);
     file.close();
     if (!file) return false;  // file reading error (failbit or badbit).
-    result->assign(buffer.begin(), buffer.end());
     return true;
   }
   return false;
 }
 
+// Maps 'filename' read-only for the lifetime of the process, or reads it where
+// mmap is not available.
+bool MapFile(const std::string& filename, std::string_view* result) {
+#ifdef ROBOTS_MAIN_HAVE_MMAP
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  const size_t size = st.st_size;
+  void* data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  *result = std::string_view(static_cast<const char*>(data), size);
+  return true;
+#else
+  static std::string* content = new std::string;
+  if (!LoadFile(filename, content)) return false;
+  *result = *content;
+  return true;
+#endif
+}
+
+// robots_main --convert <robots_all.bin> <pack>
+int ConvertToPack(const std::string& corpus_filename,
+                  const std::string& pack_filename) {
+  std::string corpus;
+  if (!LoadFile(corpus_filename, &corpus)) {
+    std::cerr << "failed to read file \"" << corpus_filename << "\""
+              << std::endl;
+    return 2;
+  }
+  googlebot::RobotsPack::Builder builder;
+  size_t pos = 0;
+  while (pos < corpus.size()) {
+    uint32_t length;
+    if (corpus.size() - pos < sizeof(length)) break;
+    std::memcpy(&length, corpus.data() + pos, sizeof(length));
+    pos += sizeof(length);
+    if (corpus.size() - pos < length) break;
+    builder.Add(std::to_string(builder.size()),
+                std::string_view(corpus).substr(pos, length));
+    pos += length;
+  }
+  if (pos != corpus.size()) {
+    std::cerr << "truncated record at offset " << pos << " of \""
+              << corpus_filename << "\"" << std::endl;
+    return 2;
+  }
+  const std::string pack = builder.Finish();
+  std::ofstream out(pack_filename, std::ios::out | std::ios::binary);
+  out.write(pack.data(), pack.size());
+  out.close();
+  if (!out) {
+    std::cerr << "failed to write file \"" << pack_filename << "\""
+              << std::endl;
+    return 2;
+  }
+  std::cout << "wrote " << builder.size() << " entries, " << pack.size()
+            << " bytes to \"" << pack_filename << "\"" << std::endl;
+  return 0;
+}
+
+// robots_main --pack <pack> <key> <user_agent> <url>
+int CheckPack(const std::string& pack_filename, const std::string& key,
+              const std::string& user_agents_arg, const std::string& url) {
+  std::string_view data;
+  if (!MapFile(pack_filename, &data)) {
+    std::cerr << "failed to read file \"" << pack_filename << "\""
+              << std::endl;
+    return 2;
+  }
+  const std::optional<googlebot::RobotsPack> pack =
+      googlebot::RobotsPack::Open(data);
+  if (!pack.has_value()) {
+    std::cerr << "\"" << pack_filename << "\" is not a valid robots pack"
+              << std::endl;
+    return 2;
+  }
+  const std::optional<googlebot::CompiledRobots> robots = pack->Find(key);
+  if (!robots.has_value()) {
+    std::cerr << "key \"" << key << "\" is not in the pack" << std::endl;
+    return 2;
+  }
+  std::vector<std::string> useragents = SplitString(user_agents_arg, ',');
+  const bool allowed = robots->Allowed(&useragents, url);
+  std::cout << "user-agent '" << user_agents_arg << "' with URI '" << url
+            << "': " << (allowed ? "ALLOWED" : "DISALLOWED") << std::endl;
+  return allowed ? 0 : 1;
+}
+
+// robots_main --analyze [--threads=N] [--verdicts] <robots_all.bin>
+//     <user_agent> [<url>...]
+int Analyze(int argc, char** argv) {
+  googlebot::CorpusAnalysisOptions options;
+  options.keep_verdicts = false;
+  int arg = 2;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; ++arg) {
+    const std::string flag = argv[arg];
+    if (flag.rfind("--threads=", 0) == 0) {
+      options.num_threads = std::strtoul(flag.c_str() + 10, nullptr, 10);
+    } else if (flag == "--verdicts") {
+      options.keep_verdicts = true;
+    } else {
+      std::cerr << "unknown flag \"" << flag << "\"" << std::endl;
+      return 2;
+    }
+  }
+  if (argc - arg < 2) {
+    std::cerr << "--analyze needs a corpus and user agents" << std::endl;
+    return 2;
+  }
+  const std::string corpus_filename = argv[arg++];
+  options.user_agents = SplitString(argv[arg++], ',');
+  options.urls.assign(argv + arg, argv + argc);
+
+  std::string error;
+  const std::unique_ptr<googlebot::RobotsCorpus> corpus =
+      googlebot::RobotsCorpus::Open(corpus_filename, &error);
+  if (corpus == nullptr) {
+    std::cerr << error << " of \"" << corpus_filename << "\"" << std::endl;
+    return 2;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const googlebot::CorpusAnalysis analysis =
+      googlebot::AnalyzeCorpus(*corpus, options);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  // Indexed by googlebot::RobotsParsedLine::RobotsTagName.
+  static const char* const kTagNames[] = {
+      "unknown",     "user-agent",   "allow",          "disallow", "sitemap",
+      "crawl-delay", "request-rate", "content-signal", "unused"};
+  static_assert(sizeof(kTagNames) / sizeof(kTagNames[0]) ==
+                googlebot::RobotsCorpusStats::kNumTagNames);
+  const googlebot::RobotsCorpusStats& stats = analysis.stats;
+  std::cout << "files\t" << stats.files << std::endl
+            << "bytes\t" << stats.bytes << std::endl
+            << "lines\t" << stats.lines << std::endl
+            << "empty lines\t" << stats.empty_lines << std::endl
+            << "comment lines\t" << stats.comment_lines << std::endl
+            << "lines too long\t" << stats.lines_too_long << std::endl
+            << "missing colon\t" << stats.missing_colon_separator
+            << std::endl
+            << "files with typos\t" << stats.files_with_typos << std::endl;
+  for (int tag = 0; tag < googlebot::RobotsCorpusStats::kNumTagNames; ++tag) {
+    std::cout << "tag " << kTagNames[tag] << "\t" << stats.tags[tag] << "\t"
+              << stats.typos[tag] << " typos" << std::endl;
+  }
+  for (size_t agent = 0; agent < analysis.num_user_agents; ++agent) {
+    for (size_t url = 0; url < analysis.num_urls; ++url) {
+      std::cout << "allowed\t" << options.user_agents[agent] << "\t"
+                << options.urls[url] << "\t"
+                << analysis.allowed_files[agent * analysis.num_urls + url]
+                << std::endl;
+    }
+  }
+  if (options.keep_verdicts) {
+    for (size_t file = 0; file < analysis.num_files; ++file) {
+      std::cout << "file\t" << file << "\t";
+      for (size_t agent = 0; agent < analysis.num_user_agents; ++agent) {
+        for (size_t url = 0; url < analysis.num_urls; ++url) {
+          std::cout << (analysis.allowed(file, agent, url) ? '1' : '0');
+        }
+      }
+      std::cout << '\n';
+    }
+    std::cout.flush();
+  }
+  std::cerr << "analyzed " << stats.files << " files, " << stats.bytes
+            << " bytes in " << elapsed.count() << " s ("
+            << stats.bytes / 1e6 / elapsed.count() << " MB/s)" << std::endl;
+  return 0;
+}
+
+// Where --batch finds the robots.txt of each line of input: a single file
+// for all of them, or the record or file named by the key before the tab.
+struct BatchSource {
+  std::vector<std::string> user_agents;
+  // The rules of the single file, or null.
+  const googlebot::ResolvedRobots* robots = nullptr;
+  // The records of a robots_all.bin corpus, keyed by their index.
+  std::vector<std::string_view> bodies;
+  // The directory of files named by their key, used if not empty.
+  std::string dir;
+};
+
+// Counts over the lines checked by one worker.
+struct BatchCounts {
+  uint64_t checked = 0;
+  uint64_t allowed = 0;
+  // Lines whose key names no record or file.
+  uint64_t unknown = 0;
+};
+
+// Returns the robots.txt stored under 'key' in 'source', or false if there is
+// none. 'storage' holds the body if it was read from a file.
+bool FindBatchBody(const BatchSource& source, std::string_view key,
+                   std::string* storage, std::string_view* body) {
+  if (!source.dir.empty()) {
+    // Keys are host names, never paths.
+    if (key.empty() || key == "." || key == ".." ||
+        key.find('/') != std::string_view::npos) {
+      return false;
+    }
+    std::string filename = source.dir;
+    filename += '/';
+    filename += key;
+    if (!LoadFile(filename, storage)) return false;
+    *body = *storage;
+    return true;
+  }
+  uint64_t index = 0;
+  const auto parsed =
+      std::from_chars(key.data(), key.data() + key.size(), index);
+  if (key.empty() || parsed.ec != std::errc() ||
+      parsed.ptr != key.data() + key.size() || index >= source.bodies.size()) {
+    return false;
+  }
+  *body = source.bodies[index];
+  return true;
+}
+
+// Appends "<verdict>\t<matching line>\t<input line>\n" for each of 'lines' to
+// 'out', from the results of matching their URLs.
+void AppendBatchVerdicts(const std::vector<std::string_view>& lines,
+                         const googlebot::CompiledRobots::MatchResult* results,
+                         std::string* out, BatchCounts* counts) {
+  for (size_t i = 0; i < lines.size(); ++i) {
+    out->append(results[i].allowed ? "ALLOWED\t" : "DISALLOWED\t");
+    char number[16];
+    const auto printed = std::to_chars(number, number + sizeof(number),
+                                       results[i].matching_line);
+    out->append(number, printed.ptr);
+    out->push_back('\t');
+    out->append(lines[i]);
+    out->push_back('\n');
+    counts->allowed += results[i].allowed;
+  }
+  counts->checked += lines.size();
+}
+
+// Checks the lines of 'input', of whole lines, against 'source' and appends
+// their verdicts to 'out'. Empty lines and lines starting with '#' are skipped.
+// With keys, consecutive lines of the same key are matched together against
+// the rules compiled once for them.
+void CheckBatchLines(const BatchSource& source, std::string_view input,
+                     std::string* out, BatchCounts* counts) {
+  out->reserve(out->size() + input.size() + input.size() / 2);
+  std::vector<std::string_view> lines;
+  std::vector<std::string_view> urls;
+  std::vector<googlebot::CompiledRobots::MatchResult> results;
+  std::string storage;
+  std::string_view key;
+  // Matches the pending lines, all of 'key' if the source has keys.
+  const auto flush = [&]() {
+    if (lines.empty()) return;
+    results.resize(urls.size());
+    if (source.robots != nullptr) {
+      source.robots->MatchBatch(urls.data(), urls.size(), results.data());
+      AppendBatchVerdicts(lines, results.data(), out, counts);
+    } else {
+      std::string_view body;
+      if (FindBatchBody(source, key, &storage, &body)) {
+        googlebot::CompiledRobots(body)
+            .Resolve(&source.user_agents)
+            .MatchBatch(urls.data(), urls.size(), results.data());
+        AppendBatchVerdicts(lines, results.data(), out, counts);
+      } else {
+        for (const std::string_view line : lines) {
+          out->append("UNKNOWN\t0\t");
+          out->append(line);
+          out->push_back('\n');
+        }
+        counts->unknown += lines.size();
+      }
+    }
+    lines.clear();
+    urls.clear();
+  };
+  while (!input.empty()) {
+    const size_t end = input.find('\n');
+    std::string_view line = input.substr(0, end);
+    input.remove_prefix(end == std::string_view::npos ? input.size()
+                                                      : end + 1);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty() || line[0] == '#') continue;
+    std::string_view url = line;
+    if (source.robots == nullptr) {
+      const size_t tab = line.find('\t');
+      const std::string_view line_key =
+          line.substr(0, tab == std::string_view::npos ? line.size() : tab);
+      url = tab == std::string_view::npos ? std::string_view()
+                                          : line.substr(tab + 1);
+      if (line_key != key) {
+        flush();
+        key = line_key;
+      }
+    }
+    lines.push_back(line);
+    urls.push_back(url);
+  }
+  flush();
+}
+
+// robots_main --batch [--threads=N] <robots.txt> <user_agent> [<urls>]
+// robots_main --batch [--threads=N] --corpus=<robots_all.bin> <user_agent>
+//     [<urls.tsv>]
+// robots_main --batch [--threads=N] --robots-dir=<dir> <user_agent>
+//     [<urls.tsv>]
+int Batch(int argc, char** argv) {
+  // Input is read and checked in blocks of about this size, split between
+  // the threads at line boundaries, and each thread gets at least
+  // kMinBytesPerThread of it, so that small inputs stay on one thread.
+  constexpr size_t kBlockSize = 4 << 20;
+  constexpr size_t kMinBytesPerThread = 256 << 10;
+
+  size_t num_threads = 0;
+  std::string corpus_filename;
+  BatchSource source;
+  int arg = 2;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; ++arg) {
+    const std::string flag = argv[arg];
+    if (flag.rfind("--threads=", 0) == 0) {
+      num_threads = std::strtoul(flag.c_str() + 10, nullptr, 10);
+    } else if (flag.rfind("--corpus=", 0) == 0) {
+      corpus_filename = flag.substr(9);
+    } else if (flag.rfind("--robots-dir=", 0) == 0) {
+      source.dir = flag.substr(13);
+    } else {
+      std::cerr << "unknown flag \"" << flag << "\"" << std::endl;
+      return 2;
+    }
+  }
+  const bool keyed = !corpus_filename.empty() || !source.dir.empty();
+  if (!corpus_filename.empty() && !source.dir.empty()) {
+    std::cerr << "--corpus and --robots-dir are exclusive" << std::endl;
+    return 2;
+  }
+  const int num_args = argc - arg;
+  if (num_args < (keyed ? 1 : 2) || num_args > (keyed ? 2 : 3)) {
+    std::cerr << "--batch needs a robots.txt file, --corpus or --robots-dir,"
+              << " and user agents" << std::endl;
+    return 2;
+  }
+
+  std::optional<googlebot::ResolvedRobots> robots;
+  std::unique_ptr<googlebot::RobotsCorpus> corpus;
+  if (!keyed) {
+    const std::string filename = argv[arg++];
+    std::string_view body;
+    if (!MapFile(filename, &body)) {
+      std::cerr << "failed to read file \"" << filename << "\"" << std::endl;
+      return 2;
+    }
+    source.user_agents = SplitString(argv[arg++], ',');
+    robots = googlebot::CompiledRobots(body).Resolve(&source.user_agents);
+    source.robots = &*robots;
+  } else {
+    if (!corpus_filename.empty()) {
+      std::string error;
+      corpus = googlebot::RobotsCorpus::Open(corpus_filename, &error);
+      if (corpus == nullptr) {
+        std::cerr << error << " of \"" << corpus_filename << "\""
+                  << std::endl;
+        return 2;
+      }
+      // Open() checked that the records are whole.
+      std::string_view data = corpus->data();
+      source.bodies.reserve(corpus->size());
+      while (data.size() >= sizeof(uint32_t)) {
+        uint32_t length;
+        std::memcpy(&length, data.data(), sizeof(length));
+        source.bodies.push_back(data.substr(sizeof(length), length));
+        data.remove_prefix(sizeof(length) + length);
+      }
+    }
+    source.user_agents = SplitString(argv[arg++], ',');
+  }
+
+  FILE* input = stdin;
+  std::string input_filename = "<stdin>";
+  if (arg < argc && std::strcmp(argv[arg], "-") != 0) {
+    input_filename = argv[arg];
+    input = std::fopen(argv[arg], "rb");
+    if (input == nullptr) {
+      std::cerr << "failed to read file \"" << input_filename << "\""
+                << std::endl;
+      return 2;
+    }
+  }
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::string block;
+  size_t pending = 0;  // Bytes of an incomplete line at the start of 'block'.
+  std::vector<std::string> outputs(num_threads);
+  std::vector<BatchCounts> counts(num_threads);
+  std::vector<std::thread> workers;
+  bool ok = true;
+  for (bool eof = false; !eof;) {
+    block.resize(pending + kBlockSize);
+    const size_t read = std::fread(&block[pending], 1, kBlockSize, input);
+    if (read < kBlockSize) {
+      eof = true;
+      ok = !std::ferror(input);
+    }
+    const size_t size = pending + read;
+    size_t end = size;
+    if (!eof) {
+      end = block.rfind('\n', size - 1);
+      // A line longer than a block: read on.
+      if (end == std::string::npos || end < pending) {
+        pending = size;
+        continue;
+      }
+      ++end;
+    }
+    // Split [0, end) between the threads at line boundaries.
+    std::string_view lines(block.data(), end);
+    const size_t parts = std::min(
+        num_threads, std::max<size_t>(1, lines.size() / kMinBytesPerThread));
+    for (size_t part = 0; part < parts; ++part) {
+      size_t part_end = lines.size();
+      if (part + 1 < parts) {
+        part_end = lines.find('\n', lines.size() / (parts - part));
+        part_end =
+            part_end == std::string_view::npos ? lines.size() : part_end + 1;
+      }
+      const std::string_view part_lines = lines.substr(0, part_end);
+      lines.remove_prefix(part_end);
+      outputs[part].clear();
+      if (parts == 1) {
+        CheckBatchLines(source, part_lines, &outputs[part], &counts[part]);
+      } else {
+        workers.emplace_back(CheckBatchLines, std::cref(source), part_lines,
+                             &outputs[part], &counts[part]);
+      }
+    }
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+    for (size_t part = 0; part < parts; ++part) {
+      std::fwrite(outputs[part].data(), 1, outputs[part].size(), stdout);
+    }
+    pending = size - end;
+    std::memmove(&block[0], block.data() + end, pending);
+  }
+  if (input != stdin) std::fclose(input);
+  std::fflush(stdout);
+  if (!ok) {
+    std::cerr << "failed to read file \"" << input_filename << "\""
+              << std::endl;
+    return 2;
+  }
+
+  BatchCounts total;
+  for (const BatchCounts& part : counts) {
+    total.checked += part.checked;
+    total.allowed += part.allowed;
+    total.unknown += part.unknown;
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cerr << "checked " << total.checked << " URLs, " << total.allowed
+            << " allowed";
+  if (keyed) std::cerr << ", " << total.unknown << " with unknown keys";
+  std::cerr << " in " << elapsed.count() << " s ("
+            << total.checked / elapsed.count() << " URLs/s)" << std::endl;
+  return 0;
+}
+
 void ShowHelp(int argc, char** argv) {
   std::cerr << "Shows whether the given user_agent and URI combination"
             << " is allowed or disallowed by the given robots.txt file. "
@@ -88,7 +627,40 @@ void ShowHelp(int argc, char** argv) {
             << std::endl;
   std::cerr << "Example: " << std::endl
             << "  " << argv[0] << " robots.txt FooBot http://example.com/foo"
+            << std::endl
             << std::endl;
+  std::cerr << "Precompiled packs of many robots.txt files: " << std::endl
+            << "  " << argv[0] << " --convert <robots_all.bin> <pack>"
+            << std::endl
+            << "  " << argv[0] << " --pack <pack> <key> <user_agent> <URI>"
+            << std::endl
+            << "Files are keyed by their index in robots_all.bin." << std::endl
+            << std::endl;
+  std::cerr << "Statistics and verdicts over a corpus of robots.txt files: "
+            << std::endl
+            << "  " << argv[0]
+            << " --analyze [--threads=N] [--verdicts] <robots_all.bin>"
+            << " <user_agent> [<URI>...]" << std::endl
+            << "Each of the comma-separated user agents is checked on its own."
+            << std::endl
+            << std::endl;
+  std::cerr << "Many URIs, one per line of <URIs> or of the standard input: "
+            << std::endl
+            << "  " << argv[0]
+            << " --batch [--threads=N] <robots.txt filename> <user_agent>"
+            << " [<URIs>]" << std::endl
+            << "  " << argv[0]
+            << " --batch [--threads=N] --corpus=<robots_all.bin> <user_agent>"
+            << " [<keys and URIs>]" << std::endl
+            << "  " << argv[0]
+            << " --batch [--threads=N] --robots-dir=<dir> <user_agent>"
+            << " [<keys and URIs>]" << std::endl
+            << "Prints the verdict, the matching line and the input line per"
+            << " URI." << std::endl
+            << "With --corpus or --robots-dir, each line is <key>\\t<URI>,"
+            << " where <key> is" << std::endl
+            << "the index of a file in robots_all.bin or the name of a file in"
+            << " <dir>." << std::endl;
 }
 
 int main(int argc, char** argv) {
@@ -97,6 +669,18 @@ int main(int argc, char** argv) {
     ShowHelp(argc, argv);
     return 2;
   }
+  if (filename == "--convert" && argc == 4) {
+    return ConvertToPack(argv[2], argv[3]);
+  }
+  if (filename == "--analyze") {
+    return Analyze(argc, argv);
+  }
+  if (filename == "--batch") {
+    return Batch(argc, argv);
+  }
+  if (filename == "--pack" && argc == 6) {
+    return CheckPack(argv[2], argv[3], argv[4], argv[5]);
+  }
   if (argc != 4) {
     std::cerr << "Invalid amount of arguments. Showing help." << std::endl
               << std::endl;
@@ -19,6 +19,8 @@ OUTPUT_DIR = SCRIPT_DIR
 # Files to process
 ROBOTS_HEADER = os.path.join(ROOT_DIR, "robots.h")
 ROBOTS_SOURCE = os.path.join(ROOT_DIR, "robots.cc")
+ROBOTS_CACHE_HEADER = os.path.join(ROOT_DIR, "robots_cache.h")
+ROBOTS_CACHE_SOURCE = os.path.join(ROOT_DIR, "robots_cache.cc")
 ROBOTS_C_HEADER = os.path.join(ROOT_DIR, "bindings", "c", "robots_c.h")
 ROBOTS_C_SOURCE = os.path.join(ROOT_DIR, "bindings", "c", "robots_c.cc")
 REPORTING_HEADER = os.path.join(ROOT_DIR, "reporting_robots.h")
@@ -295,15 +297,20 @@ def generate_robots_c_h():
 
     robots_h = read_file(ROBOTS_HEADER)
     robots_cc = read_file(ROBOTS_SOURCE)
+    robots_cache_h = read_file(ROBOTS_CACHE_HEADER)
+    robots_cache_cc = read_file(ROBOTS_CACHE_SOURCE)
     robots_c_h = read_file(ROBOTS_C_HEADER)
     robots_c_cc = read_file(ROBOTS_C_SOURCE)
 
-    # Strip include guards from robots.h
+    # Strip include guards from robots.h and robots_cache.h
     robots_h_inner = strip_include_guards(robots_h)
+    robots_cache_h_inner = strip_include_guards(
+        remove_include(robots_cache_h, "robots.h"))
 
-    # Remove #include "robots_c.h" and "robots.h" from robots_c.cc
+    # Remove local includes from robots_c.cc
     robots_c_cc = remove_include(robots_c_cc, "robots_c.h")
     robots_c_cc = remove_include(robots_c_cc, "robots.h")
+    robots_c_cc = remove_include(robots_c_cc, "robots_cache.h")
 
     # Find where to insert robots.h content (after #define ROBOTS_C_H)
     lines = robots_c_h.split('\n')
@@ -320,6 +327,9 @@ def generate_robots_c_h():
         "// === Begin embedded robots.h (C++ only) ===",
         robots_h_inner,
         "// === End embedded robots.h ===",
+        "// === Begin embedded robots_cache.h (C++ only) ===",
+        robots_cache_h_inner,
+        "// === End embedded robots_cache.h ===",
         "#endif  // __cplusplus",
         ""
     ]
@@ -329,6 +339,8 @@ def generate_robots_c_h():
 
     # Extract implementations
     robots_impl = extract_implementation(robots_cc, ["robots.h"])
+    robots_cache_impl = extract_implementation(robots_cache_cc,
+                                               ["robots_cache.h"])
     robots_c_impl = extract_implementation(robots_c_cc, ["robots_c.h", "robots.h"])
 
     # Find last #endif
@@ -366,6 +378,10 @@ def generate_robots_c_h():
 {robots_impl}
 // === End robots.cc implementation ===
 
+// === Begin robots_cache.cc implementation ===
+{robots_cache_impl}
+// === End robots_cache.cc implementation ===
+
 // === Begin robots_c.cc implementation ===
 {robots_c_impl}
 // === End robots_c.cc implementation ===
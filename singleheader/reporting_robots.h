@@ -1,7 +1,7 @@
 //
 // *** AMALGAMATED SINGLE-HEADER VERSION ***
-// Generated: 2026-01-16 23:01:33 +0200
-// Commit: 0e413cb
+// Generated: 2026-10-14 15:52:02 +0000
+// Commit: 4bc5ae9
 //
 // This file is auto-generated. Do not edit directly.
 // Run: python3 singleheader/amalgamate.py
@@ -42,19 +42,66 @@
 //   https://developers.google.com/search/docs/crawling-indexing/robots/robots_txt
 //
 // This library provides a low-level parser for robots.txt (ParseRobotsTxt()),
-// and a matcher for URLs against a robots.txt (class RobotsMatcher).
+// a matcher for URLs against a robots.txt (class RobotsMatcher), and a
+// pre-parsed robots.txt for matching many URLs (class CompiledRobots).
 
 
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
+// std::span overloads are only offered to C++20 callers, the library itself
+// builds as C++17.
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#include <span>
+#define ROBOTS_HAVE_SPAN 1
+#endif
+
+// Matching behaviour beyond RFC 9309. Each switch defaults to 1, the behaviour
+// of Google's parser. Defining it to 0 compiles the code path out, for builds
+// that only need the standard and a leaner parser and matcher:
+//   ROBOTS_ALLOW_FREQUENT_TYPOS: keys with frequent typos, like "disalow" or
+//     "useragent", count as the directive they misspell.
+//   ROBOTS_DECODE_PERCENT_ESCAPES: a %XX escape in a path or pattern matches
+//     the byte it encodes, so "/a%2Fb" matches "/a/b". With 0, escapes only
+//     match themselves, with case-insensitive hex digits.
+//   ROBOTS_NORMALIZE_INDEX_HTML: "Allow: /dir/index.htm" and ".../index.html"
+//     also allow "/dir/".
+//   ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES: parse Crawl-delay and Request-rate.
+//     With 0 they are unknown directives, and the default of
+//     ROBOTS_SUPPORT_CONTENT_SIGNAL below.
+// The URL parser is chosen at build time too: ada-url with ROBOTS_USE_ADA,
+// a built-in parser otherwise.
+#ifndef ROBOTS_ALLOW_FREQUENT_TYPOS
+#define ROBOTS_ALLOW_FREQUENT_TYPOS 1
+#endif
+#ifndef ROBOTS_DECODE_PERCENT_ESCAPES
+#define ROBOTS_DECODE_PERCENT_ESCAPES 1
+#endif
+#ifndef ROBOTS_NORMALIZE_INDEX_HTML
+#define ROBOTS_NORMALIZE_INDEX_HTML 1
+#endif
+#ifndef ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+#define ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES 1
+#endif
+
 // Content-Signal directive support (proposed for AI content preferences).
 // Define ROBOTS_SUPPORT_CONTENT_SIGNAL=0 to disable for smaller binary/faster parsing.
-// Default: enabled (1)
+// Default: ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES, enabled (1)
 #ifndef ROBOTS_SUPPORT_CONTENT_SIGNAL
-#define ROBOTS_SUPPORT_CONTENT_SIGNAL 1
+#define ROBOTS_SUPPORT_CONTENT_SIGNAL ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+#endif
+
+// Hot-path statistics, see RobotsStats. Define ROBOTS_ENABLE_STATS=1 to count
+// and time the work of the parser and matchers. Default: disabled (0), which
+// compiles the counters out.
+#ifndef ROBOTS_ENABLE_STATS
+#define ROBOTS_ENABLE_STATS 0
 #endif
 
 namespace googlebot {
@@ -166,6 +213,18 @@ class RobotsParseHandler {
   };
 
   virtual void ReportLineMetadata(int line_num, const LineMetadata& metadata) {}
+
+  // Asked after each line. Returning true tells the parser that no later line
+  // can change what the handler computes: the rest of the body is skipped and
+  // HandleRobotsEnd() is called right away.
+  virtual bool CanStopParsing() const { return false; }
+
+  // Asked after each line, like CanStopParsing(). Returning true tells the
+  // parser that no line before the next user-agent line can change what the
+  // handler computes, except sitemap lines, which belong to no group: the
+  // parser may skip the other lines without any callback, ReportLineMetadata()
+  // included. Line numbers still count them.
+  virtual bool CanSkipToNextUserAgent() const { return false; }
 };
 
 // Parses body of a robots.txt and emits parse callbacks. This will accept
@@ -176,6 +235,150 @@ class RobotsParseHandler {
 void ParseRobotsTxt(std::string_view robots_body,
                     RobotsParseHandler* parse_callback);
 
+// SHA-256 digest of a robots.txt body. A digest identifies a body without
+// keeping it: RobotsCache shares the CompiledRobots of bodies with the same
+// digest.
+using BodyDigest = std::array<uint8_t, 32>;
+BodyDigest DigestBody(std::string_view body);
+
+// RobotsTxtStreamParser - ParseRobotsTxt() for a body received in chunks.
+//
+// The chunks are passed to Feed() in order, then Finish() ends the body. The
+// handler gets the same callbacks as from ParseRobotsTxt() on the whole body,
+// wherever the chunks are split: inside a line, between the CR and LF of a
+// line ending or inside the byte order mark. Lines are parsed from the chunks
+// in place, only a line spanning chunks is copied, up to the length at which
+// lines are truncated.
+//
+// Example:
+//   RobotsTxtStreamParser parser(&handler);
+//   while (ReadChunk(&chunk) && parser.Feed(chunk)) {}
+//   parser.Finish();
+class RobotsTxtStreamParser {
+ public:
+  explicit RobotsTxtStreamParser(RobotsParseHandler* handler);
+
+  // Disallow copying and assignment.
+  RobotsTxtStreamParser(const RobotsTxtStreamParser&) = delete;
+  RobotsTxtStreamParser& operator=(const RobotsTxtStreamParser&) = delete;
+
+  // Parses the lines completed by 'chunk'. Returns false once the handler can
+  // stop parsing (RobotsParseHandler::CanStopParsing()): the rest of the body
+  // is not needed and further chunks are ignored.
+  bool Feed(std::string_view chunk);
+
+  // Parses the last line and calls HandleRobotsEnd(). Call it once, after the
+  // last chunk, even if parsing stopped early.
+  void Finish();
+
+  // True once the handler stopped parsing.
+  bool stopped() const { return stopped_; }
+
+ private:
+  // Calls HandleRobotsStart() on the first chunk.
+  void Start();
+  // Parses the pending line, completed with 'tail'.
+  void EmitLine(std::string_view tail);
+
+  RobotsParseHandler* const handler_;
+  // Start of a line spanning chunks, truncated like lines are.
+  std::string line_;
+  // Length of that line before truncation.
+  size_t line_length_ = 0;
+  int line_num_ = 0;
+  // Bytes of the byte order mark skipped so far.
+  int bom_bytes_ = 0;
+  bool started_ = false;
+  bool in_bom_ = true;
+  bool last_was_carriage_return_ = false;
+  bool stopped_ = false;
+  // The handler can skip to the next user-agent line.
+  bool skip_to_user_agent_ = false;
+};
+
+// Counters of the work done by the parser and the matchers of the calling
+// thread, to find out where the time goes for a slow robots.txt and to flag
+// adversarial ones. They are only collected when built with
+// ROBOTS_ENABLE_STATS=1; otherwise GetRobotsStats() returns zeros.
+//
+// The phases nest: parse_ns includes classify_ns and, for RobotsMatcher, which
+// matches while it parses, match_ns. Timing a phase costs two clock reads, so
+// collecting stats slows down matching noticeably.
+struct RobotsStats {
+  // Bytes of robots.txt bodies given to the parsers.
+  uint64_t bytes = 0;
+  // Lines of those bodies, including lines skipped without being parsed.
+  uint64_t lines = 0;
+  // Lines with a key and a value.
+  uint64_t directives = 0;
+  // URLs whose path was extracted for matching.
+  uint64_t urls = 0;
+  // Allow/Disallow patterns matched against a path one by one. The literal
+  // patterns that ResolvedRobots matches in its trie are not counted.
+  uint64_t patterns_evaluated = 0;
+  // Path positions added to the position set by a '*' of a pattern.
+  uint64_t wildcard_expansions = 0;
+  // Positions examined by the wildcard matcher, its total work, and the most
+  // for a single pattern: large values flag a pathological robots.txt.
+  uint64_t match_steps = 0;
+  uint64_t max_match_steps = 0;
+
+  // Nanoseconds spent extracting paths from URLs (GetPathParamsQuery()),
+  // parsing, classifying keys and matching patterns.
+  uint64_t url_ns = 0;
+  uint64_t parse_ns = 0;
+  uint64_t classify_ns = 0;
+  uint64_t match_ns = 0;
+
+  // Adds the counters of 'other', e.g. from another thread.
+  void Merge(const RobotsStats& other);
+};
+
+// True iff the library collects RobotsStats.
+constexpr bool kRobotsStatsEnabled = ROBOTS_ENABLE_STATS;
+
+// Returns the counters of the calling thread since it started or since the
+// last ResetRobotsStats().
+RobotsStats GetRobotsStats();
+
+// Sets the counters of the calling thread to zero.
+void ResetRobotsStats();
+
+// Limits on the work of matching one URL, for robots.txt files of unknown
+// origin. Allow/Disallow patterns with '*' are matched against a set of path
+// positions, so a pattern like "/*a*a*a*a*b" costs up to the length of the
+// path for each of its characters, and a hostile file can repeat it on
+// thousands of lines. A check that would go over these limits stops matching
+// and returns the 'allow_on_exceeded' verdict instead, and reports that it did.
+//
+// The caps apply to each pattern that the check evaluates, the steps to all of
+// them together. By default there are no limits, which is what the reference
+// matcher does.
+struct MatchBudget {
+  // Longest pattern, in bytes, and most '*' in a pattern.
+  size_t max_pattern_length = std::numeric_limits<size_t>::max();
+  size_t max_wildcards = std::numeric_limits<size_t>::max();
+  // Path positions that the wildcard matcher may examine, summed over the
+  // patterns of a check. Counted like RobotsStats::match_steps: plain prefix
+  // patterns that need no position set cost nothing.
+  uint64_t max_steps = std::numeric_limits<uint64_t>::max();
+  // Verdict of a check that went over the budget. Not crawling is the
+  // conservative choice, as nothing is known about the rules left unmatched.
+  bool allow_on_exceeded = false;
+};
+
+// How the matchers below get the path to match from a URL.
+enum class UrlMode {
+  // Parses the URL, with ada-url when built with ROBOTS_USE_ADA. This is the
+  // default and the right choice for URLs of unknown origin.
+  kParse,
+  // Trusts the URL to be absolute and canonical, e.g. as normalized by a crawl
+  // frontier ("https://example.com/path?query"). The path and query are sliced
+  // out with a single scan instead of being parsed. Results for URLs that
+  // are not canonical are unspecified.
+  kTrustedCanonical,
+};
+
 // RobotsMatcher - matches robots.txt against URLs.
 //
 // The Matcher uses a default match strategy for Allow/Disallow patterns which
@@ -220,13 +423,50 @@ class RobotsMatcher : protected RobotsParseHandler {
   // according to RFC3986.
   bool AllowedByRobots(std::string_view robots_body,
                        const std::vector<std::string>* user_agents,
-                       const std::string& url);
+                       std::string_view url);
+
+  // Same as above for the "num_user_agents" agents at 'user_agents'. None of
+  // the arguments are copied: a check only allocates if the path of 'url'
+  // contains '*' or '$', which have to be %-encoded for matching.
+  bool AllowedByRobots(std::string_view robots_body,
+                       const std::string_view* user_agents,
+                       size_t num_user_agents, std::string_view url);
+
+#ifdef ROBOTS_HAVE_SPAN
+  bool AllowedByRobots(std::string_view robots_body,
+                       std::span<const std::string_view> user_agents,
+                       std::string_view url) {
+    return AllowedByRobots(robots_body, user_agents.data(), user_agents.size(),
+                           url);
+  }
+#endif
 
   // Do robots check for 'url' when there is only one user agent. 'url' must
   // be %-encoded according to RFC3986.
   bool OneAgentAllowedByRobots(std::string_view robots_txt,
-                               const std::string& user_agent,
-                               const std::string& url);
+                               std::string_view user_agent,
+                               std::string_view url);
+
+  // Sets how the *AllowedByRobots() methods extract the path from their 'url'.
+  void set_url_mode(UrlMode mode) { url_mode_ = mode; }
+  UrlMode url_mode() const { return url_mode_; }
+
+  // Sets whether the lines of groups for other user agents are skipped up to
+  // the next user-agent line instead of being parsed. Skipped lines cannot
+  // change any result, so this is on by default; turn it off for subclasses
+  // that need the callbacks of every line.
+  void set_skip_other_groups(bool skip) { skip_other_groups_ = skip; }
+  bool skip_other_groups() const { return skip_other_groups_; }
+
+  // Sets the limits on the work of each check. They only apply to the default
+  // match strategy.
+  void set_match_budget(const MatchBudget& budget) { match_budget_ = budget; }
+  const MatchBudget& match_budget() const { return match_budget_; }
+
+  // Sets whether checks collect the Sitemap lines of the robots.txt, which
+  // apply to the whole file whatever the user agents. Off by default.
+  void set_collect_sitemaps(bool collect) { collect_sitemaps_ = collect; }
+  bool collect_sitemaps() const { return collect_sitemaps_; }
 
   // Returns true if we are disallowed from crawling a matching URI.
   bool disallow() const;
@@ -243,6 +483,10 @@ class RobotsMatcher : protected RobotsParseHandler {
   // Returns the line that matched or 0 if none matched.
   int matching_line() const;
 
+  // Returns true iff the last check went over the match budget. disallow()
+  // then returns the verdict of the budget and matching_line() returns 0.
+  bool budget_exceeded() const { return budget_exceeded_; }
+
   // Returns the crawl-delay value in seconds for the matched user-agent.
   // Returns std::nullopt if no crawl-delay was specified.
   // Note: This is a non-standard directive that Google ignores, but other
@@ -261,6 +505,11 @@ class RobotsMatcher : protected RobotsParseHandler {
   std::optional<ContentSignal> GetContentSignal() const;
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
 
+  // Returns the non-empty values of the Sitemap lines of the last checked
+  // robots.txt, in file order, if set_collect_sitemaps(true) was called. They
+  // point into that robots.txt, which must outlive them: nothing is copied.
+  const std::vector<std::string_view>& sitemaps() const { return sitemaps_; }
+
  protected:
   // Parse callbacks.
   // Protected because used in unittest. Never override RobotsMatcher, implement
@@ -280,6 +529,7 @@ class RobotsMatcher : protected RobotsParseHandler {
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
   void HandleUnknownAction(int line_num, std::string_view action,
                            std::string_view value) override;
+  bool CanSkipToNextUserAgent() const override;
 
  protected:
   // Extract the matchable part of a user agent string, essentially stopping at
@@ -290,7 +540,9 @@ class RobotsMatcher : protected RobotsParseHandler {
   // Initialize next path and user-agents to check. Path must contain only the
   // path, params, and query (if any) of the url and must start with a '/'.
   void InitUserAgentsAndPath(const std::vector<std::string>* user_agents,
-                             const char* path);
+                             std::string_view path);
+  void InitUserAgentsAndPath(const std::string_view* user_agents,
+                             size_t num_user_agents, std::string_view path);
 
   // Returns true if any user-agent was seen.
   bool seen_any_agent() const {
@@ -359,13 +611,39 @@ class RobotsMatcher : protected RobotsParseHandler {
   // Used to implement "most specific wins" rule per Google's documentation.
   size_t best_specific_agent_length_;
 
-  // The path we want to pattern match. Not owned and only a valid pointer
-  // during the lifetime of *AllowedByRobots calls.
-  const char* path_;
-  // The User-Agents we are interested in. Not owned and only a valid
-  // pointer during the lifetime of *AllowedByRobots calls.
+  // Returns true if 'user_agent' is one of the User-Agents we are interested
+  // in, ignoring case.
+  bool IsQueriedAgent(std::string_view user_agent) const;
+
+  // Calls the handlers of RobotsMatcher without virtual dispatch. Defined in
+  // robots.cc.
+  class DirectHandler;
+  // Parses 'robots_body' into this matcher, through a DirectHandler unless
+  // this is an instance of a subclass.
+  void Parse(std::string_view robots_body);
+
+  // The path we want to pattern match. Not owned and only valid during the
+  // lifetime of *AllowedByRobots calls.
+  std::string_view path_;
+  // Holds the path when it can't point into the url, reused across calls.
+  std::string path_buffer_;
+  UrlMode url_mode_ = UrlMode::kParse;
+  bool skip_other_groups_ = true;
+  bool collect_sitemaps_ = false;
+  MatchBudget match_budget_;
+  // Steps of match_budget_ left for the current check, and whether the check
+  // went over the budget.
+  uint64_t budget_steps_left_ = 0;
+  bool budget_exceeded_ = false;
+  // The User-Agents we are interested in, either as a vector or as an array
+  // of 'num_user_agent_views_' views. Not owned and only valid during the
+  // lifetime of *AllowedByRobots calls.
   const std::vector<std::string>* user_agents_;
+  const std::string_view* user_agent_views_;
+  size_t num_user_agent_views_;
 
+  // nullptr for the default LongestMatchRobotsMatchStrategy, which is then
+  // called directly instead of through the RobotsMatchStrategy interface.
   RobotsMatchStrategy* match_strategy_;
 
   // Crawl-delay values for global (*) and specific user-agent groups.
@@ -382,12 +660,668 @@ class RobotsMatcher : protected RobotsParseHandler {
   std::optional<ContentSignal> content_signal_global_;
   std::optional<ContentSignal> content_signal_specific_;
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // Sitemap values seen so far if collect_sitemaps_.
+  std::vector<std::string_view> sitemaps_;
+
+  // Replays the matching logic above over pre-parsed rules.
+  friend class CompiledRobots;
+};
+
+class ResolvedRobots;
+
+// CompiledRobots - a robots.txt that is parsed once and matched many times.
+//
+// RobotsMatcher re-runs ParseRobotsTxt() over the whole body for every URL it
+// checks. CompiledRobots runs the parser once, in its constructor, and keeps
+// the user-agent groups, their Allow/Disallow patterns and the Crawl-delay,
+// Request-rate and Content-Signal values in flat tables. Queries replay the
+// group selection of RobotsMatcher ("most specific user-agent wins", global
+// fallback) over these tables, so they return exactly what disallow(),
+// matching_line() and the Get*() accessors of RobotsMatcher return after
+// AllowedByRobots() was called on the same body.
+//
+// A CompiledRobots owns copies of everything it needs and does not reference
+// the body it was built from. It cannot be modified after construction, and
+// all query methods are const and keep their match state on the stack, so a
+// single instance can be shared by any number of threads without locking.
+//
+// The tables are kept in a single position-independent image, which
+// Serialize() returns as is. FromSerialized() queries such an image in place,
+// e.g. from a memory-mapped file, without decoding or copying it.
+class CompiledRobots {
+ public:
+  explicit CompiledRobots(std::string_view robots_body);
+  // Same as above for a body whose DigestBody() the caller already has.
+  CompiledRobots(std::string_view robots_body, const BodyDigest& digest);
+
+  CompiledRobots(const CompiledRobots& other);
+  CompiledRobots& operator=(const CompiledRobots& other);
+  CompiledRobots(CompiledRobots&& other) noexcept;
+  CompiledRobots& operator=(CompiledRobots&& other) noexcept;
+
+  // Version of the image format written by Serialize(). Images of other
+  // versions are rejected by FromSerialized().
+  static constexpr uint32_t kSerializedVersion = 6;
+
+  // Returns the image of the compiled tables. It contains no pointers, so it
+  // can be written to a file and used from any address by FromSerialized().
+  // It is in the byte order of the host and records the matching switches of
+  // the build, like ROBOTS_ALLOW_FREQUENT_TYPOS, that its tables depend on.
+  std::string_view Serialize() const { return image_; }
+
+  // Returns a CompiledRobots that queries 'image', as returned by
+  // Serialize(), in place. 'image' is not copied and must outlive the result
+  // and its copies. Its address must be 8-byte aligned. Returns nullopt if
+  // 'image' is misaligned, of another version, byte order or set of matching
+  // switches, or corrupt: all offsets are bounds-checked, which takes a single
+  // pass over the tables.
+  static std::optional<CompiledRobots> FromSerialized(std::string_view image);
+
+  // Outcome of matching a single URL.
+  struct MatchResult {
+    // Same as !RobotsMatcher::disallow().
+    bool allowed = true;
+    // Same as RobotsMatcher::matching_line(): the line that decided the
+    // verdict, or 0 if no line matched.
+    int matching_line = 0;
+    // Same as RobotsMatcher::ever_seen_specific_agent().
+    bool ever_seen_specific_agent = false;
+    // Same as RobotsMatcher::budget_exceeded(). 'allowed' is then the verdict
+    // of the budget.
+    bool budget_exceeded = false;
+  };
+
+  // Matches 'url' for the collapsed rules of all "user_agents", like
+  // RobotsMatcher::AllowedByRobots(). 'url' must be %-encoded according to
+  // RFC3986. 'mode' tells how to extract its path, see UrlMode.
+  MatchResult Match(const std::vector<std::string>* user_agents,
+                    std::string_view url, UrlMode mode = UrlMode::kParse) const;
+  // Same as above within the limits of 'budget'.
+  MatchResult Match(const std::vector<std::string>* user_agents,
+                    std::string_view url, const MatchBudget& budget,
+                    UrlMode mode = UrlMode::kParse) const;
+
+  // Same as the two above for the "num_user_agents" agents at 'user_agents'.
+  // Neither the agents nor 'url' are copied: a match only allocates if the
+  // path of 'url' contains '*' or '$', which have to be %-encoded, or the
+  // first time a thread gets a path the URL parser had to normalize.
+  MatchResult Match(const std::string_view* user_agents,
+                    size_t num_user_agents, std::string_view url,
+                    UrlMode mode = UrlMode::kParse) const;
+  MatchResult Match(const std::string_view* user_agents,
+                    size_t num_user_agents, std::string_view url,
+                    const MatchBudget& budget,
+                    UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  MatchResult Match(std::span<const std::string_view> user_agents,
+                    std::string_view url,
+                    UrlMode mode = UrlMode::kParse) const {
+    return Match(user_agents.data(), user_agents.size(), url, mode);
+  }
+  MatchResult Match(std::span<const std::string_view> user_agents,
+                    std::string_view url, const MatchBudget& budget,
+                    UrlMode mode = UrlMode::kParse) const {
+    return Match(user_agents.data(), user_agents.size(), url, budget, mode);
+  }
+#endif
+
+  // Returns true iff 'url' is allowed to be fetched by any member of the
+  // "user_agents" vector.
+  bool Allowed(const std::vector<std::string>* user_agents,
+               std::string_view url, UrlMode mode = UrlMode::kParse) const;
+  // Same as above for the "num_user_agents" agents at 'user_agents'.
+  bool Allowed(const std::string_view* user_agents, size_t num_user_agents,
+               std::string_view url, UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  bool Allowed(std::span<const std::string_view> user_agents,
+               std::string_view url, UrlMode mode = UrlMode::kParse) const {
+    return Allowed(user_agents.data(), user_agents.size(), url, mode);
+  }
+#endif
+
+  // Do robots check for 'url' when there is only one user agent.
+  bool OneAgentAllowed(std::string_view user_agent, std::string_view url,
+                       UrlMode mode = UrlMode::kParse) const;
+
+  // Matches 'num_urls' URLs for the same "user_agents" and stores the result
+  // for urls[i] in results[i]. The rules are resolved for the user agents once
+  // and URLs with the same path are matched once, see
+  // ResolvedRobots::MatchBatch(). Batches within a MatchBudget go through
+  // Resolve().
+  void MatchBatch(const std::vector<std::string>* user_agents,
+                  const std::string* urls, size_t num_urls,
+                  MatchResult* results, UrlMode mode = UrlMode::kParse) const;
+  void MatchBatch(const std::vector<std::string>* user_agents,
+                  const std::string_view* urls, size_t num_urls,
+                  MatchResult* results, UrlMode mode = UrlMode::kParse) const;
+  void MatchBatch(const std::string_view* user_agents, size_t num_user_agents,
+                  const std::string_view* urls, size_t num_urls,
+                  MatchResult* results, UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  void MatchBatch(std::span<const std::string_view> user_agents,
+                  std::span<const std::string_view> urls,
+                  std::span<MatchResult> results,
+                  UrlMode mode = UrlMode::kParse) const {
+    const size_t n =
+        urls.size() < results.size() ? urls.size() : results.size();
+    MatchBatch(user_agents.data(), user_agents.size(), urls.data(), n,
+               results.data(), mode);
+  }
+#endif
+
+  // Answers of MatchAgents() for one user agent: what Match() and the Get*()
+  // methods below return for that agent alone.
+  struct AgentVerdict {
+    MatchResult match;
+    std::optional<double> crawl_delay;
+    std::optional<RequestRate> request_rate;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+    std::optional<ContentSignal> content_signal;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  };
+
+  // Matches 'url' for each of the 'num_user_agents' agents at 'user_agents'
+  // on its own, not for their collapsed rules, and stores the answers for
+  // user_agents[i] in verdicts[i]. The groups are walked once for all the
+  // agents and each rule that applies to any of them is matched once, so
+  // this costs about as much as a single Match(). A robots.txt checked only
+  // once is parsed once with CompiledRobots(robots_body).MatchAgents().
+  void MatchAgents(const std::string_view* user_agents, size_t num_user_agents,
+                   std::string_view url, AgentVerdict* verdicts,
+                   UrlMode mode = UrlMode::kParse) const;
+#ifdef ROBOTS_HAVE_SPAN
+  void MatchAgents(std::span<const std::string_view> user_agents,
+                   std::string_view url, std::span<AgentVerdict> verdicts,
+                   UrlMode mode = UrlMode::kParse) const {
+    const size_t n = user_agents.size() < verdicts.size() ? user_agents.size()
+                                                          : verdicts.size();
+    MatchAgents(user_agents.data(), n, url, verdicts.data(), mode);
+  }
+#endif
+
+  // Return the values RobotsMatcher::Get*() would return for "user_agents".
+  // These do not depend on the URL.
+  std::optional<double> GetCrawlDelay(
+      const std::vector<std::string>* user_agents) const;
+  std::optional<RequestRate> GetRequestRate(
+      const std::vector<std::string>* user_agents) const;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> GetContentSignal(
+      const std::vector<std::string>* user_agents) const;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // Resolves the rules for a fixed list of user agents. The returned object
+  // has the group selection already applied and only has to match URLs, see
+  // ResolvedRobots. It does not reference this CompiledRobots.
+  ResolvedRobots Resolve(const std::vector<std::string>* user_agents) const;
+  // Same as above for queries within the limits of 'budget'. The caps are
+  // checked once here: if a rule for the agents goes over them, every query
+  // returns the verdict of the budget. Literal rules are matched in a trie
+  // and cost no steps, so queries may get further than RobotsMatcher would.
+  ResolvedRobots Resolve(const std::vector<std::string>* user_agents,
+                         const MatchBudget& budget) const;
+  // Same as the two above for the "num_user_agents" agents at 'user_agents'.
+  ResolvedRobots Resolve(const std::string_view* user_agents,
+                         size_t num_user_agents) const;
+  ResolvedRobots Resolve(const std::string_view* user_agents,
+                         size_t num_user_agents,
+                         const MatchBudget& budget) const;
+
+  // Number of non-empty Sitemap lines, and the value of the i-th of them in
+  // file order, for i < num_sitemaps(). Sitemap lines apply to the whole file,
+  // whatever group they are in. The value points into the image.
+  size_t num_sitemaps() const;
+  std::string_view sitemap(size_t i) const;
+
+  // Number of user-agent groups and Allow/Disallow rules that were compiled.
+  size_t num_groups() const;
+  size_t num_rules() const;
+
+  // DigestBody() of the body this was compiled from. It is kept in the image,
+  // so it survives Serialize() and FromSerialized().
+  BodyDigest body_digest() const;
+
+  // What changed in the Allow/Disallow rules of a robots.txt between two
+  // versions, see Recompile().
+  struct Diff {
+    // An Allow or Disallow rule, with its line number in the version that has
+    // it. Rules derived from an "index.html" Allow rule are included.
+    struct Rule {
+      bool is_allow = false;
+      std::string pattern;
+      int line = 0;
+    };
+    // The rules that the groups naming one user agent gained or lost. A rule
+    // that only moved to another line, within a group or to another group
+    // for the same agent, is not a change.
+    struct AgentChange {
+      // Lowercase product token of the user-agent lines, "*" for the global
+      // groups.
+      std::string user_agent;
+      // Whether the previous and the new version have a group for the agent.
+      // A group, even an empty one, hides the global rules from the agent.
+      bool had_group = false;
+      bool has_group = false;
+      std::vector<Rule> added;    // Line numbers of the new version.
+      std::vector<Rule> removed;  // Line numbers of the previous version.
+    };
+
+    // True if the new body has the SHA-256 digest of the previous one.
+    // Nothing was parsed and 'changes' is empty.
+    bool identical = false;
+    // In the order of 'user_agent'. Empty if no group gained or lost a rule,
+    // e.g. if only comments, Sitemap or Crawl-delay lines changed.
+    std::vector<AgentChange> changes;
+  };
+
+  // Compiles 'robots_body', typically a refetch of the robots.txt 'previous'
+  // was compiled from, and stores what changed in 'diff' if it is not null.
+  // A body with the body_digest() of 'previous' is taken to be the same body:
+  // it is not parsed and a copy of 'previous' is returned, which shares its
+  // image if 'previous' does not own it, see FromSerialized().
+  //
+  // This is a whole-file shortcut. Any other body, however small the edit, is
+  // parsed and compiled in full; no group of 'previous' is reused. The new
+  // rules are then compared group by group with 'previous' for 'diff'.
+  static CompiledRobots Recompile(const CompiledRobots& previous,
+                                  std::string_view robots_body,
+                                  Diff* diff = nullptr);
+
+  // Returns true if this and 'other' give the same verdict for every URL
+  // matched for "user_agents": the rules that can decide a verdict for them,
+  // see Resolve(), are the same. The matching lines may still differ. Lets a
+  // crawler keep the URLs it already filtered when a refetched robots.txt
+  // changed only for other agents.
+  bool SameVerdicts(const CompiledRobots& other,
+                    const std::vector<std::string>* user_agents) const;
+
+  // Approximate number of bytes this object holds, including itself. The
+  // image is not counted if it is not owned, see FromSerialized().
+  size_t MemoryUsage() const;
+
+ private:
+  // RobotsParseHandler filling the tables below. Defined in robots.cc.
+  class Builder;
+  // Per-query match state. Defined in robots.cc.
+  struct Evaluation;
+  // Start of the image, locating the tables. Defined in robots.cc.
+  struct ImageHeader;
+  // Pointers to the tables of an image.
+  struct Tables;
+  // A group and one of the agents it names, as compared by Recompile().
+  // Defined in robots.cc.
+  struct AgentGroup;
+
+  // The user agents of a query, either a vector or an array of
+  // 'num_views' views, like RobotsMatcher keeps them. Not owned.
+  struct AgentList {
+    explicit AgentList(const std::vector<std::string>* strings)
+        : strings(strings) {}
+    AgentList(const std::string_view* views, size_t num_views)
+        : views(views), num_views(num_views) {}
+
+    // Returns true if 'name' is one of the agents, ignoring case.
+    bool Contains(std::string_view name) const;
+
+    const std::vector<std::string>* strings = nullptr;
+    const std::string_view* views = nullptr;
+    size_t num_views = 0;
+  };
+
+  CompiledRobots() = default;
+
+  Tables GetTables() const;
+
+  // Implement the public overloads of the same name.
+  MatchResult Match(const AgentList& user_agents, std::string_view url,
+                    const MatchBudget& budget, UrlMode mode) const;
+  ResolvedRobots Resolve(const AgentList& user_agents,
+                         const MatchBudget& budget) const;
+
+  // Stores an AgentGroup for each distinct agent of each group in 'groups',
+  // sorted by agent.
+  void CollectAgentGroups(std::vector<AgentGroup>* groups) const;
+  // Appends the indexes of the rules that can decide a verdict for
+  // "user_agents", the rules Resolve() keeps, to 'rules'.
+  void SelectRules(const std::vector<std::string>& user_agents,
+                   std::vector<uint32_t>* rules) const;
+
+  // Runs the group selection of RobotsMatcher for "user_agents". When 'path'
+  // is non-null, the Allow/Disallow rules of the selected groups are matched
+  // against it as well. Otherwise, if the Evaluation asks for it, the indexes
+  // of these rules are collected.
+  void Evaluate(const AgentList& user_agents, const std::string_view* path,
+                Evaluation* eval) const;
+  // Runs Evaluate() with a path for each of the 'num_user_agents' agents on
+  // its own, at most kMaxAgentsPerPass of them, into evals[i].
+  static constexpr size_t kMaxAgentsPerPass = 64;
+  void EvaluateAgents(const std::string_view* user_agents,
+                      size_t num_user_agents, std::string_view path,
+                      Evaluation* evals) const;
+
+  // The records below are the tables of the image, so they have a fixed
+  // layout: fixed-width fields, no pointers, no implicit padding. Offsets
+  // index into the string table.
+
+  // A user-agent line. The product token is stored in the string table as
+  // returned by RobotsMatcher::ExtractUserAgent().
+  struct Agent {
+    uint32_t offset;
+    uint32_t length;
+    uint8_t is_global;  // 1 for '*'.
+    uint8_t padding[3];
+  };
+
+  // The Allow and Disallow lines are kept as parallel arrays with one entry
+  // per rule, so that a query only reads the arrays it needs and filters the
+  // rules of a group in a few cache lines before matching any pattern. The
+  // patterns are stored in the string table already escaped, as they were
+  // passed to the parse callbacks. The arrays are:
+  //   offsets, lengths  uint32_t  The pattern in the string table.
+  //   lines             int32_t   Its line number.
+  //   prefix_lengths    uint32_t  Bytes before its first '*', '%' or final
+  //                               '$', which a path without '%' must start
+  //                               with.
+  //   wildcards         uint32_t  Number of '*', for the caps of MatchBudget.
+  //   keys              uint8_t   pattern[1] if kRuleKeyed.
+  //   flags             uint8_t   RuleFlags.
+  enum RuleFlags : uint8_t {
+    kRuleAllow = 1 << 0,
+    kRuleWildcard = 1 << 1,  // Has a '*'.
+    kRuleAnchored = 1 << 2,  // Ends with '$'.
+    kRulePercent = 1 << 3,   // Has a '%' that is decoded when matching.
+    kRuleKeyed = 1 << 4,     // Literal prefix of at least 2 bytes.
+  };
+
+  // A Crawl-delay, Request-rate or Content-Signal line. These lines do not
+  // close a group, so they only apply to the 'agents_before' user-agent lines
+  // of their group that precede them.
+  struct Extension {
+    // Content-Signal records are kept in builds without Content-Signal
+    // support, so that images do not depend on ROBOTS_SUPPORT_CONTENT_SIGNAL.
+    enum Kind : uint8_t {
+      kCrawlDelay = 0,
+      kRequestRate = 1,
+      kContentSignal = 2,
+    };
+    Kind kind;
+    // Content-Signal values: -1 if not set, else 0 or 1.
+    int8_t ai_train;
+    int8_t ai_input;
+    int8_t search;
+    uint32_t agents_before;
+    double crawl_delay;
+    int32_t requests;
+    int32_t seconds;
+  };
+
+  // A Sitemap line.
+  struct Sitemap {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  // A run of user-agent lines followed by the rules that apply to them. Each
+  // field indexes into the corresponding table.
+  struct Group {
+    uint32_t first_agent;
+    uint32_t num_agents;
+    uint32_t first_rule;
+    uint32_t num_rules;
+    uint32_t first_extension;
+    uint32_t num_extensions;
+  };
+
+  // The image owned by this object, if it was compiled from a body. In
+  // uint64_t units so that the tables are aligned.
+  std::vector<uint64_t> buffer_;
+  // Either the bytes of buffer_, or an image owned by the caller.
+  std::string_view image_;
+};
+
+// RobotsPack - the serialized CompiledRobots of many hosts in one buffer.
+//
+// A pack is meant to be built once, shipped between machines and
+// memory-mapped, so that a freshly started process can query the robots.txt
+// files of a whole crawl without parsing any of them. Like the images of
+// CompiledRobots, a pack is position-independent and queried in place.
+//
+//   RobotsPack::Builder builder;
+//   builder.Add("https://example.com", robots_body);
+//   const std::string pack = builder.Finish();
+//   ...
+//   std::optional<RobotsPack> pack = RobotsPack::Open(mapped_file);
+//   std::optional<CompiledRobots> robots = pack->Find("https://example.com");
+//
+// Opening a pack checks its index; an image is checked when it is looked up,
+// so that only the pages of the hosts actually queried are touched.
+class RobotsPack {
+ public:
+  class Builder {
+   public:
+    // Adds the robots.txt of 'host'. The host key is used as given, see
+    // RobotsCache. A later entry for the same host replaces an earlier one.
+    void Add(std::string_view host, std::string_view robots_body);
+    void Add(std::string_view host, const CompiledRobots& robots);
+
+    size_t size() const { return entries_.size(); }
+
+    // Returns the pack of the entries added so far.
+    std::string Finish() const;
+
+   private:
+    std::vector<std::pair<std::string, std::string>> entries_;
+  };
+
+  // Version of the pack format written by Builder::Finish().
+  static constexpr uint32_t kVersion = 1;
+
+  // Returns a RobotsPack that reads 'data' in place. 'data' must outlive the
+  // result and everything returned by it, and be 8-byte aligned. Returns
+  // nullopt if 'data' is not a pack of this version and byte order, or its
+  // index is corrupt.
+  static std::optional<RobotsPack> Open(std::string_view data);
+
+  // Number of hosts in the pack.
+  size_t size() const { return num_entries_; }
+  // The i-th host, in lexicographic order.
+  std::string_view host(size_t i) const;
+  // The CompiledRobots of the i-th host, or nullopt if its image is corrupt.
+  std::optional<CompiledRobots> robots(size_t i) const;
+
+  // Returns the CompiledRobots of 'host', or nullopt if it is not in the pack
+  // or its image is corrupt.
+  std::optional<CompiledRobots> Find(std::string_view host) const;
+
+ private:
+  // Start of a pack and its index records. Defined in robots.cc.
+  struct PackHeader;
+  struct Entry;
+
+  RobotsPack() = default;
+
+  std::string_view data_;
+  const Entry* entries_ = nullptr;
+  size_t num_entries_ = 0;
+};
+
+// ResolvedRobots - the rules of a CompiledRobots for one fixed list of user
+// agents.
+//
+// CompiledRobots::Resolve() runs the user-agent matching and the "most
+// specific user-agent wins" selection once, and keeps only the rules that can
+// decide a verdict for those agents: the rules of the specific groups if the
+// file has any for them, the global rules otherwise. Queries only match the
+// URL against this flat list. Answers are the same as those of the
+// CompiledRobots it was resolved from, for the same user agents.
+//
+// The rules are indexed so that a query finds the longest Allow and Disallow
+// match in a single pass over the path, instead of matching every pattern in
+// turn. The results are those of the default longest-match strategy.
+//
+// Like CompiledRobots, a ResolvedRobots is immutable and can be shared by any
+// number of threads.
+class ResolvedRobots {
+ public:
+  // Matches 'url', which must be %-encoded according to RFC3986. 'mode'
+  // tells how to extract its path, see UrlMode.
+  CompiledRobots::MatchResult Match(std::string_view url,
+                                    UrlMode mode = UrlMode::kParse) const;
+
+  // Returns true iff 'url' is allowed.
+  bool Allowed(std::string_view url, UrlMode mode = UrlMode::kParse) const;
+
+  // Matches 'num_urls' URLs and stores the result for urls[i] in results[i].
+  // The paths are sorted first so that each distinct path is matched only
+  // once, which helps with the duplicates common in crawl frontier batches,
+  // and so that paths sharing a prefix share the walk along it.
+  void MatchBatch(const std::string* urls, size_t num_urls,
+                  CompiledRobots::MatchResult* results,
+                  UrlMode mode = UrlMode::kParse) const;
+  void MatchBatch(const std::string_view* urls, size_t num_urls,
+                  CompiledRobots::MatchResult* results,
+                  UrlMode mode = UrlMode::kParse) const;
+
+  // Matches URLs one after the other, reusing the walk of the previous path
+  // along the prefix it shares with the next one. See below.
+  class PrefixMatcher;
+
+  // Returns true iff the robots.txt has a group for one of the user agents.
+  bool ever_seen_specific_agent() const { return ever_seen_specific_agent_; }
+
+  std::optional<double> GetCrawlDelay() const { return crawl_delay_; }
+  std::optional<RequestRate> GetRequestRate() const { return request_rate_; }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> GetContentSignal() const {
+    return content_signal_;
+  }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // Number of Allow/Disallow rules that apply to the user agents.
+  size_t num_rules() const { return rules_.size(); }
+
+ private:
+  friend class CompiledRobots;
+  ResolvedRobots() = default;
+
+  // An Allow or Disallow pattern in strings_, in file order.
+  struct Rule {
+    uint32_t offset;
+    uint32_t length;
+    int line;
+    bool is_allow;
+  };
+
+  // Priority and line of the best match among a set of rules. Ties go to the
+  // rule that comes first in the file, like in RobotsMatcher.
+  struct Best {
+    int priority = -1;
+    int line = 0;
+    void Update(int p, int l) {
+      if (p > priority || (p == priority && l < line)) {
+        priority = p;
+        line = l;
+      }
+    }
+  };
+
+  // A node of the trie over the %-decoded literal prefixes of rules_. A rule
+  // without '*' ends at the node of its whole pattern and matches every path
+  // reaching that node; if it ends with '$' it only matches when the path ends
+  // there as well. A rule with '*' is attached to the node of the literal text
+  // before its first '*' and has to be matched in full when the path gets
+  // there.
+  struct TrieNode {
+    uint32_t first_edge = 0;
+    uint32_t num_edges = 0;
+    Best allow;
+    Best disallow;
+    Best allow_at_end;
+    Best disallow_at_end;
+    uint32_t first_wildcard = 0;
+    uint32_t num_wildcards = 0;
+  };
+  struct TrieEdge {
+    unsigned char byte;
+    uint32_t child;
+  };
+
+  // Builds nodes_, edges_ and wildcard_rules_ from rules_.
+  void BuildIndex();
+
+  // Matches a path as returned by GetPathParamsQuery().
+  CompiledRobots::MatchResult MatchPath(std::string_view path) const;
+  // MatchBatch() for the paths of the URLs.
+  void MatchPaths(const std::string_view* paths, size_t num_paths,
+                  CompiledRobots::MatchResult* results) const;
+
+  std::string strings_;
+  std::vector<Rule> rules_;
+  std::vector<TrieNode> nodes_;
+  std::vector<TrieEdge> edges_;
+  std::vector<uint32_t> wildcard_rules_;  // Indexes into rules_.
+  MatchBudget budget_;
+  // True if a rule goes over the caps of budget_.
+  bool over_budget_ = false;
+  bool ever_seen_specific_agent_ = false;
+  std::optional<double> crawl_delay_;
+  std::optional<RequestRate> request_rate_;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> content_signal_;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+};
+
+// ResolvedRobots::PrefixMatcher - matches a stream of URLs against a
+// ResolvedRobots and keeps the trie walk of the last path. The walk for the
+// next path resumes where the two paths stop sharing a prefix, so URLs in
+// sorted order, like those of a sitemap or of a sorted crawl frontier, cost
+// about their distinct suffixes instead of their whole paths. Rules with '*'
+// on the shared part still have to be matched against each whole path.
+//
+// Results are those of ResolvedRobots::Match(), in any order; only the speed
+// depends on the order. ResolvedRobots::MatchBatch() sorts its paths and uses
+// a PrefixMatcher. The ResolvedRobots must outlive the PrefixMatcher, which
+// is not thread-safe: use one per thread.
+class ResolvedRobots::PrefixMatcher {
+ public:
+  explicit PrefixMatcher(const ResolvedRobots& robots);
+
+  CompiledRobots::MatchResult Match(std::string_view url,
+                                    UrlMode mode = UrlMode::kParse);
+
+ private:
+  friend class ResolvedRobots;
+
+  // A step of the walk: the trie node reached at byte 'pos' of path_, and the
+  // best rules without '*' or '$' on the way. The walk up to this step looked
+  // at the bytes of path_ before 'examined', which a next path has to share
+  // for the step to hold.
+  struct Frame {
+    uint32_t node;
+    uint32_t pos;
+    uint32_t examined;
+    Best allow;
+    Best disallow;
+    // Size of wildcards_ once the rules with '*' of the node are added.
+    uint32_t num_wildcards;
+  };
+
+  CompiledRobots::MatchResult MatchPath(std::string_view path);
+
+  const ResolvedRobots* robots_;
+  std::string path_;
+  std::vector<Frame> frames_;
+  // Rules with '*' of the nodes on the walk, in walk order.
+  std::vector<uint32_t> wildcards_;
+  std::string buffer_;
 };
 
 }  // namespace googlebot
 // === End embedded robots.h ===
 
 
+#include <cstddef>
 #include <map>
 #include <string_view>
 #include <vector>
@@ -426,7 +1360,31 @@ struct RobotsParsedLine {
   RobotsParseHandler::LineMetadata metadata;
 };
 
-class RobotsParsingReporter : public googlebot::RobotsParseHandler {
+#ifdef ROBOTS_HAVE_SPAN
+using RobotsParsedLines = std::span<const RobotsParsedLine>;
+#else
+// A view of consecutive RobotsParsedLine, std::span before C++20.
+class RobotsParsedLines {
+ public:
+  RobotsParsedLines(const RobotsParsedLine* data, size_t size)
+      : data_(data), size_(size) {}
+
+  const RobotsParsedLine* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const RobotsParsedLine* begin() const { return data_; }
+  const RobotsParsedLine* end() const { return data_ + size_; }
+  const RobotsParsedLine& operator[](size_t i) const { return data_[i]; }
+
+ private:
+  const RobotsParsedLine* data_;
+  size_t size_;
+};
+#endif  // ROBOTS_HAVE_SPAN
+
+// Classifies the lines of a robots.txt into RobotsParsedLine. The reporters
+// below differ only in how they store the lines.
+class RobotsParsingReporterBase : public googlebot::RobotsParseHandler {
  public:
   void HandleRobotsStart() override;
   void HandleRobotsEnd() override;
@@ -446,6 +1404,23 @@ class RobotsParsingReporter : public googlebot::RobotsParseHandler {
   int last_line_seen() const { return last_line_seen_; }
   int valid_directives() const { return valid_directives_; }
   int unused_directives() const { return unused_directives_; }
+
+ protected:
+  // Returns the stored line numbered 'line_num', adding it if needed.
+  virtual RobotsParsedLine& Line(int line_num) = 0;
+
+ private:
+  void Digest(int line_num, RobotsParsedLine::RobotsTagName parsed_tag);
+
+  int last_line_seen_ = 0;
+  int valid_directives_ = 0;
+  int unused_directives_ = 0;
+};
+
+// Keeps the lines in a map. Results of earlier parses are kept and merged
+// with the lines of later ones.
+class RobotsParsingReporter : public RobotsParsingReporterBase {
+ public:
   std::vector<RobotsParsedLine> parse_results() const {
     std::vector<RobotsParsedLine> vec;
     for (const auto& entry : robots_parse_results_) {
@@ -454,22 +1429,40 @@ class RobotsParsingReporter : public googlebot::RobotsParseHandler {
     return vec;
   }
 
- private:
-  void Digest(int line_num, RobotsParsedLine::RobotsTagName parsed_tag);
+ protected:
+  RobotsParsedLine& Line(int line_num) override;
 
+ private:
   // Indexed and sorted by line number.
   std::map<int, RobotsParsedLine> robots_parse_results_;
-  int last_line_seen_ = 0;
-  int valid_directives_ = 0;
-  int unused_directives_ = 0;
+};
+
+// Keeps the lines of the last parse in one flat buffer sorted by line number,
+// which is how the parser reports them. A new parse drops the lines of the
+// previous one but keeps the buffer, so reusing one reporter for many files
+// doesn't allocate once the buffer has grown to the longest of them.
+class FlatRobotsParsingReporter : public RobotsParsingReporterBase {
+ public:
+  void HandleRobotsStart() override;
+
+  // Valid until the next parse, not copied.
+  RobotsParsedLines parse_results() const {
+    return RobotsParsedLines(lines_.data(), lines_.size());
+  }
+
+ protected:
+  RobotsParsedLine& Line(int line_num) override;
+
+ private:
+  std::vector<RobotsParsedLine> lines_;
 };
 }  // namespace googlebot
 
 // ============================================================================
 // IMPLEMENTATION
 // ============================================================================
-// Generated: 2026-01-16 23:01:33 +0200
-// Commit: 0e413cb
+// Generated: 2026-10-14 15:52:02 +0000
+// Commit: 4bc5ae9
 //
 // Define ROBOTS_IMPLEMENTATION in exactly one source file before including
 // this header to include the implementation:
@@ -487,18 +1480,57 @@ class RobotsParsingReporter : public googlebot::RobotsParseHandler {
 #ifdef ROBOTS_USE_ADA
 #include <ada.h>
 #endif
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <deque>
+#include <limits>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <typeinfo>
 #include <vector>
 
+// Vector kernels for the line scanner in RobotsTxtParser::Parse() and the
+// canonical URL scanner. Define ROBOTS_DISABLE_SIMD to build with the scalar
+// loops only.
+#ifndef ROBOTS_DISABLE_SIMD
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ROBOTS_HAVE_SSE2 1
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ROBOTS_HAVE_AVX2 1  // Selected at runtime.
+#include <cpuid.h>
+#define ROBOTS_HAVE_SHANI 1  // Selected at runtime.
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ROBOTS_HAVE_NEON 1
+#endif
+#endif  // ROBOTS_DISABLE_SIMD
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>  // _BitScanForward64
+#endif
+
 // Replacement for ROBOTS_ASSERT
 #define ROBOTS_ASSERT(x) assert(x)
 
+// Expands to its arguments only when RobotsStats are collected.
+#if ROBOTS_ENABLE_STATS
+#define ROBOTS_STATS_ONLY(...) __VA_ARGS__
+#else
+#define ROBOTS_STATS_ONLY(...)
+#endif
+
 namespace {
 
 // String utility functions - constexpr for compile-time evaluation (C++20)
@@ -548,6 +1580,17 @@ constexpr bool StartsWithIgnoreCase(std::string_view s, std::string_view prefix)
   return true;
 }
 
+// Orders 'a' and 'b' like their lowercase forms, returning <0, 0 or >0.
+constexpr int CompareIgnoreCase(std::string_view a, std::string_view b) {
+  const size_t n = a.size() < b.size() ? a.size() : b.size();
+  for (size_t i = 0; i < n; ++i) {
+    const unsigned char x = AsciiToLower(a[i]);
+    const unsigned char y = AsciiToLower(b[i]);
+    if (x != y) return x < y ? -1 : 1;
+  }
+  return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
+
 constexpr bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
   if (a.size() != b.size()) return false;
   for (size_t i = 0; i < a.size(); ++i) {
@@ -558,11 +1601,69 @@ constexpr bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
 
 }  // namespace
 
+// The matching switches of robots.h, see there.
 // Allow for typos such as DISALOW in robots.txt.
-constexpr bool kAllowFrequentTypos = true;
+constexpr bool kAllowFrequentTypos = ROBOTS_ALLOW_FREQUENT_TYPOS;
+// Match %XX escapes to the byte they encode.
+constexpr bool kDecodePercentEscapes = ROBOTS_DECODE_PERCENT_ESCAPES;
+// Also allow the directory of an allowed index.htm(l).
+constexpr bool kNormalizeIndexHtml = ROBOTS_NORMALIZE_INDEX_HTML;
+// Parse Crawl-delay and Request-rate.
+constexpr bool kSupportNonStandardDirectives =
+    ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES;
 
 namespace googlebot {
 
+#if ROBOTS_ENABLE_STATS
+namespace {
+thread_local RobotsStats thread_stats;
+
+// Adds the time from its construction to its destruction to a phase of
+// thread_stats.
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(uint64_t RobotsStats::*phase_ns)
+      : phase_ns_(phase_ns), start_(std::chrono::steady_clock::now()) {}
+
+  ~PhaseTimer() {
+    thread_stats.*phase_ns_ +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_)
+            .count();
+  }
+
+ private:
+  uint64_t RobotsStats::*const phase_ns_;
+  const std::chrono::steady_clock::time_point start_;
+};
+}  // namespace
+#endif  // ROBOTS_ENABLE_STATS
+
+void RobotsStats::Merge(const RobotsStats& other) {
+  bytes += other.bytes;
+  lines += other.lines;
+  directives += other.directives;
+  urls += other.urls;
+  patterns_evaluated += other.patterns_evaluated;
+  wildcard_expansions += other.wildcard_expansions;
+  match_steps += other.match_steps;
+  max_match_steps = std::max(max_match_steps, other.max_match_steps);
+  url_ns += other.url_ns;
+  parse_ns += other.parse_ns;
+  classify_ns += other.classify_ns;
+  match_ns += other.match_ns;
+}
+
+RobotsStats GetRobotsStats() {
+#if ROBOTS_ENABLE_STATS
+  return thread_stats;
+#else
+  return RobotsStats();
+#endif
+}
+
+void ResetRobotsStats() { ROBOTS_STATS_ONLY(thread_stats = RobotsStats();) }
+
 // A RobotsMatchStrategy defines a strategy for matching individual lines in a
 // robots.txt file. Each Match* method should return a match priority, which is
 // interpreted as:
@@ -587,6 +1688,10 @@ class RobotsMatchStrategy {
  protected:
   // Implements robots.txt pattern matching.
   static bool Matches(std::string_view path, std::string_view pattern);
+  // Same as above, taking the path positions it examines from '*steps_left'.
+  // Returns false and sets '*exceeded' if fewer are left than it needs.
+  static bool Matches(std::string_view path, std::string_view pattern,
+                      uint64_t* steps_left, bool* exceeded);
 };
 
 // Helper: decode a hex digit to its value (0-15), or -1 if invalid.
@@ -600,32 +1705,63 @@ static int HexDigitValue(char c) {
 // Helper: check if position in string is a valid %XX sequence.
 // If so, returns the decoded character and sets *advance to 3.
 // Otherwise returns the character at pos and sets *advance to 1.
+// Without kDecodePercentEscapes, every character stands for itself.
 static char DecodePercentOrChar(std::string_view s, size_t pos, int* advance) {
-  if (pos + 2 < s.size() && s[pos] == '%') {
-    int hi = HexDigitValue(s[pos + 1]);
-    int lo = HexDigitValue(s[pos + 2]);
-    if (hi >= 0 && lo >= 0) {
-      *advance = 3;
-      return static_cast<char>((hi << 4) | lo);
+  if constexpr (kDecodePercentEscapes) {
+    if (pos + 2 < s.size() && s[pos] == '%') {
+      int hi = HexDigitValue(s[pos + 1]);
+      int lo = HexDigitValue(s[pos + 2]);
+      if (hi >= 0 && lo >= 0) {
+        *advance = 3;
+        return static_cast<char>((hi << 4) | lo);
+      }
     }
   }
   *advance = 1;
   return s[pos];
 }
 
-// Returns true if URI path matches the specified pattern. Pattern is anchored
-// at the beginning of path. '$' is special only at the end of pattern.
-//
-// Per RFC 9309 section 2.2.2, percent-encoded characters should match their
-// decoded equivalents (e.g., %2F matches /, %26 matches &).
-//
-// Since 'path' and 'pattern' are both externally determined (by the webmaster),
-// we make sure to have acceptable worst-case performance.
-/* static */ bool RobotsMatchStrategy::Matches(
-    std::string_view path, std::string_view pattern) {
+// Charges 'steps' against what is left of MatchBudget::max_steps in
+// '*steps_left'. Returns false and sets '*exceeded' if fewer are left.
+static bool SpendSteps(uint64_t steps, uint64_t* steps_left, bool* exceeded) {
+  if (steps > *steps_left) {
+    *exceeded = true;
+    return false;
+  }
+  *steps_left -= steps;
+  return true;
+}
+
+// Returns true iff 'pattern' is within the caps of 'budget'.
+static bool WithinCaps(std::string_view pattern, const MatchBudget& budget) {
+  if (pattern.size() > budget.max_pattern_length) return false;
+  // A pattern has at most as many '*' as bytes.
+  return pattern.size() <= budget.max_wildcards ||
+         static_cast<size_t>(std::count(pattern.begin(), pattern.end(), '*')) <=
+             budget.max_wildcards;
+}
+
+// The matching loop of RobotsMatchStrategy::Matches(). 'pos' is scratch space
+// for at least path.length() + 1 indexes. Each step of the main loop costs one
+// step of '*steps_left' per position in the set.
+static bool MatchesWithPositions(std::string_view path,
+                                 std::string_view pattern, size_t* pos,
+                                 uint64_t* steps_left, bool* exceeded) {
   const size_t pathlen = path.length();
-  std::vector<size_t> pos(pathlen + 1);
   int numpos;
+#if ROBOTS_ENABLE_STATS
+  // The work of this call, added to thread_stats on return.
+  struct Work {
+    uint64_t steps = 0;
+    uint64_t expansions = 0;
+    ~Work() {
+      thread_stats.match_steps += steps;
+      thread_stats.wildcard_expansions += expansions;
+      thread_stats.max_match_steps =
+          std::max(thread_stats.max_match_steps, steps);
+    }
+  } work;
+#endif  // ROBOTS_ENABLE_STATS
 
   // The pos[] array holds a sorted list of indexes of 'path', with length
   // 'numpos'.  At the start and end of each iteration of the main loop below,
@@ -645,9 +1781,11 @@ static char DecodePercentOrChar(std::string_view s, size_t pos, int* advance) {
     }
     if (pat_char == '*') {
       numpos = pathlen - pos[0] + 1;
+      if (!SpendSteps(numpos, steps_left, exceeded)) return false;
       for (int i = 1; i < numpos; i++) {
         pos[i] = pos[i-1] + 1;
       }
+      ROBOTS_STATS_ONLY(work.steps += numpos; work.expansions += numpos;)
       ++pat_idx;
     } else {
       // Decode pattern character (handle %XX sequences)
@@ -655,6 +1793,8 @@ static char DecodePercentOrChar(std::string_view s, size_t pos, int* advance) {
       char decoded_pat = DecodePercentOrChar(pattern, pat_idx, &pat_advance);
 
       // Includes '$' when not at end of pattern.
+      if (!SpendSteps(numpos, steps_left, exceeded)) return false;
+      ROBOTS_STATS_ONLY(work.steps += numpos;)
       int newnumpos = 0;
       for (int i = 0; i < numpos; i++) {
         if (pos[i] < pathlen) {
@@ -676,6 +1816,50 @@ static char DecodePercentOrChar(std::string_view s, size_t pos, int* advance) {
   return true;
 }
 
+// Returns true if URI path matches the specified pattern. Pattern is anchored
+// at the beginning of path. '$' is special only at the end of pattern.
+//
+// Per RFC 9309 section 2.2.2, percent-encoded characters should match their
+// decoded equivalents (e.g., %2F matches /, %26 matches &), unless built
+// without ROBOTS_DECODE_PERCENT_ESCAPES.
+//
+// Since 'path' and 'pattern' are both externally determined (by the webmaster),
+// we make sure to have acceptable worst-case performance. The overload taking
+// 'steps_left' also gives up once the MatchBudget::max_steps it was handed are
+// spent.
+/* static */ bool RobotsMatchStrategy::Matches(
+    std::string_view path, std::string_view pattern) {
+  uint64_t steps_left = std::numeric_limits<uint64_t>::max();
+  bool exceeded = false;
+  return Matches(path, pattern, &steps_left, &exceeded);
+}
+
+/* static */ bool RobotsMatchStrategy::Matches(
+    std::string_view path, std::string_view pattern, uint64_t* steps_left,
+    bool* exceeded) {
+  ROBOTS_STATS_ONLY(PhaseTimer timer(&RobotsStats::match_ns);
+                    ++thread_stats.patterns_evaluated;)
+  // Most patterns are plain prefixes. If the path starts with the pattern they
+  // match, and if neither contains a %-escape they can't match otherwise.
+  if (pattern.find_first_of(kDecodePercentEscapes ? "*$%" : "*$") ==
+      std::string_view::npos) {
+    if (path.substr(0, pattern.size()) == pattern) return true;
+    if (!kDecodePercentEscapes || path.find('%') == std::string_view::npos) {
+      return false;
+    }
+  }
+
+  // The position set lives on the stack unless the path is very long.
+  constexpr size_t kMaxStackPositions = 512;
+  if (path.length() < kMaxStackPositions) {
+    size_t pos[kMaxStackPositions];
+    return MatchesWithPositions(path, pattern, pos, steps_left, exceeded);
+  }
+  std::vector<size_t> pos(path.length() + 1);
+  return MatchesWithPositions(path, pattern, pos.data(), steps_left,
+                              exceeded);
+}
+
 constexpr std::string_view kHexDigits = "0123456789ABCDEF";
 
 // Percent-encode special robots.txt characters (* and $) in a path.
@@ -683,17 +1867,14 @@ constexpr std::string_view kHexDigits = "0123456789ABCDEF";
 // robots.txt patterns, so they must be encoded in URLs to match correctly
 // against patterns containing %2A or %24.
 // See: https://github.com/google/robotstxt/issues/57
-static std::string EncodePathForMatching(std::string_view path) {
+//
+// Returns 'path' itself if it has no special chars, otherwise the encoded path
+// stored in *buffer. 'path' may point into *buffer.
+static std::string_view EncodePathForMatching(std::string_view path,
+                                              std::string* buffer) {
   // Quick check: if no special chars, return as-is
-  bool has_special = false;
-  for (char c : path) {
-    if (c == '*' || c == '$') {
-      has_special = true;
-      break;
-    }
-  }
-  if (!has_special) {
-    return std::string(path);
+  if (path.find_first_of("*$") == std::string_view::npos) {
+    return path;
   }
 
   // Encode * as %2A and $ as %24
@@ -708,7 +1889,8 @@ static std::string EncodePathForMatching(std::string_view path) {
       result += c;
     }
   }
-  return result;
+  *buffer = std::move(result);
+  return *buffer;
 }
 
 // GetPathParamsQuery is not in anonymous namespace to allow testing.
@@ -716,7 +1898,10 @@ static std::string EncodePathForMatching(std::string_view path) {
 // Extracts path (with params) and query part from URL. Removes scheme,
 // authority, and fragment. Result always starts with "/".
 // Returns "/" if the url doesn't have a path or is not valid.
-std::string GetPathParamsQuery(const std::string& url) {
+//
+// The result points into 'url' whenever possible. Otherwise it is stored in
+// *buffer, so it stays valid as long as both of them do.
+std::string_view GetPathParamsQuery(std::string_view url, std::string* buffer) {
   if (url.empty()) return "/";
 
 #ifdef ROBOTS_USE_ADA
@@ -728,27 +1913,38 @@ std::string GetPathParamsQuery(const std::string& url) {
   if (!parsed) {
     // Handle protocol-relative URLs (//example.com/path)
     if (url.size() >= 2 && url[0] == '/' && url[1] == '/') {
-      parsed = ada::parse<ada::url_aggregator>("http:" + url);
+      parsed = ada::parse<ada::url_aggregator>(std::string("http:").append(url));
     } else if (url[0] != '/') {
       // Try adding scheme for URLs like "example.com/path"
-      parsed = ada::parse<ada::url_aggregator>("http://" + url);
+      parsed =
+          ada::parse<ada::url_aggregator>(std::string("http://").append(url));
     }
   }
 
   if (!parsed) {
     // Last resort: if URL starts with '/', treat it as a path
     if (url[0] == '/') {
-      size_t hash_pos = url.find('#');
-      std::string path = (hash_pos == std::string::npos) ? url : url.substr(0, hash_pos);
-      return EncodePathForMatching(path);
+      return EncodePathForMatching(url.substr(0, url.find('#')), buffer);
     }
     return "/";
   }
 
-  std::string result(parsed->get_pathname());
-  std::string_view search = parsed->get_search();
-  if (!search.empty()) result += search;
-  return result.empty() ? "/" : EncodePathForMatching(result);
+  // The normalized path and query live in 'parsed'. Most URLs are already
+  // normalized, then they end 'url' up to the fragment and the result can
+  // point there. Otherwise, copy them out.
+  const std::string_view pathname = parsed->get_pathname();
+  const std::string_view search = parsed->get_search();
+  if (pathname.empty() && search.empty()) return "/";
+  const std::string_view input = url.substr(0, url.find('#'));
+  const size_t length = pathname.size() + search.size();
+  if (input.size() >= length &&
+      input.substr(input.size() - length, pathname.size()) == pathname &&
+      input.substr(input.size() - search.size()) == search) {
+    return EncodePathForMatching(input.substr(input.size() - length), buffer);
+  }
+  buffer->assign(pathname);
+  buffer->append(search);
+  return EncodePathForMatching(*buffer, buffer);
 
 #else
   // Fallback: simple URL parsing without ada-url dependency
@@ -780,7 +1976,9 @@ std::string GetPathParamsQuery(const std::string& url) {
       if (hash_pos != std::string_view::npos) {
         s = s.substr(0, hash_pos);
       }
-      return EncodePathForMatching("/" + std::string(s));
+      buffer->assign(1, '/');
+      buffer->append(s);
+      return EncodePathForMatching(*buffer, buffer);
     }
     path_start = slash_pos;
   }
@@ -792,10 +1990,15 @@ std::string GetPathParamsQuery(const std::string& url) {
     s = s.substr(0, hash_pos);
   }
 
-  return s.empty() ? "/" : EncodePathForMatching(s);
+  return s.empty() ? "/" : EncodePathForMatching(s, buffer);
 #endif
 }
 
+std::string GetPathParamsQuery(const std::string& url) {
+  std::string buffer;
+  return std::string(GetPathParamsQuery(url, &buffer));
+}
+
 // MaybeEscapePattern is not in anonymous namespace to allow testing.
 //
 // Canonicalize the allowed/disallowed paths. For example:
@@ -968,150 +2171,405 @@ class ParsedRobotsKey {
   std::string_view key_text_;
 };
 
+// The parsers of the values of the non-standard directives take the value as
+// is, without copying it. The numbers are read like strtol() and strtod() read
+// them in the "C" locale, but regardless of the locale of the process.
+
+// Reads the longest prefix of 's' that strtol(s, &end, 10) would read.
+// Returns its length, 0 if there is no number. Out of range values saturate
+// like strtol() does.
+size_t ParseLongPrefix(std::string_view s, long* value) {
+  size_t pos = 0;
+  while (pos < s.size() && AsciiIsSpace(s[pos])) ++pos;
+  const size_t sign_pos = pos;
+  if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) ++pos;
+  if (pos == s.size() || s[pos] < '0' || s[pos] > '9') return 0;
+  // from_chars() accepts a '-' but no '+', so the sign is included only if it
+  // is a '-'.
+  const char* first = s.data() + (s[sign_pos] == '-' ? sign_pos : pos);
+  const std::from_chars_result result =
+      std::from_chars(first, s.data() + s.size(), *value);
+  if (result.ec == std::errc::result_out_of_range) {
+    *value = s[sign_pos] == '-' ? LONG_MIN : LONG_MAX;
+  }
+  return result.ptr - s.data();
+}
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+// Returns whether the number 'digits' in the given format, which from_chars()
+// found out of the range of double, is too large rather than too small, that
+// is whether it is at least 1.
+bool IsTooLarge(std::string_view digits, std::chars_format format) {
+  const bool hex = format == std::chars_format::hex;
+  // Exponent of the first significant digit, e.g. 2 for "123" and -3 for
+  // "0.001", in digits of the format.
+  long magnitude = -1;
+  bool found = false;
+  bool fraction = false;
+  size_t pos = 0;
+  for (; pos < digits.size(); ++pos) {
+    const char c = AsciiToLower(digits[pos]);
+    if (c == (hex ? 'p' : 'e')) break;
+    if (c == '.') {
+      fraction = true;
+    } else if (!found && c == '0') {
+      if (fraction) --magnitude;
+    } else if (!found) {
+      found = true;
+      if (!fraction) magnitude = 0;
+    } else if (!fraction) {
+      ++magnitude;
+    }
+  }
+  long exponent = 0;
+  if (pos < digits.size()) {
+    ParseLongPrefix(digits.substr(pos + 1), &exponent);
+  }
+  // The magnitude is bounded by the line length, keep the sum from overflowing.
+  constexpr long kMaxExponent = 1L << 24;
+  exponent = std::max(-kMaxExponent, std::min(exponent, kMaxExponent));
+  // Hexadecimal digits weigh 4 bits, their exponent is in bits.
+  return (hex ? 4 * magnitude : magnitude) + exponent >= 0;
+}
+#endif
+
+// Reads the longest prefix of 's' that strtod() would read in the "C" locale.
+// Returns false if there is no number.
+bool ParseDoublePrefix(std::string_view s, double* value) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  size_t pos = 0;
+  while (pos < s.size() && AsciiIsSpace(s[pos])) ++pos;
+  bool negative = false;
+  if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+    negative = s[pos] == '-';
+    ++pos;
+  }
+  // from_chars() takes neither a '+' nor the "0x" of hexadecimal numbers.
+  std::chars_format format = std::chars_format::general;
+  if (s.size() - pos > 2 && s[pos] == '0' && AsciiToLower(s[pos + 1]) == 'x') {
+    const char c = AsciiToLower(s[pos + 2]);
+    const char next = s.size() - pos > 3 ? s[pos + 3] : '\0';
+    // strtod() reads "0x" as 0 unless a hexadecimal digit follows, possibly
+    // after the point.
+    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+        (c == '.' && std::isxdigit(static_cast<unsigned char>(next)))) {
+      format = std::chars_format::hex;
+      pos += 2;
+    }
+  }
+  if (pos < s.size() && s[pos] == '-') return false;  // Like "+-1".
+  double parsed = 0.0;
+  const std::from_chars_result result =
+      std::from_chars(s.data() + pos, s.data() + s.size(), parsed, format);
+  if (result.ec == std::errc::invalid_argument) return false;
+  if (result.ec == std::errc::result_out_of_range) {
+    const std::string_view digits =
+        s.substr(pos, result.ptr - (s.data() + pos));
+    parsed = IsTooLarge(digits, format) ? HUGE_VAL : 0.0;
+  }
+  *value = negative ? -parsed : parsed;
+  return true;
+#else
+  // No from_chars() for floating point numbers, strtod() needs a terminated
+  // copy.
+  const std::string terminated(s);
+  char* end = nullptr;
+  *value = strtod(terminated.c_str(), &end);
+  return end != terminated.c_str();
+#endif
+}
+
+// Parses the seconds of a Crawl-delay. Invalid and negative values are 0.
+double ParseCrawlDelay(std::string_view value) {
+  double delay = 0.0;
+  if (!ParseDoublePrefix(value, &delay) || delay < 0) return 0.0;
+  return delay;
+}
+
+// Parses a Request-rate of the form "requests/seconds" (e.g., "1/5", "1/5s",
+// "30/60", "1"). A missing or invalid number of seconds is 1 second.
+RequestRate ParseRequestRate(std::string_view value) {
+  RequestRate rate;
+  long requests = 0;
+  const size_t requests_end = ParseLongPrefix(value, &requests);
+  if (requests_end == 0 || requests <= 0) return rate;
+  rate.requests = static_cast<int>(requests);
+  if (requests_end < value.size() && value[requests_end] == '/') {
+    long seconds = 0;
+    if (ParseLongPrefix(value.substr(requests_end + 1), &seconds) != 0 &&
+        seconds > 0) {
+      rate.seconds = static_cast<int>(seconds);
+    }
+    // Anything after the seconds, like the 's' of "1/5s", is ignored.
+  }
+  return rate;
+}
+
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+// Parses a Content-Signal of the form "key=value, key=value" (e.g.,
+// "ai-train=no, search=yes, ai-input=yes").
+ContentSignal ParseContentSignal(std::string_view value) {
+  ContentSignal signal;
+  size_t pos = 0;
+  while (pos < value.size()) {
+    // Skip whitespace and commas.
+    while (pos < value.size() &&
+           (value[pos] == ' ' || value[pos] == '\t' || value[pos] == ',')) {
+      ++pos;
+    }
+    if (pos >= value.size()) break;
+
+    // Find the '=' separator.
+    const size_t eq_pos = value.find('=', pos);
+    if (eq_pos == std::string_view::npos) break;
+    const std::string_view key_part =
+        StripAsciiWhitespace(value.substr(pos, eq_pos - pos));
+
+    // Find end of value (next comma or end of string).
+    const size_t val_start = eq_pos + 1;
+    size_t val_end = value.find(',', val_start);
+    if (val_end == std::string_view::npos) val_end = value.size();
+    const std::string_view val_part =
+        StripAsciiWhitespace(value.substr(val_start, val_end - val_start));
+
+    // Parse boolean value (yes/no, true/false, 1/0).
+    std::optional<bool> bool_val;
+    if (EqualsIgnoreCase(val_part, "yes") ||
+        EqualsIgnoreCase(val_part, "true") || val_part == "1") {
+      bool_val = true;
+    } else if (EqualsIgnoreCase(val_part, "no") ||
+               EqualsIgnoreCase(val_part, "false") || val_part == "0") {
+      bool_val = false;
+    }
+
+    // Set the appropriate signal field.
+    if (bool_val.has_value()) {
+      if (EqualsIgnoreCase(key_part, "ai-train")) {
+        signal.ai_train = *bool_val;
+      } else if (EqualsIgnoreCase(key_part, "ai-input")) {
+        signal.ai_input = *bool_val;
+      } else if (EqualsIgnoreCase(key_part, "search")) {
+        signal.search = *bool_val;
+      }
+    }
+
+    pos = val_end;
+  }
+  return signal;
+}
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+template <typename Handler>
 void EmitKeyValueToHandler(int line, const ParsedRobotsKey& key,
-                           std::string_view value,
-                           RobotsParseHandler* handler) {
+                           std::string_view value, Handler* handler) {
   typedef ParsedRobotsKey Key;
   switch (key.type()) {
     case Key::USER_AGENT:     handler->HandleUserAgent(line, value); break;
     case Key::ALLOW:          handler->HandleAllow(line, value); break;
     case Key::DISALLOW:       handler->HandleDisallow(line, value); break;
     case Key::SITEMAP:        handler->HandleSitemap(line, value); break;
-    case Key::CRAWL_DELAY: {
-      // Parse value as double (seconds). Invalid values are treated as 0.
-      double delay = 0.0;
-      if (!value.empty()) {
-        // Use strtod for parsing. Create a null-terminated copy.
-        std::string value_str(value);
-        char* endptr = nullptr;
-        delay = strtod(value_str.c_str(), &endptr);
-        // If parsing failed or value is negative, use 0.
-        if (endptr == value_str.c_str() || delay < 0) {
-          delay = 0.0;
-        }
-      }
-      handler->HandleCrawlDelay(line, delay);
+    case Key::CRAWL_DELAY:
+      handler->HandleCrawlDelay(line, ParseCrawlDelay(value));
       break;
-    }
-    case Key::REQUEST_RATE: {
-      // Parse "requests/seconds" format (e.g., "1/5", "1/5s", "30/60", "1").
-      RequestRate rate;
-      if (!value.empty()) {
-        std::string value_str(value);
-        char* endptr = nullptr;
-        long requests = strtol(value_str.c_str(), &endptr, 10);
-        if (endptr != value_str.c_str() && requests > 0) {
-          rate.requests = static_cast<int>(requests);
-          // Check for "/" separator
-          if (*endptr == '/') {
-            ++endptr;
-            char* seconds_end = nullptr;
-            long seconds = strtol(endptr, &seconds_end, 10);
-            if (seconds_end != endptr && seconds > 0) {
-              rate.seconds = static_cast<int>(seconds);
-            }
-            // Ignore optional 's' suffix (e.g., "1/5s")
-          }
-          // If no "/" found, treat as "requests/1" (requests per second)
-        }
-      }
-      handler->HandleRequestRate(line, rate);
+    case Key::REQUEST_RATE:
+      handler->HandleRequestRate(line, ParseRequestRate(value));
       break;
-    }
 #if ROBOTS_SUPPORT_CONTENT_SIGNAL
-    case Key::CONTENT_SIGNAL: {
-      // Parse "key=value, key=value" format
-      // (e.g., "ai-train=no, search=yes, ai-input=yes").
-      ContentSignal signal;
-      if (!value.empty()) {
-        // Parse comma-separated key=value pairs
-        size_t pos = 0;
-        while (pos < value.size()) {
-          // Skip whitespace and commas
-          while (pos < value.size() && (value[pos] == ' ' || value[pos] == '\t' || value[pos] == ',')) {
-            ++pos;
-          }
-          if (pos >= value.size()) break;
+    case Key::CONTENT_SIGNAL:
+      handler->HandleContentSignal(line, ParseContentSignal(value));
+      break;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+    case Key::UNKNOWN:
+      handler->HandleUnknownAction(line, key.GetUnknownText(), value);
+      break;
+      // No default case Key:: to have the compiler warn about new values.
+  }
+}
 
-          // Find the '=' separator
-          size_t eq_pos = value.find('=', pos);
-          if (eq_pos == std::string_view::npos) break;
+// Returns the index of the first '\n' or '\r' in s[pos, size), or size if
+// there is none.
+size_t FindLineEndScalar(const char* s, size_t pos, size_t size) {
+  for (; pos < size; ++pos) {
+    if (s[pos] == '\n' || s[pos] == '\r') return pos;
+  }
+  return size;
+}
 
-          std::string_view key_part = StripAsciiWhitespace(value.substr(pos, eq_pos - pos));
+// Index of the lowest set bit of a non-zero mask.
+inline int CountTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(mask);
+#endif
+}
 
-          // Find end of value (next comma or end of string)
-          size_t val_start = eq_pos + 1;
-          size_t val_end = value.find(',', val_start);
-          if (val_end == std::string_view::npos) {
-            val_end = value.size();
-          }
+#if ROBOTS_HAVE_SSE2
+size_t FindLineEndSSE2(const char* s, size_t pos, size_t size) {
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + pos));
+    const unsigned mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+    if (mask != 0) return pos + CountTrailingZeros(mask);
+  }
+  return FindLineEndScalar(s, pos, size);
+}
+#endif  // ROBOTS_HAVE_SSE2
+
+#if ROBOTS_HAVE_AVX2
+__attribute__((target("avx2"))) size_t FindLineEndAVX2(const char* s,
+                                                        size_t pos,
+                                                        size_t size) {
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  for (; pos + 32 <= size; pos += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + pos));
+    const unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, lf), _mm256_cmpeq_epi8(chunk, cr)));
+    if (mask != 0) return pos + CountTrailingZeros(mask);
+  }
+  return FindLineEndSSE2(s, pos, size);
+}
+#endif  // ROBOTS_HAVE_AVX2
+
+#if ROBOTS_HAVE_NEON
+size_t FindLineEndNEON(const char* s, size_t pos, size_t size) {
+  const uint8x16_t lf = vdupq_n_u8('\n');
+  const uint8x16_t cr = vdupq_n_u8('\r');
+  for (; pos + 16 <= size; pos += 16) {
+    const uint8x16_t chunk =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(s + pos));
+    const uint8x16_t eq = vorrq_u8(vceqq_u8(chunk, lf), vceqq_u8(chunk, cr));
+    // Narrows the byte mask to 4 bits per byte.
+    const uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (mask != 0) return pos + CountTrailingZeros(mask) / 4;
+  }
+  return FindLineEndScalar(s, pos, size);
+}
+#endif  // ROBOTS_HAVE_NEON
 
-          std::string_view val_part = StripAsciiWhitespace(value.substr(val_start, val_end - val_start));
+using FindLineEndFn = size_t (*)(const char* s, size_t pos, size_t size);
 
-          // Parse boolean value (yes/no, true/false, 1/0)
-          std::optional<bool> bool_val;
-          if (EqualsIgnoreCase(val_part, "yes") || EqualsIgnoreCase(val_part, "true") || val_part == "1") {
-            bool_val = true;
-          } else if (EqualsIgnoreCase(val_part, "no") || EqualsIgnoreCase(val_part, "false") || val_part == "0") {
-            bool_val = false;
-          }
+// Picks the widest kernel the CPU supports.
+FindLineEndFn ChooseFindLineEnd() {
+#if ROBOTS_HAVE_AVX2
+  if (__builtin_cpu_supports("avx2")) return FindLineEndAVX2;
+#endif
+#if ROBOTS_HAVE_SSE2
+  return FindLineEndSSE2;
+#elif ROBOTS_HAVE_NEON
+  return FindLineEndNEON;
+#else
+  return FindLineEndScalar;
+#endif
+}
 
-          // Set the appropriate signal field
-          if (bool_val.has_value()) {
-            if (EqualsIgnoreCase(key_part, "ai-train")) {
-              signal.ai_train = *bool_val;
-            } else if (EqualsIgnoreCase(key_part, "ai-input")) {
-              signal.ai_input = *bool_val;
-            } else if (EqualsIgnoreCase(key_part, "search")) {
-              signal.search = *bool_val;
-            }
-          }
+size_t FindLineEnd(std::string_view s, size_t pos) {
+  static const FindLineEndFn find_line_end = ChooseFindLineEnd();
+  return find_line_end(s.data(), pos, s.size());
+}
 
-          pos = val_end;
-        }
-      }
-      handler->HandleContentSignal(line, signal);
-      break;
+// Returns the index of the first '#', '*' or '$' in s[pos), or s.size() if
+// there is none. These end the path of a canonical URL or need encoding.
+// Paths are short, so there is no AVX2 kernel.
+size_t FindPathSpecial(std::string_view s, size_t pos) {
+  const char* data = s.data();
+  const size_t size = s.size();
+#if ROBOTS_HAVE_SSE2
+  const __m128i hash = _mm_set1_epi8('#');
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i dollar = _mm_set1_epi8('$');
+  for (; pos + 16 <= size; pos += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    const unsigned mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(chunk, hash),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, star),
+                     _mm_cmpeq_epi8(chunk, dollar))));
+    if (mask != 0) return pos + CountTrailingZeros(mask);
+  }
+#elif ROBOTS_HAVE_NEON
+  const uint8x16_t hash = vdupq_n_u8('#');
+  const uint8x16_t star = vdupq_n_u8('*');
+  const uint8x16_t dollar = vdupq_n_u8('$');
+  for (; pos + 16 <= size; pos += 16) {
+    const uint8x16_t chunk =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(data + pos));
+    const uint8x16_t eq =
+        vorrq_u8(vceqq_u8(chunk, hash),
+                 vorrq_u8(vceqq_u8(chunk, star), vceqq_u8(chunk, dollar)));
+    const uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (mask != 0) return pos + CountTrailingZeros(mask) / 4;
+  }
+#endif
+  for (; pos < size; ++pos) {
+    if (data[pos] == '#' || data[pos] == '*' || data[pos] == '$') return pos;
+  }
+  return size;
+}
+
+// UTF-8 byte order marks.
+constexpr unsigned char kUtfBom[3] = {0xEF, 0xBB, 0xBF};
+
+// Certain browsers limit the URL length to 2083 bytes. In a robots.txt, it's
+// fairly safe to assume any valid line isn't going to be more than many times
+// that max url length of 2KB. We want some padding for
+// UTF-8 encoding/nulls/etc. but a much smaller bound would be okay as well.
+// If so, we can ignore the chars on a line past that.
+constexpr size_t kBrowserMaxLineLen = 2083;
+// Note: original code used a buffer of kMaxLineLen bytes with the last byte
+// reserved for null terminator, so max content length is kMaxLineLen - 1.
+constexpr size_t kMaxLineLen = kBrowserMaxLineLen * 8 - 1;
+
+// Returns false if 'line' can neither be a user-agent line nor a sitemap line,
+// which applies whatever the group it is in. The key starts at the first
+// non-whitespace character and all accepted spellings of these keys start with
+// a 'u' or an 's', see ParsedRobotsKey::Parse().
+bool MayBeUserAgentOrSitemapLine(std::string_view line) {
+  for (const char c : line) {
+    if (!AsciiIsSpace(c)) {
+      return c == 'u' || c == 'U' || c == 's' || c == 'S';
     }
-#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
-    case Key::UNKNOWN:
-      handler->HandleUnknownAction(line, key.GetUnknownText(), value);
-      break;
-      // No default case Key:: to have the compiler warn about new values.
   }
+  return false;
 }
 
+// Parses a robots.txt and emits its callbacks to a 'Handler': either
+// RobotsParseHandler, called through its virtual interface, or a final class or
+// a class with the same methods, whose callbacks are called directly and can be
+// inlined into the parse loop.
+template <typename Handler>
 class RobotsTxtParser {
  public:
   typedef ParsedRobotsKey Key;
 
-  RobotsTxtParser(std::string_view robots_body,
-                  RobotsParseHandler* handler)
+  RobotsTxtParser(std::string_view robots_body, Handler* handler)
       : robots_body_(robots_body), handler_(handler) {
   }
 
   void Parse();
 
- private:
-  // Parses a line into key and value string_views without copying.
-  // Note that `key` and `value` are only set when `metadata->has_directive
-  // == true`.
-  static void GetKeyAndValueFrom(std::string_view line,
-                                 std::string_view* key, std::string_view* value,
-                                 RobotsParseHandler::LineMetadata* metadata);
-
+  // Parses one line, already split and truncated, and emits its callbacks.
   void ParseAndEmitLine(int current_line, std::string_view line,
                         bool line_too_long);
-  static bool NeedEscapeValueForKey(const Key& key);
 
+ private:
   std::string_view robots_body_;
-  RobotsParseHandler* const handler_;
+  Handler* const handler_;
 };
 
-bool RobotsTxtParser::NeedEscapeValueForKey(const Key& key) {
+bool NeedEscapeValueForKey(const ParsedRobotsKey& key) {
   switch (key.type()) {
-    case RobotsTxtParser::Key::USER_AGENT:
-    case RobotsTxtParser::Key::SITEMAP:
+    case ParsedRobotsKey::USER_AGENT:
+    case ParsedRobotsKey::SITEMAP:
       return false;
     default:
       return true;
@@ -1129,8 +2587,10 @@ constexpr size_t FindFirstOf(std::string_view s, std::string_view chars) {
   return std::string_view::npos;
 }
 
-// Zero-copy version: parses line into key/value string_views.
-/* static */ void RobotsTxtParser::GetKeyAndValueFrom(
+// Parses a line into key and value string_views without copying.
+// Note that `key` and `value` are only set when `metadata->has_directive
+// == true`.
+void GetKeyAndValueFrom(
     std::string_view line,
     std::string_view* key, std::string_view* value,
     RobotsParseHandler::LineMetadata* metadata) {
@@ -1185,8 +2645,10 @@ constexpr size_t FindFirstOf(std::string_view s, std::string_view chars) {
   }
 }
 
-void RobotsTxtParser::ParseAndEmitLine(int current_line, std::string_view line,
-                                       bool line_too_long) {
+template <typename Handler>
+void RobotsTxtParser<Handler>::ParseAndEmitLine(int current_line,
+                                                std::string_view line,
+                                                bool line_too_long) {
   std::string_view string_key;
   std::string_view value;
   RobotsParseHandler::LineMetadata line_metadata;
@@ -1198,8 +2660,12 @@ void RobotsTxtParser::ParseAndEmitLine(int current_line, std::string_view line,
     handler_->ReportLineMetadata(current_line, line_metadata);
     return;
   }
+  ROBOTS_STATS_ONLY(++thread_stats.directives;)
   Key key;
-  key.Parse(string_key, &line_metadata.is_acceptable_typo);
+  {
+    ROBOTS_STATS_ONLY(PhaseTimer timer(&RobotsStats::classify_ns);)
+    key.Parse(string_key, &line_metadata.is_acceptable_typo);
+  }
   if (NeedEscapeValueForKey(key)) {
     auto escaped = MaybeEscapePattern(value);
     if (escaped) {
@@ -1214,52 +2680,53 @@ void RobotsTxtParser::ParseAndEmitLine(int current_line, std::string_view line,
   handler_->ReportLineMetadata(current_line, line_metadata);
 }
 
-void RobotsTxtParser::Parse() {
-  // UTF-8 byte order marks.
-  constexpr unsigned char utf_bom[3] = {0xEF, 0xBB, 0xBF};
-
-  // Certain browsers limit the URL length to 2083 bytes. In a robots.txt, it's
-  // fairly safe to assume any valid line isn't going to be more than many times
-  // that max url length of 2KB. We want some padding for
-  // UTF-8 encoding/nulls/etc. but a much smaller bound would be okay as well.
-  // If so, we can ignore the chars on a line past that.
-  constexpr size_t kBrowserMaxLineLen = 2083;
-  // Note: original code used a buffer of kMaxLineLen bytes with the last byte
-  // reserved for null terminator, so max content length is kMaxLineLen - 1.
-  constexpr size_t kMaxLineLen = kBrowserMaxLineLen * 8 - 1;
-
+template <typename Handler>
+void RobotsTxtParser<Handler>::Parse() {
+  ROBOTS_STATS_ONLY(PhaseTimer timer(&RobotsStats::parse_ns);
+                    thread_stats.bytes += robots_body_.size();)
   // Zero-copy parsing: track line boundaries via indices into robots_body_.
   int line_num = 0;
   size_t bom_skip = 0;
   bool last_was_carriage_return = false;
   handler_->HandleRobotsStart();
+  bool skip_to_user_agent = handler_->CanSkipToNextUserAgent();
 
   // Skip UTF-8 BOM prefix if present (even partial BOM is skipped).
-  while (bom_skip < sizeof(utf_bom) && bom_skip < robots_body_.size() &&
-         static_cast<unsigned char>(robots_body_[bom_skip]) == utf_bom[bom_skip]) {
+  while (bom_skip < sizeof(kUtfBom) && bom_skip < robots_body_.size() &&
+         static_cast<unsigned char>(robots_body_[bom_skip]) == kUtfBom[bom_skip]) {
     ++bom_skip;
   }
 
   size_t line_start = bom_skip;
-  for (size_t i = bom_skip; i < robots_body_.size(); ++i) {
+  // Jumps from one line-ending character to the next.
+  for (size_t i = FindLineEnd(robots_body_, bom_skip); i < robots_body_.size();
+       i = FindLineEnd(robots_body_, i + 1)) {
     const unsigned char ch = static_cast<unsigned char>(robots_body_[i]);
-    if (ch == 0x0A || ch == 0x0D) {  // Line-ending character.
-      // Only emit an empty line if this was not due to the second character
-      // of the DOS line-ending \r\n.
-      const bool is_CRLF_continuation =
-          (i == line_start) && last_was_carriage_return && ch == 0x0A;
-      if (!is_CRLF_continuation) {
-        size_t line_len = i - line_start;
-        bool line_too_long = line_len > kMaxLineLen;
-        if (line_too_long) {
-          line_len = kMaxLineLen;
-        }
-        std::string_view line = robots_body_.substr(line_start, line_len);
+    // Only emit an empty line if this was not due to the second character
+    // of the DOS line-ending \r\n.
+    const bool is_CRLF_continuation =
+        (i == line_start) && last_was_carriage_return && ch == 0x0A;
+    if (!is_CRLF_continuation) {
+      size_t line_len = i - line_start;
+      bool line_too_long = line_len > kMaxLineLen;
+      if (line_too_long) {
+        line_len = kMaxLineLen;
+      }
+      std::string_view line = robots_body_.substr(line_start, line_len);
+      if (skip_to_user_agent && !MayBeUserAgentOrSitemapLine(line)) {
+        ++line_num;
+      } else {
         ParseAndEmitLine(++line_num, line, line_too_long);
+        if (handler_->CanStopParsing()) {
+          ROBOTS_STATS_ONLY(thread_stats.lines += line_num;)
+          handler_->HandleRobotsEnd();
+          return;
+        }
+        skip_to_user_agent = handler_->CanSkipToNextUserAgent();
       }
-      line_start = i + 1;
-      last_was_carriage_return = (ch == 0x0D);
     }
+    line_start = i + 1;
+    last_was_carriage_return = (ch == 0x0D);
   }
 
   // Handle final line (if no trailing newline) or emit empty line if file
@@ -1271,83 +2738,477 @@ void RobotsTxtParser::Parse() {
       line_len = kMaxLineLen;
     }
     std::string_view line = robots_body_.substr(line_start, line_len);
-    ParseAndEmitLine(++line_num, line, line_too_long);
+    if (!skip_to_user_agent || MayBeUserAgentOrSitemapLine(line)) {
+      ParseAndEmitLine(++line_num, line, line_too_long);
+    } else {
+      ++line_num;
+    }
   }
+  ROBOTS_STATS_ONLY(thread_stats.lines += line_num;)
   handler_->HandleRobotsEnd();
 }
 
 // Implements the default robots.txt matching strategy. The maximum number of
-// characters matched by a pattern is returned as its match priority.
+// characters matched by a pattern is returned as its match priority. The
+// matchers call it directly instead of going through the RobotsMatchStrategy
+// interface, so it only has static methods.
 class LongestMatchRobotsMatchStrategy : public RobotsMatchStrategy {
  public:
-  LongestMatchRobotsMatchStrategy() = default;
-
-  // Disallow copying and assignment.
-  LongestMatchRobotsMatchStrategy(const LongestMatchRobotsMatchStrategy&) =
-      delete;
-  LongestMatchRobotsMatchStrategy& operator=(
-      const LongestMatchRobotsMatchStrategy&) = delete;
+  LongestMatchRobotsMatchStrategy() = delete;
+
+  // The priority of an Allow or Disallow 'pattern' for 'path', taking the
+  // steps of the match from '*steps_left'. Returns -1 and sets '*exceeded' if
+  // there are not enough left.
+  static int Priority(std::string_view path, std::string_view pattern,
+                      uint64_t* steps_left, bool* exceeded) {
+    return Matches(path, pattern, steps_left, exceeded) ? pattern.length()
+                                                        : -1;
+  }
 
-  int MatchAllow(std::string_view path, std::string_view pattern) override;
-  int MatchDisallow(std::string_view path, std::string_view pattern) override;
+  // Same as above, and also sets '*exceeded' if 'pattern' goes over the caps
+  // of 'budget'. Returns -1 without matching once '*exceeded' is set.
+  static int Priority(std::string_view path, std::string_view pattern,
+                      const MatchBudget& budget, uint64_t* steps_left,
+                      bool* exceeded) {
+    if (*exceeded) return -1;
+    if (!WithinCaps(pattern, budget)) {
+      *exceeded = true;
+      return -1;
+    }
+    return Priority(path, pattern, steps_left, exceeded);
+  }
 };
 }  // end anonymous namespace
 
+// GetPathParamsQueryOfCanonicalUrl is not in anonymous namespace to allow
+// testing.
+//
+// Same as GetPathParamsQuery() for an absolute URL in canonical form, without
+// parsing it: the path and query start at the first '/' after the authority
+// and end at the fragment. URLs without "://" or with a query but no path are
+// handed to GetPathParamsQuery().
+std::string_view GetPathParamsQueryOfCanonicalUrl(std::string_view url,
+                                                  std::string* buffer) {
+  const size_t scheme_end = url.find("://");
+  if (scheme_end == std::string_view::npos) {
+    return GetPathParamsQuery(url, buffer);
+  }
+  const size_t path_start = url.find_first_of("/?#", scheme_end + 3);
+  if (path_start == std::string_view::npos || url[path_start] == '#') {
+    return "/";
+  }
+  if (url[path_start] == '?') return GetPathParamsQuery(url, buffer);
+
+  const size_t special = FindPathSpecial(url, path_start);
+  if (special == url.size() || url[special] == '#') {
+    return url.substr(path_start, special - path_start);
+  }
+  // A '*' or '$', which has to be encoded.
+  const size_t hash_pos = url.find('#', special);
+  return EncodePathForMatching(
+      url.substr(path_start, hash_pos == std::string_view::npos
+                                 ? std::string_view::npos
+                                 : hash_pos - path_start),
+      buffer);
+}
+
+// Extracts the path to match from 'url' as requested by 'mode'.
+static std::string_view GetMatchPath(std::string_view url, UrlMode mode,
+                                     std::string* buffer) {
+  ROBOTS_STATS_ONLY(PhaseTimer timer(&RobotsStats::url_ns); ++thread_stats.urls;)
+  return mode == UrlMode::kTrustedCanonical
+             ? GetPathParamsQueryOfCanonicalUrl(url, buffer)
+             : GetPathParamsQuery(url, buffer);
+}
+
+// Buffer for GetMatchPath() in the const queries of CompiledRobots and
+// ResolvedRobots, which may run on several threads at once. Kept per thread
+// so that its capacity is reused from one query to the next.
+static std::string* ThreadPathBuffer() {
+  thread_local std::string buffer;
+  return &buffer;
+}
+
 void ParseRobotsTxt(std::string_view robots_body,
                     RobotsParseHandler* parse_callback) {
-  RobotsTxtParser parser(robots_body, parse_callback);
+  RobotsTxtParser<RobotsParseHandler> parser(robots_body, parse_callback);
   parser.Parse();
 }
 
+namespace {
+// FIPS 180-4 SHA-256, for DigestBody().
+constexpr uint32_t kSha256Rounds[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// Compresses 'num_blocks' 64-byte blocks at 'data' into 'state'.
+void Sha256BlocksScalar(uint32_t state[8], const unsigned char* data,
+                        size_t num_blocks) {
+  auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+  for (; num_blocks > 0; --num_blocks, data += 64) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      w[i] = uint32_t{data[4 * i]} << 24 | uint32_t{data[4 * i + 1]} << 16 |
+             uint32_t{data[4 * i + 2]} << 8 | uint32_t{data[4 * i + 3]};
+    }
+    for (int i = 16; i < 64; ++i) {
+      const uint32_t s0 =
+          rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      const uint32_t s1 =
+          rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+      const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                          ((e & f) ^ (~e & g)) + kSha256Rounds[i] + w[i];
+      const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                          ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+  }
+}
+
+#if ROBOTS_HAVE_SHANI
+// Same as above with the SHA extensions. The state is kept as the ABEF and
+// CDGH halves that _mm_sha256rnds2_epu32() works on.
+__attribute__((target("sha,sse4.1"))) void Sha256BlocksShaNi(
+    uint32_t state[8], const unsigned char* data, size_t num_blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+  __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+  const __m128i cdab = _mm_shuffle_epi32(dcba, 0xb1);
+  const __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1b);
+  __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+  __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+  for (; num_blocks > 0; --num_blocks, data += 64) {
+    const __m128i abef_before = abef;
+    const __m128i cdgh_before = cdgh;
+    // msg[i % 4] holds words 4i to 4i + 3 of the message schedule.
+    __m128i msg[4];
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC unroll 16
+#endif
+    for (int i = 0; i < 16; ++i) {
+      if (i < 4) {
+        msg[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)),
+            byte_swap);
+      } else {
+        __m128i next = _mm_sha256msg1_epu32(msg[i % 4], msg[(i + 1) % 4]);
+        next = _mm_add_epi32(
+            next, _mm_alignr_epi8(msg[(i + 3) % 4], msg[(i + 2) % 4], 4));
+        msg[i % 4] = _mm_sha256msg2_epu32(next, msg[(i + 3) % 4]);
+      }
+      __m128i words = _mm_add_epi32(
+          msg[i % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                          kSha256Rounds + 4 * i)));
+      cdgh = _mm_sha256rnds2_epu32(cdgh, abef, words);
+      words = _mm_shuffle_epi32(words, 0x0e);
+      abef = _mm_sha256rnds2_epu32(abef, cdgh, words);
+    }
+    abef = _mm_add_epi32(abef, abef_before);
+    cdgh = _mm_add_epi32(cdgh, cdgh_before);
+  }
+
+  const __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+  const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+  dcba = _mm_blend_epi16(feba, dchg, 0xf0);
+  hgfe = _mm_alignr_epi8(dchg, feba, 8);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), dcba);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), hgfe);
+}
+#endif  // ROBOTS_HAVE_SHANI
+
+using Sha256BlocksFn = void (*)(uint32_t state[8], const unsigned char* data,
+                                size_t num_blocks);
+
+Sha256BlocksFn ChooseSha256Blocks() {
+#if ROBOTS_HAVE_SHANI
+  // __builtin_cpu_supports("sha") is not reliable across GCC versions.
+  unsigned eax, ebx, ecx, edx;
+  const bool sse41 = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 19) & 1;
+  if (sse41 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+      (ebx >> 29) & 1) {
+    return Sha256BlocksShaNi;
+  }
+#endif
+  return Sha256BlocksScalar;
+}
+}  // namespace
+
+BodyDigest DigestBody(std::string_view body) {
+  static const Sha256BlocksFn sha256_blocks = ChooseSha256Blocks();
+  uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  const unsigned char* const data =
+      reinterpret_cast<const unsigned char*>(body.data());
+  const size_t num_blocks = body.size() / 64;
+  if (num_blocks > 0) sha256_blocks(state, data, num_blocks);
+  // The rest of the body, a 1 bit, zeros and the length in bits, in one or
+  // two blocks.
+  unsigned char tail[128] = {};
+  const size_t rest = body.size() - num_blocks * 64;
+  if (rest > 0) std::memcpy(tail, data + num_blocks * 64, rest);
+  tail[rest] = 0x80;
+  const size_t tail_size = rest < 56 ? 64 : 128;
+  const uint64_t bits = uint64_t{body.size()} * 8;
+  for (int b = 0; b < 8; ++b) {
+    tail[tail_size - 1 - b] = static_cast<unsigned char>(bits >> (8 * b));
+  }
+  sha256_blocks(state, tail, tail_size / 64);
+
+  BodyDigest digest;
+  for (int w = 0; w < 8; ++w) {
+    for (int b = 0; b < 4; ++b) {
+      digest[4 * w + b] = static_cast<uint8_t>(state[w] >> (24 - 8 * b));
+    }
+  }
+  return digest;
+}
+
+RobotsTxtStreamParser::RobotsTxtStreamParser(RobotsParseHandler* handler)
+    : handler_(handler) {}
+
+void RobotsTxtStreamParser::Start() {
+  if (started_) return;
+  started_ = true;
+  handler_->HandleRobotsStart();
+  skip_to_user_agent_ = handler_->CanSkipToNextUserAgent();
+}
+
+void RobotsTxtStreamParser::EmitLine(std::string_view tail) {
+  std::string_view line = tail;
+  size_t line_len = tail.size();
+  if (line_length_ > 0) {
+    line_.append(tail.substr(0, kMaxLineLen - line_.size()));
+    line = line_;
+    line_len += line_length_;
+  }
+  const bool line_too_long = line_len > kMaxLineLen;
+  if (line_too_long) {
+    line = line.substr(0, kMaxLineLen);
+  }
+  ROBOTS_STATS_ONLY(++thread_stats.lines;)
+  if (skip_to_user_agent_ && !MayBeUserAgentOrSitemapLine(line)) {
+    ++line_num_;
+  } else {
+    RobotsTxtParser<RobotsParseHandler>(std::string_view(), handler_)
+        .ParseAndEmitLine(++line_num_, line, line_too_long);
+    stopped_ = handler_->CanStopParsing();
+    skip_to_user_agent_ = handler_->CanSkipToNextUserAgent();
+  }
+  line_.clear();
+  line_length_ = 0;
+}
+
+bool RobotsTxtStreamParser::Feed(std::string_view chunk) {
+  if (stopped_) return false;
+  ROBOTS_STATS_ONLY(PhaseTimer timer(&RobotsStats::parse_ns);
+                    thread_stats.bytes += chunk.size();)
+  Start();
+
+  // Skips the byte order mark, or what the body starts with of it, as
+  // ParseRobotsTxt() does.
+  if (in_bom_) {
+    while (!chunk.empty() && bom_bytes_ < static_cast<int>(sizeof(kUtfBom)) &&
+           static_cast<unsigned char>(chunk[0]) == kUtfBom[bom_bytes_]) {
+      ++bom_bytes_;
+      chunk.remove_prefix(1);
+    }
+    if (chunk.empty() && bom_bytes_ < static_cast<int>(sizeof(kUtfBom))) {
+      return true;
+    }
+    in_bom_ = false;
+  }
+
+  size_t line_start = 0;
+  for (size_t i = FindLineEnd(chunk, 0); i < chunk.size();
+       i = FindLineEnd(chunk, i + 1)) {
+    const unsigned char ch = static_cast<unsigned char>(chunk[i]);
+    // The LF of a CRLF can come at the start of the next chunk.
+    const bool is_CRLF_continuation = i == line_start && line_length_ == 0 &&
+                                      last_was_carriage_return_ && ch == 0x0A;
+    if (!is_CRLF_continuation) {
+      EmitLine(chunk.substr(line_start, i - line_start));
+      if (stopped_) return false;
+    }
+    line_start = i + 1;
+    last_was_carriage_return_ = (ch == 0x0D);
+  }
+
+  // The start of a line that ends in a later chunk.
+  const std::string_view rest = chunk.substr(line_start);
+  line_.append(rest.substr(0, kMaxLineLen - line_.size()));
+  line_length_ += rest.size();
+  return true;
+}
+
+void RobotsTxtStreamParser::Finish() {
+  ROBOTS_STATS_ONLY(PhaseTimer timer(&RobotsStats::parse_ns);)
+  Start();
+  // Like ParseRobotsTxt(), ends with the line after the last line ending, even
+  // if it is empty.
+  if (!stopped_) EmitLine(std::string_view());
+  handler_->HandleRobotsEnd();
+}
+
 RobotsMatcher::RobotsMatcher()
     : seen_global_agent_(false),
       seen_specific_agent_(false),
       ever_seen_specific_agent_(false),
       seen_separator_(false),
       best_specific_agent_length_(0),
-      path_(nullptr),
-      user_agents_(nullptr) {
-  match_strategy_ = new LongestMatchRobotsMatchStrategy();
-}
+      user_agents_(nullptr),
+      user_agent_views_(nullptr),
+      num_user_agent_views_(0),
+      match_strategy_(nullptr) {}
 
-RobotsMatcher::~RobotsMatcher() {
-  delete match_strategy_;
-}
+RobotsMatcher::~RobotsMatcher() = default;
 
 bool RobotsMatcher::ever_seen_specific_agent() const {
   return ever_seen_specific_agent_;
 }
 
 void RobotsMatcher::InitUserAgentsAndPath(
-    const std::vector<std::string>* user_agents, const char* path) {
+    const std::vector<std::string>* user_agents, std::string_view path) {
   // The RobotsParser object doesn't own path_ or user_agents_, so overwriting
   // these pointers doesn't cause a memory leak.
   path_ = path;
-  ROBOTS_ASSERT('/' == *path_);
+  ROBOTS_ASSERT(!path_.empty() && '/' == path_[0]);
   user_agents_ = user_agents;
+  user_agent_views_ = nullptr;
+  num_user_agent_views_ = 0;
+  best_specific_agent_length_ = 0;
+}
+
+void RobotsMatcher::InitUserAgentsAndPath(const std::string_view* user_agents,
+                                          size_t num_user_agents,
+                                          std::string_view path) {
+  path_ = path;
+  ROBOTS_ASSERT(!path_.empty() && '/' == path_[0]);
+  user_agents_ = nullptr;
+  user_agent_views_ = user_agents;
+  num_user_agent_views_ = num_user_agents;
   best_specific_agent_length_ = 0;
 }
 
 bool RobotsMatcher::AllowedByRobots(std::string_view robots_body,
                                     const std::vector<std::string>* user_agents,
-                                    const std::string& url) {
+                                    std::string_view url) {
   // The url is not normalized (escaped, percent encoded) here because the user
   // is asked to provide it in escaped form already.
-  std::string path = GetPathParamsQuery(url);
-  InitUserAgentsAndPath(user_agents, path.c_str());
-  ParseRobotsTxt(robots_body, this);
+  InitUserAgentsAndPath(user_agents,
+                        GetMatchPath(url, url_mode_, &path_buffer_));
+  Parse(robots_body);
+  return !disallow();
+}
+
+bool RobotsMatcher::AllowedByRobots(std::string_view robots_body,
+                                    const std::string_view* user_agents,
+                                    size_t num_user_agents,
+                                    std::string_view url) {
+  InitUserAgentsAndPath(user_agents, num_user_agents,
+                        GetMatchPath(url, url_mode_, &path_buffer_));
+  Parse(robots_body);
   return !disallow();
 }
 
+// Forwards the parser callbacks to the handlers of RobotsMatcher itself, with
+// qualified and so non-virtual calls that the parser can inline.
+class RobotsMatcher::DirectHandler {
+ public:
+  explicit DirectHandler(RobotsMatcher* matcher) : matcher_(matcher) {}
+
+  void HandleRobotsStart() { matcher_->RobotsMatcher::HandleRobotsStart(); }
+  void HandleRobotsEnd() { matcher_->RobotsMatcher::HandleRobotsEnd(); }
+  void HandleUserAgent(int line_num, std::string_view value) {
+    matcher_->RobotsMatcher::HandleUserAgent(line_num, value);
+  }
+  void HandleAllow(int line_num, std::string_view value) {
+    matcher_->RobotsMatcher::HandleAllow(line_num, value);
+  }
+  void HandleDisallow(int line_num, std::string_view value) {
+    matcher_->RobotsMatcher::HandleDisallow(line_num, value);
+  }
+  void HandleSitemap(int line_num, std::string_view value) {
+    matcher_->RobotsMatcher::HandleSitemap(line_num, value);
+  }
+  void HandleCrawlDelay(int line_num, double value) {
+    matcher_->RobotsMatcher::HandleCrawlDelay(line_num, value);
+  }
+  void HandleRequestRate(int line_num, const RequestRate& rate) {
+    matcher_->RobotsMatcher::HandleRequestRate(line_num, rate);
+  }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleContentSignal(int line_num, const ContentSignal& signal) {
+    matcher_->RobotsMatcher::HandleContentSignal(line_num, signal);
+  }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleUnknownAction(int line_num, std::string_view action,
+                           std::string_view value) {
+    matcher_->RobotsMatcher::HandleUnknownAction(line_num, action, value);
+  }
+  // RobotsMatcher doesn't override these.
+  void ReportLineMetadata(int line_num,
+                          const RobotsParseHandler::LineMetadata& metadata) {}
+  bool CanStopParsing() const { return false; }
+  bool CanSkipToNextUserAgent() const {
+    return matcher_->RobotsMatcher::CanSkipToNextUserAgent();
+  }
+
+ private:
+  RobotsMatcher* const matcher_;
+};
+
+void RobotsMatcher::Parse(std::string_view robots_body) {
+#if defined(__GXX_RTTI) || defined(_CPPRTTI)
+  // Subclasses may override the callbacks, only a RobotsMatcher itself can
+  // skip the virtual calls.
+  if (typeid(*this) == typeid(RobotsMatcher)) {
+    DirectHandler handler(this);
+    RobotsTxtParser<DirectHandler>(robots_body, &handler).Parse();
+    return;
+  }
+#endif
+  RobotsTxtParser<RobotsParseHandler>(robots_body, this).Parse();
+}
+
 bool RobotsMatcher::OneAgentAllowedByRobots(std::string_view robots_txt,
-                                            const std::string& user_agent,
-                                            const std::string& url) {
-  std::vector<std::string> v;
-  v.push_back(user_agent);
-  return AllowedByRobots(robots_txt, &v, url);
+                                            std::string_view user_agent,
+                                            std::string_view url) {
+  return AllowedByRobots(robots_txt, &user_agent, 1, url);
 }
 
 bool RobotsMatcher::disallow() const {
+  if (budget_exceeded_) return !match_budget_.allow_on_exceeded;
   if (allow_.specific.priority() > 0 || disallow_.specific.priority() > 0) {
     return (disallow_.specific.priority() > allow_.specific.priority());
   }
@@ -1365,6 +3226,7 @@ bool RobotsMatcher::disallow() const {
 }
 
 bool RobotsMatcher::disallow_ignore_global() const {
+  if (budget_exceeded_) return !match_budget_.allow_on_exceeded;
   if (allow_.specific.priority() > 0 || disallow_.specific.priority() > 0) {
     return disallow_.specific.priority() > allow_.specific.priority();
   }
@@ -1372,6 +3234,7 @@ bool RobotsMatcher::disallow_ignore_global() const {
 }
 
 int RobotsMatcher::matching_line() const {
+  if (budget_exceeded_) return 0;
   if (ever_seen_specific_agent_) {
     return Match::HigherPriorityMatch(disallow_.specific, allow_.specific)
         .line();
@@ -1392,6 +3255,9 @@ void RobotsMatcher::HandleRobotsStart() {
   ever_seen_specific_agent_ = false;
   seen_separator_ = false;
 
+  budget_steps_left_ = match_budget_.max_steps;
+  budget_exceeded_ = false;
+
   crawl_delay_global_.reset();
   crawl_delay_specific_.reset();
   request_rate_global_.reset();
@@ -1400,16 +3266,33 @@ void RobotsMatcher::HandleRobotsStart() {
   content_signal_global_.reset();
   content_signal_specific_.reset();
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  sitemaps_.clear();
 }
 
 /*static*/ std::string_view RobotsMatcher::ExtractUserAgent(
     std::string_view user_agent) {
   // Allowed characters in user-agent are [a-zA-Z_-].
-  const char* end = user_agent.data();
-  while (AsciiIsAlpha(*end) || *end == '-' || *end == '_') {
+  size_t end = 0;
+  while (end < user_agent.size() &&
+         (AsciiIsAlpha(user_agent[end]) || user_agent[end] == '-' ||
+          user_agent[end] == '_')) {
     ++end;
   }
-  return user_agent.substr(0, end - user_agent.data());
+  return user_agent.substr(0, end);
+}
+
+bool RobotsMatcher::IsQueriedAgent(std::string_view user_agent) const {
+  if (user_agents_ != nullptr) {
+    for (const auto& agent : *user_agents_) {
+      if (EqualsIgnoreCase(user_agent, agent)) return true;
+    }
+    return false;
+  }
+  for (size_t i = 0; i < num_user_agent_views_; ++i) {
+    if (EqualsIgnoreCase(user_agent, user_agent_views_[i])) return true;
+  }
+  return false;
 }
 
 /*static*/ bool RobotsMatcher::IsValidUserAgentToObey(
@@ -1430,29 +3313,26 @@ void RobotsMatcher::HandleUserAgent(int line_num,
     seen_global_agent_ = true;
   } else {
     user_agent = ExtractUserAgent(user_agent);
-    for (const auto& agent : *user_agents_) {
-      if (EqualsIgnoreCase(user_agent, agent)) {        
-        // Implement "most specific user-agent wins" rule per Google's docs:
-        // https://developers.google.com/search/reference/robots_txt#order-of-precedence-for-user-agents
-        
-        // A longer matching user-agent string is more specific.
-        
-        if (user_agent.length() > best_specific_agent_length_) {
-          // Found a more specific match - reset previous specific rules.
-          best_specific_agent_length_ = user_agent.length();
-          allow_.specific.Clear();
-          disallow_.specific.Clear();
-          ever_seen_specific_agent_ = seen_specific_agent_ = true;
-        
-        } else if (user_agent.length() == best_specific_agent_length_) {
-          // Same specificity - allow this group to contribute rules.
-          ever_seen_specific_agent_ = seen_specific_agent_ = true;
-        }
-        
-        // If user_agent.length() < best_specific_agent_length_, we ignore
-        // this less specific group by not setting seen_specific_agent_.
-        break;
+    if (IsQueriedAgent(user_agent)) {
+      // Implement "most specific user-agent wins" rule per Google's docs:
+      // https://developers.google.com/search/reference/robots_txt#order-of-precedence-for-user-agents
+
+      // A longer matching user-agent string is more specific.
+
+      if (user_agent.length() > best_specific_agent_length_) {
+        // Found a more specific match - reset previous specific rules.
+        best_specific_agent_length_ = user_agent.length();
+        allow_.specific.Clear();
+        disallow_.specific.Clear();
+        ever_seen_specific_agent_ = seen_specific_agent_ = true;
+
+      } else if (user_agent.length() == best_specific_agent_length_) {
+        // Same specificity - allow this group to contribute rules.
+        ever_seen_specific_agent_ = seen_specific_agent_ = true;
       }
+
+      // If user_agent.length() < best_specific_agent_length_, we ignore
+      // this less specific group by not setting seen_specific_agent_.
     }
   }
 }
@@ -1460,7 +3340,15 @@ void RobotsMatcher::HandleUserAgent(int line_num,
 void RobotsMatcher::HandleAllow(int line_num, std::string_view value) {
   if (!seen_any_agent()) return;
   seen_separator_ = true;
-  const int priority = match_strategy_->MatchAllow(path_, value);
+  // The global rules are not used once a group for the queried agents was
+  // seen, see disallow().
+  if (!seen_specific_agent_ && ever_seen_specific_agent_) return;
+  const int priority =
+      match_strategy_ == nullptr
+          ? LongestMatchRobotsMatchStrategy::Priority(
+                path_, value, match_budget_, &budget_steps_left_,
+                &budget_exceeded_)
+          : match_strategy_->MatchAllow(path_, value);
   if (priority >= 0) {
     if (seen_specific_agent_) {
       if (allow_.specific.priority() < priority) {
@@ -1472,7 +3360,7 @@ void RobotsMatcher::HandleAllow(int line_num, std::string_view value) {
         allow_.global.Set(priority, line_num);
       }
     }
-  } else {
+  } else if constexpr (kNormalizeIndexHtml) {
     // Google-specific optimization: 'index.htm' and 'index.html' are normalized
     // to '/'.
     const size_t slash_pos = value.find_last_of('/');
@@ -1492,7 +3380,13 @@ void RobotsMatcher::HandleAllow(int line_num, std::string_view value) {
 void RobotsMatcher::HandleDisallow(int line_num, std::string_view value) {
   if (!seen_any_agent()) return;
   seen_separator_ = true;
-  const int priority = match_strategy_->MatchDisallow(path_, value);
+  if (!seen_specific_agent_ && ever_seen_specific_agent_) return;
+  const int priority =
+      match_strategy_ == nullptr
+          ? LongestMatchRobotsMatchStrategy::Priority(
+                path_, value, match_budget_, &budget_steps_left_,
+                &budget_exceeded_)
+          : match_strategy_->MatchDisallow(path_, value);
   if (priority >= 0) {
     if (seen_specific_agent_) {
       if (disallow_.specific.priority() < priority) {
@@ -1507,18 +3401,11 @@ void RobotsMatcher::HandleDisallow(int line_num, std::string_view value) {
   }
 }
 
-int LongestMatchRobotsMatchStrategy::MatchAllow(std::string_view path,
-                                                std::string_view pattern) {
-  return Matches(path, pattern) ? pattern.length() : -1;
-}
-
-int LongestMatchRobotsMatchStrategy::MatchDisallow(std::string_view path,
-                                                   std::string_view pattern) {
-  return Matches(path, pattern) ? pattern.length() : -1;
+void RobotsMatcher::HandleSitemap(int line_num, std::string_view value) {
+  // Sitemap lines are not part of any group.
+  if (collect_sitemaps_ && !value.empty()) sitemaps_.push_back(value);
 }
 
-void RobotsMatcher::HandleSitemap(int line_num, std::string_view value) {}
-
 void RobotsMatcher::HandleCrawlDelay(int line_num, double value) {
   if (!seen_any_agent()) return;
   // Store crawl-delay for the current user-agent group.
@@ -1594,75 +3481,1916 @@ std::optional<ContentSignal> RobotsMatcher::GetContentSignal() const {
 void RobotsMatcher::HandleUnknownAction(int line_num, std::string_view action,
                                         std::string_view value) {}
 
-void ParsedRobotsKey::Parse(std::string_view key, bool* is_acceptable_typo) {
-  key_text_ = std::string_view();
-  if (KeyIsUserAgent(key, is_acceptable_typo)) {
-    type_ = USER_AGENT;
-  } else if (KeyIsAllow(key, is_acceptable_typo)) {
-    type_ = ALLOW;
-  } else if (KeyIsDisallow(key, is_acceptable_typo)) {
-    type_ = DISALLOW;
-  } else if (KeyIsSitemap(key, is_acceptable_typo)) {
-    type_ = SITEMAP;
-  } else if (KeyIsCrawlDelay(key, is_acceptable_typo)) {
-    type_ = CRAWL_DELAY;
-  } else if (KeyIsRequestRate(key, is_acceptable_typo)) {
-    type_ = REQUEST_RATE;
-#if ROBOTS_SUPPORT_CONTENT_SIGNAL
-  } else if (KeyIsContentSignal(key, is_acceptable_typo)) {
-    type_ = CONTENT_SIGNAL;
-#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
-  } else {
-    type_ = UNKNOWN;
-    key_text_ = key;
-  }
+bool RobotsMatcher::CanSkipToNextUserAgent() const {
+  // Outside of a group for the queried agents or '*' all of the callbacks
+  // above return right away.
+  return skip_other_groups_ && !seen_any_agent();
 }
 
-std::string_view ParsedRobotsKey::GetUnknownText() const {
-  ROBOTS_ASSERT(type_ == UNKNOWN && !key_text_.empty());
-  return key_text_;
-}
+// Collects the groups of a robots.txt into the tables of a CompiledRobots.
+//
+// RobotsMatcher starts a new group at a user-agent line that follows an
+// Allow/Disallow line. It does so only when the previous group applied to the
+// queried agents, but for any other group the reset is a no-op, so the group
+// boundaries do not depend on the query and can be computed up front.
+class CompiledRobots::Builder final : public RobotsParseHandler {
+ public:
+  Builder() = default;
 
-bool ParsedRobotsKey::KeyIsUserAgent(std::string_view key,
-                                     bool* is_acceptable_typo) {
-  *is_acceptable_typo =
-      (kAllowFrequentTypos && (StartsWithIgnoreCase(key, "useragent") ||
-                               StartsWithIgnoreCase(key, "user agent")));
-  return (StartsWithIgnoreCase(key, "user-agent") || *is_acceptable_typo);
-}
+  void HandleRobotsStart() override {}
+  void HandleRobotsEnd() override {}
 
-bool ParsedRobotsKey::KeyIsAllow(std::string_view key,
-                                 bool* is_acceptable_typo) {
-  // We don't support typos for the "allow" key.
-  *is_acceptable_typo = false;
-  return StartsWithIgnoreCase(key, "allow");
-}
+  void HandleUserAgent(int line_num, std::string_view user_agent) override {
+    if (!in_group_ || group_has_rules_) {
+      CompiledRobots::Group group;
+      group.first_agent = agents_.size();
+      group.num_agents = 0;
+      group.first_rule = rules_.size();
+      group.num_rules = 0;
+      group.first_extension = extensions_.size();
+      group.num_extensions = 0;
+      groups_.push_back(group);
+      in_group_ = true;
+      group_has_rules_ = false;
+    }
+    CompiledRobots::Agent agent = {};
+    // Same test for a global rule as in RobotsMatcher::HandleUserAgent().
+    agent.is_global = user_agent.length() >= 1 && user_agent[0] == '*' &&
+                      (user_agent.length() == 1 || isspace(user_agent[1]));
+    user_agent = agent.is_global ? std::string_view()
+                                 : RobotsMatcher::ExtractUserAgent(user_agent);
+    agent.offset = AddString(user_agent);
+    agent.length = user_agent.length();
+    agents_.push_back(agent);
+    ++groups_.back().num_agents;
+  }
 
-bool ParsedRobotsKey::KeyIsDisallow(std::string_view key,
-                                    bool* is_acceptable_typo) {
-  *is_acceptable_typo =
-      (kAllowFrequentTypos && ((StartsWithIgnoreCase(key, "dissallow")) ||
-                               (StartsWithIgnoreCase(key, "dissalow")) ||
-                               (StartsWithIgnoreCase(key, "disalow")) ||
-                               (StartsWithIgnoreCase(key, "diasllow")) ||
-                               (StartsWithIgnoreCase(key, "disallaw"))));
-  return (StartsWithIgnoreCase(key, "disallow") || *is_acceptable_typo);
-}
+  void HandleAllow(int line_num, std::string_view value) override {
+    if (!in_group_) return;
+    AddRule(line_num, value, true);
+    // Google-specific optimization: 'index.htm' and 'index.html' are
+    // normalized to '/'. RobotsMatcher only tries the normalized pattern if the
+    // original one does not match, but the normalized pattern is always
+    // shorter, so evaluating both and keeping the longest match is equivalent.
+    if constexpr (kNormalizeIndexHtml) {
+      const size_t slash_pos = value.find_last_of('/');
+      if (slash_pos != std::string_view::npos &&
+          StartsWith(value.substr(slash_pos), "/index.htm")) {
+        std::string pattern(value.substr(0, slash_pos + 1));
+        pattern += '$';
+        AddRule(line_num, pattern, true);
+      }
+    }
+  }
+
+  void HandleDisallow(int line_num, std::string_view value) override {
+    if (!in_group_) return;
+    AddRule(line_num, value, false);
+  }
+
+  void HandleSitemap(int line_num, std::string_view value) override {
+    if (value.empty()) return;
+    Sitemap& sitemap = sitemaps_.emplace_back();
+    sitemap.offset = AddString(value);
+    sitemap.length = value.length();
+  }
+
+  void HandleCrawlDelay(int line_num, double value) override {
+    if (!in_group_) return;
+    AddExtension(Extension::kCrawlDelay)->crawl_delay = value;
+  }
+
+  void HandleRequestRate(int line_num, const RequestRate& rate) override {
+    if (!in_group_) return;
+    Extension* extension = AddExtension(Extension::kRequestRate);
+    extension->requests = rate.requests;
+    extension->seconds = rate.seconds;
+  }
+
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleContentSignal(int line_num, const ContentSignal& signal) override {
+    if (!in_group_) return;
+    Extension* extension = AddExtension(Extension::kContentSignal);
+    extension->ai_train = EncodeSignal(signal.ai_train);
+    extension->ai_input = EncodeSignal(signal.ai_input);
+    extension->search = EncodeSignal(signal.search);
+  }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  void HandleUnknownAction(int line_num, std::string_view action,
+                           std::string_view value) override {}
+
+  // Lays out the tables as an image in 'buffer', recording 'body_digest' as
+  // the digest of the body they were built from.
+  void Finish(const BodyDigest& body_digest,
+              std::vector<uint64_t>* buffer) const;
+
+ private:
+  uint32_t AddString(std::string_view s) {
+    const uint32_t offset = strings_.size();
+    strings_.append(s.data(), s.size());
+    return offset;
+  }
+
+  void AddRule(int line_num, std::string_view pattern, bool is_allow) {
+    Rule& rule = rules_.emplace_back();
+    rule.offset = AddString(pattern);
+    rule.length = pattern.length();
+    rule.line = line_num;
+    rule.prefix_length = pattern.size();
+    rule.wildcards = 0;
+    rule.flags = is_allow ? kRuleAllow : 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+      if (pattern[i] == '*') {
+        ++rule.wildcards;
+        rule.flags |= kRuleWildcard;
+      } else if (kDecodePercentEscapes && pattern[i] == '%') {
+        rule.flags |= kRulePercent;
+      } else if (pattern[i] != '$' || i + 1 < pattern.size()) {
+        continue;
+      } else {
+        rule.flags |= kRuleAnchored;
+      }
+      if (rule.prefix_length == pattern.size()) rule.prefix_length = i;
+    }
+    if (rule.prefix_length >= 2) rule.flags |= kRuleKeyed;
+    rule.key = rule.prefix_length >= 2 ? pattern[1] : 0;
+    ++groups_.back().num_rules;
+    group_has_rules_ = true;
+  }
+
+  Extension* AddExtension(Extension::Kind kind) {
+    Extension& extension = extensions_.emplace_back();
+    extension = {};
+    extension.kind = kind;
+    extension.ai_train = extension.ai_input = extension.search = -1;
+    extension.agents_before = groups_.back().num_agents;
+    ++groups_.back().num_extensions;
+    return &extension;
+  }
+
+  static int8_t EncodeSignal(const std::optional<bool>& value) {
+    return value.has_value() ? *value : -1;
+  }
+
+  std::string strings_;
+  // An entry of each of the rule arrays of the image, which Finish() splits
+  // into the arrays. See CompiledRobots::RuleFlags.
+  struct Rule {
+    uint32_t offset;
+    uint32_t length;
+    int32_t line;
+    uint32_t prefix_length;
+    uint32_t wildcards;
+    uint8_t key;
+    uint8_t flags;
+  };
+
+  std::vector<Agent> agents_;
+  std::vector<Rule> rules_;
+  std::vector<Extension> extensions_;
+  std::vector<Group> groups_;
+  std::vector<Sitemap> sitemaps_;
+  bool in_group_ = false;         // True once the first user-agent was seen.
+  bool group_has_rules_ = false;  // True if the current group has rules.
+};
+
+// The image starts with this header. Each table is stored at an 8-byte aligned
+// offset from the start of the image, in the byte order of the machine that
+// built it.
+struct CompiledRobots::ImageHeader {
+  char magic[4];
+  uint32_t version;
+  BodyDigest body_digest;  // Of the body compiled into the image.
+  uint32_t byte_order;  // kByteOrderMark as written by the builder.
+  uint32_t switches;    // kImageSwitches of the builder.
+  uint32_t size;        // Of the whole image.
+  uint32_t num_groups;
+  uint32_t groups_offset;
+  uint32_t num_agents;
+  uint32_t agents_offset;
+  uint32_t num_rules;
+  uint32_t rule_offsets_offset;
+  uint32_t rule_lengths_offset;
+  uint32_t rule_lines_offset;
+  uint32_t rule_prefix_lengths_offset;
+  uint32_t rule_wildcards_offset;
+  uint32_t rule_keys_offset;
+  uint32_t rule_flags_offset;
+  uint32_t num_extensions;
+  uint32_t extensions_offset;
+  uint32_t num_sitemaps;
+  uint32_t sitemaps_offset;
+  uint32_t strings_size;
+  uint32_t strings_offset;
+  uint32_t padding;
+};
+
+namespace {
+// A path matched against the rules of a CompiledRobots, with what their
+// filters need to know about it.
+struct RulePath {
+  explicit RulePath(std::string_view p)
+      : path(p),
+        literal(!kDecodePercentEscapes ||
+                p.find('%') == std::string_view::npos) {}
+
+  std::string_view path;
+  // True if the path has no %-escape to decode. A rule can then only match if
+  // the path starts with the literal prefix of the rule, byte for byte.
+  bool literal;
+};
+
+#if ROBOTS_HAVE_NEON
+constexpr int kLaneBits = 4;  // Bits per byte of a narrowed NEON mask.
+#else
+constexpr int kLaneBits = 1;  // Bits per byte of a movemask.
+#endif
+}  // namespace
+
+struct CompiledRobots::Tables {
+  const Group* groups;
+  size_t num_groups;
+  const Agent* agents;
+  size_t num_rules;
+  const uint32_t* rule_offsets;
+  const uint32_t* rule_lengths;
+  const int32_t* rule_lines;
+  const uint32_t* rule_prefix_lengths;
+  const uint32_t* rule_wildcards;
+  const uint8_t* rule_keys;
+  const uint8_t* rule_flags;
+  const Extension* extensions;
+  const Sitemap* sitemaps;
+  size_t num_sitemaps;
+  const char* strings;
+
+  std::string_view pattern(uint32_t rule) const {
+    return std::string_view(strings + rule_offsets[rule], rule_lengths[rule]);
+  }
+
+  // Returns a mask with kLaneBits bits set for each of the 16 rules from
+  // 'first' that the key byte does not rule out for 'path', which must be
+  // literal.
+  uint64_t KeyCandidates16(uint32_t first, const RulePath& path) const {
+    const bool has_key = path.path.size() >= 2;
+    const uint8_t key = has_key ? path.path[1] : 0;
+#if ROBOTS_HAVE_SSE2
+    const __m128i keys =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(rule_keys + first));
+    const __m128i flags =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(rule_flags + first));
+    const __m128i keyed_bit = _mm_set1_epi8(static_cast<char>(kRuleKeyed));
+    const __m128i keyed =
+        _mm_cmpeq_epi8(_mm_and_si128(flags, keyed_bit), keyed_bit);
+    const __m128i same_key =
+        has_key ? _mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(key)))
+                : _mm_setzero_si128();
+    // Unkeyed rules, and keyed rules with the key of the path.
+    return _mm_movemask_epi8(
+        _mm_or_si128(same_key, _mm_andnot_si128(keyed, _mm_set1_epi8(-1))));
+#elif ROBOTS_HAVE_NEON
+    const uint8x16_t keys = vld1q_u8(rule_keys + first);
+    const uint8x16_t flags = vld1q_u8(rule_flags + first);
+    const uint8x16_t keyed = vtstq_u8(flags, vdupq_n_u8(kRuleKeyed));
+    const uint8x16_t same_key =
+        has_key ? vceqq_u8(keys, vdupq_n_u8(key)) : vdupq_n_u8(0);
+    const uint8x16_t candidates = vorrq_u8(same_key, vmvnq_u8(keyed));
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(
+                             vreinterpretq_u16_u8(candidates), 4)),
+                         0);
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 16; ++i) {
+      if (IsKeyCandidate(first + i, has_key, key)) mask |= uint64_t{1} << i;
+    }
+    return mask;
+#endif
+  }
+
+  bool IsKeyCandidate(uint32_t rule, bool has_key, uint8_t key) const {
+    return (rule_flags[rule] & kRuleKeyed) == 0 ||
+           (has_key && rule_keys[rule] == key);
+  }
+
+  // Calls f(rule) in order for the 'num_rules' rules from 'first' that can
+  // match 'path'. The key bytes of a group are compared 16 at a time, so most
+  // rules are ruled out without reading their pattern.
+  template <typename F>
+  void ForEachCandidate(uint32_t first, uint32_t count, const RulePath& path,
+                        F f) const {
+    uint32_t i = 0;
+    if (!path.literal) {
+      for (; i < count; ++i) f(first + i);
+      return;
+    }
+    constexpr uint64_t kLaneMask = (uint64_t{1} << kLaneBits) - 1;
+    for (; i + 16 <= count; i += 16) {
+      for (uint64_t mask = KeyCandidates16(first + i, path); mask != 0;) {
+        const int lane = CountTrailingZeros(mask) / kLaneBits;
+        mask &= ~(kLaneMask << (lane * kLaneBits));
+        f(first + i + lane);
+      }
+    }
+    const bool has_key = path.path.size() >= 2;
+    const uint8_t key = has_key ? path.path[1] : 0;
+    for (; i < count; ++i) {
+      if (IsKeyCandidate(first + i, has_key, key)) f(first + i);
+    }
+  }
+
+  // Same as LongestMatchRobotsMatchStrategy::Priority() for the pattern of
+  // 'rule'. Literal prefixes are compared first, and patterns that are only
+  // a literal prefix, possibly ending with '$', are not matched any further,
+  // so ruling them out costs no steps.
+  int Priority(uint32_t rule, const RulePath& path, uint64_t* steps_left,
+               bool* exceeded) const {
+    const std::string_view pattern = this->pattern(rule);
+    if (path.literal) {
+      const uint32_t prefix_length = rule_prefix_lengths[rule];
+      if (path.path.size() < prefix_length ||
+          std::memcmp(path.path.data(), pattern.data(), prefix_length) != 0) {
+        return -1;
+      }
+      if (prefix_length == pattern.size()) return prefix_length;
+      if ((rule_flags[rule] & (kRuleWildcard | kRulePercent)) == 0) {
+        // The prefix is followed by the final '$'.
+        return path.path.size() == prefix_length ? pattern.size() : -1;
+      }
+    }
+    return LongestMatchRobotsMatchStrategy::Priority(path.path, pattern,
+                                                     steps_left, exceeded);
+  }
+};
+
+namespace {
+constexpr char kImageMagic[4] = {'R', 'B', 'T', 'C'};
+constexpr char kPackMagic[4] = {'R', 'B', 'T', 'P'};
+// Reads as 0x01020304 only in the byte order it was written in.
+constexpr uint32_t kByteOrderMark = 0x01020304;
+// The matching switches the tables of an image depend on: the directives and
+// rules the parser kept, and the prefix lengths and flags of the rules.
+constexpr uint32_t kImageSwitches =
+    (kAllowFrequentTypos ? 1 << 0 : 0) | (kDecodePercentEscapes ? 1 << 1 : 0) |
+    (kNormalizeIndexHtml ? 1 << 2 : 0) |
+    (kSupportNonStandardDirectives ? 1 << 3 : 0) |
+    (ROBOTS_SUPPORT_CONTENT_SIGNAL ? 1 << 4 : 0);
+
+constexpr size_t AlignTo8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+bool IsAligned8(const void* p) {
+  return reinterpret_cast<uintptr_t>(p) % alignof(uint64_t) == 0;
+}
+
+// True if 'count' records of 'record_size' bytes at 'offset' are aligned and
+// lie within 'size' bytes.
+bool TableFits(uint64_t offset, uint64_t count, uint64_t record_size,
+               uint64_t size) {
+  return offset % 8 == 0 && offset <= size &&
+         count <= (size - offset) / record_size;
+}
+
+// True if [first, first + count) is within [0, limit).
+bool RangeFits(uint64_t first, uint64_t count, uint64_t limit) {
+  return first <= limit && count <= limit - first;
+}
+
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+std::optional<bool> DecodeSignal(int8_t value) {
+  if (value < 0) return std::nullopt;
+  return value != 0;
+}
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+}  // namespace
+
+void CompiledRobots::Builder::Finish(const BodyDigest& body_digest,
+                                     std::vector<uint64_t>* buffer) const {
+  // Everything a query reads is in the image, so its records must not depend
+  // on the compiler beyond byte order.
+  static_assert(sizeof(Agent) == 12, "Agent layout");
+  static_assert(sizeof(Extension) == 24, "Extension layout");
+  static_assert(sizeof(Group) == 24, "Group layout");
+  static_assert(sizeof(Sitemap) == 8, "Sitemap layout");
+  static_assert(sizeof(BodyDigest) == 32, "BodyDigest layout");
+  static_assert(sizeof(ImageHeader) == 128, "ImageHeader layout");
+  ImageHeader header = {};
+  std::memcpy(header.magic, kImageMagic, sizeof(header.magic));
+  header.version = kSerializedVersion;
+  header.body_digest = body_digest;
+  header.byte_order = kByteOrderMark;
+  header.switches = kImageSwitches;
+  size_t size = AlignTo8(sizeof(header));
+  auto place = [&size](size_t bytes) {
+    const uint32_t offset = size;
+    size = AlignTo8(size + bytes);
+    return offset;
+  };
+  header.num_groups = groups_.size();
+  header.groups_offset = place(groups_.size() * sizeof(Group));
+  header.num_agents = agents_.size();
+  header.agents_offset = place(agents_.size() * sizeof(Agent));
+  const size_t num_rules = rules_.size();
+  header.num_rules = num_rules;
+  header.rule_offsets_offset = place(num_rules * sizeof(uint32_t));
+  header.rule_lengths_offset = place(num_rules * sizeof(uint32_t));
+  header.rule_lines_offset = place(num_rules * sizeof(int32_t));
+  header.rule_prefix_lengths_offset = place(num_rules * sizeof(uint32_t));
+  header.rule_wildcards_offset = place(num_rules * sizeof(uint32_t));
+  header.rule_keys_offset = place(num_rules);
+  header.rule_flags_offset = place(num_rules);
+  header.num_extensions = extensions_.size();
+  header.extensions_offset = place(extensions_.size() * sizeof(Extension));
+  header.num_sitemaps = sitemaps_.size();
+  header.sitemaps_offset = place(sitemaps_.size() * sizeof(Sitemap));
+  header.strings_size = strings_.size();
+  header.strings_offset = place(strings_.size());
+  header.size = size;
+
+  buffer->assign(size / sizeof(uint64_t), 0);
+  char* const image = reinterpret_cast<char*>(buffer->data());
+  auto copy = [image](uint32_t offset, const void* data, size_t bytes) {
+    if (bytes > 0) std::memcpy(image + offset, data, bytes);
+  };
+  copy(0, &header, sizeof(header));
+  copy(header.groups_offset, groups_.data(), groups_.size() * sizeof(Group));
+  copy(header.agents_offset, agents_.data(), agents_.size() * sizeof(Agent));
+  auto array = [image](uint32_t offset, auto value) {
+    return reinterpret_cast<decltype(value)*>(image + offset);
+  };
+  uint32_t* const offsets = array(header.rule_offsets_offset, uint32_t{});
+  uint32_t* const lengths = array(header.rule_lengths_offset, uint32_t{});
+  int32_t* const lines = array(header.rule_lines_offset, int32_t{});
+  uint32_t* const prefix_lengths =
+      array(header.rule_prefix_lengths_offset, uint32_t{});
+  uint32_t* const wildcards = array(header.rule_wildcards_offset, uint32_t{});
+  uint8_t* const keys = array(header.rule_keys_offset, uint8_t{});
+  uint8_t* const flags = array(header.rule_flags_offset, uint8_t{});
+  for (size_t i = 0; i < num_rules; ++i) {
+    const Rule& rule = rules_[i];
+    offsets[i] = rule.offset;
+    lengths[i] = rule.length;
+    lines[i] = rule.line;
+    prefix_lengths[i] = rule.prefix_length;
+    wildcards[i] = rule.wildcards;
+    keys[i] = rule.key;
+    flags[i] = rule.flags;
+  }
+  copy(header.extensions_offset, extensions_.data(),
+       extensions_.size() * sizeof(Extension));
+  copy(header.sitemaps_offset, sitemaps_.data(),
+       sitemaps_.size() * sizeof(Sitemap));
+  copy(header.strings_offset, strings_.data(), strings_.size());
+}
+
+// Mirrors the match bookkeeping of RobotsMatcher for a single query. This is
+// the state RobotsMatcher keeps in member fields; CompiledRobots keeps it on
+// the stack of the querying thread instead, which makes queries reentrant.
+struct CompiledRobots::Evaluation {
+  RobotsMatcher::MatchHierarchy allow;
+  RobotsMatcher::MatchHierarchy disallow;
+  bool ever_seen_specific_agent = false;
+  size_t best_specific_agent_length = 0;
+
+  std::optional<double> crawl_delay_global;
+  std::optional<double> crawl_delay_specific;
+  std::optional<RequestRate> request_rate_global;
+  std::optional<RequestRate> request_rate_specific;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  std::optional<ContentSignal> content_signal_global;
+  std::optional<ContentSignal> content_signal_specific;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+  // If set, Evaluate() without a path collects the indexes of the rules that
+  // would be matched against the specific and global agent scores. Specific
+  // rules are dropped when a more specific user-agent is found, just like the
+  // matches in 'allow' and 'disallow'.
+  std::vector<uint32_t>* specific_rules = nullptr;
+  std::vector<uint32_t>* global_rules = nullptr;
+
+  // Limits of an Evaluate() with a path, like RobotsMatcher::match_budget_.
+  MatchBudget budget;
+  uint64_t budget_steps_left = std::numeric_limits<uint64_t>::max();
+  bool budget_exceeded = false;
+
+  // Stores the value of 'e' for the specific or the global agent, first value
+  // wins, like RobotsMatcher::HandleCrawlDelay() and friends.
+  void ApplyExtension(const Extension& e, bool specific) {
+    switch (e.kind) {
+      case Extension::kCrawlDelay: {
+        auto& delay = specific ? crawl_delay_specific : crawl_delay_global;
+        if (!delay.has_value()) delay = e.crawl_delay;
+        break;
+      }
+      case Extension::kRequestRate: {
+        auto& rate = specific ? request_rate_specific : request_rate_global;
+        if (!rate.has_value()) {
+          rate.emplace();
+          rate->requests = e.requests;
+          rate->seconds = e.seconds;
+        }
+        break;
+      }
+      case Extension::kContentSignal: {
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+        auto& signal =
+            specific ? content_signal_specific : content_signal_global;
+        if (!signal.has_value()) {
+          signal.emplace();
+          signal->ai_train = DecodeSignal(e.ai_train);
+          signal->ai_input = DecodeSignal(e.ai_input);
+          signal->search = DecodeSignal(e.search);
+        }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+        break;
+      }
+    }
+  }
+
+  // Same as RobotsMatcher::disallow().
+  bool Disallow() const {
+    if (allow.specific.priority() > 0 || disallow.specific.priority() > 0) {
+      return disallow.specific.priority() > allow.specific.priority();
+    }
+    if (ever_seen_specific_agent) return false;
+    if (disallow.global.priority() > 0 || allow.global.priority() > 0) {
+      return disallow.global.priority() > allow.global.priority();
+    }
+    return false;
+  }
+
+  // Same as RobotsMatcher::matching_line().
+  int MatchingLine() const {
+    if (ever_seen_specific_agent) {
+      return RobotsMatcher::Match::HigherPriorityMatch(disallow.specific,
+                                                       allow.specific)
+          .line();
+    }
+    return RobotsMatcher::Match::HigherPriorityMatch(disallow.global,
+                                                     allow.global)
+        .line();
+  }
+};
+
+CompiledRobots::CompiledRobots(std::string_view robots_body)
+    : CompiledRobots(robots_body, DigestBody(robots_body)) {}
+
+CompiledRobots::CompiledRobots(std::string_view robots_body,
+                               const BodyDigest& digest) {
+  Builder builder;
+  RobotsTxtParser<Builder>(robots_body, &builder).Parse();
+  // Sized exactly, instances are often kept around in large numbers, e.g. in
+  // a RobotsCache.
+  builder.Finish(digest, &buffer_);
+  image_ = std::string_view(reinterpret_cast<const char*>(buffer_.data()),
+                            buffer_.size() * sizeof(uint64_t));
+}
+
+CompiledRobots::CompiledRobots(const CompiledRobots& other)
+    : buffer_(other.buffer_), image_(other.image_) {
+  if (!buffer_.empty()) {
+    image_ = std::string_view(reinterpret_cast<const char*>(buffer_.data()),
+                              image_.size());
+  }
+}
+
+CompiledRobots& CompiledRobots::operator=(const CompiledRobots& other) {
+  if (this != &other) *this = CompiledRobots(other);
+  return *this;
+}
+
+// Moving a vector keeps its storage, so image_ stays valid.
+CompiledRobots::CompiledRobots(CompiledRobots&& other) noexcept
+    : buffer_(std::move(other.buffer_)), image_(other.image_) {
+  other.image_ = std::string_view();
+}
+
+CompiledRobots& CompiledRobots::operator=(CompiledRobots&& other) noexcept {
+  buffer_ = std::move(other.buffer_);
+  image_ = other.image_;
+  if (this != &other) other.image_ = std::string_view();
+  return *this;
+}
+
+/* static */ std::optional<CompiledRobots> CompiledRobots::FromSerialized(
+    std::string_view image) {
+  if (!IsAligned8(image.data()) || image.size() < sizeof(ImageHeader)) {
+    return std::nullopt;
+  }
+  const ImageHeader& header =
+      *reinterpret_cast<const ImageHeader*>(image.data());
+  const uint64_t size = image.size();
+  if (std::memcmp(header.magic, kImageMagic, sizeof(header.magic)) != 0 ||
+      header.version != kSerializedVersion ||
+      header.byte_order != kByteOrderMark ||
+      header.switches != kImageSwitches || header.size != size ||
+      !TableFits(header.groups_offset, header.num_groups, sizeof(Group),
+                 size) ||
+      !TableFits(header.agents_offset, header.num_agents, sizeof(Agent),
+                 size) ||
+      !TableFits(header.rule_offsets_offset, header.num_rules,
+                 sizeof(uint32_t), size) ||
+      !TableFits(header.rule_lengths_offset, header.num_rules,
+                 sizeof(uint32_t), size) ||
+      !TableFits(header.rule_lines_offset, header.num_rules, sizeof(int32_t),
+                 size) ||
+      !TableFits(header.rule_prefix_lengths_offset, header.num_rules,
+                 sizeof(uint32_t), size) ||
+      !TableFits(header.rule_wildcards_offset, header.num_rules,
+                 sizeof(uint32_t), size) ||
+      !TableFits(header.rule_keys_offset, header.num_rules, 1, size) ||
+      !TableFits(header.rule_flags_offset, header.num_rules, 1, size) ||
+      !TableFits(header.extensions_offset, header.num_extensions,
+                 sizeof(Extension), size) ||
+      !TableFits(header.sitemaps_offset, header.num_sitemaps, sizeof(Sitemap),
+                 size) ||
+      !TableFits(header.strings_offset, header.strings_size, 1, size)) {
+    return std::nullopt;
+  }
+
+  CompiledRobots robots;
+  robots.image_ = image;
+  const Tables t = robots.GetTables();
+  for (size_t i = 0; i < t.num_groups; ++i) {
+    const Group& group = t.groups[i];
+    if (!RangeFits(group.first_agent, group.num_agents, header.num_agents) ||
+        !RangeFits(group.first_rule, group.num_rules, header.num_rules) ||
+        !RangeFits(group.first_extension, group.num_extensions,
+                   header.num_extensions)) {
+      return std::nullopt;
+    }
+  }
+  for (size_t i = 0; i < header.num_agents; ++i) {
+    if (!RangeFits(t.agents[i].offset, t.agents[i].length,
+                   header.strings_size)) {
+      return std::nullopt;
+    }
+  }
+  for (size_t i = 0; i < t.num_rules; ++i) {
+    if (!RangeFits(t.rule_offsets[i], t.rule_lengths[i],
+                   header.strings_size) ||
+        t.rule_prefix_lengths[i] > t.rule_lengths[i]) {
+      return std::nullopt;
+    }
+  }
+  for (size_t i = 0; i < header.num_extensions; ++i) {
+    if (t.extensions[i].kind > Extension::kContentSignal) return std::nullopt;
+  }
+  for (size_t i = 0; i < t.num_sitemaps; ++i) {
+    if (!RangeFits(t.sitemaps[i].offset, t.sitemaps[i].length,
+                   header.strings_size)) {
+      return std::nullopt;
+    }
+  }
+  return robots;
+}
+
+CompiledRobots::Tables CompiledRobots::GetTables() const {
+  const char* const image = image_.data();
+  const ImageHeader& header = *reinterpret_cast<const ImageHeader*>(image);
+  Tables t;
+  t.groups = reinterpret_cast<const Group*>(image + header.groups_offset);
+  t.num_groups = header.num_groups;
+  t.agents = reinterpret_cast<const Agent*>(image + header.agents_offset);
+  t.num_rules = header.num_rules;
+  t.rule_offsets =
+      reinterpret_cast<const uint32_t*>(image + header.rule_offsets_offset);
+  t.rule_lengths =
+      reinterpret_cast<const uint32_t*>(image + header.rule_lengths_offset);
+  t.rule_lines =
+      reinterpret_cast<const int32_t*>(image + header.rule_lines_offset);
+  t.rule_prefix_lengths = reinterpret_cast<const uint32_t*>(
+      image + header.rule_prefix_lengths_offset);
+  t.rule_wildcards =
+      reinterpret_cast<const uint32_t*>(image + header.rule_wildcards_offset);
+  t.rule_keys =
+      reinterpret_cast<const uint8_t*>(image + header.rule_keys_offset);
+  t.rule_flags =
+      reinterpret_cast<const uint8_t*>(image + header.rule_flags_offset);
+  t.extensions =
+      reinterpret_cast<const Extension*>(image + header.extensions_offset);
+  t.sitemaps =
+      reinterpret_cast<const Sitemap*>(image + header.sitemaps_offset);
+  t.num_sitemaps = header.num_sitemaps;
+  t.strings = image + header.strings_offset;
+  return t;
+}
+
+size_t CompiledRobots::num_groups() const { return GetTables().num_groups; }
+
+size_t CompiledRobots::num_rules() const { return GetTables().num_rules; }
+
+BodyDigest CompiledRobots::body_digest() const {
+  return reinterpret_cast<const ImageHeader*>(image_.data())->body_digest;
+}
+
+size_t CompiledRobots::num_sitemaps() const {
+  return GetTables().num_sitemaps;
+}
+
+std::string_view CompiledRobots::sitemap(size_t i) const {
+  const Tables t = GetTables();
+  return std::string_view(t.strings + t.sitemaps[i].offset,
+                          t.sitemaps[i].length);
+}
+
+bool CompiledRobots::AgentList::Contains(std::string_view name) const {
+  if (strings != nullptr) {
+    for (const auto& agent : *strings) {
+      if (EqualsIgnoreCase(name, agent)) return true;
+    }
+    return false;
+  }
+  for (size_t i = 0; i < num_views; ++i) {
+    if (EqualsIgnoreCase(name, views[i])) return true;
+  }
+  return false;
+}
+
+void CompiledRobots::Evaluate(const AgentList& user_agents,
+                              const std::string_view* path,
+                              Evaluation* eval) const {
+  const Tables t = GetTables();
+  const RulePath rule_path(path != nullptr ? *path : std::string_view());
+  const bool has_caps =
+      eval->budget.max_pattern_length != MatchBudget().max_pattern_length ||
+      eval->budget.max_wildcards != MatchBudget().max_wildcards;
+  for (const Group* group_it = t.groups; group_it != t.groups + t.num_groups;
+       ++group_it) {
+    const Group& group = *group_it;
+    bool seen_global_agent = false;
+    bool seen_specific_agent = false;
+    const Extension* extension = t.extensions + group.first_extension;
+    const Extension* const extensions_end = extension + group.num_extensions;
+
+    // Stores an extension value for the user-agent lines seen so far.
+    auto apply_extension = [&](const Extension& e) {
+      if (!seen_specific_agent && !seen_global_agent) return;
+      eval->ApplyExtension(e, seen_specific_agent);
+    };
+
+    for (uint32_t i = 0; i < group.num_agents; ++i) {
+      for (; extension != extensions_end && extension->agents_before == i;
+           ++extension) {
+        apply_extension(*extension);
+      }
+      const Agent& agent = t.agents[group.first_agent + i];
+      if (agent.is_global) {
+        seen_global_agent = true;
+        continue;
+      }
+      const std::string_view name(t.strings + agent.offset, agent.length);
+      if (!user_agents.Contains(name)) continue;
+      // "Most specific user-agent wins", see RobotsMatcher::HandleUserAgent().
+      if (name.length() > eval->best_specific_agent_length) {
+        eval->best_specific_agent_length = name.length();
+        eval->allow.specific.Clear();
+        eval->disallow.specific.Clear();
+        if (eval->specific_rules != nullptr) eval->specific_rules->clear();
+        eval->ever_seen_specific_agent = seen_specific_agent = true;
+      } else if (name.length() == eval->best_specific_agent_length) {
+        eval->ever_seen_specific_agent = seen_specific_agent = true;
+      }
+    }
+    for (; extension != extensions_end; ++extension) {
+      apply_extension(*extension);
+    }
+
+    if (!seen_specific_agent && !seen_global_agent) continue;
+    if (path == nullptr) {
+      std::vector<uint32_t>* collected =
+          seen_specific_agent ? eval->specific_rules : eval->global_rules;
+      if (collected == nullptr) continue;
+      for (uint32_t i = 0; i < group.num_rules; ++i) {
+        collected->push_back(group.first_rule + i);
+      }
+      continue;
+    }
+    // The global rules are not used once a group for the agents was seen,
+    // see RobotsMatcher::HandleAllow().
+    if (!seen_specific_agent && eval->ever_seen_specific_agent) continue;
+    if (eval->budget_exceeded) continue;
+    // The caps apply to every rule of the group, including those the filter
+    // rules out.
+    for (uint32_t i = 0; has_caps && i < group.num_rules; ++i) {
+      const uint32_t rule = group.first_rule + i;
+      if (t.rule_lengths[rule] > eval->budget.max_pattern_length ||
+          t.rule_wildcards[rule] > eval->budget.max_wildcards) {
+        eval->budget_exceeded = true;
+      }
+    }
+    if (eval->budget_exceeded) continue;
+    t.ForEachCandidate(
+        group.first_rule, group.num_rules, rule_path, [&](uint32_t rule) {
+          if (eval->budget_exceeded) return;
+          const int priority = t.Priority(rule, rule_path,
+                                          &eval->budget_steps_left,
+                                          &eval->budget_exceeded);
+          if (priority < 0) return;
+          RobotsMatcher::MatchHierarchy& hierarchy =
+              (t.rule_flags[rule] & kRuleAllow) ? eval->allow : eval->disallow;
+          RobotsMatcher::Match& match =
+              seen_specific_agent ? hierarchy.specific : hierarchy.global;
+          if (match.priority() < priority) {
+            match.Set(priority, t.rule_lines[rule]);
+          }
+        });
+  }
+}
+
+void CompiledRobots::EvaluateAgents(const std::string_view* user_agents,
+                                    size_t num_user_agents,
+                                    std::string_view path,
+                                    Evaluation* evals) const {
+  ROBOTS_ASSERT(num_user_agents <= kMaxAgentsPerPass);
+  // Bit i stands for user_agents[i].
+  const uint64_t all_agents =
+      num_user_agents == 64 ? ~uint64_t{0}
+                            : (uint64_t{1} << num_user_agents) - 1;
+  uint64_t ever_seen_specific = 0;
+  const Tables t = GetTables();
+  const RulePath rule_path(path);
+  for (const Group* group_it = t.groups; group_it != t.groups + t.num_groups;
+       ++group_it) {
+    const Group& group = *group_it;
+    bool seen_global_agent = false;
+    uint64_t seen_specific = 0;
+    const Extension* extension = t.extensions + group.first_extension;
+    const Extension* const extensions_end = extension + group.num_extensions;
+
+    // Same as in Evaluate(), for every agent.
+    auto apply_extension = [&](const Extension& e) {
+      for (size_t a = 0; a < num_user_agents; ++a) {
+        const bool specific = (seen_specific >> a) & 1;
+        if (specific || seen_global_agent) {
+          evals[a].ApplyExtension(e, specific);
+        }
+      }
+    };
+
+    for (uint32_t i = 0; i < group.num_agents; ++i) {
+      for (; extension != extensions_end && extension->agents_before == i;
+           ++extension) {
+        apply_extension(*extension);
+      }
+      const Agent& agent = t.agents[group.first_agent + i];
+      if (agent.is_global) {
+        seen_global_agent = true;
+        continue;
+      }
+      const std::string_view name(t.strings + agent.offset, agent.length);
+      for (size_t a = 0; a < num_user_agents; ++a) {
+        if (!EqualsIgnoreCase(name, user_agents[a])) continue;
+        Evaluation& eval = evals[a];
+        if (name.length() > eval.best_specific_agent_length) {
+          eval.best_specific_agent_length = name.length();
+          eval.allow.specific.Clear();
+          eval.disallow.specific.Clear();
+        } else if (name.length() < eval.best_specific_agent_length) {
+          continue;
+        }
+        eval.ever_seen_specific_agent = true;
+        seen_specific |= uint64_t{1} << a;
+      }
+    }
+    for (; extension != extensions_end; ++extension) {
+      apply_extension(*extension);
+    }
+    ever_seen_specific |= seen_specific;
+
+    // The agents this group is global for, except those that saw a group of
+    // their own, for which global rules no longer count.
+    const uint64_t global =
+        seen_global_agent ? all_agents & ~seen_specific & ~ever_seen_specific
+                          : 0;
+    if ((seen_specific | global) == 0) continue;
+    t.ForEachCandidate(
+        group.first_rule, group.num_rules, rule_path, [&](uint32_t rule) {
+          uint64_t steps_left = std::numeric_limits<uint64_t>::max();
+          bool exceeded = false;
+          const int priority =
+              t.Priority(rule, rule_path, &steps_left, &exceeded);
+          if (priority < 0) return;
+          const bool is_allow = t.rule_flags[rule] & kRuleAllow;
+          for (uint64_t agents = seen_specific | global; agents != 0;
+               agents &= agents - 1) {
+            const int a = CountTrailingZeros(agents);
+            RobotsMatcher::MatchHierarchy& hierarchy =
+                is_allow ? evals[a].allow : evals[a].disallow;
+            RobotsMatcher::Match& match = ((seen_specific >> a) & 1)
+                                              ? hierarchy.specific
+                                              : hierarchy.global;
+            if (match.priority() < priority) {
+              match.Set(priority, t.rule_lines[rule]);
+            }
+          }
+        });
+  }
+}
+
+void CompiledRobots::MatchAgents(const std::string_view* user_agents,
+                                 size_t num_user_agents, std::string_view url,
+                                 AgentVerdict* verdicts, UrlMode mode) const {
+  const std::string_view path = GetMatchPath(url, mode, ThreadPathBuffer());
+  ROBOTS_ASSERT('/' == path[0]);
+  // The state of a few agents stays on the stack; constructing the state of
+  // a full pass would cost more than a Match().
+  Evaluation stack_evals[4];
+  std::vector<Evaluation> heap_evals;
+  Evaluation* evals = stack_evals;
+  if (num_user_agents > 4) {
+    heap_evals.resize(std::min(kMaxAgentsPerPass, num_user_agents));
+    evals = heap_evals.data();
+  }
+  for (size_t first = 0; first < num_user_agents;
+       first += kMaxAgentsPerPass) {
+    const size_t n = std::min(kMaxAgentsPerPass, num_user_agents - first);
+    if (first > 0) std::fill(evals, evals + n, Evaluation());
+    EvaluateAgents(user_agents + first, n, path, evals);
+    for (size_t a = 0; a < n; ++a) {
+      const Evaluation& eval = evals[a];
+      AgentVerdict& verdict = verdicts[first + a];
+      verdict.match = MatchResult();
+      verdict.match.allowed = !eval.Disallow();
+      verdict.match.matching_line = eval.MatchingLine();
+      verdict.match.ever_seen_specific_agent = eval.ever_seen_specific_agent;
+      // Same as the Get*() methods.
+      const bool specific = eval.ever_seen_specific_agent;
+      verdict.crawl_delay = specific && eval.crawl_delay_specific.has_value()
+                                ? eval.crawl_delay_specific
+                                : eval.crawl_delay_global;
+      verdict.request_rate = specific && eval.request_rate_specific.has_value()
+                                 ? eval.request_rate_specific
+                                 : eval.request_rate_global;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+      verdict.content_signal =
+          specific && eval.content_signal_specific.has_value()
+              ? eval.content_signal_specific
+              : eval.content_signal_global;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+    }
+  }
+}
+
+CompiledRobots::MatchResult CompiledRobots::Match(
+    const std::vector<std::string>* user_agents, std::string_view url,
+    UrlMode mode) const {
+  return Match(user_agents, url, MatchBudget(), mode);
+}
+
+CompiledRobots::MatchResult CompiledRobots::Match(
+    const std::vector<std::string>* user_agents, std::string_view url,
+    const MatchBudget& budget, UrlMode mode) const {
+  return Match(AgentList(user_agents), url, budget, mode);
+}
+
+CompiledRobots::MatchResult CompiledRobots::Match(
+    const std::string_view* user_agents, size_t num_user_agents,
+    std::string_view url, UrlMode mode) const {
+  return Match(AgentList(user_agents, num_user_agents), url, MatchBudget(),
+               mode);
+}
+
+CompiledRobots::MatchResult CompiledRobots::Match(
+    const std::string_view* user_agents, size_t num_user_agents,
+    std::string_view url, const MatchBudget& budget, UrlMode mode) const {
+  return Match(AgentList(user_agents, num_user_agents), url, budget, mode);
+}
+
+CompiledRobots::MatchResult CompiledRobots::Match(const AgentList& user_agents,
+                                                  std::string_view url,
+                                                  const MatchBudget& budget,
+                                                  UrlMode mode) const {
+  // The url is not normalized (escaped, percent encoded) here because the user
+  // is asked to provide it in escaped form already.
+  const std::string_view path = GetMatchPath(url, mode, ThreadPathBuffer());
+  ROBOTS_ASSERT('/' == path[0]);
+  Evaluation eval;
+  eval.budget = budget;
+  eval.budget_steps_left = budget.max_steps;
+  Evaluate(user_agents, &path, &eval);
+  MatchResult result;
+  result.ever_seen_specific_agent = eval.ever_seen_specific_agent;
+  if (eval.budget_exceeded) {
+    result.allowed = budget.allow_on_exceeded;
+    result.budget_exceeded = true;
+    return result;
+  }
+  result.allowed = !eval.Disallow();
+  result.matching_line = eval.MatchingLine();
+  return result;
+}
+
+bool CompiledRobots::Allowed(const std::vector<std::string>* user_agents,
+                             std::string_view url, UrlMode mode) const {
+  return Match(user_agents, url, mode).allowed;
+}
+
+bool CompiledRobots::Allowed(const std::string_view* user_agents,
+                             size_t num_user_agents, std::string_view url,
+                             UrlMode mode) const {
+  return Match(user_agents, num_user_agents, url, mode).allowed;
+}
+
+bool CompiledRobots::OneAgentAllowed(std::string_view user_agent,
+                                     std::string_view url, UrlMode mode) const {
+  return Allowed(&user_agent, 1, url, mode);
+}
+
+void CompiledRobots::MatchBatch(const std::vector<std::string>* user_agents,
+                                const std::string* urls, size_t num_urls,
+                                MatchResult* results, UrlMode mode) const {
+  Resolve(user_agents).MatchBatch(urls, num_urls, results, mode);
+}
+
+void CompiledRobots::MatchBatch(const std::vector<std::string>* user_agents,
+                                const std::string_view* urls, size_t num_urls,
+                                MatchResult* results, UrlMode mode) const {
+  Resolve(user_agents).MatchBatch(urls, num_urls, results, mode);
+}
+
+void CompiledRobots::MatchBatch(const std::string_view* user_agents,
+                                size_t num_user_agents,
+                                const std::string_view* urls, size_t num_urls,
+                                MatchResult* results, UrlMode mode) const {
+  Resolve(user_agents, num_user_agents).MatchBatch(urls, num_urls, results,
+                                                   mode);
+}
+
+std::optional<double> CompiledRobots::GetCrawlDelay(
+    const std::vector<std::string>* user_agents) const {
+  Evaluation eval;
+  Evaluate(AgentList(user_agents), nullptr, &eval);
+  if (eval.ever_seen_specific_agent && eval.crawl_delay_specific.has_value()) {
+    return eval.crawl_delay_specific;
+  }
+  return eval.crawl_delay_global;
+}
+
+std::optional<RequestRate> CompiledRobots::GetRequestRate(
+    const std::vector<std::string>* user_agents) const {
+  Evaluation eval;
+  Evaluate(AgentList(user_agents), nullptr, &eval);
+  if (eval.ever_seen_specific_agent && eval.request_rate_specific.has_value()) {
+    return eval.request_rate_specific;
+  }
+  return eval.request_rate_global;
+}
+
+size_t CompiledRobots::MemoryUsage() const {
+  return sizeof(*this) + buffer_.capacity() * sizeof(uint64_t);
+}
+
+ResolvedRobots CompiledRobots::Resolve(
+    const std::vector<std::string>* user_agents) const {
+  return Resolve(user_agents, MatchBudget());
+}
+
+ResolvedRobots CompiledRobots::Resolve(
+    const std::vector<std::string>* user_agents,
+    const MatchBudget& budget) const {
+  return Resolve(AgentList(user_agents), budget);
+}
+
+ResolvedRobots CompiledRobots::Resolve(const std::string_view* user_agents,
+                                       size_t num_user_agents) const {
+  return Resolve(AgentList(user_agents, num_user_agents), MatchBudget());
+}
+
+ResolvedRobots CompiledRobots::Resolve(const std::string_view* user_agents,
+                                       size_t num_user_agents,
+                                       const MatchBudget& budget) const {
+  return Resolve(AgentList(user_agents, num_user_agents), budget);
+}
+
+ResolvedRobots CompiledRobots::Resolve(const AgentList& user_agents,
+                                       const MatchBudget& budget) const {
+  std::vector<uint32_t> specific_rules;
+  std::vector<uint32_t> global_rules;
+  Evaluation eval;
+  eval.specific_rules = &specific_rules;
+  eval.global_rules = &global_rules;
+  Evaluate(user_agents, nullptr, &eval);
+
+  ResolvedRobots resolved;
+  resolved.ever_seen_specific_agent_ = eval.ever_seen_specific_agent;
+  // Once a specific group was seen, RobotsMatcher::disallow() never looks at
+  // the global scores, so the global rules can be dropped. Otherwise there
+  // are no specific rules.
+  const std::vector<uint32_t>& selected =
+      eval.ever_seen_specific_agent ? specific_rules : global_rules;
+  const Tables t = GetTables();
+  resolved.rules_.reserve(selected.size());
+  for (const uint32_t index : selected) {
+    ResolvedRobots::Rule& resolved_rule = resolved.rules_.emplace_back();
+    resolved_rule.offset = resolved.strings_.size();
+    resolved_rule.length = t.rule_lengths[index];
+    resolved_rule.line = t.rule_lines[index];
+    resolved_rule.is_allow = t.rule_flags[index] & kRuleAllow;
+    resolved.strings_.append(t.pattern(index));
+    if (t.rule_lengths[index] > budget.max_pattern_length ||
+        t.rule_wildcards[index] > budget.max_wildcards) {
+      resolved.over_budget_ = true;
+    }
+  }
+  resolved.budget_ = budget;
+
+  const bool specific = eval.ever_seen_specific_agent;
+  resolved.crawl_delay_ = specific && eval.crawl_delay_specific.has_value()
+                              ? eval.crawl_delay_specific
+                              : eval.crawl_delay_global;
+  resolved.request_rate_ = specific && eval.request_rate_specific.has_value()
+                               ? eval.request_rate_specific
+                               : eval.request_rate_global;
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  resolved.content_signal_ =
+      specific && eval.content_signal_specific.has_value()
+          ? eval.content_signal_specific
+          : eval.content_signal_global;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  resolved.BuildIndex();
+  return resolved;
+}
+
+struct CompiledRobots::AgentGroup {
+  std::string_view user_agent;  // Points into the image, "*" for '*'.
+  uint32_t group;
+
+  // By agent, ignoring case, then by group.
+  bool operator<(const AgentGroup& other) const {
+    const int order = CompareIgnoreCase(user_agent, other.user_agent);
+    return order != 0 ? order < 0 : group < other.group;
+  }
+  bool operator==(const AgentGroup& other) const {
+    return group == other.group &&
+           EqualsIgnoreCase(user_agent, other.user_agent);
+  }
+};
+
+void CompiledRobots::CollectAgentGroups(std::vector<AgentGroup>* groups) const {
+  const Tables t = GetTables();
+  for (uint32_t g = 0; g < t.num_groups; ++g) {
+    const Group& group = t.groups[g];
+    for (uint32_t i = 0; i < group.num_agents; ++i) {
+      const Agent& agent = t.agents[group.first_agent + i];
+      groups->push_back(
+          {agent.is_global ? std::string_view("*")
+                           : std::string_view(t.strings + agent.offset,
+                                              agent.length),
+           g});
+    }
+  }
+  // A group applies once to an agent it names several times.
+  std::sort(groups->begin(), groups->end());
+  groups->erase(std::unique(groups->begin(), groups->end()), groups->end());
+}
+
+void CompiledRobots::SelectRules(const std::vector<std::string>& user_agents,
+                                 std::vector<uint32_t>* rules) const {
+  std::vector<uint32_t> specific_rules;
+  std::vector<uint32_t> global_rules;
+  Evaluation eval;
+  eval.specific_rules = &specific_rules;
+  eval.global_rules = &global_rules;
+  Evaluate(AgentList(&user_agents), nullptr, &eval);
+  const std::vector<uint32_t>& selected =
+      eval.ever_seen_specific_agent ? specific_rules : global_rules;
+  rules->insert(rules->end(), selected.begin(), selected.end());
+}
+
+namespace {
+// An Allow/Disallow rule as compared by CompiledRobots::Recompile().
+struct RuleView {
+  bool is_allow;
+  std::string_view pattern;
+  int line;
+
+  bool SameRule(const RuleView& other) const {
+    return is_allow == other.is_allow && pattern == other.pattern;
+  }
+  bool operator<(const RuleView& other) const {
+    return std::tie(is_allow, pattern, line) <
+           std::tie(other.is_allow, other.pattern, other.line);
+  }
+};
+
+// Drops the rules that 'a' and 'b' have in common at their start and end, and
+// sorts the rest. A refetched robots.txt mostly has the rules of the previous
+// one in the same order, which leaves little to sort.
+void TrimAndSortRules(std::vector<RuleView>* a, std::vector<RuleView>* b) {
+  size_t prefix = 0;
+  while (prefix < a->size() && prefix < b->size() &&
+         (*a)[prefix].SameRule((*b)[prefix])) {
+    ++prefix;
+  }
+  size_t suffix = 0;
+  while (suffix < a->size() - prefix && suffix < b->size() - prefix &&
+         (*a)[a->size() - 1 - suffix].SameRule((*b)[b->size() - 1 - suffix])) {
+    ++suffix;
+  }
+  for (std::vector<RuleView>* rules : {a, b}) {
+    rules->erase(rules->end() - suffix, rules->end());
+    rules->erase(rules->begin(), rules->begin() + prefix);
+    std::sort(rules->begin(), rules->end());
+  }
+}
+}  // namespace
+
+/* static */ CompiledRobots CompiledRobots::Recompile(
+    const CompiledRobots& previous, std::string_view robots_body,
+    Diff* diff) {
+  const BodyDigest digest = DigestBody(robots_body);
+  if (digest == previous.body_digest()) {
+    if (diff != nullptr) {
+      *diff = Diff();
+      diff->identical = true;
+    }
+    return previous;
+  }
+  CompiledRobots robots(robots_body, digest);
+  if (diff == nullptr) return robots;
+  *diff = Diff();
+
+  std::vector<AgentGroup> before;
+  std::vector<AgentGroup> after;
+  previous.CollectAgentGroups(&before);
+  robots.CollectAgentGroups(&after);
+  const Tables before_tables = previous.GetTables();
+  const Tables after_tables = robots.GetTables();
+  // The rules of the groups in [first, last).
+  auto collect_rules = [](const Tables& t, auto first, auto last,
+                          std::vector<RuleView>* rules) {
+    rules->clear();
+    for (; first != last; ++first) {
+      const Group& group = t.groups[first->group];
+      for (uint32_t i = 0; i < group.num_rules; ++i) {
+        const uint32_t rule = group.first_rule + i;
+        rules->push_back({(t.rule_flags[rule] & kRuleAllow) != 0,
+                          t.pattern(rule), t.rule_lines[rule]});
+      }
+    }
+  };
+  auto to_rule = [](const RuleView& rule) {
+    return Diff::Rule{rule.is_allow, std::string(rule.pattern), rule.line};
+  };
+  // Whether [first, last) and the groups of the previous agent are the same.
+  auto same_groups = [](auto first, auto last, auto previous_first,
+                        auto previous_last) {
+    return last - first == previous_last - previous_first &&
+           std::equal(first, last, previous_first,
+                      [](const AgentGroup& x, const AgentGroup& y) {
+                        return x.group == y.group;
+                      });
+  };
+
+  // Both lists are walked one agent at a time. The rules of the agent are
+  // paired up by type and pattern, in line order. Agents often share all of
+  // their groups, e.g. when a group names many of them, and then share the
+  // changes of the previous agent.
+  std::vector<RuleView> before_rules;
+  std::vector<RuleView> after_rules;
+  Diff::AgentChange rules_change;
+  auto a = before.begin();
+  auto b = after.begin();
+  auto previous_a = a, previous_a_end = a;
+  auto previous_b = b, previous_b_end = b;
+  bool have_previous = false;
+  while (a != before.end() || b != after.end()) {
+    const std::string_view user_agent =
+        b == after.end() ||
+                (a != before.end() &&
+                 CompareIgnoreCase(a->user_agent, b->user_agent) < 0)
+            ? a->user_agent
+            : b->user_agent;
+    auto agent_end = [user_agent](auto it, auto end) {
+      while (it != end && EqualsIgnoreCase(it->user_agent, user_agent)) ++it;
+      return it;
+    };
+    const auto a_end = agent_end(a, before.end());
+    const auto b_end = agent_end(b, after.end());
+    if (!have_previous || !same_groups(a, a_end, previous_a, previous_a_end) ||
+        !same_groups(b, b_end, previous_b, previous_b_end)) {
+      collect_rules(before_tables, a, a_end, &before_rules);
+      collect_rules(after_tables, b, b_end, &after_rules);
+      TrimAndSortRules(&before_rules, &after_rules);
+      rules_change.added.clear();
+      rules_change.removed.clear();
+      auto x = before_rules.begin();
+      auto y = after_rules.begin();
+      while (x != before_rules.end() || y != after_rules.end()) {
+        if (y == after_rules.end() ||
+            (x != before_rules.end() && !x->SameRule(*y) && *x < *y)) {
+          rules_change.removed.push_back(to_rule(*x++));
+        } else if (x == before_rules.end() || !x->SameRule(*y)) {
+          rules_change.added.push_back(to_rule(*y++));
+        } else {
+          ++x;
+          ++y;
+        }
+      }
+      have_previous = true;
+    }
+    previous_a = a;
+    previous_a_end = a_end;
+    previous_b = b;
+    previous_b_end = b_end;
+
+    const bool had_group = a != a_end;
+    const bool has_group = b != b_end;
+    if (had_group != has_group || !rules_change.added.empty() ||
+        !rules_change.removed.empty()) {
+      Diff::AgentChange& change = diff->changes.emplace_back();
+      change.user_agent = std::string(user_agent);
+      for (char& c : change.user_agent) c = AsciiToLower(c);
+      change.had_group = had_group;
+      change.has_group = has_group;
+      change.added = rules_change.added;
+      change.removed = rules_change.removed;
+    }
+    a = a_end;
+    b = b_end;
+  }
+  return robots;
+}
+
+bool CompiledRobots::SameVerdicts(
+    const CompiledRobots& other,
+    const std::vector<std::string>* user_agents) const {
+  if (body_digest() == other.body_digest()) return true;
+  // The longest match does not depend on the order or the lines of the rules.
+  auto selected = [user_agents](const CompiledRobots& robots,
+                                std::vector<RuleView>* rules) {
+    std::vector<uint32_t> indexes;
+    robots.SelectRules(*user_agents, &indexes);
+    const Tables t = robots.GetTables();
+    rules->reserve(indexes.size());
+    for (const uint32_t index : indexes) {
+      rules->push_back({(t.rule_flags[index] & kRuleAllow) != 0,
+                        t.pattern(index), t.rule_lines[index]});
+    }
+  };
+  std::vector<RuleView> rules;
+  std::vector<RuleView> other_rules;
+  selected(*this, &rules);
+  selected(other, &other_rules);
+  if (rules.size() != other_rules.size()) return false;
+  TrimAndSortRules(&rules, &other_rules);
+  return std::equal(rules.begin(), rules.end(), other_rules.begin(),
+                    [](const RuleView& a, const RuleView& b) {
+                      return a.SameRule(b);
+                    });
+}
+
+void ResolvedRobots::BuildIndex() {
+  // Nodes are built with per-node child lists first and flattened into a
+  // sorted edge array afterwards.
+  std::vector<std::vector<TrieEdge>> children(1);
+  std::vector<std::vector<uint32_t>> wildcards(1);
+  nodes_.assign(1, TrieNode());
+
+  for (uint32_t index = 0; index < rules_.size(); ++index) {
+    const Rule& rule = rules_[index];
+    const std::string_view pattern(strings_.data() + rule.offset, rule.length);
+    uint32_t node = 0;
+    bool has_wildcard = false;
+    bool anchored_at_end = false;
+    for (size_t i = 0; i < pattern.size();) {
+      if (pattern[i] == '*') {
+        has_wildcard = true;
+        break;
+      }
+      if (pattern[i] == '$' && i + 1 == pattern.size()) {
+        anchored_at_end = true;
+        break;
+      }
+      // Same decoding as RobotsMatchStrategy::Matches().
+      int advance;
+      const unsigned char byte = DecodePercentOrChar(pattern, i, &advance);
+      i += advance;
+      auto it = std::find_if(children[node].begin(), children[node].end(),
+                             [byte](const TrieEdge& e) { return e.byte == byte; });
+      if (it != children[node].end()) {
+        node = it->child;
+      } else {
+        const uint32_t child = nodes_.size();
+        nodes_.emplace_back();
+        children.emplace_back();
+        wildcards.emplace_back();
+        children[node].push_back({byte, child});
+        node = child;
+      }
+    }
+
+    TrieNode& n = nodes_[node];
+    const int priority = pattern.length();
+    if (has_wildcard) {
+      wildcards[node].push_back(index);
+    } else if (anchored_at_end) {
+      (rule.is_allow ? n.allow_at_end : n.disallow_at_end)
+          .Update(priority, rule.line);
+    } else {
+      (rule.is_allow ? n.allow : n.disallow).Update(priority, rule.line);
+    }
+  }
+
+  edges_.clear();
+  wildcard_rules_.clear();
+  for (uint32_t node = 0; node < nodes_.size(); ++node) {
+    std::sort(children[node].begin(), children[node].end(),
+              [](const TrieEdge& a, const TrieEdge& b) {
+                return a.byte < b.byte;
+              });
+    nodes_[node].first_edge = edges_.size();
+    nodes_[node].num_edges = children[node].size();
+    edges_.insert(edges_.end(), children[node].begin(), children[node].end());
+    nodes_[node].first_wildcard = wildcard_rules_.size();
+    nodes_[node].num_wildcards = wildcards[node].size();
+    wildcard_rules_.insert(wildcard_rules_.end(), wildcards[node].begin(),
+                           wildcards[node].end());
+  }
+}
+
+CompiledRobots::MatchResult ResolvedRobots::Match(std::string_view url,
+                                                  UrlMode mode) const {
+  return MatchPath(GetMatchPath(url, mode, ThreadPathBuffer()));
+}
+
+namespace {
+// Extracts the paths of 'num_urls' URLs. Only the paths that can't point into
+// their URL get a buffer, which a deque keeps in place as it grows.
+template <typename Url>
+std::vector<std::string_view> GetBatchPaths(const Url* urls, size_t num_urls,
+                                            UrlMode mode,
+                                            std::deque<std::string>* buffers) {
+  std::vector<std::string_view> paths(num_urls);
+  std::string buffer;
+  for (size_t i = 0; i < num_urls; ++i) {
+    paths[i] = GetMatchPath(urls[i], mode, &buffer);
+    if (!buffer.empty()) {
+      buffers->emplace_back(std::move(buffer));
+      paths[i] = buffers->back();
+      buffer.clear();
+    }
+  }
+  return paths;
+}
+}  // namespace
+
+void ResolvedRobots::MatchBatch(const std::string* urls, size_t num_urls,
+                                CompiledRobots::MatchResult* results,
+                                UrlMode mode) const {
+  std::deque<std::string> buffers;
+  const std::vector<std::string_view> paths =
+      GetBatchPaths(urls, num_urls, mode, &buffers);
+  MatchPaths(paths.data(), num_urls, results);
+}
+
+void ResolvedRobots::MatchBatch(const std::string_view* urls, size_t num_urls,
+                                CompiledRobots::MatchResult* results,
+                                UrlMode mode) const {
+  std::deque<std::string> buffers;
+  const std::vector<std::string_view> paths =
+      GetBatchPaths(urls, num_urls, mode, &buffers);
+  MatchPaths(paths.data(), num_urls, results);
+}
+
+void ResolvedRobots::MatchPaths(const std::string_view* paths, size_t num_paths,
+                                CompiledRobots::MatchResult* results) const {
+  std::vector<size_t> order(num_paths);
+  for (size_t i = 0; i < num_paths; ++i) order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [paths](size_t a, size_t b) { return paths[a] < paths[b]; });
+  PrefixMatcher matcher(*this);
+  for (size_t k = 0; k < num_paths; ++k) {
+    const size_t i = order[k];
+    if (k > 0 && paths[i] == paths[order[k - 1]]) {
+      results[i] = results[order[k - 1]];
+    } else {
+      results[i] = matcher.MatchPath(paths[i]);
+    }
+  }
+}
+
+CompiledRobots::MatchResult ResolvedRobots::MatchPath(
+    std::string_view path) const {
+  CompiledRobots::MatchResult result;
+  result.ever_seen_specific_agent = ever_seen_specific_agent_;
+  uint64_t steps_left = budget_.max_steps;
+  bool exceeded = over_budget_;
+  Best allow;
+  Best disallow;
+
+  // Walks the trie along the %-decoded path. Every node on the way is a
+  // literal prefix of the path, so its rules match.
+  const TrieNode* node = &nodes_[0];
+  size_t pos = 0;
+  while (true) {
+    allow.Update(node->allow.priority, node->allow.line);
+    disallow.Update(node->disallow.priority, node->disallow.line);
+    if (pos == path.size()) {
+      allow.Update(node->allow_at_end.priority, node->allow_at_end.line);
+      disallow.Update(node->disallow_at_end.priority,
+                      node->disallow_at_end.line);
+    }
+    for (uint32_t i = 0; i < node->num_wildcards && !exceeded; ++i) {
+      const Rule& rule = rules_[wildcard_rules_[node->first_wildcard + i]];
+      const std::string_view pattern(strings_.data() + rule.offset,
+                                     rule.length);
+      (rule.is_allow ? allow : disallow)
+          .Update(LongestMatchRobotsMatchStrategy::Priority(
+                      path, pattern, &steps_left, &exceeded),
+                  rule.line);
+    }
+    if (exceeded) {
+      result.allowed = budget_.allow_on_exceeded;
+      result.budget_exceeded = true;
+      return result;
+    }
+    if (pos == path.size() || node->num_edges == 0) break;
+
+    int advance;
+    const unsigned char byte = DecodePercentOrChar(path, pos, &advance);
+    const TrieEdge* edges_begin = edges_.data() + node->first_edge;
+    const TrieEdge* edges_end = edges_begin + node->num_edges;
+    const TrieEdge* edge = std::lower_bound(
+        edges_begin, edges_end, byte,
+        [](const TrieEdge& e, unsigned char b) { return e.byte < b; });
+    if (edge == edges_end || edge->byte != byte) break;
+    node = &nodes_[edge->child];
+    pos += advance;
+  }
+
+  if (allow.priority > 0 || disallow.priority > 0) {
+    result.allowed = disallow.priority <= allow.priority;
+  }
+  // Same tie-break as RobotsMatcher::Match::HigherPriorityMatch().
+  result.matching_line =
+      disallow.priority > allow.priority ? disallow.line : allow.line;
+  return result;
+}
+
+bool ResolvedRobots::Allowed(std::string_view url, UrlMode mode) const {
+  return Match(url, mode).allowed;
+}
+
+ResolvedRobots::PrefixMatcher::PrefixMatcher(const ResolvedRobots& robots)
+    : robots_(&robots) {
+  const TrieNode& root = robots.nodes_[0];
+  Frame& frame = frames_.emplace_back();
+  frame.node = 0;
+  frame.pos = 0;
+  frame.examined = 0;
+  frame.allow.Update(root.allow.priority, root.allow.line);
+  frame.disallow.Update(root.disallow.priority, root.disallow.line);
+  wildcards_.insert(wildcards_.end(),
+                    robots.wildcard_rules_.begin() + root.first_wildcard,
+                    robots.wildcard_rules_.begin() + root.first_wildcard +
+                        root.num_wildcards);
+  frame.num_wildcards = wildcards_.size();
+}
+
+CompiledRobots::MatchResult ResolvedRobots::PrefixMatcher::Match(
+    std::string_view url, UrlMode mode) {
+  buffer_.clear();
+  return MatchPath(GetMatchPath(url, mode, &buffer_));
+}
+
+CompiledRobots::MatchResult ResolvedRobots::PrefixMatcher::MatchPath(
+    std::string_view path) {
+  const ResolvedRobots& robots = *robots_;
+  CompiledRobots::MatchResult result;
+  result.ever_seen_specific_agent = robots.ever_seen_specific_agent_;
+  if (robots.over_budget_) {
+    result.allowed = robots.budget_.allow_on_exceeded;
+    result.budget_exceeded = true;
+    return result;
+  }
+
+  // Keeps the steps that only decoded bytes the paths share. A "%XX" escape
+  // decodes differently if the paths differ in any of its bytes, or if one
+  // of them ends before it does.
+  const size_t common = static_cast<size_t>(
+      std::mismatch(path.begin(), path.end(), path_.begin(), path_.end())
+          .first -
+      path.begin());
+  while (frames_.size() > 1 && frames_.back().examined > common) {
+    frames_.pop_back();
+  }
+  wildcards_.resize(frames_.back().num_wildcards);
+  path_.assign(path.data(), path.size());
+
+  // Walks the rest of the path like ResolvedRobots::MatchPath().
+  while (true) {
+    const Frame& frame = frames_.back();
+    const TrieNode& node = robots.nodes_[frame.node];
+    if (frame.pos == path.size() || node.num_edges == 0) break;
+
+    int advance;
+    const unsigned char byte = DecodePercentOrChar(path, frame.pos, &advance);
+    const TrieEdge* edges_begin = robots.edges_.data() + node.first_edge;
+    const TrieEdge* edges_end = edges_begin + node.num_edges;
+    const TrieEdge* edge = std::lower_bound(
+        edges_begin, edges_end, byte,
+        [](const TrieEdge& e, unsigned char b) { return e.byte < b; });
+    if (edge == edges_end || edge->byte != byte) break;
+
+    const TrieNode& child = robots.nodes_[edge->child];
+    Frame next = frame;
+    next.node = edge->child;
+    const bool escape = kDecodePercentEscapes && path[frame.pos] == '%';
+    next.examined =
+        std::max<uint32_t>(frame.examined, frame.pos + (escape ? 3 : 1));
+    next.pos = frame.pos + advance;
+    next.allow.Update(child.allow.priority, child.allow.line);
+    next.disallow.Update(child.disallow.priority, child.disallow.line);
+    wildcards_.insert(wildcards_.end(),
+                      robots.wildcard_rules_.begin() + child.first_wildcard,
+                      robots.wildcard_rules_.begin() + child.first_wildcard +
+                          child.num_wildcards);
+    next.num_wildcards = wildcards_.size();
+    frames_.push_back(next);
+  }
+
+  const Frame& last = frames_.back();
+  Best allow = last.allow;
+  Best disallow = last.disallow;
+  if (last.pos == path.size()) {
+    const TrieNode& node = robots.nodes_[last.node];
+    allow.Update(node.allow_at_end.priority, node.allow_at_end.line);
+    disallow.Update(node.disallow_at_end.priority, node.disallow_at_end.line);
+  }
+  uint64_t steps_left = robots.budget_.max_steps;
+  bool exceeded = false;
+  for (size_t i = 0; i < wildcards_.size() && !exceeded; ++i) {
+    const Rule& rule = robots.rules_[wildcards_[i]];
+    const std::string_view pattern(robots.strings_.data() + rule.offset,
+                                   rule.length);
+    (rule.is_allow ? allow : disallow)
+        .Update(LongestMatchRobotsMatchStrategy::Priority(
+                    path, pattern, &steps_left, &exceeded),
+                rule.line);
+  }
+  if (exceeded) {
+    result.allowed = robots.budget_.allow_on_exceeded;
+    result.budget_exceeded = true;
+    return result;
+  }
+
+  if (allow.priority > 0 || disallow.priority > 0) {
+    result.allowed = disallow.priority <= allow.priority;
+  }
+  // Same tie-break as RobotsMatcher::Match::HigherPriorityMatch().
+  result.matching_line =
+      disallow.priority > allow.priority ? disallow.line : allow.line;
+  return result;
+}
+
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+std::optional<ContentSignal> CompiledRobots::GetContentSignal(
+    const std::vector<std::string>* user_agents) const {
+  Evaluation eval;
+  Evaluate(AgentList(user_agents), nullptr, &eval);
+  if (eval.ever_seen_specific_agent &&
+      eval.content_signal_specific.has_value()) {
+    return eval.content_signal_specific;
+  }
+  return eval.content_signal_global;
+}
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+// A pack is this header, the index sorted by host, the host strings, and the
+// images, each at an 8-byte aligned offset from the start of the pack.
+struct RobotsPack::PackHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;  // kByteOrderMark as written by the builder.
+  uint32_t num_entries;
+  uint64_t size;  // Of the whole pack.
+};
+
+struct RobotsPack::Entry {
+  uint64_t host_offset;
+  uint64_t image_offset;
+  uint32_t host_length;
+  uint32_t image_size;
+};
+
+void RobotsPack::Builder::Add(std::string_view host,
+                              std::string_view robots_body) {
+  Add(host, CompiledRobots(robots_body));
+}
+
+void RobotsPack::Builder::Add(std::string_view host,
+                              const CompiledRobots& robots) {
+  entries_.emplace_back(std::string(host), std::string(robots.Serialize()));
+}
+
+std::string RobotsPack::Builder::Finish() const {
+  static_assert(sizeof(PackHeader) == 24, "PackHeader layout");
+  static_assert(sizeof(Entry) == 24, "Entry layout");
+  // Sorted by host, the last entry added for a host first.
+  std::vector<size_t> order(entries_.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    const int cmp = entries_[a].first.compare(entries_[b].first);
+    return cmp != 0 ? cmp < 0 : a > b;
+  });
+  order.erase(std::unique(order.begin(), order.end(),
+                          [this](size_t a, size_t b) {
+                            return entries_[a].first == entries_[b].first;
+                          }),
+              order.end());
+
+  PackHeader header;
+  std::memcpy(header.magic, kPackMagic, sizeof(header.magic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.num_entries = order.size();
+  std::vector<Entry> index(order.size());
+  uint64_t size = sizeof(header) + order.size() * sizeof(Entry);
+  for (size_t i = 0; i < order.size(); ++i) {
+    index[i].host_offset = size;
+    index[i].host_length = entries_[order[i]].first.size();
+    size += entries_[order[i]].first.size();
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    size = AlignTo8(size);
+    index[i].image_offset = size;
+    index[i].image_size = entries_[order[i]].second.size();
+    size += entries_[order[i]].second.size();
+  }
+  header.size = size;
+
+  std::string pack(size, '\0');
+  std::memcpy(&pack[0], &header, sizeof(header));
+  if (!index.empty()) {
+    std::memcpy(&pack[sizeof(header)], index.data(),
+                index.size() * sizeof(Entry));
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    const auto& entry = entries_[order[i]];
+    pack.replace(index[i].host_offset, entry.first.size(), entry.first);
+    pack.replace(index[i].image_offset, entry.second.size(), entry.second);
+  }
+  return pack;
+}
+
+/* static */ std::optional<RobotsPack> RobotsPack::Open(
+    std::string_view data) {
+  if (!IsAligned8(data.data()) || data.size() < sizeof(PackHeader)) {
+    return std::nullopt;
+  }
+  const PackHeader& header = *reinterpret_cast<const PackHeader*>(data.data());
+  const uint64_t size = data.size();
+  if (std::memcmp(header.magic, kPackMagic, sizeof(header.magic)) != 0 ||
+      header.version != kVersion || header.byte_order != kByteOrderMark ||
+      header.size != size ||
+      !TableFits(sizeof(PackHeader), header.num_entries, sizeof(Entry),
+                 size)) {
+    return std::nullopt;
+  }
+
+  RobotsPack pack;
+  pack.data_ = data;
+  pack.entries_ =
+      reinterpret_cast<const Entry*>(data.data() + sizeof(PackHeader));
+  pack.num_entries_ = header.num_entries;
+  for (size_t i = 0; i < pack.num_entries_; ++i) {
+    const Entry& entry = pack.entries_[i];
+    if (!RangeFits(entry.host_offset, entry.host_length, size) ||
+        !TableFits(entry.image_offset, entry.image_size, 1, size)) {
+      return std::nullopt;
+    }
+    // Find() relies on the order.
+    if (i > 0 && !(pack.host(i - 1) < pack.host(i))) return std::nullopt;
+  }
+  return pack;
+}
+
+std::string_view RobotsPack::host(size_t i) const {
+  return data_.substr(entries_[i].host_offset, entries_[i].host_length);
+}
+
+std::optional<CompiledRobots> RobotsPack::robots(size_t i) const {
+  return CompiledRobots::FromSerialized(
+      data_.substr(entries_[i].image_offset, entries_[i].image_size));
+}
+
+std::optional<CompiledRobots> RobotsPack::Find(std::string_view host) const {
+  size_t low = 0;
+  size_t high = num_entries_;
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if (this->host(mid) < host) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == num_entries_ || this->host(low) != host) return std::nullopt;
+  return robots(low);
+}
+
+void ParsedRobotsKey::Parse(std::string_view key, bool* is_acceptable_typo) {
+  key_text_ = std::string_view();
+  *is_acceptable_typo = false;
+  // No two supported keys or typo variants share their first letter, unless
+  // they're for the same directive, so checking it avoids trying every key.
+  // "crawl-delay" and "content-signal" are the only ones left to tell apart.
+  type_ = UNKNOWN;
+  switch (key.empty() ? '\0' : AsciiToLower(key[0])) {
+    case 'u':
+      if (KeyIsUserAgent(key, is_acceptable_typo)) type_ = USER_AGENT;
+      break;
+    case 'a':
+      if (KeyIsAllow(key, is_acceptable_typo)) type_ = ALLOW;
+      break;
+    case 'd':
+      if (KeyIsDisallow(key, is_acceptable_typo)) type_ = DISALLOW;
+      break;
+    case 's':
+      if (KeyIsSitemap(key, is_acceptable_typo)) type_ = SITEMAP;
+      break;
+    case 'c':
+      if constexpr (kSupportNonStandardDirectives) {
+        if (KeyIsCrawlDelay(key, is_acceptable_typo)) {
+          type_ = CRAWL_DELAY;
+          break;
+        }
+      }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+      if (KeyIsContentSignal(key, is_acceptable_typo)) type_ = CONTENT_SIGNAL;
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+      break;
+    case 'r':
+      if constexpr (kSupportNonStandardDirectives) {
+        if (KeyIsRequestRate(key, is_acceptable_typo)) type_ = REQUEST_RATE;
+      }
+      break;
+  }
+  if (type_ == UNKNOWN) key_text_ = key;
+}
+
+std::string_view ParsedRobotsKey::GetUnknownText() const {
+  ROBOTS_ASSERT(type_ == UNKNOWN && !key_text_.empty());
+  return key_text_;
+}
+
+bool ParsedRobotsKey::KeyIsUserAgent(std::string_view key,
+                                     bool* is_acceptable_typo) {
+  if (StartsWithIgnoreCase(key, "user-agent")) {
+    *is_acceptable_typo = false;
+    return true;
+  }
+  *is_acceptable_typo =
+      (kAllowFrequentTypos && (StartsWithIgnoreCase(key, "useragent") ||
+                               StartsWithIgnoreCase(key, "user agent")));
+  return *is_acceptable_typo;
+}
+
+bool ParsedRobotsKey::KeyIsAllow(std::string_view key,
+                                 bool* is_acceptable_typo) {
+  // We don't support typos for the "allow" key.
+  *is_acceptable_typo = false;
+  return StartsWithIgnoreCase(key, "allow");
+}
+
+bool ParsedRobotsKey::KeyIsDisallow(std::string_view key,
+                                    bool* is_acceptable_typo) {
+  if (StartsWithIgnoreCase(key, "disallow")) {
+    *is_acceptable_typo = false;
+    return true;
+  }
+  *is_acceptable_typo =
+      (kAllowFrequentTypos && ((StartsWithIgnoreCase(key, "dissallow")) ||
+                               (StartsWithIgnoreCase(key, "dissalow")) ||
+                               (StartsWithIgnoreCase(key, "disalow")) ||
+                               (StartsWithIgnoreCase(key, "diasllow")) ||
+                               (StartsWithIgnoreCase(key, "disallaw"))));
+  return *is_acceptable_typo;
+}
 
 bool ParsedRobotsKey::KeyIsSitemap(std::string_view key,
                                    bool* is_acceptable_typo) {
+  if (StartsWithIgnoreCase(key, "sitemap")) {
+    *is_acceptable_typo = false;
+    return true;
+  }
   *is_acceptable_typo =
       (kAllowFrequentTypos && (StartsWithIgnoreCase(key, "site-map")));
-  return StartsWithIgnoreCase(key, "sitemap") || *is_acceptable_typo;
+  return *is_acceptable_typo;
 }
 
 bool ParsedRobotsKey::KeyIsCrawlDelay(std::string_view key,
                                       bool* is_acceptable_typo) {
   // Accept common variants: "crawl-delay", "crawldelay", "crawl delay"
+  if (StartsWithIgnoreCase(key, "crawl-delay")) {
+    *is_acceptable_typo = false;
+    return true;
+  }
   *is_acceptable_typo =
       (kAllowFrequentTypos && (StartsWithIgnoreCase(key, "crawldelay") ||
                                StartsWithIgnoreCase(key, "crawl delay")));
-  return StartsWithIgnoreCase(key, "crawl-delay") || *is_acceptable_typo;
+  return *is_acceptable_typo;
 }
 
 bool ParsedRobotsKey::KeyIsRequestRate(std::string_view key,
@@ -1676,13 +5404,39 @@ bool ParsedRobotsKey::KeyIsRequestRate(std::string_view key,
 bool ParsedRobotsKey::KeyIsContentSignal(std::string_view key,
                                          bool* is_acceptable_typo) {
   // Accept "content-signal" and common variants.
+  if (StartsWithIgnoreCase(key, "content-signal")) {
+    *is_acceptable_typo = false;
+    return true;
+  }
   *is_acceptable_typo =
       (kAllowFrequentTypos && (StartsWithIgnoreCase(key, "contentsignal") ||
                                StartsWithIgnoreCase(key, "content signal")));
-  return StartsWithIgnoreCase(key, "content-signal") || *is_acceptable_typo;
+  return *is_acceptable_typo;
 }
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
 
+// ClassifyRobotsKey is not in anonymous namespace to allow testing and
+// benchmarking. Returns the canonical name of the directive `key` stands for,
+// or an empty string if it isn't a supported one.
+std::string_view ClassifyRobotsKey(std::string_view key,
+                                   bool* is_acceptable_typo) {
+  ParsedRobotsKey parsed;
+  parsed.Parse(key, is_acceptable_typo);
+  switch (parsed.type()) {
+    case ParsedRobotsKey::USER_AGENT:     return "user-agent";
+    case ParsedRobotsKey::ALLOW:          return "allow";
+    case ParsedRobotsKey::DISALLOW:       return "disallow";
+    case ParsedRobotsKey::SITEMAP:        return "sitemap";
+    case ParsedRobotsKey::CRAWL_DELAY:    return "crawl-delay";
+    case ParsedRobotsKey::REQUEST_RATE:   return "request-rate";
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+    case ParsedRobotsKey::CONTENT_SIGNAL: return "content-signal";
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+    case ParsedRobotsKey::UNKNOWN:        return "";
+  }
+  return "";
+}
+
 }  // namespace googlebot
 
 // === End robots.cc implementation ===
@@ -1726,7 +5480,7 @@ static const std::vector<std::string> kUnsupportedTags = {
     // Other
     "license"};
 
-void RobotsParsingReporter::Digest(int line_num,
+void RobotsParsingReporterBase::Digest(int line_num,
                                    RobotsParsedLine::RobotsTagName parsed_tag) {
   if (line_num > last_line_seen_) {
     last_line_seen_ = line_num;
@@ -1736,58 +5490,55 @@ void RobotsParsingReporter::Digest(int line_num,
     ++valid_directives_;
   }
 
-  RobotsParsedLine& line = robots_parse_results_[line_num];
-  line.line_num = line_num;
-  line.tag_name = parsed_tag;
+  Line(line_num).tag_name = parsed_tag;
 }
 
-void RobotsParsingReporter::ReportLineMetadata(int line_num,
+void RobotsParsingReporterBase::ReportLineMetadata(int line_num,
                                                const LineMetadata& metadata) {
   if (line_num > last_line_seen_) {
     last_line_seen_ = line_num;
   }
-  RobotsParsedLine& line = robots_parse_results_[line_num];
-  line.line_num = line_num;
+  RobotsParsedLine& line = Line(line_num);
   line.is_typo = metadata.is_acceptable_typo;
   line.metadata = metadata;
 }
 
-void RobotsParsingReporter::HandleRobotsStart() {
+void RobotsParsingReporterBase::HandleRobotsStart() {
   last_line_seen_ = 0;
   valid_directives_ = 0;
   unused_directives_ = 0;
 }
-void RobotsParsingReporter::HandleRobotsEnd() {}
-void RobotsParsingReporter::HandleUserAgent(int line_num,
+void RobotsParsingReporterBase::HandleRobotsEnd() {}
+void RobotsParsingReporterBase::HandleUserAgent(int line_num,
                                             std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kUserAgent);
 }
-void RobotsParsingReporter::HandleAllow(int line_num,
+void RobotsParsingReporterBase::HandleAllow(int line_num,
                                         std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kAllow);
 }
-void RobotsParsingReporter::HandleDisallow(int line_num,
+void RobotsParsingReporterBase::HandleDisallow(int line_num,
                                            std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kDisallow);
 }
-void RobotsParsingReporter::HandleSitemap(int line_num,
+void RobotsParsingReporterBase::HandleSitemap(int line_num,
                                           std::string_view line_value) {
   Digest(line_num, RobotsParsedLine::kSitemap);
 }
-void RobotsParsingReporter::HandleCrawlDelay(int line_num, double value) {
+void RobotsParsingReporterBase::HandleCrawlDelay(int line_num, double value) {
   Digest(line_num, RobotsParsedLine::kCrawlDelay);
 }
-void RobotsParsingReporter::HandleRequestRate(int line_num,
+void RobotsParsingReporterBase::HandleRequestRate(int line_num,
                                               const RequestRate& rate) {
   Digest(line_num, RobotsParsedLine::kRequestRate);
 }
 #if ROBOTS_SUPPORT_CONTENT_SIGNAL
-void RobotsParsingReporter::HandleContentSignal(int line_num,
+void RobotsParsingReporterBase::HandleContentSignal(int line_num,
                                                 const ContentSignal& signal) {
   Digest(line_num, RobotsParsedLine::kContentSignal);
 }
 #endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
-void RobotsParsingReporter::HandleUnknownAction(int line_num,
+void RobotsParsingReporterBase::HandleUnknownAction(int line_num,
                                                 std::string_view action,
                                                 std::string_view line_value) {
   RobotsParsedLine::RobotsTagName rtn =
@@ -1799,6 +5550,35 @@ void RobotsParsingReporter::HandleUnknownAction(int line_num,
   Digest(line_num, rtn);
 }
 
+RobotsParsedLine& RobotsParsingReporter::Line(int line_num) {
+  RobotsParsedLine& line = robots_parse_results_[line_num];
+  line.line_num = line_num;
+  return line;
+}
+
+void FlatRobotsParsingReporter::HandleRobotsStart() {
+  RobotsParsingReporterBase::HandleRobotsStart();
+  lines_.clear();
+}
+
+RobotsParsedLine& FlatRobotsParsingReporter::Line(int line_num) {
+  if (lines_.empty() || lines_.back().line_num < line_num) {
+    lines_.emplace_back().line_num = line_num;
+    return lines_.back();
+  }
+  if (lines_.back().line_num == line_num) return lines_.back();
+  // Lines reported out of order, which the parsers don't do.
+  auto it = std::lower_bound(lines_.begin(), lines_.end(), line_num,
+                             [](const RobotsParsedLine& line, int num) {
+                               return line.line_num < num;
+                             });
+  if (it == lines_.end() || it->line_num != line_num) {
+    it = lines_.insert(it, RobotsParsedLine());
+    it->line_num = line_num;
+  }
+  return *it;
+}
+
 }  // namespace googlebot
 
 // === End reporting_robots.cc implementation ===
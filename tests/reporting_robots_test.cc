@@ -137,7 +137,8 @@ TEST(RobotsUnittest, LinesNumbersAreCountedCorrectly) {
       "Noarchive: /someCapital\n";            // 15
                                               // 16 (from \n)
   googlebot::ParseRobotsTxt(kSimpleFile, &report);
-  EXPECT_EQ(8, report.valid_directives());
+  // Lines 11 to 13 are typos.
+  EXPECT_EQ(ROBOTS_ALLOW_FREQUENT_TYPOS ? 8 : 5, report.valid_directives());
   EXPECT_EQ(16, report.last_line_seen());
   EXPECT_EQ(report.parse_results().size(), report.last_line_seen());
   std::vector<std::string_view> lines = StrSplit(kSimpleFile, '\n');
@@ -266,6 +267,7 @@ TEST(RobotsUnittest, LinesNumbersAreCountedCorrectly) {
                            .has_directive = false,
                            .is_missing_colon_separator = false,
                        }});
+#if ROBOTS_ALLOW_FREQUENT_TYPOS
   // For line "useragent: baz\n";         // 11
   expectLineToParseTo(
       lines, report.parse_results(),
@@ -305,6 +307,7 @@ TEST(RobotsUnittest, LinesNumbersAreCountedCorrectly) {
                            .has_directive = true,
                            .is_acceptable_typo = true,
                        }});
+#endif  // ROBOTS_ALLOW_FREQUENT_TYPOS
   // For line "sitemap: https://e/t.xml\n"  // 14;
   expectLineToParseTo(
       lines, report.parse_results(),
@@ -424,3 +427,54 @@ TEST(RobotsUnittest, LinesTooLongReportedCorrectly) {
                            .is_line_too_long = false,
                        }});
 }
+
+TEST(RobotsUnittest, FlatReporterReportsLikeReporter) {
+  static const char* const kFiles[] = {
+      "User-Agent: foo\n"
+      "Allow: /some/path\n"
+      "User-Agent bar # no\n"
+      "absolutely random line\n"
+      "#so comment, much wow\n"
+      "\n"
+      "unicorns: /extinct\n"
+      "noarchive: /some\n"
+      "Disallow: /\n"
+      "crawl-delay: 5\n"
+      "useragent: baz\n"
+      "disallaw: /some\n"
+      "site-map: https://e/s.xml #comment\n",
+      "",
+      "sitemap: https://e/t.xml",
+      "\xEF\xBB\xBFuser-agent: *\r\ndisallow: /x\r\n\r\nallow: /\r\n",
+  };
+  // One flat reporter for all files, to check that nothing is carried over.
+  googlebot::FlatRobotsParsingReporter flat;
+  for (const char* file : kFiles) {
+    RobotsParsingReporter report;
+    googlebot::ParseRobotsTxt(file, &report);
+    googlebot::ParseRobotsTxt(file, &flat);
+    const std::vector<RobotsParsedLine> expected = report.parse_results();
+    const googlebot::RobotsParsedLines lines = flat.parse_results();
+    ASSERT_EQ(expected.size(), lines.size()) << file;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i], lines[i]) << file;
+    }
+    EXPECT_EQ(report.last_line_seen(), flat.last_line_seen());
+    EXPECT_EQ(report.valid_directives(), flat.valid_directives());
+    EXPECT_EQ(report.unused_directives(), flat.unused_directives());
+  }
+}
+
+TEST(RobotsUnittest, FlatReporterKeepsItsBuffer) {
+  googlebot::FlatRobotsParsingReporter report;
+  googlebot::ParseRobotsTxt("user-agent: *\ndisallow: /\nallow: /x\n",
+                            &report);
+  ASSERT_EQ(4, report.parse_results().size());
+  const RobotsParsedLine* data = report.parse_results().data();
+
+  googlebot::ParseRobotsTxt("user-agent: *\n", &report);
+  ASSERT_EQ(2, report.parse_results().size());
+  EXPECT_EQ(data, report.parse_results().data());
+  EXPECT_EQ(RobotsParsedLine::kUserAgent, report.parse_results()[0].tag_name);
+  EXPECT_EQ(2, report.parse_results()[1].line_num);
+}
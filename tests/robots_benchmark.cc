@@ -14,13 +14,60 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <optional>
+#include <random>
 #include <string>
 #include <vector>
 
+#include "reporting_robots.h"
 #include "robots.h"
 
+// Counts heap allocations so that benchmarks can report them. The operators
+// are kept out of line, otherwise GCC flags the free() of memory it sees
+// coming from operator new.
+#if defined(__GNUC__)
+#define ROBOTS_BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+#define ROBOTS_BENCHMARK_NOINLINE
+#endif
+
+static std::atomic<uint64_t> g_num_allocations{0};
+
+ROBOTS_BENCHMARK_NOINLINE void* operator new(size_t size) {
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+ROBOTS_BENCHMARK_NOINLINE void operator delete(void* p) noexcept {
+  std::free(p);
+}
+ROBOTS_BENCHMARK_NOINLINE void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+// The URL parser robots.cc was built with, reported in the benchmark context.
+// Set by the build, see CMakeLists.txt.
+#ifndef ROBOTS_BENCHMARK_URL_PARSER
+#define ROBOTS_BENCHMARK_URL_PARSER "unknown"
+#endif
+
+// Only available to the linker, see robots.cc.
+namespace googlebot {
+std::string_view ClassifyRobotsKey(std::string_view key,
+                                   bool* is_acceptable_typo);
+std::string_view GetPathParamsQuery(std::string_view url, std::string* buffer);
+std::string_view GetPathParamsQueryOfCanonicalUrl(std::string_view url,
+                                                  std::string* buffer);
+}  // namespace googlebot
+
 namespace {
 
 // Load all robots.txt files from binary format:
@@ -57,14 +104,23 @@ void LoadFilesOnce() {
   }
 }
 
-// Benchmark: Parse all robots.txt files
+// A subclass, which RobotsMatcher parses through the virtual callbacks.
+class VirtualDispatchMatcher : public googlebot::RobotsMatcher {};
+
+// Benchmark: Parse all robots.txt files, through the virtual callbacks of
+// RobotsParseHandler (Arg 0) or with the direct calls RobotsMatcher makes when
+// it is not subclassed (Arg 1).
 static void BM_ParseAllRobotsTxt(benchmark::State& state) {
   LoadFilesOnce();
+  const bool direct = state.range(0) != 0;
+  const std::vector<std::string> agents = {"Googlebot"};
+  googlebot::RobotsMatcher direct_matcher;
+  VirtualDispatchMatcher virtual_matcher;
+  googlebot::RobotsMatcher& matcher =
+      direct ? direct_matcher : virtual_matcher;
 
   for (auto _ : state) {
     for (const auto& robots_content : g_robots_files) {
-      googlebot::RobotsMatcher matcher;
-      std::vector<std::string> agents = {"Googlebot"};
       benchmark::DoNotOptimize(
           matcher.AllowedByRobots(robots_content, &agents, "/"));
     }
@@ -78,7 +134,58 @@ static void BM_ParseAllRobotsTxt(benchmark::State& state) {
         return total;
       }());
 }
-BENCHMARK(BM_ParseAllRobotsTxt);
+BENCHMARK(BM_ParseAllRobotsTxt)->Arg(0)->Arg(1);
+
+// Collects sitemaps through a second parse of the body.
+class SitemapCollector : public googlebot::RobotsParseHandler {
+ public:
+  std::vector<std::string_view> sitemaps;
+
+  void HandleRobotsStart() override { sitemaps.clear(); }
+  void HandleRobotsEnd() override {}
+  void HandleUserAgent(int line_num, std::string_view value) override {}
+  void HandleAllow(int line_num, std::string_view value) override {}
+  void HandleDisallow(int line_num, std::string_view value) override {}
+  void HandleSitemap(int line_num, std::string_view value) override {
+    if (!value.empty()) sitemaps.push_back(value);
+  }
+  void HandleCrawlDelay(int line_num, double value) override {}
+  void HandleRequestRate(int line_num,
+                         const googlebot::RequestRate& rate) override {}
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleContentSignal(int line_num,
+                           const googlebot::ContentSignal& signal) override {}
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleUnknownAction(int line_num, std::string_view action,
+                           std::string_view value) override {}
+};
+
+// Benchmark: A check and the sitemaps of every file, with a second parse for
+// the sitemaps (Arg 0) or collected by the check (Arg 1).
+static void BM_CheckAndSitemaps(benchmark::State& state) {
+  LoadFilesOnce();
+  const bool same_pass = state.range(0) != 0;
+  const std::vector<std::string> agents = {"Googlebot"};
+  googlebot::RobotsMatcher matcher;
+  matcher.set_collect_sitemaps(same_pass);
+  SitemapCollector collector;
+  size_t sitemaps = 0;
+  for (auto _ : state) {
+    for (const auto& robots_content : g_robots_files) {
+      benchmark::DoNotOptimize(
+          matcher.AllowedByRobots(robots_content, &agents, "/"));
+      if (same_pass) {
+        sitemaps += matcher.sitemaps().size();
+      } else {
+        googlebot::ParseRobotsTxt(robots_content, &collector);
+        sitemaps += collector.sitemaps.size();
+      }
+    }
+  }
+  benchmark::DoNotOptimize(sitemaps);
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+}
+BENCHMARK(BM_CheckAndSitemaps)->Arg(0)->Arg(1);
 
 // Benchmark: Parse single robots.txt (average size)
 static void BM_ParseSingleRobotsTxt(benchmark::State& state) {
@@ -87,10 +194,10 @@ static void BM_ParseSingleRobotsTxt(benchmark::State& state) {
 
   // Pick a representative file (middle one)
   const std::string& robots_content = g_robots_files[g_robots_files.size() / 2];
+  const std::vector<std::string> agents = {"Googlebot"};
+  googlebot::RobotsMatcher matcher;
 
   for (auto _ : state) {
-    googlebot::RobotsMatcher matcher;
-    std::vector<std::string> agents = {"Googlebot"};
     benchmark::DoNotOptimize(
         matcher.AllowedByRobots(robots_content, &agents, "/test/path"));
   }
@@ -106,15 +213,470 @@ static void BM_MatchMultipleUserAgents(benchmark::State& state) {
 
   const std::string& robots_content = g_robots_files[g_robots_files.size() / 2];
   std::vector<std::string> agents = {"Googlebot", "Googlebot-Image", "Googlebot-News"};
+  googlebot::RobotsMatcher matcher;
 
   for (auto _ : state) {
-    googlebot::RobotsMatcher matcher;
     benchmark::DoNotOptimize(
         matcher.AllowedByRobots(robots_content, &agents, "/some/path/to/check"));
   }
 }
 BENCHMARK(BM_MatchMultipleUserAgents);
 
+// Benchmark: a separate verdict, crawl-delay and content-signal for each of
+// three agents, over all files. Arg 0 parses each file once per agent with
+// RobotsMatcher, Arg 1 queries a CompiledRobots once per agent, Arg 2 asks
+// CompiledRobots::MatchAgents() for all of them at once. Compiling is not
+// timed for Args 1 and 2.
+static void BM_PerAgentVerdicts(benchmark::State& state) {
+  LoadFilesOnce();
+  if (g_robots_files.empty()) return;
+
+  const std::vector<std::string_view> agents = {"Googlebot", "Googlebot-Image",
+                                                "Googlebot-News"};
+  const std::string_view url = "/some/path/to/check";
+  std::vector<googlebot::CompiledRobots> compiled;
+  if (state.range(0) != 0) {
+    compiled.reserve(g_robots_files.size());
+    for (const auto& robots_content : g_robots_files) {
+      compiled.emplace_back(robots_content);
+    }
+  }
+  std::vector<std::vector<std::string>> agent_vectors;
+  for (std::string_view agent : agents) {
+    agent_vectors.push_back({std::string(agent)});
+  }
+  googlebot::RobotsMatcher matcher;
+  googlebot::CompiledRobots::AgentVerdict verdicts[3];
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < g_robots_files.size(); ++i) {
+      switch (state.range(0)) {
+        case 0:
+          for (std::string_view agent : agents) {
+            benchmark::DoNotOptimize(matcher.OneAgentAllowedByRobots(
+                g_robots_files[i], agent, url));
+            benchmark::DoNotOptimize(matcher.GetCrawlDelay());
+          }
+          break;
+        case 1:
+          for (const auto& agent : agent_vectors) {
+            benchmark::DoNotOptimize(compiled[i].Match(&agent, url));
+            benchmark::DoNotOptimize(compiled[i].GetCrawlDelay(&agent));
+          }
+          break;
+        default:
+          compiled[i].MatchAgents(agents.data(), agents.size(), url, verdicts);
+          benchmark::DoNotOptimize(verdicts);
+          break;
+      }
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+}
+BENCHMARK(BM_PerAgentVerdicts)->Arg(0)->Arg(1)->Arg(2);
+
+// All robots.txt files, compiled once and shared by all benchmark threads.
+const std::vector<googlebot::CompiledRobots>& CompiledFiles() {
+  static const std::vector<googlebot::CompiledRobots>* compiled = [] {
+    LoadFilesOnce();
+    auto* v = new std::vector<googlebot::CompiledRobots>();
+    v->reserve(g_robots_files.size());
+    for (const auto& robots_content : g_robots_files) {
+      v->emplace_back(robots_content);
+    }
+    return v;
+  }();
+  return *compiled;
+}
+
+// Benchmark: Match against pre-compiled robots.txt files. Every thread queries
+// the same CompiledRobots instances without any locking, so items_per_second
+// should grow linearly with the number of threads.
+static void BM_CompiledMatchThreaded(benchmark::State& state) {
+  const std::vector<googlebot::CompiledRobots>& compiled = CompiledFiles();
+  const std::vector<std::string> agents = {"Googlebot"};
+
+  for (auto _ : state) {
+    for (const auto& robots : compiled) {
+      benchmark::DoNotOptimize(robots.Allowed(&agents, "/some/path/to/check"));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * compiled.size());
+}
+BENCHMARK(BM_CompiledMatchThreaded)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+// A robots.txt with state.range(0) Disallow lines, a few of them with
+// wildcards, like the large files of some e-commerce sites.
+std::string ManyRulesRobotsTxt(int num_rules) {
+  std::string robots_content = "User-agent: *\n";
+  for (int i = 0; i < num_rules; ++i) {
+    robots_content += (i % 10 == 0 ? "Allow: /catalog/" : "Disallow: /catalog/");
+    robots_content += std::to_string(i);
+    robots_content += (i % 50 == 0 ? "/*?sort=\n" : "/\n");
+  }
+  return robots_content;
+}
+
+// Benchmark: RobotsMatcher on a file with many rules, which tries every
+// pattern against the URL.
+static void BM_MatchManyRules(benchmark::State& state) {
+  const std::string robots_content = ManyRulesRobotsTxt(state.range(0));
+  googlebot::RobotsMatcher matcher;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(matcher.OneAgentAllowedByRobots(
+        robots_content, "Googlebot", "http://foo.bar/catalog/1234/item?sort=1"));
+  }
+}
+BENCHMARK(BM_MatchManyRules)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Benchmark: Trie-indexed ResolvedRobots on the same files, match only.
+static void BM_ResolvedMatchManyRules(benchmark::State& state) {
+  const googlebot::CompiledRobots compiled(ManyRulesRobotsTxt(state.range(0)));
+  const std::vector<std::string> agents = {"Googlebot"};
+  const googlebot::ResolvedRobots resolved = compiled.Resolve(&agents);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resolved.Allowed("http://foo.bar/catalog/1234/item?sort=1"));
+  }
+}
+BENCHMARK(BM_ResolvedMatchManyRules)->Arg(100)->Arg(1000)->Arg(10000);
+
+// A per-host batch of URLs as a crawl frontier would dequeue it, with some
+// URLs repeated.
+std::vector<std::string> FrontierBatch() {
+  std::vector<std::string> urls;
+  for (int i = 0; i < 1000; ++i) {
+    urls.push_back("http://foo.bar/catalog/" + std::to_string(i % 700) +
+                   "/item?sort=" + std::to_string(i % 3));
+  }
+  return urls;
+}
+
+// Benchmark: One CompiledRobots::Match() call per URL of a batch.
+static void BM_MatchBatchOneByOne(benchmark::State& state) {
+  const googlebot::CompiledRobots compiled(ManyRulesRobotsTxt(1000));
+  const std::vector<std::string> agents = {"Googlebot"};
+  const std::vector<std::string> urls = FrontierBatch();
+  for (auto _ : state) {
+    for (const std::string& url : urls) {
+      benchmark::DoNotOptimize(compiled.Match(&agents, url));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * urls.size());
+}
+BENCHMARK(BM_MatchBatchOneByOne);
+
+// Benchmark: The same batch with a single CompiledRobots::MatchBatch() call.
+static void BM_MatchBatch(benchmark::State& state) {
+  const googlebot::CompiledRobots compiled(ManyRulesRobotsTxt(1000));
+  const std::vector<std::string> agents = {"Googlebot"};
+  const std::vector<std::string> urls = FrontierBatch();
+  std::vector<googlebot::CompiledRobots::MatchResult> results(urls.size());
+  for (auto _ : state) {
+    compiled.MatchBatch(&agents, urls.data(), urls.size(), results.data());
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * urls.size());
+}
+BENCHMARK(BM_MatchBatch);
+
+// URLs in the sorted order of a sitemap: runs of paths sharing a prefix that
+// is also the pattern of a rule.
+std::vector<std::string> SitemapUrls() {
+  std::vector<std::string> urls;
+  for (int i = 0; i < 1000; ++i) {
+    urls.push_back("http://foo.bar/catalog/" + std::to_string(100 + i / 20) +
+                   "/item-" + std::to_string(1000 + i) + ".html");
+  }
+  std::sort(urls.begin(), urls.end());
+  return urls;
+}
+
+// Benchmark: The sitemap URLs with one ResolvedRobots::Match() each (0), and
+// with a ResolvedRobots::PrefixMatcher that resumes the walk of the previous
+// path (1).
+static void BM_SortedPaths(benchmark::State& state) {
+  const googlebot::CompiledRobots compiled(ManyRulesRobotsTxt(1000));
+  const std::vector<std::string> agents = {"Googlebot"};
+  const googlebot::ResolvedRobots resolved = compiled.Resolve(&agents);
+  const std::vector<std::string> urls = SitemapUrls();
+  for (auto _ : state) {
+    if (state.range(0) == 0) {
+      for (const std::string& url : urls) {
+        benchmark::DoNotOptimize(resolved.Match(url));
+      }
+    } else {
+      googlebot::ResolvedRobots::PrefixMatcher matcher(resolved);
+      for (const std::string& url : urls) {
+        benchmark::DoNotOptimize(matcher.Match(url));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * urls.size());
+}
+BENCHMARK(BM_SortedPaths)->Arg(0)->Arg(1);
+
+// Benchmark: Heap allocations per CompiledRobots match, which runs the pattern
+// matcher against every rule of the matching groups. Nothing should allocate.
+static void BM_MatchAllocations(benchmark::State& state) {
+  const googlebot::CompiledRobots compiled(
+      "User-agent: *\n"
+      "Disallow: /some/path\n"
+      "Allow: /some/path/to\n"
+      "Disallow: /*.php$\n"
+      "Disallow: /some/*/check\n"
+      "Allow: /some/%70ath/to/check\n"
+      "Disallow: /other\n");
+  const std::vector<std::string> agents = {"Googlebot"};
+  const std::string url = "http://foo.bar/some/path/to/check?with=query";
+
+  const uint64_t allocations_before = g_num_allocations.load();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compiled.Allowed(&agents, url));
+  }
+  state.counters["allocs_per_match"] = benchmark::Counter(
+      static_cast<double>(g_num_allocations.load() - allocations_before) /
+      state.iterations());
+}
+BENCHMARK(BM_MatchAllocations);
+
+// Benchmark: Heap allocations of a single CompiledRobots::OneAgentAllowed()
+// check, which passes its agent on as a view. Nothing should allocate.
+static void BM_CompiledOneAgentAllocations(benchmark::State& state) {
+  const googlebot::CompiledRobots compiled(
+      "User-agent: *\n"
+      "Disallow: /some/path\n"
+      "Allow: /some/path/to\n"
+      "Disallow: /*.php$\n"
+      "Disallow: /some/*/check\n"
+      "Allow: /some/%70ath/to/check\n"
+      "Disallow: /other\n");
+  const std::string_view url = "http://foo.bar/some/path/to/check?with=query";
+
+  const uint64_t allocations_before = g_num_allocations.load();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(compiled.OneAgentAllowed("Googlebot", url));
+  }
+  state.counters["allocs_per_match"] = benchmark::Counter(
+      static_cast<double>(g_num_allocations.load() - allocations_before) /
+      state.iterations());
+}
+BENCHMARK(BM_CompiledOneAgentAllocations);
+
+// Benchmark: Path extraction from the URLs of a frontier batch, with the full
+// URL parse (Arg 0) and with UrlMode::kTrustedCanonical (Arg 1).
+static void BM_UrlPath(benchmark::State& state) {
+  const std::vector<std::string> urls = FrontierBatch();
+  const bool canonical = state.range(0) != 0;
+  std::string buffer;
+  for (auto _ : state) {
+    for (const std::string& url : urls) {
+      benchmark::DoNotOptimize(
+          canonical ? googlebot::GetPathParamsQueryOfCanonicalUrl(url, &buffer)
+                    : googlebot::GetPathParamsQuery(url, &buffer));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * urls.size());
+}
+BENCHMARK(BM_UrlPath)->Arg(0)->Arg(1);
+
+// Records the lines a RobotsMatcher parses, to measure what it skips.
+class LineRecordingMatcher : public googlebot::RobotsMatcher {
+ public:
+  std::vector<int> lines;
+
+ protected:
+  void ReportLineMetadata(int line_num, const LineMetadata&) override {
+    lines.push_back(line_num);
+  }
+};
+
+// Returns the length of each line of 'body' with its line ending, numbered
+// like the parser does.
+std::vector<size_t> LineLengths(std::string_view body) {
+  std::vector<size_t> lengths;
+  size_t start = 0;
+  for (size_t i = 0; i < body.size(); ++i) {
+    if (body[i] != '\n' && body[i] != '\r') continue;
+    if (body[i] == '\r' && i + 1 < body.size() && body[i + 1] == '\n') ++i;
+    lengths.push_back(i + 1 - start);
+    start = i + 1;
+  }
+  lengths.push_back(body.size() - start);
+  return lengths;
+}
+
+// Benchmark: Checking "/" once per file, the probe a crawler makes before its
+// first fetch, parsing every line (Arg 0) or skipping the groups for other
+// agents (Arg 1). Reports the share of the bytes skipped, over the corpus and
+// per file.
+static void BM_OneShotProbe(benchmark::State& state) {
+  LoadFilesOnce();
+  const bool skip = state.range(0) != 0;
+
+  size_t total_bytes = 0;
+  size_t skipped_bytes = 0;
+  std::vector<double> skipped_per_file;
+  for (const auto& robots_content : g_robots_files) {
+    LineRecordingMatcher matcher;
+    matcher.set_skip_other_groups(skip);
+    matcher.OneAgentAllowedByRobots(robots_content, "Googlebot", "/");
+    const std::vector<size_t> lengths = LineLengths(robots_content);
+    size_t parsed = 0;
+    for (int line : matcher.lines) parsed += lengths[line - 1];
+    total_bytes += robots_content.size();
+    skipped_bytes += robots_content.size() - parsed;
+    if (!robots_content.empty()) {
+      skipped_per_file.push_back(
+          static_cast<double>(robots_content.size() - parsed) /
+          robots_content.size());
+    }
+  }
+
+  for (auto _ : state) {
+    for (const auto& robots_content : g_robots_files) {
+      googlebot::RobotsMatcher matcher;
+      matcher.set_skip_other_groups(skip);
+      benchmark::DoNotOptimize(
+          matcher.OneAgentAllowedByRobots(robots_content, "Googlebot", "/"));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+  state.SetBytesProcessed(state.iterations() * total_bytes);
+  state.counters["skipped_bytes"] =
+      total_bytes == 0 ? 0.0
+                       : static_cast<double>(skipped_bytes) / total_bytes;
+  if (!skipped_per_file.empty()) {
+    std::sort(skipped_per_file.begin(), skipped_per_file.end());
+    const auto percentile = [&skipped_per_file](double p) {
+      return skipped_per_file[static_cast<size_t>(
+          p * (skipped_per_file.size() - 1))];
+    };
+    state.counters["file_skipped_p50"] = percentile(0.5);
+    state.counters["file_skipped_p90"] = percentile(0.9);
+    state.counters["file_skipped_max"] = skipped_per_file.back();
+  }
+}
+BENCHMARK(BM_OneShotProbe)->Arg(0)->Arg(1);
+
+// Benchmark: Heap allocations of a single RobotsMatcher check, which only
+// allocates for paths with '*' or '$'.
+static void BM_OneAgentAllocations(benchmark::State& state) {
+  const std::string_view robots_txt =
+      "User-agent: *\n"
+      "Disallow: /some/path\n"
+      "Allow: /some/path/to\n"
+      "Disallow: /*.php$\n"
+      "Disallow: /some/*/check\n"
+      "Allow: /some/%70ath/to/check\n"
+      "Disallow: /other\n";
+  const std::string_view url = "http://foo.bar/some/path/to/check?with=query";
+  googlebot::RobotsMatcher matcher;
+
+  const uint64_t allocations_before = g_num_allocations.load();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        matcher.OneAgentAllowedByRobots(robots_txt, "Googlebot", url));
+  }
+  state.counters["allocs_per_match"] = benchmark::Counter(
+      static_cast<double>(g_num_allocations.load() - allocations_before) /
+      state.iterations());
+}
+BENCHMARK(BM_OneAgentAllocations);
+
+// Benchmark: Directive key recognition alone, on a mix of keys roughly as
+// frequent as in real files.
+static void BM_ClassifyKeys(benchmark::State& state) {
+  const std::vector<std::string_view> keys = {
+      "Disallow", "Disallow", "Disallow", "Disallow", "disallow", "Allow",
+      "Allow",    "User-agent", "User-Agent", "Sitemap", "Crawl-delay",
+      "Disalow",  "Noindex",  "Host"};
+  bool is_acceptable_typo;
+  for (auto _ : state) {
+    for (std::string_view key : keys) {
+      benchmark::DoNotOptimize(
+          googlebot::ClassifyRobotsKey(key, &is_acceptable_typo));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_ClassifyKeys);
+
+// Benchmark: Cold start from robots.txt bodies, compiling every file, against
+// cold start from a pack, checking and looking up every file in place.
+static void BM_CompileAll(benchmark::State& state) {
+  LoadFilesOnce();
+
+  for (auto _ : state) {
+    for (const auto& robots_content : g_robots_files) {
+      googlebot::CompiledRobots compiled(robots_content);
+      benchmark::DoNotOptimize(compiled.num_rules());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+}
+BENCHMARK(BM_CompileAll);
+
+static void BM_LoadAllFromPack(benchmark::State& state) {
+  LoadFilesOnce();
+  googlebot::RobotsPack::Builder builder;
+  std::vector<std::string> keys;
+  for (const auto& robots_content : g_robots_files) {
+    keys.push_back(std::to_string(keys.size()));
+    builder.Add(keys.back(), robots_content);
+  }
+  const std::string data = builder.Finish();
+  // Aligned like a memory-mapped file.
+  std::vector<uint64_t> storage((data.size() + 7) / 8);
+  std::memcpy(storage.data(), data.data(), data.size());
+  const std::string_view mapped(reinterpret_cast<const char*>(storage.data()),
+                                data.size());
+
+  for (auto _ : state) {
+    const std::optional<googlebot::RobotsPack> pack =
+        googlebot::RobotsPack::Open(mapped);
+    for (const auto& key : keys) {
+      benchmark::DoNotOptimize(pack->Find(key)->num_rules());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+}
+BENCHMARK(BM_LoadAllFromPack);
+
+// Benchmark: Refetching every file and deciding whether the rules for an
+// agent changed. Arg 0 refetches the same bodies, which are only hashed; arg 1
+// bodies with one more line, which are compiled and diffed.
+static void BM_RefetchAll(benchmark::State& state) {
+  const std::vector<googlebot::CompiledRobots>& compiled = CompiledFiles();
+  const std::vector<std::string> agents = {"Googlebot"};
+  std::vector<std::string> refetched = g_robots_files;
+  if (state.range(0) != 0) {
+    for (std::string& body : refetched) body += "\nDisallow: /refetched\n";
+  }
+
+  googlebot::CompiledRobots::Diff diff;
+  for (auto _ : state) {
+    size_t unchanged = 0;
+    for (size_t i = 0; i < refetched.size(); ++i) {
+      const googlebot::CompiledRobots next =
+          googlebot::CompiledRobots::Recompile(compiled[i], refetched[i],
+                                               &diff);
+      unchanged += diff.identical || next.SameVerdicts(compiled[i], &agents);
+    }
+    benchmark::DoNotOptimize(unchanged);
+  }
+
+  state.SetItemsProcessed(state.iterations() * refetched.size());
+}
+BENCHMARK(BM_RefetchAll)->Arg(0)->Arg(1);
+
 // Benchmark: Just parsing without matching
 class NoOpHandler : public googlebot::RobotsParseHandler {
  public:
@@ -146,6 +708,318 @@ static void BM_ParseOnly(benchmark::State& state) {
 }
 BENCHMARK(BM_ParseOnly);
 
+// Benchmark: parsing bodies fed in chunks of the given size, as received from
+// the network.
+static void BM_StreamParseOnly(benchmark::State& state) {
+  LoadFilesOnce();
+  const size_t chunk_size = state.range(0);
+
+  for (auto _ : state) {
+    for (const auto& robots_content : g_robots_files) {
+      NoOpHandler handler;
+      googlebot::RobotsTxtStreamParser parser(&handler);
+      const std::string_view body(robots_content);
+      for (size_t pos = 0; pos < body.size(); pos += chunk_size) {
+        parser.Feed(body.substr(pos, chunk_size));
+      }
+      parser.Finish();
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+}
+BENCHMARK(BM_StreamParseOnly)->Arg(64)->Arg(1460)->Arg(16384);
+
+// Benchmark: RobotsParsingReporter (Arg 0), a new reporter per file, against
+// one FlatRobotsParsingReporter reused for all files (Arg 1), both reading the
+// results once.
+static void BM_ReportLines(benchmark::State& state) {
+  LoadFilesOnce();
+  const bool flat = state.range(0) != 0;
+  googlebot::FlatRobotsParsingReporter flat_reporter;
+  size_t lines = 0;
+
+  const uint64_t allocations_before = g_num_allocations.load();
+  for (auto _ : state) {
+    for (const auto& robots_content : g_robots_files) {
+      if (flat) {
+        googlebot::ParseRobotsTxt(robots_content, &flat_reporter);
+        lines += flat_reporter.parse_results().size();
+      } else {
+        googlebot::RobotsParsingReporter reporter;
+        googlebot::ParseRobotsTxt(robots_content, &reporter);
+        lines += reporter.parse_results().size();
+      }
+    }
+  }
+  benchmark::DoNotOptimize(lines);
+
+  state.SetItemsProcessed(state.iterations() * g_robots_files.size());
+  state.counters["allocs_per_file"] = benchmark::Counter(
+      static_cast<double>(g_num_allocations.load() - allocations_before) /
+      (state.iterations() * g_robots_files.size()));
+}
+BENCHMARK(BM_ReportLines)->Arg(0)->Arg(1);
+
+// Hostile robots.txt files for the wildcard matcher, generated from a fixed
+// seed: every line alternates '*' with bytes of the path and ends with a byte
+// the path lacks, so it never matches and keeps most of the path positions in
+// play up to its end.
+std::vector<std::string> WorstCaseRobotsTxts() {
+  std::mt19937 rng(9309);
+  std::vector<std::string> files;
+  for (int file = 0; file < 8; ++file) {
+    std::string body = "user-agent: *\n";
+    for (int line = 0; line < 100; ++line) {
+      body += "disallow: /";
+      const int num_wildcards = 1 + rng() % 32;
+      for (int i = 0; i < num_wildcards; ++i) {
+        body += '*';
+        body += "ab"[rng() % 2];
+      }
+      body += "*c\n";
+    }
+    files.push_back(std::move(body));
+  }
+  return files;
+}
+
+// Benchmark: RobotsMatcher on the files above, for a URL with a long path
+// over the same bytes, without limits (Arg 0) and within a MatchBudget
+// (Arg 1). Reports the fraction of checks that went over the budget.
+static void BM_WorstCaseWildcards(benchmark::State& state) {
+  const std::vector<std::string> files = WorstCaseRobotsTxts();
+  std::mt19937 rng(2083);
+  std::string url = "http://foo.bar/";
+  for (int i = 0; i < 1000; ++i) url += "ab"[rng() % 2];
+  googlebot::RobotsMatcher matcher;
+  if (state.range(0) != 0) {
+    googlebot::MatchBudget budget;
+    budget.max_wildcards = 32;
+    budget.max_steps = uint64_t{1} << 16;
+    matcher.set_match_budget(budget);
+  }
+  size_t exceeded = 0;
+  for (auto _ : state) {
+    for (const std::string& robots_content : files) {
+      benchmark::DoNotOptimize(
+          matcher.OneAgentAllowedByRobots(robots_content, "FooBot", url));
+      exceeded += matcher.budget_exceeded();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * files.size());
+  state.counters["exceeded"] = benchmark::Counter(
+      static_cast<double>(exceeded) / (state.iterations() * files.size()));
+}
+BENCHMARK(BM_WorstCaseWildcards)->Arg(0)->Arg(1);
+
+// A URL workload for the robots.txt files: "<file index>\t<url>" lines in
+// robots_files/robots_urls.tsv, taken from a crawl log or generated by
+// benchmark-utils/make-workload.py. Lines starting with '#' are comments. The
+// harnesses in benchmark-utils/ run the same checks.
+struct WorkloadCheck {
+  uint32_t file;
+  std::string url;
+};
+struct Workload {
+  std::vector<WorkloadCheck> checks;
+  // The URLs of 'checks' by file, in workload order.
+  std::vector<std::vector<std::string>> urls_by_file;
+};
+
+// Loaded once, also when the first callers are the threads of a benchmark.
+const Workload& GetWorkload() {
+  static const Workload* workload = [] {
+    LoadFilesOnce();
+    auto* w = new Workload();
+    std::ifstream in("robots_files/robots_urls.tsv");
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      const size_t tab = line.find('\t');
+      if (tab == std::string::npos) continue;
+      const unsigned long file = std::strtoul(line.c_str(), nullptr, 10);
+      if (file >= g_robots_files.size()) continue;
+      w->checks.push_back({static_cast<uint32_t>(file), line.substr(tab + 1)});
+    }
+    if (w->checks.empty()) {
+      fprintf(stderr, "Warning: No URL workload loaded!\n");
+    } else {
+      fprintf(stderr, "Loaded %zu URLs\n", w->checks.size());
+    }
+    w->urls_by_file.resize(g_robots_files.size());
+    for (const WorkloadCheck& check : w->checks) {
+      w->urls_by_file[check.file].push_back(check.url);
+    }
+    return w;
+  }();
+  return *workload;
+}
+
+// Returns the workload, or null after marking 'state' as skipped if there is
+// none.
+const Workload* GetWorkload(benchmark::State& state) {
+  const Workload& workload = GetWorkload();
+  if (workload.checks.empty()) {
+    state.SkipWithError("no URL workload");
+    return nullptr;
+  }
+  return &workload;
+}
+
+// The first 'n' agents of a crawler with several personas.
+std::vector<std::string> WorkloadAgents(int64_t n) {
+  const std::vector<std::string> agents = {"Googlebot", "Googlebot-Image",
+                                           "Googlebot-News"};
+  return std::vector<std::string>(agents.begin(), agents.begin() + n);
+}
+
+// Reports the checks per second, and which fraction of them was allowed to
+// compare verdicts with the other harnesses.
+void SetWorkloadCounters(benchmark::State& state, const Workload& workload,
+                         uint64_t allowed) {
+  const size_t checks = state.iterations() * workload.checks.size();
+  state.SetItemsProcessed(checks);
+  state.counters["allowed"] =
+      benchmark::Counter(static_cast<double>(allowed) / checks);
+}
+
+// Benchmark: Every check of the workload with RobotsMatcher, which parses the
+// robots.txt again for each URL, for 1 or 3 agents.
+static void BM_WorkloadReparse(benchmark::State& state) {
+  const Workload* workload = GetWorkload(state);
+  if (workload == nullptr) return;
+  const std::vector<std::string> agents = WorkloadAgents(state.range(0));
+  googlebot::RobotsMatcher matcher;
+  uint64_t allowed = 0;
+  for (auto _ : state) {
+    for (const WorkloadCheck& check : workload->checks) {
+      allowed += matcher.AllowedByRobots(g_robots_files[check.file], &agents,
+                                         check.url);
+    }
+  }
+  SetWorkloadCounters(state, *workload, allowed);
+}
+BENCHMARK(BM_WorkloadReparse)->ArgName("agents")->Arg(1)->Arg(3);
+
+// Benchmark: The same checks against the files compiled beforehand.
+static void BM_WorkloadCompiled(benchmark::State& state) {
+  const Workload* workload = GetWorkload(state);
+  if (workload == nullptr) return;
+  const std::vector<googlebot::CompiledRobots>& compiled = CompiledFiles();
+  const std::vector<std::string> agents = WorkloadAgents(state.range(0));
+  uint64_t allowed = 0;
+  for (auto _ : state) {
+    for (const WorkloadCheck& check : workload->checks) {
+      allowed += compiled[check.file].Allowed(&agents, check.url);
+    }
+  }
+  SetWorkloadCounters(state, *workload, allowed);
+}
+BENCHMARK(BM_WorkloadCompiled)->ArgName("agents")->Arg(1)->Arg(3);
+
+// Benchmark: Compiles each file and checks all its URLs in one MatchBatch(),
+// the end-to-end cost of the compiled path for a file seen once.
+static void BM_WorkloadCompileAndMatch(benchmark::State& state) {
+  const Workload* workload = GetWorkload(state);
+  if (workload == nullptr) return;
+  const std::vector<std::string> agents = WorkloadAgents(1);
+  std::vector<googlebot::CompiledRobots::MatchResult> results;
+  uint64_t allowed = 0;
+  for (auto _ : state) {
+    for (size_t file = 0; file < workload->urls_by_file.size(); ++file) {
+      const std::vector<std::string>& urls = workload->urls_by_file[file];
+      if (urls.empty()) continue;
+      const googlebot::CompiledRobots robots(g_robots_files[file]);
+      results.resize(urls.size());
+      robots.MatchBatch(&agents, urls.data(), urls.size(), results.data());
+      for (const auto& result : results) allowed += result.allowed;
+    }
+  }
+  SetWorkloadCounters(state, *workload, allowed);
+}
+BENCHMARK(BM_WorkloadCompileAndMatch);
+
+// Benchmark: MatchBatch() of the URLs of each file against its rules resolved
+// beforehand, with the full URL parse (Arg 0) or UrlMode::kTrustedCanonical
+// (Arg 1).
+static void BM_WorkloadResolvedBatch(benchmark::State& state) {
+  const Workload* workload = GetWorkload(state);
+  if (workload == nullptr) return;
+  const googlebot::UrlMode mode = state.range(0) != 0
+                                      ? googlebot::UrlMode::kTrustedCanonical
+                                      : googlebot::UrlMode::kParse;
+  const std::vector<std::string> agents = WorkloadAgents(1);
+  std::vector<googlebot::ResolvedRobots> resolved;
+  for (const googlebot::CompiledRobots& robots : CompiledFiles()) {
+    resolved.push_back(robots.Resolve(&agents));
+  }
+  std::vector<googlebot::CompiledRobots::MatchResult> results;
+  uint64_t allowed = 0;
+  for (auto _ : state) {
+    for (size_t file = 0; file < workload->urls_by_file.size(); ++file) {
+      const std::vector<std::string>& urls = workload->urls_by_file[file];
+      results.resize(urls.size());
+      resolved[file].MatchBatch(urls.data(), urls.size(), results.data(),
+                                mode);
+      for (const auto& result : results) allowed += result.allowed;
+    }
+  }
+  SetWorkloadCounters(state, *workload, allowed);
+}
+BENCHMARK(BM_WorkloadResolvedBatch)->ArgName("canonical")->Arg(0)->Arg(1);
+
+// Benchmark: Path extraction alone for the URLs of the workload, which is
+// where the ada-url and fallback builds differ (Arg 0), and with
+// UrlMode::kTrustedCanonical (Arg 1).
+static void BM_WorkloadUrlPath(benchmark::State& state) {
+  const Workload* workload = GetWorkload(state);
+  if (workload == nullptr) return;
+  const bool canonical = state.range(0) != 0;
+  std::string buffer;
+  for (auto _ : state) {
+    for (const WorkloadCheck& check : workload->checks) {
+      benchmark::DoNotOptimize(
+          canonical
+              ? googlebot::GetPathParamsQueryOfCanonicalUrl(check.url, &buffer)
+              : googlebot::GetPathParamsQuery(check.url, &buffer));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * workload->checks.size());
+}
+BENCHMARK(BM_WorkloadUrlPath)->ArgName("canonical")->Arg(0)->Arg(1);
+
+// Benchmark: The compiled checks split between threads, which share the
+// CompiledRobots without locking.
+static void BM_WorkloadCompiledThreaded(benchmark::State& state) {
+  const Workload* workload = GetWorkload(state);
+  if (workload == nullptr) return;
+  const std::vector<googlebot::CompiledRobots>& compiled = CompiledFiles();
+  const std::vector<std::string> agents = WorkloadAgents(1);
+  size_t checks = 0;
+  for (auto _ : state) {
+    for (size_t i = state.thread_index(); i < workload->checks.size();
+         i += state.threads()) {
+      const WorkloadCheck& check = workload->checks[i];
+      benchmark::DoNotOptimize(compiled[check.file].Allowed(&agents, check.url));
+      ++checks;
+    }
+  }
+  state.SetItemsProcessed(checks);
+}
+BENCHMARK(BM_WorkloadCompiledThreaded)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
 }  // namespace
 
-BENCHMARK_MAIN();
+// Run with --benchmark_out=<file> --benchmark_out_format=json to get the
+// results that benchmark-utils/results.py turns into BENCHMARK_RESULTS tables.
+int main(int argc, char** argv) {
+  benchmark::AddCustomContext("url_parser", ROBOTS_BENCHMARK_URL_PARSER);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
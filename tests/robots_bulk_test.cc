@@ -0,0 +1,174 @@
+#include "robots_bulk.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "reporting_robots.h"
+#include "robots.h"
+
+using ::googlebot::AnalyzeCorpus;
+using ::googlebot::CorpusAnalysis;
+using ::googlebot::CorpusAnalysisOptions;
+using ::googlebot::RobotsCorpus;
+using ::googlebot::RobotsParsedLine;
+
+namespace {
+
+// Appends 'body' to 'corpus' as one record.
+void AppendRecord(const std::string& body, std::string* corpus) {
+  const uint32_t length = body.size();
+  for (int i = 0; i < 4; ++i) corpus->push_back(length >> (8 * i) & 0xff);
+  corpus->append(body);
+}
+
+std::vector<std::string> TestBodies() {
+  std::vector<std::string> bodies = {
+      "",
+      "user-agent: *\ndisallow: /\n",
+      "user-agent: FooBot\ndisallow: /x\n\nuser-agent: *\nallow: /\n",
+      "# comment\nuseragent: BarBot\ndisalow: /y\nallow: /y/z\n",
+      "user-agent: *\ndisallow: /x\nsitemap: https://foo.com/s.xml\n"
+      "crawl-delay: 5\nfoo: bar\n",
+  };
+  // Enough files for several ranges.
+  for (int i = 0; i < 1000; ++i) {
+    bodies.push_back("user-agent: BarBot\ndisallow: /" + std::to_string(i) +
+                     "\n\nuser-agent: *\ndisallow: /y\n");
+  }
+  return bodies;
+}
+
+TEST(RobotsBulkTest, MatchesRobotsMatcher) {
+  const std::vector<std::string> bodies = TestBodies();
+  std::string data;
+  for (const std::string& body : bodies) AppendRecord(body, &data);
+  std::string error;
+  const std::unique_ptr<RobotsCorpus> corpus =
+      RobotsCorpus::FromData(data, &error);
+  ASSERT_NE(nullptr, corpus) << error;
+  EXPECT_EQ(bodies.size(), corpus->size());
+
+  CorpusAnalysisOptions options;
+  options.user_agents = {"FooBot", "BarBot"};
+  options.urls = {"https://foo.com/", "https://foo.com/x",
+                  "https://foo.com/y/z", "https://foo.com/7"};
+  for (size_t num_threads : {1, 4}) {
+    options.num_threads = num_threads;
+    const CorpusAnalysis analysis = AnalyzeCorpus(*corpus, options);
+    ASSERT_EQ(bodies.size(), analysis.num_files);
+    EXPECT_EQ(bodies.size(), analysis.stats.files);
+
+    std::vector<uint64_t> allowed_files(8, 0);
+    for (size_t file = 0; file < bodies.size(); ++file) {
+      for (size_t agent = 0; agent < 2; ++agent) {
+        for (size_t url = 0; url < 4; ++url) {
+          googlebot::RobotsMatcher matcher;
+          const bool allowed = matcher.OneAgentAllowedByRobots(
+              bodies[file], options.user_agents[agent], options.urls[url]);
+          EXPECT_EQ(allowed, analysis.allowed(file, agent, url))
+              << "file " << file << " agent " << agent << " url " << url;
+          allowed_files[agent * 4 + url] += allowed;
+        }
+      }
+    }
+    EXPECT_EQ(allowed_files, analysis.allowed_files);
+  }
+}
+
+TEST(RobotsBulkTest, CountsLikeReporter) {
+  const std::vector<std::string> bodies = TestBodies();
+  std::string data;
+  googlebot::RobotsCorpusStats expected;
+  for (const std::string& body : bodies) {
+    AppendRecord(body, &data);
+    googlebot::RobotsParsingReporter reporter;
+    googlebot::ParseRobotsTxt(body, &reporter);
+    bool has_typo = false;
+    for (const RobotsParsedLine& line : reporter.parse_results()) {
+      ++expected.tags[line.tag_name];
+      if (line.is_typo) {
+        ++expected.typos[line.tag_name];
+        has_typo = true;
+      }
+    }
+    expected.lines += reporter.last_line_seen();
+    expected.files_with_typos += has_typo;
+  }
+  const std::unique_ptr<RobotsCorpus> corpus = RobotsCorpus::FromData(data);
+  ASSERT_NE(nullptr, corpus);
+
+  CorpusAnalysisOptions options;
+  options.num_threads = 4;
+  const CorpusAnalysis analysis = AnalyzeCorpus(*corpus, options);
+  EXPECT_TRUE(analysis.verdicts.empty());
+  EXPECT_TRUE(analysis.allowed_files.empty());
+  EXPECT_EQ(data.size() - 4 * bodies.size(), analysis.stats.bytes);
+  EXPECT_EQ(expected.lines, analysis.stats.lines);
+  for (int i = 0; i < googlebot::RobotsCorpusStats::kNumTagNames; ++i) {
+    EXPECT_EQ(expected.tags[i], analysis.stats.tags[i]) << i;
+    EXPECT_EQ(expected.typos[i], analysis.stats.typos[i]) << i;
+  }
+  const uint64_t typos = ROBOTS_ALLOW_FREQUENT_TYPOS;
+  EXPECT_EQ(typos, analysis.stats.typos[RobotsParsedLine::kUserAgent]);
+  EXPECT_EQ(typos, analysis.stats.typos[RobotsParsedLine::kDisallow]);
+  EXPECT_EQ(typos, analysis.stats.files_with_typos);
+  EXPECT_EQ(1u, analysis.stats.comment_lines);
+}
+
+TEST(RobotsBulkTest, RejectsTruncatedRecords) {
+  std::string data;
+  AppendRecord("user-agent: *\n", &data);
+  AppendRecord("disallow: /\n", &data);
+  std::string error;
+  EXPECT_EQ(nullptr, RobotsCorpus::FromData(
+                         std::string_view(data).substr(0, data.size() - 1),
+                         &error));
+  EXPECT_EQ("truncated record at offset 18", error);
+  EXPECT_EQ(nullptr, RobotsCorpus::FromData(
+                         std::string_view(data).substr(0, 20), &error));
+  EXPECT_NE(nullptr, RobotsCorpus::FromData(data));
+}
+
+TEST(RobotsBulkTest, OpensFiles) {
+  std::string data;
+  AppendRecord("user-agent: *\ndisallow: /x\n", &data);
+  AppendRecord("user-agent: *\nallow: /\n", &data);
+  const std::string path = testing::TempDir() + "/robots_bulk_test.bin";
+  std::ofstream(path, std::ios::binary) << data;
+
+  std::string error;
+  const std::unique_ptr<RobotsCorpus> corpus =
+      RobotsCorpus::Open(path, &error);
+  ASSERT_NE(nullptr, corpus) << error;
+  EXPECT_EQ(2u, corpus->size());
+  EXPECT_EQ(data, corpus->data());
+  CorpusAnalysisOptions options;
+  options.user_agents = {"FooBot"};
+  options.urls = {"https://foo.com/x"};
+  const CorpusAnalysis analysis = AnalyzeCorpus(*corpus, options);
+  EXPECT_FALSE(analysis.allowed(0, 0, 0));
+  EXPECT_TRUE(analysis.allowed(1, 0, 0));
+
+  EXPECT_EQ(nullptr, RobotsCorpus::Open(path + ".missing", &error));
+  EXPECT_FALSE(error.empty());
+}
+
+TEST(RobotsBulkTest, EmptyCorpus) {
+  const std::unique_ptr<RobotsCorpus> corpus = RobotsCorpus::FromData("");
+  ASSERT_NE(nullptr, corpus);
+  EXPECT_EQ(0u, corpus->size());
+
+  CorpusAnalysisOptions options;
+  options.user_agents = {"FooBot"};
+  options.urls = {"https://foo.com/"};
+  const CorpusAnalysis analysis = AnalyzeCorpus(*corpus, options);
+  EXPECT_EQ(0u, analysis.stats.files);
+  EXPECT_EQ(std::vector<uint64_t>{0}, analysis.allowed_files);
+  EXPECT_TRUE(analysis.verdicts.empty());
+}
+
+}  // namespace
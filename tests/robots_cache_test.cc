@@ -0,0 +1,271 @@
+#include "robots_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "robots.h"
+
+using ::googlebot::RobotsCache;
+
+namespace {
+
+// Fake time for the expiry tests.
+RobotsCache::Clock::time_point fake_now;
+RobotsCache::Clock::time_point FakeNow() { return fake_now; }
+
+const std::vector<std::string> kAgents = {"FooBot"};
+
+TEST(RobotsCacheTest, InsertAndLookup) {
+  RobotsCache cache;
+  EXPECT_EQ(nullptr, cache.Lookup("http://foo.com"));
+
+  cache.Insert("http://foo.com", "user-agent: *\ndisallow: /x\n");
+  RobotsCache::Entry robots = cache.Lookup("http://foo.com");
+  ASSERT_NE(nullptr, robots);
+  EXPECT_FALSE(robots->Allowed(&kAgents, "http://foo.com/x"));
+  EXPECT_TRUE(robots->Allowed(&kAgents, "http://foo.com/y"));
+  EXPECT_EQ(nullptr, cache.Lookup("http://bar.com"));
+
+  // Inserting again replaces the entry.
+  cache.Insert("http://foo.com", "user-agent: *\ndisallow: /y\n");
+  robots = cache.Lookup("http://foo.com");
+  ASSERT_NE(nullptr, robots);
+  EXPECT_TRUE(robots->Allowed(&kAgents, "http://foo.com/x"));
+  EXPECT_FALSE(robots->Allowed(&kAgents, "http://foo.com/y"));
+
+  const RobotsCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(2u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(2u, stats.compilations);
+  EXPECT_EQ(1u, stats.entries);
+  EXPECT_LT(0u, stats.bytes);
+
+  cache.Erase("http://foo.com");
+  EXPECT_EQ(nullptr, cache.Lookup("http://foo.com"));
+  EXPECT_EQ(0u, cache.GetStats().entries);
+  EXPECT_EQ(0u, cache.GetStats().bytes);
+}
+
+TEST(RobotsCacheTest, Expiry) {
+  RobotsCache::Options options;
+  options.now = &FakeNow;
+  RobotsCache cache(options);
+
+  cache.Insert("http://foo.com", "", std::chrono::seconds(10));
+  cache.Insert("http://bar.com", "");  // 24 hours by default.
+  fake_now += std::chrono::seconds(9);
+  EXPECT_NE(nullptr, cache.Lookup("http://foo.com"));
+  fake_now += std::chrono::seconds(1);
+  EXPECT_EQ(nullptr, cache.Lookup("http://foo.com"));
+  EXPECT_NE(nullptr, cache.Lookup("http://bar.com"));
+
+  const RobotsCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(1u, stats.expirations);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(1u, stats.entries);
+}
+
+TEST(RobotsCacheTest, EvictsLeastRecentlyUsed) {
+  // Distinct bodies of the same size, so that entries don't share memory.
+  size_t entry_bytes;
+  {
+    RobotsCache cache;
+    cache.Insert("http://a.com", "user-agent: *\ndisallow: /a\n");
+    entry_bytes = cache.GetStats().bytes;
+  }
+  RobotsCache::Options options;
+  options.num_shards = 1;
+  options.max_bytes = 3 * entry_bytes;
+  RobotsCache cache(options);
+
+  cache.Insert("http://a.com", "user-agent: *\ndisallow: /a\n");
+  cache.Insert("http://b.com", "user-agent: *\ndisallow: /b\n");
+  cache.Insert("http://c.com", "user-agent: *\ndisallow: /c\n");
+  EXPECT_EQ(0u, cache.GetStats().evictions);
+  EXPECT_EQ(3 * entry_bytes, cache.GetStats().bytes);
+  // 'a' is used again, so 'b' goes first.
+  EXPECT_NE(nullptr, cache.Lookup("http://a.com"));
+  cache.Insert("http://d.com", "user-agent: *\ndisallow: /d\n");
+
+  EXPECT_EQ(1u, cache.GetStats().evictions);
+  EXPECT_EQ(nullptr, cache.Lookup("http://b.com"));
+  EXPECT_NE(nullptr, cache.Lookup("http://a.com"));
+  EXPECT_NE(nullptr, cache.Lookup("http://c.com"));
+  EXPECT_NE(nullptr, cache.Lookup("http://d.com"));
+  EXPECT_GE(options.max_bytes, cache.GetStats().bytes);
+
+  // Returned entries outlive their eviction.
+  RobotsCache::Entry a = cache.Lookup("http://a.com");
+  cache.Clear();
+  EXPECT_EQ(0u, cache.GetStats().entries);
+  EXPECT_EQ(0u, cache.GetStats().bytes);
+  EXPECT_FALSE(a->Allowed(&kAgents, "http://a.com/a"));
+}
+
+TEST(RobotsCacheTest, EvictsFromOtherShards) {
+  size_t entry_bytes;
+  {
+    RobotsCache cache;
+    cache.Insert("http://a.com", "user-agent: *\ndisallow: /a\n");
+    entry_bytes = cache.GetStats().bytes;
+  }
+  RobotsCache::Options options;
+  options.num_shards = 16;
+  options.max_bytes = 4 * entry_bytes;
+  RobotsCache cache(options);
+  for (char c = 'a'; c <= 'z'; ++c) {
+    cache.Insert(std::string("http://") + c + ".com",
+                 std::string("user-agent: *\ndisallow: /") + c + "\n");
+    EXPECT_GE(options.max_bytes, cache.GetStats().bytes);
+  }
+  EXPECT_EQ(4u, cache.GetStats().entries);
+  EXPECT_EQ(22u, cache.GetStats().evictions);
+  EXPECT_NE(nullptr, cache.Lookup("http://z.com"));
+}
+
+TEST(RobotsCacheTest, InternsIdenticalBodies) {
+  const std::string body = "user-agent: *\ndisallow: /private\n";
+  RobotsCache cache;
+  EXPECT_EQ(nullptr, cache.FindCompiled(body));
+
+  RobotsCache::Entry a = cache.Insert("http://a.com", body);
+  const size_t one_entry_bytes = cache.GetStats().bytes;
+  RobotsCache::Entry b = cache.Insert("http://b.com", body);
+  cache.Insert("http://c.com", "user-agent: *\ndisallow: /\n");
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a, cache.FindCompiled(body));
+  EXPECT_EQ(nullptr, cache.FindCompiled(body + "\n"));
+  EXPECT_NE(a, cache.Lookup("http://c.com"));
+
+  RobotsCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(2u, stats.compilations);
+  EXPECT_EQ(1u, stats.interned);
+  EXPECT_EQ(3u, stats.entries);
+  EXPECT_EQ(2u, stats.unique_robots);
+
+  // The shared CompiledRobots is released with its last entry.
+  cache.Erase("http://a.com");
+  EXPECT_EQ(a, cache.FindCompiled(body));
+  cache.Erase("http://b.com");
+  EXPECT_EQ(nullptr, cache.FindCompiled(body));
+  stats = cache.GetStats();
+  EXPECT_EQ(1u, stats.unique_robots);
+  cache.Erase("http://c.com");
+  EXPECT_EQ(0u, cache.GetStats().bytes);
+
+  // The second entry only costs its key and bookkeeping.
+  cache.Insert("http://a.com", body);
+  cache.Insert("http://b.com", body);
+  EXPECT_GT(2 * one_entry_bytes, cache.GetStats().bytes);
+
+  // Only the digest of a body is kept, not the body.
+  cache.Clear();
+  const std::string commented = body + "# " + std::string(100000, 'x') + "\n";
+  cache.Insert("http://a.com", commented);
+  EXPECT_EQ(cache.Lookup("http://a.com"), cache.FindCompiled(commented));
+  EXPECT_GT(commented.size(), cache.GetStats().bytes);
+}
+
+TEST(RobotsCacheTest, InterningDisabled) {
+  const std::string body = "user-agent: *\ndisallow: /private\n";
+  RobotsCache::Options options;
+  options.intern_bodies = false;
+  RobotsCache cache(options);
+  RobotsCache::Entry a = cache.Insert("http://a.com", body);
+  RobotsCache::Entry b = cache.Insert("http://b.com", body);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(nullptr, cache.FindCompiled(body));
+
+  const RobotsCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(2u, stats.compilations);
+  EXPECT_EQ(0u, stats.interned);
+  EXPECT_EQ(2u, stats.unique_robots);
+}
+
+TEST(RobotsCacheTest, ConcurrentInterning) {
+  RobotsCache::Options options;
+  options.num_shards = 4;
+  RobotsCache cache(options);
+  constexpr int kNumThreads = 8;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&cache, t]() {
+      for (int i = 0; i < 200; ++i) {
+        const std::string host =
+            "http://" + std::to_string((t * 200 + i) % 50) + ".com";
+        const std::string body =
+            "user-agent: *\ndisallow: /" + std::to_string(i % 5) + "\n";
+        RobotsCache::Entry robots = cache.Insert(host, body);
+        EXPECT_FALSE(robots->Allowed(&kAgents, "http://x.com/" +
+                                                   std::to_string(i % 5)));
+        if (i % 7 == 0) cache.Erase(host);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const RobotsCache::Stats stats = cache.GetStats();
+  EXPECT_GE(5u, stats.unique_robots);
+  EXPECT_EQ(uint64_t{kNumThreads * 200}, stats.compilations + stats.interned);
+  cache.Clear();
+  EXPECT_EQ(0u, cache.GetStats().bytes);
+  EXPECT_EQ(0u, cache.GetStats().unique_robots);
+}
+
+TEST(RobotsCacheTest, GetOrCompileFetchesOnce) {
+  RobotsCache cache;
+  std::atomic<int> num_fetches{0};
+  auto fetch = [&num_fetches]() {
+    ++num_fetches;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return std::string("user-agent: *\ndisallow: /\n");
+  };
+
+  constexpr int kNumThreads = 8;
+  std::vector<std::thread> threads;
+  std::atomic<int> num_disallowed{0};
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&]() {
+      RobotsCache::Entry robots = cache.GetOrCompile("http://foo.com", fetch);
+      if (!robots->Allowed(&kAgents, "http://foo.com/")) ++num_disallowed;
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(1, num_fetches.load());
+  EXPECT_EQ(kNumThreads, num_disallowed.load());
+  EXPECT_EQ(1u, cache.GetStats().compilations);
+
+  // Cached now.
+  cache.GetOrCompile("http://foo.com", fetch);
+  EXPECT_EQ(1, num_fetches.load());
+}
+
+TEST(RobotsCacheTest, GetOrCompileFetchFailure) {
+  RobotsCache cache;
+  auto failing_fetch = []() -> std::string {
+    throw std::runtime_error("unreachable");
+  };
+  EXPECT_THROW(cache.GetOrCompile("http://foo.com", failing_fetch),
+               std::runtime_error);
+  EXPECT_EQ(nullptr, cache.Lookup("http://foo.com"));
+
+  // The next call fetches again.
+  RobotsCache::Entry robots =
+      cache.GetOrCompile("http://foo.com", []() { return std::string(); });
+  ASSERT_NE(nullptr, robots);
+  EXPECT_TRUE(robots->Allowed(&kAgents, "http://foo.com/"));
+}
+
+TEST(RobotsCacheTest, Shared) {
+  RobotsCache& shared = RobotsCache::Shared();
+  EXPECT_EQ(&shared, &RobotsCache::Shared());
+  EXPECT_FALSE(RobotsCache::InitShared(RobotsCache::Options()));
+}
+
+}  // namespace
@@ -17,10 +17,16 @@
 // https://www.rfc-editor.org/rfc/rfc9309.html
 #include "robots.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -201,6 +207,7 @@ TEST(RobotsUnittest, ID_LineSyntax_Groups_OtherRules) {
   }
 }
 
+#if ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
 // Test Crawl-delay parsing and retrieval via GetCrawlDelay().
 TEST(RobotsUnittest, ID_CrawlDelay) {
   // Test basic crawl-delay parsing.
@@ -254,6 +261,7 @@ TEST(RobotsUnittest, ID_CrawlDelay) {
     auto delay = matcher.GetCrawlDelay();
     EXPECT_FALSE(delay.has_value());
   }
+#if ROBOTS_ALLOW_FREQUENT_TYPOS
   // Test crawl-delay with typo variant "crawldelay".
   {
     const std::string_view robotstxt =
@@ -266,6 +274,7 @@ TEST(RobotsUnittest, ID_CrawlDelay) {
     ASSERT_TRUE(delay.has_value());
     EXPECT_DOUBLE_EQ(3.0, delay.value());
   }
+#endif  // ROBOTS_ALLOW_FREQUENT_TYPOS
   // Test crawl-delay with invalid value (should be 0).
   {
     const std::string_view robotstxt =
@@ -292,6 +301,56 @@ TEST(RobotsUnittest, ID_CrawlDelay) {
   }
 }
 
+// Crawl-delay and Request-rate values are read like strtod() and strtol() read
+// them in the "C" locale, including their odd corners.
+TEST(RobotsUnittest, ID_NumericValuesLikeStrtod) {
+  const std::vector<std::string> agents = {"Googlebot"};
+  for (const std::string value :
+       {"10", "0.5", ".5", "5.", "1e3", "1e", "1e+", "+2", "-0", "+-2", "0x10",
+        "0x", "0x.8p1", "0xg", "1e999", "-1e999", "1e-999", "4.9e-324", "inf",
+        "infinity", "nan", "12abc", "1,5", "1/5s", "30/60", "4294967297/5",
+        "1/4294967301", "5/ 7", "5/-7", "5/", "/5", "-5/3",
+        "99999999999999999999"}) {
+    const std::string robotstxt = "User-agent: *\nCrawl-delay: " + value +
+                                  "\nRequest-rate: " + value + "\n";
+    char* end = nullptr;
+    double delay = std::strtod(value.c_str(), &end);
+    if (end == value.c_str() || delay < 0) delay = 0.0;
+    googlebot::RequestRate rate;
+    const long requests = std::strtol(value.c_str(), &end, 10);
+    if (end != value.c_str() && requests > 0) {
+      rate.requests = static_cast<int>(requests);
+      if (*end == '/') {
+        const char* seconds_start = end + 1;
+        const long seconds = std::strtol(seconds_start, &end, 10);
+        if (end != seconds_start && seconds > 0) {
+          rate.seconds = static_cast<int>(seconds);
+        }
+      }
+    }
+
+    googlebot::RobotsMatcher matcher;
+    matcher.AllowedByRobots(robotstxt, &agents, "http://example.com/");
+    const googlebot::CompiledRobots compiled(robotstxt);
+    const googlebot::ResolvedRobots resolved = compiled.Resolve(&agents);
+    for (const std::optional<double>& parsed :
+         {matcher.GetCrawlDelay(), resolved.GetCrawlDelay()}) {
+      ASSERT_TRUE(parsed.has_value()) << value;
+      if (std::isnan(delay)) {
+        EXPECT_TRUE(std::isnan(*parsed)) << value;
+      } else {
+        EXPECT_EQ(delay, *parsed) << value;
+      }
+    }
+    for (const std::optional<googlebot::RequestRate>& parsed :
+         {matcher.GetRequestRate(), resolved.GetRequestRate()}) {
+      ASSERT_TRUE(parsed.has_value()) << value;
+      EXPECT_EQ(rate.requests, parsed->requests) << value;
+      EXPECT_EQ(rate.seconds, parsed->seconds) << value;
+    }
+  }
+}
+
 TEST(RobotsUnittest, ID_RequestRate) {
   // Test basic request-rate parsing (requests/seconds format).
   {
@@ -379,6 +438,7 @@ TEST(RobotsUnittest, ID_RequestRate) {
     EXPECT_EQ(1, rate.value().seconds);
   }
 }
+#endif  // ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
 
 #if ROBOTS_SUPPORT_CONTENT_SIGNAL
 // Test Content-Signal parsing and retrieval via GetContentSignal().
@@ -844,10 +904,12 @@ TEST(RobotsUnittest, ID_Encoding) {
     EXPECT_TRUE(IsUserAgentAllowed(
         robotstxt, "FooBot",
         "http://foo.bar/foo/bar?qux=taz&baz=http://foo.bar?tar&par"));
+#if ROBOTS_DECODE_PERCENT_ESCAPES
     // RFC-compliant encoded URL should also match
     EXPECT_TRUE(IsUserAgentAllowed(
         robotstxt, "FooBot",
         "http://foo.bar/foo/bar?qux=taz&baz=http%3A%2F%2Ffoo.bar%3Ftar%26par"));
+#endif  // ROBOTS_DECODE_PERCENT_ESCAPES
   }
   // Test with already-encoded rule
   {
@@ -859,10 +921,12 @@ TEST(RobotsUnittest, ID_Encoding) {
     EXPECT_TRUE(IsUserAgentAllowed(
         robotstxt, "FooBot",
         "http://foo.bar/foo/bar?qux=taz&baz=http%3A%2F%2Ffoo.bar%3Ftar%26par"));
+#if ROBOTS_DECODE_PERCENT_ESCAPES
     // Unencoded URL should also match (gets normalized to encoded form)
     EXPECT_TRUE(IsUserAgentAllowed(
         robotstxt, "FooBot",
         "http://foo.bar/foo/bar?qux=taz&baz=http://foo.bar?tar&par"));
+#endif  // ROBOTS_DECODE_PERCENT_ESCAPES
   }
 
   // 3 byte character: /foo/bar/ツ -> /foo/bar/%E3%83%84
@@ -876,9 +940,11 @@ TEST(RobotsUnittest, ID_Encoding) {
     // Encoded URL matches (rule's ツ is encoded to %E3%83%84, then decoded for comparison)
     EXPECT_TRUE(IsUserAgentAllowed(robotstxt, "FooBot",
                                    "http://foo.bar/foo/bar/%E3%83%84"));
+#if ROBOTS_DECODE_PERCENT_ESCAPES
     // Raw UTF-8 URL also matches (both are decoded/compared as raw bytes)
     EXPECT_TRUE(
         IsUserAgentAllowed(robotstxt, "FooBot", "http://foo.bar/foo/bar/ツ"));
+#endif  // ROBOTS_DECODE_PERCENT_ESCAPES
   }
   // Percent encoded 3 byte character: /foo/bar/%E3%83%84 -> /foo/bar/%E3%83%84
   {
@@ -889,9 +955,11 @@ TEST(RobotsUnittest, ID_Encoding) {
     // Encoded URL matches encoded rule
     EXPECT_TRUE(IsUserAgentAllowed(robotstxt, "FooBot",
                                    "http://foo.bar/foo/bar/%E3%83%84"));
+#if ROBOTS_DECODE_PERCENT_ESCAPES
     // Raw UTF-8 URL also matches (decoded for comparison per RFC 9309)
     EXPECT_TRUE(
         IsUserAgentAllowed(robotstxt, "FooBot", "http://foo.bar/foo/bar/ツ"));
+#endif  // ROBOTS_DECODE_PERCENT_ESCAPES
   }
   // Percent encoded unreserved US-ASCII: /foo/bar/%62%61%7A matches /foo/bar/baz
   // Per RFC 9309 section 2.2.2: "If a percent-encoded ASCII octet is encountered
@@ -899,6 +967,7 @@ TEST(RobotsUnittest, ID_Encoding) {
   // character in the URI as defined by RFC3986..."
   // Note: While encoding unreserved chars is discouraged by RFC 3986, RFC 9309
   // requires decoding them for comparison.
+#if ROBOTS_DECODE_PERCENT_ESCAPES
   {
     const std::string_view robotstxt =
         "User-agent: FooBot\n"
@@ -910,6 +979,20 @@ TEST(RobotsUnittest, ID_Encoding) {
     EXPECT_TRUE(IsUserAgentAllowed(robotstxt, "FooBot",
                                    "http://foo.bar/foo/bar/%62%61%7A"));
   }
+  // The other way around: a plain rule matches the percent-encoded URL.
+  {
+    const std::string_view robotstxt =
+        "User-agent: FooBot\n"
+        "Disallow: /\n"
+        "Allow: /foo/bar/baz\n";
+    EXPECT_TRUE(IsUserAgentAllowed(robotstxt, "FooBot",
+                                   "http://foo.bar/foo/bar/%62%61%7A"));
+    EXPECT_TRUE(IsUserAgentAllowed(robotstxt, "FooBot",
+                                   "http://foo.bar/foo/bar/b%61zaar"));
+    EXPECT_FALSE(IsUserAgentAllowed(robotstxt, "FooBot",
+                                    "http://foo.bar/foo/bar/%62%61"));
+  }
+#endif  // ROBOTS_DECODE_PERCENT_ESCAPES
 }
 
 // Per RFC 9309 section 2.2.3, percent-encoded special characters (%2A for *,
@@ -1013,14 +1096,15 @@ TEST(RobotsUnittest, ID_SpecialCharacters) {
 }
 
 // Google-specific: "index.html" (and only that) at the end of a pattern is
-// equivalent to "/".
+// equivalent to "/", unless built without ROBOTS_NORMALIZE_INDEX_HTML.
 TEST(RobotsUnittest, GoogleOnly_IndexHTMLisDirectory) {
   const std::string_view robotstxt =
       "User-Agent: *\n"
       "Allow: /allowed-slash/index.html\n"
       "Disallow: /\n";
   // If index.html is allowed, we interpret this as / being allowed too.
-  EXPECT_TRUE(
+  EXPECT_EQ(
+      ROBOTS_NORMALIZE_INDEX_HTML != 0,
       IsUserAgentAllowed(robotstxt, "foobot", "http://foo.com/allowed-slash/"));
   // Does not exatly match.
   EXPECT_FALSE(IsUserAgentAllowed(robotstxt, "foobot",
@@ -1434,6 +1518,31 @@ TEST(RobotsUnittest, ID_LinesNumbersAreCountedCorrectly) {
   EXPECT_EQ(6, report.last_line_seen());
 }
 
+// Line endings are found wherever they fall relative to the 16 and 32 byte
+// blocks the parser scans at a time.
+TEST(RobotsUnittest, ID_LineEndingsAtAnyOffset) {
+  static const char* const kLineEndings[] = {"\n", "\r", "\r\n"};
+  std::string robotstxt;
+  std::string sitemaps;
+  int lines = 0;
+  for (int length = 1; length < 100; ++length) {
+    const std::string value(length, 'a' + length % 26);
+    robotstxt += "Sitemap: " + value + kLineEndings[length % 3];
+    sitemaps += value;
+    ++lines;
+    if (length % 7 == 0) {
+      // An empty line between two CRs.
+      robotstxt += "\r";
+      ++lines;
+    }
+  }
+  RobotsStatsReporter report;
+  googlebot::ParseRobotsTxt(robotstxt, &report);
+  EXPECT_EQ(99, report.valid_directives());
+  EXPECT_EQ(lines, report.last_line_seen());
+  EXPECT_EQ(sitemaps, report.sitemap());
+}
+
 // BOM characters are unparseable and thus skipped. The rules following the line
 // are used.
 TEST(RobotsUnittest, ID_UTF8ByteOrderMarkIsSkipped) {
@@ -1483,6 +1592,224 @@ TEST(RobotsUnittest, ID_UTF8ByteOrderMarkIsSkipped) {
   EXPECT_EQ(1, report.unknown_directives());
 }
 
+// Records every parse callback, to compare parses of the same body.
+class RobotsTraceHandler : public googlebot::RobotsParseHandler {
+ public:
+  // Stops parsing after line 'stop_after_line' if positive.
+  explicit RobotsTraceHandler(int stop_after_line = 0)
+      : stop_after_line_(stop_after_line) {}
+
+  void HandleRobotsStart() override {
+    trace_.clear();
+    last_line_ = 0;
+    Add("start");
+  }
+  void HandleRobotsEnd() override { Add("end"); }
+  void HandleUserAgent(int line_num, std::string_view value) override {
+    Add(StrCat(line_num, " user-agent ", value));
+  }
+  void HandleAllow(int line_num, std::string_view value) override {
+    Add(StrCat(line_num, " allow ", value));
+  }
+  void HandleDisallow(int line_num, std::string_view value) override {
+    Add(StrCat(line_num, " disallow ", value));
+  }
+  void HandleSitemap(int line_num, std::string_view value) override {
+    Add(StrCat(line_num, " sitemap ", value));
+  }
+  void HandleCrawlDelay(int line_num, double value) override {
+    Add(StrCat(line_num, " crawl-delay ", value));
+  }
+  void HandleRequestRate(int line_num,
+                         const googlebot::RequestRate& rate) override {
+    Add(StrCat(line_num, " request-rate ", rate.requests, "/", rate.seconds));
+  }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleContentSignal(int line_num,
+                           const googlebot::ContentSignal& signal) override {
+    Add(StrCat(line_num, " content-signal ", signal.ai_train.value_or(false)));
+  }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  void HandleUnknownAction(int line_num, std::string_view action,
+                           std::string_view value) override {
+    Add(StrCat(line_num, " unknown ", action, " ", value.size()));
+  }
+  void ReportLineMetadata(int line_num, const LineMetadata& metadata) override {
+    last_line_ = line_num;
+    Add(StrCat(line_num, " metadata ", metadata.is_empty, metadata.has_comment,
+               metadata.is_comment, metadata.has_directive,
+               metadata.is_acceptable_typo, metadata.is_line_too_long,
+               metadata.is_missing_colon_separator));
+  }
+  bool CanStopParsing() const override {
+    return stop_after_line_ > 0 && last_line_ >= stop_after_line_;
+  }
+
+  const std::vector<std::string>& trace() const { return trace_; }
+
+ private:
+  void Add(std::string event) { trace_.push_back(std::move(event)); }
+
+  const int stop_after_line_;
+  int last_line_ = 0;
+  std::vector<std::string> trace_;
+};
+
+std::vector<std::string> TraceOfParse(std::string_view robotstxt) {
+  RobotsTraceHandler handler;
+  googlebot::ParseRobotsTxt(robotstxt, &handler);
+  return handler.trace();
+}
+
+std::vector<std::string> TraceOfStreamParse(
+    const std::vector<std::string_view>& chunks) {
+  RobotsTraceHandler handler;
+  googlebot::RobotsTxtStreamParser parser(&handler);
+  for (std::string_view chunk : chunks) parser.Feed(chunk);
+  parser.Finish();
+  return handler.trace();
+}
+
+// The stream parser emits the same callbacks as ParseRobotsTxt() wherever the
+// body is split.
+TEST(RobotsUnittest, StreamParser_SameCallbacksAsParser) {
+  const std::string long_line =
+      "Disallow: /" + std::string(2083 * 8, 'a') + "\n";
+  const std::vector<std::string> bodies = {
+      "",
+      "\n",
+      "\r\n",
+      "\r\r\n\n",
+      "\xEF\xBB\xBF"
+      "User-Agent: foo\r\nAllow: /x\r\n",
+      "\xEF\xBB"
+      "User-Agent: foo\n",
+      "\xEF\xEF\xBB\xBF"
+      "User-Agent: foo\n",
+      "\xEF",
+      "User-Agent: foo\n"
+      "Allow: /some/path\r\n"
+      "User-Agent: bar\r"
+      "\r\n"
+      "disalow /typo # comment\n"
+      "# just a comment\n"
+      "Crawl-delay: 1.5\n"
+      "Request-rate: 1/5\n"
+      "Sitemap: http://foo.com/sitemap.xml\n"
+      "Unknown: value\n"
+      "Disallow: /no/final/newline",
+      "User-Agent: *\n" + long_line + "Allow: /\n",
+      long_line.substr(0, long_line.size() - 1),
+  };
+  for (const std::string& body : bodies) {
+    SCOPED_TRACE(body.substr(0, 80));
+    const std::vector<std::string> expected = TraceOfParse(body);
+    EXPECT_EQ(expected, TraceOfStreamParse({body}));
+    EXPECT_EQ(expected, TraceOfStreamParse({"", body, ""}));
+
+    // Split in two everywhere, and in chunks of every size for short bodies.
+    const std::string_view view(body);
+    for (size_t split = 0; split <= body.size(); split += 1 + split / 64) {
+      EXPECT_EQ(expected,
+                TraceOfStreamParse({view.substr(0, split), view.substr(split)}))
+          << "split at " << split;
+    }
+    for (size_t size = 1; size <= 7 && body.size() < 1000; ++size) {
+      std::vector<std::string_view> chunks;
+      for (size_t pos = 0; pos < body.size(); pos += size) {
+        chunks.push_back(view.substr(pos, size));
+      }
+      EXPECT_EQ(expected, TraceOfStreamParse(chunks)) << "chunks of " << size;
+    }
+  }
+}
+
+// Both parsers stop after the line where the handler can stop.
+TEST(RobotsUnittest, StreamParser_StopsEarly) {
+  const std::string body =
+      "User-Agent: *\n"
+      "Disallow: /\n"
+      "Allow: /x\n"
+      "Sitemap: http://foo.com/sitemap.xml\n";
+  RobotsTraceHandler handler(2);
+  googlebot::ParseRobotsTxt(body, &handler);
+  const std::vector<std::string> expected = {
+      "start", "1 user-agent *", "1 metadata 0001000",
+      "2 disallow /", "2 metadata 0001000", "end"};
+  EXPECT_EQ(expected, handler.trace());
+
+  const std::string_view view(body);
+  RobotsTraceHandler stream_handler(2);
+  googlebot::RobotsTxtStreamParser parser(&stream_handler);
+  EXPECT_TRUE(parser.Feed(view.substr(0, 20)));
+  EXPECT_FALSE(parser.stopped());
+  EXPECT_FALSE(parser.Feed(view.substr(20, 10)));
+  EXPECT_TRUE(parser.stopped());
+  EXPECT_FALSE(parser.Feed(view.substr(30)));
+  parser.Finish();
+  EXPECT_EQ(expected, stream_handler.trace());
+}
+
+// Records the lines that RobotsMatcher parses.
+class LineRecordingMatcher : public RobotsMatcher {
+ public:
+  std::vector<int> lines;
+
+ protected:
+  void ReportLineMetadata(int line_num, const LineMetadata& metadata) override {
+    lines.push_back(line_num);
+  }
+};
+
+// The lines of groups for other agents are skipped, without changing results.
+TEST(RobotsUnittest, RobotsMatcher_SkipsOtherGroups) {
+  const std::string robotstxt =
+      "Disallow: /before-any-group\n"
+      "User-agent: BarBot\n"
+      "Disallow: /\n"
+      "Crawl-delay: 10\n"
+      "  user-agent: FooBot\n"
+      "Disallow: /foo\n"
+      "User-agent: BazBot\n"
+      "Allow: /\n"
+      "useragent: *\n"
+      "Disallow: /star\n";
+  LineRecordingMatcher matcher;
+  EXPECT_TRUE(matcher.skip_other_groups());
+  EXPECT_FALSE(matcher.OneAgentAllowedByRobots(robotstxt, "FooBot",
+                                               "http://foo.com/foo"));
+#if ROBOTS_ALLOW_FREQUENT_TYPOS
+  EXPECT_EQ(std::vector<int>({2, 5, 6, 7, 9, 10, 11}), matcher.lines);
+#else
+  // Line 9 looks like a user-agent line, but "useragent" is not one, so the
+  // group of BazBot goes on.
+  EXPECT_EQ(std::vector<int>({2, 5, 6, 7, 9}), matcher.lines);
+#endif  // ROBOTS_ALLOW_FREQUENT_TYPOS
+  EXPECT_EQ(6, matcher.matching_line());
+  EXPECT_FALSE(matcher.GetCrawlDelay().has_value());
+
+  const std::vector<std::pair<std::string, std::string>> queries = {
+      {"FooBot", "http://foo.com/"},     {"FooBot", "http://foo.com/star"},
+      {"BarBot", "http://foo.com/x"},    {"BazBot", "http://foo.com/star"},
+      {"QuxBot", "http://foo.com/star"}, {"QuxBot", "http://foo.com/x"},
+      {"QuxBot", "http://foo.com/before-any-group"}};
+  for (const auto& [agent, url] : queries) {
+    SCOPED_TRACE(agent + " " + url);
+    RobotsMatcher skipping;
+    RobotsMatcher parsing;
+    parsing.set_skip_other_groups(false);
+    EXPECT_EQ(parsing.OneAgentAllowedByRobots(robotstxt, agent, url),
+              skipping.OneAgentAllowedByRobots(robotstxt, agent, url));
+    EXPECT_EQ(parsing.matching_line(), skipping.matching_line());
+    EXPECT_EQ(parsing.GetCrawlDelay(), skipping.GetCrawlDelay());
+  }
+
+  matcher.lines.clear();
+  matcher.set_skip_other_groups(false);
+  matcher.OneAgentAllowedByRobots(robotstxt, "FooBot", "http://foo.com/foo");
+  EXPECT_EQ(11u, matcher.lines.size());
+}
+
 // Google specific: the RFC allows any line that crawlers might need, such as
 // sitemaps, which Google supports.
 // See REP RFC section "Other records".
@@ -1519,17 +1846,1126 @@ TEST(RobotsUnittest, ID_NonStandardLineExample_Sitemap) {
   }
 }
 
+// Robots.txt with sitemap lines outside of any group, in the group of the
+// queried agent, in a group that is skipped and with typos.
+const char kSitemapsRobotsTxt[] =
+    "Sitemap: http://foo.bar/first.xml\n"
+    "User-agent: BarBot\n"
+    "Disallow: /\n"
+    "  sitemap: http://foo.bar/bar.xml # In the group of BarBot\n"
+    "Sitemap:\n"
+    "User-agent: FooBot\n"
+    "Disallow: /foo\n"
+    "Site-map: http://foo.bar/typo.xml\n"
+    "SITEMAP:http://foo.bar/last.xml\n";
+
+// With set_collect_sitemaps(true), a check also returns the sitemaps of the
+// robots.txt, whatever the agent, as views into the body.
+TEST(RobotsUnittest, RobotsMatcher_CollectsSitemaps) {
+  const std::string robotstxt = kSitemapsRobotsTxt;
+  const std::vector<std::string_view> expected = {
+      "http://foo.bar/first.xml", "http://foo.bar/bar.xml",
+#if ROBOTS_ALLOW_FREQUENT_TYPOS
+      "http://foo.bar/typo.xml",
+#endif  // ROBOTS_ALLOW_FREQUENT_TYPOS
+      "http://foo.bar/last.xml"};
+  RobotsMatcher matcher;
+  EXPECT_FALSE(matcher.collect_sitemaps());
+  EXPECT_FALSE(matcher.OneAgentAllowedByRobots(robotstxt, "FooBot",
+                                               "http://foo.bar/foo"));
+  EXPECT_TRUE(matcher.sitemaps().empty());
+
+  matcher.set_collect_sitemaps(true);
+  for (const bool skip : {true, false}) {
+    matcher.set_skip_other_groups(skip);
+    EXPECT_FALSE(matcher.OneAgentAllowedByRobots(robotstxt, "FooBot",
+                                                 "http://foo.bar/foo"));
+    EXPECT_EQ(7, matcher.matching_line());
+    EXPECT_EQ(expected, matcher.sitemaps());
+    for (std::string_view sitemap : matcher.sitemaps()) {
+      EXPECT_GE(sitemap.data(), robotstxt.data());
+      EXPECT_LE(sitemap.data() + sitemap.size(),
+                robotstxt.data() + robotstxt.size());
+    }
+  }
+
+  // The next check starts over.
+  EXPECT_TRUE(matcher.OneAgentAllowedByRobots("User-agent: *\nAllow: /\n",
+                                              "FooBot", "http://foo.bar/"));
+  EXPECT_TRUE(matcher.sitemaps().empty());
+}
+
+// Bodies exercising the group selection corner cases of RobotsMatcher:
+// secondary groups, "most specific agent wins", rules before any user-agent,
+// extensions between user-agent lines, index.html normalization, encoding and
+// wildcards.
+const char* const kCompiledRobotsBodies[] = {
+    "",
+    "user-agent: FooBot\n"
+    "disallow: /\n",
+    "allow: /foo/bar/\n"
+    "\n"
+    "user-agent: FooBot\n"
+    "disallow: /\n"
+    "allow: /x/\n"
+    "user-agent: BarBot\n"
+    "disallow: /\n"
+    "allow: /y/\n",
+    "user-agent: *\n"
+    "disallow: /x/\n"
+    "user-agent: FooBot\n"
+    "crawl-delay: 3\n"
+    "user-agent: BarBot\n"
+    "request-rate: 1/5\n"
+    "disallow: /y/\n"
+    "allow: /y/z\n"
+    "crawl-delay: 7\n"
+    "user-agent: FooBot\n"
+    "disallow: /\n",
+    "User-agent: Googlebot\n"
+    "Disallow: /a\n"
+    "Crawl-delay: 1\n"
+    "User-agent: Googlebot-Image\n"
+    "Disallow: /b\n"
+    "Allow: /a\n"
+    "Crawl-delay: 2\n"
+    "User-agent: Googlebot\n"
+    "Allow: /b\n"
+    "Content-Signal: ai-train=no, search=yes\n"
+    "User-agent: *\n"
+    "Disallow: /c\n"
+    "Content-Signal: ai-input=no\n",
+    "user-agent: *\n"
+    "user-agent: FooBot\n"
+    "allow: /\n"
+    "disallow: /\n"
+    "disallow: /index.html\n"
+    "allow: /allowed-slash/index.html\n"
+    "disallow: /*.php$\n"
+    "allow: /foo/*/bar$\n"
+    "disallow: /foo%2Fbar\n"
+    "allow: /foo/ba%72\n"
+    "disallow: /%2A\n"
+    "allow: /$\n"
+    "disallow:\n",
+    "User-agent: * baz\n"
+    "Disallow: /\n"
+    "User-agent: FooBot/1.2\n"
+    "Allow: /\n"
+    "Disallow: /private\n"
+    "User-agent: *foo\n"
+    "Disallow: /star\n",
+    // More rules than the key filter of CompiledRobots compares at once.
+    "user-agent: FooBot\n"
+    "disallow: /a\n"
+    "disallow: /b\n"
+    "allow: /x/\n"
+    "disallow: /y/z$\n"
+    "allow: /c\n"
+    "disallow: /d\n"
+    "disallow: /e\n"
+    "disallow: /f\n"
+    "disallow: /g\n"
+    "disallow: /h\n"
+    "disallow: /i\n"
+    "disallow: /j\n"
+    "disallow: /k\n"
+    "disallow: /l\n"
+    "disallow: /m\n"
+    "disallow: /n\n"
+    "allow: /%61\n"
+    "allow: /*.php$\n"
+    "disallow: *star\n"
+    "disallow: /\n"
+    "allow: /y/\n"
+    "allow: /priv*te/\n"
+    "disallow: /private$\n"
+    "allow: /foo/%62ar\n"
+    "disallow: /f\n",
+};
+
+// Copies 'image' to 8-byte aligned storage, as a memory-mapped file would be.
+std::string_view AlignedCopy(std::string_view image,
+                             std::vector<uint64_t>* storage) {
+  storage->assign((image.size() + 7) / 8, 0);
+  if (!image.empty()) std::memcpy(storage->data(), image.data(), image.size());
+  return std::string_view(reinterpret_cast<const char*>(storage->data()),
+                          image.size());
+}
+
+void ExpectCompiledRobotsMatchesMatcher(
+    std::string_view robotstxt, const std::vector<std::string>& user_agents) {
+  const googlebot::CompiledRobots compiled(robotstxt);
+  const googlebot::ResolvedRobots resolved = compiled.Resolve(&user_agents);
+  // The same tables, queried in place from a copy of the image.
+  std::vector<uint64_t> storage;
+  const std::optional<googlebot::CompiledRobots> loaded =
+      googlebot::CompiledRobots::FromSerialized(
+          AlignedCopy(compiled.Serialize(), &storage));
+  ASSERT_TRUE(loaded.has_value()) << robotstxt;
+  EXPECT_EQ(compiled.num_rules(), loaded->num_rules());
+  const char* const kUrls[] = {
+      "http://foo.bar/",
+      "http://foo.bar/x/y",
+      "http://foo.bar/y/z",
+      "http://foo.bar/y/zz",
+      "http://foo.bar/a",
+      "http://foo.bar/b",
+      "http://foo.bar/c",
+      "http://foo.bar/index.html",
+      "http://foo.bar/allowed-slash/",
+      "http://foo.bar/allowed-slash/index.htm",
+      "http://foo.bar/x.php",
+      "http://foo.bar/x.php?y",
+      "http://foo.bar/foo/baz/bar",
+      "http://foo.bar/foo/bar",
+      "http://foo.bar/*",
+      "http://foo.bar/star",
+      "http://foo.bar/private/page",
+  };
+  for (const char* url : kUrls) {
+    RobotsMatcher matcher;
+    const bool allowed = matcher.AllowedByRobots(robotstxt, &user_agents, url);
+    const googlebot::CompiledRobots::MatchResult result =
+        compiled.Match(&user_agents, url);
+    EXPECT_EQ(allowed, result.allowed) << robotstxt << url;
+    EXPECT_EQ(allowed, compiled.Allowed(&user_agents, url));
+    EXPECT_EQ(matcher.matching_line(), result.matching_line)
+        << robotstxt << url;
+    EXPECT_EQ(matcher.ever_seen_specific_agent(),
+              result.ever_seen_specific_agent);
+    const googlebot::CompiledRobots::MatchResult loaded_result =
+        loaded->Match(&user_agents, url);
+    EXPECT_EQ(allowed, loaded_result.allowed) << robotstxt << url;
+    EXPECT_EQ(matcher.matching_line(), loaded_result.matching_line);
+    EXPECT_EQ(matcher.GetCrawlDelay(), compiled.GetCrawlDelay(&user_agents));
+    EXPECT_EQ(matcher.GetCrawlDelay(), loaded->GetCrawlDelay(&user_agents));
+    const auto rate = matcher.GetRequestRate();
+    const auto compiled_rate = compiled.GetRequestRate(&user_agents);
+    ASSERT_EQ(rate.has_value(), compiled_rate.has_value());
+    if (rate.has_value()) {
+      EXPECT_EQ(rate->requests, compiled_rate->requests);
+      EXPECT_EQ(rate->seconds, compiled_rate->seconds);
+    }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+    const auto signal = matcher.GetContentSignal();
+    const auto compiled_signal = compiled.GetContentSignal(&user_agents);
+    ASSERT_EQ(signal.has_value(), compiled_signal.has_value());
+    if (signal.has_value()) {
+      EXPECT_EQ(signal->ai_train, compiled_signal->ai_train);
+      EXPECT_EQ(signal->ai_input, compiled_signal->ai_input);
+      EXPECT_EQ(signal->search, compiled_signal->search);
+    }
+    const auto loaded_signal = loaded->GetContentSignal(&user_agents);
+    ASSERT_EQ(signal.has_value(), loaded_signal.has_value());
+    if (signal.has_value()) {
+      EXPECT_EQ(signal->ai_train, loaded_signal->ai_train);
+      EXPECT_EQ(signal->search, loaded_signal->search);
+    }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+
+    const googlebot::CompiledRobots::MatchResult resolved_result =
+        resolved.Match(url);
+    EXPECT_EQ(allowed, resolved_result.allowed) << robotstxt << url;
+    EXPECT_EQ(matcher.matching_line(), resolved_result.matching_line)
+        << robotstxt << url;
+    EXPECT_EQ(matcher.ever_seen_specific_agent(),
+              resolved.ever_seen_specific_agent());
+    EXPECT_EQ(matcher.GetCrawlDelay(), resolved.GetCrawlDelay());
+    ASSERT_EQ(rate.has_value(), resolved.GetRequestRate().has_value());
+    if (rate.has_value()) {
+      EXPECT_EQ(rate->requests, resolved.GetRequestRate()->requests);
+      EXPECT_EQ(rate->seconds, resolved.GetRequestRate()->seconds);
+    }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+    ASSERT_EQ(signal.has_value(), resolved.GetContentSignal().has_value());
+    if (signal.has_value()) {
+      EXPECT_EQ(signal->ai_train, resolved.GetContentSignal()->ai_train);
+      EXPECT_EQ(signal->ai_input, resolved.GetContentSignal()->ai_input);
+      EXPECT_EQ(signal->search, resolved.GetContentSignal()->search);
+    }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  }
+}
+
+// CompiledRobots must answer every query exactly like RobotsMatcher does for
+// the same body.
+TEST(RobotsUnittest, CompiledRobots_SameAnswersAsRobotsMatcher) {
+  const std::vector<std::vector<std::string>> kAgentLists = {
+      {},
+      {""},
+      {"FooBot"},
+      {"BarBot"},
+      {"FooBot", "BarBot"},
+      {"Googlebot"},
+      {"Googlebot-Image"},
+      {"Googlebot", "Googlebot-Image"},
+      {"Googlebot-Image", "Googlebot"},
+      {"UnknownBot"},
+  };
+  for (const char* robotstxt : kCompiledRobotsBodies) {
+    for (const auto& user_agents : kAgentLists) {
+      ExpectCompiledRobotsMatchesMatcher(robotstxt, user_agents);
+    }
+  }
+}
+
+// Each matching switch of robots.h that is defined to 0 turns its behaviour
+// off in RobotsMatcher, CompiledRobots and ResolvedRobots alike.
+TEST(RobotsUnittest, MatchingSwitches) {
+  const std::string robotstxt =
+      "user-agent: FooBot\n"
+      "disalow: /typo\n"
+      "disallow: /a%2Fb\n"
+      "allow: /dir/index.html\n"
+      "disallow: /dir/\n"
+      "crawl-delay: 3\n";
+  const std::vector<std::string> agents = {"FooBot"};
+  const googlebot::CompiledRobots compiled(robotstxt);
+  const googlebot::ResolvedRobots resolved = compiled.Resolve(&agents);
+  const std::pair<const char*, bool> kChecks[] = {
+      {"http://foo.bar/typo", !ROBOTS_ALLOW_FREQUENT_TYPOS},
+      {"http://foo.bar/a/b", !ROBOTS_DECODE_PERCENT_ESCAPES},
+      {"http://foo.bar/a%2Fb", false},
+      {"http://foo.bar/dir/", ROBOTS_NORMALIZE_INDEX_HTML != 0},
+      {"http://foo.bar/dir/x", false},
+  };
+  for (const auto& [url, allowed] : kChecks) {
+    SCOPED_TRACE(url);
+    RobotsMatcher matcher;
+    EXPECT_EQ(allowed, matcher.AllowedByRobots(robotstxt, &agents, url));
+    EXPECT_EQ(allowed, compiled.Allowed(&agents, url));
+    EXPECT_EQ(allowed, resolved.Allowed(url));
+  }
+  RobotsMatcher matcher;
+  matcher.AllowedByRobots(robotstxt, &agents, "http://foo.bar/");
+  const std::optional<double> delay =
+      ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES ? std::optional<double>(3.0)
+                                            : std::nullopt;
+  EXPECT_EQ(delay, matcher.GetCrawlDelay());
+  EXPECT_EQ(delay, resolved.GetCrawlDelay());
+}
+
+TEST(RobotsUnittest, CompiledRobots_Basics) {
+  const googlebot::CompiledRobots compiled(
+      "user-agent: FooBot\n"
+      "disallow: /\n"
+      "allow: /public\n"
+      "\n"
+      "user-agent: *\n"
+      "crawl-delay: 5\n"
+      "disallow: /private\n");
+  EXPECT_EQ(2, compiled.num_groups());
+  EXPECT_EQ(3, compiled.num_rules());
+
+  EXPECT_FALSE(compiled.OneAgentAllowed("FooBot", "http://foo.bar/x"));
+  EXPECT_TRUE(compiled.OneAgentAllowed("FooBot", "http://foo.bar/public"));
+  EXPECT_TRUE(compiled.OneAgentAllowed("BarBot", "http://foo.bar/x"));
+  EXPECT_FALSE(compiled.OneAgentAllowed("BarBot", "http://foo.bar/private"));
+
+  const std::vector<std::string> foo = {"FooBot"};
+  const googlebot::CompiledRobots::MatchResult result =
+      compiled.Match(&foo, "http://foo.bar/public/page");
+  EXPECT_TRUE(result.allowed);
+  EXPECT_EQ(3, result.matching_line);
+  EXPECT_TRUE(result.ever_seen_specific_agent);
+#if ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+  // No crawl-delay in the FooBot group, so the global value applies.
+  EXPECT_EQ(5.0, compiled.GetCrawlDelay(&foo));
+#endif  // ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+  EXPECT_EQ(std::nullopt, compiled.GetRequestRate(&foo));
+
+  // Nothing to compile: everything is allowed.
+  const googlebot::CompiledRobots empty("");
+  EXPECT_EQ(0, empty.num_groups());
+  EXPECT_TRUE(empty.OneAgentAllowed("FooBot", "http://foo.bar/x"));
+}
+
+// Resolving keeps only the rules of the most specific groups for the agents,
+// or the global rules if the file has no group for them.
+TEST(RobotsUnittest, CompiledRobots_Resolve) {
+  const googlebot::CompiledRobots compiled(
+      "User-agent: *\n"
+      "Disallow: /\n"
+      "User-agent: OurBot\n"
+      "Disallow: /private\n"
+      "User-agent: OurBot-Image\n"
+      "Disallow: /images\n"
+      "Allow: /images/public\n"
+      "Crawl-delay: 2\n");
+  EXPECT_EQ(4, compiled.num_rules());
+
+  const std::vector<std::string> agents = {"OurBot", "OurBot-Image"};
+  const googlebot::ResolvedRobots ours = compiled.Resolve(&agents);
+  EXPECT_TRUE(ours.ever_seen_specific_agent());
+  EXPECT_EQ(2, ours.num_rules());
+  EXPECT_TRUE(ours.Allowed("http://foo.bar/private"));
+  EXPECT_FALSE(ours.Allowed("http://foo.bar/images/x"));
+  EXPECT_TRUE(ours.Allowed("http://foo.bar/images/public/x"));
+#if ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+  EXPECT_EQ(2.0, ours.GetCrawlDelay());
+#endif  // ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+
+  const std::vector<std::string> other = {"OtherBot"};
+  const googlebot::ResolvedRobots global = compiled.Resolve(&other);
+  EXPECT_FALSE(global.ever_seen_specific_agent());
+  EXPECT_EQ(1, global.num_rules());
+  EXPECT_FALSE(global.Allowed("http://foo.bar/"));
+  EXPECT_EQ(2, global.Match("http://foo.bar/").matching_line);
+  EXPECT_EQ(std::nullopt, global.GetCrawlDelay());
+}
+
+// ResolvedRobots indexes its rules in a trie. Many rules sharing prefixes, with
+// %-escapes, wildcards and '$', must give the same answers as RobotsMatcher.
+TEST(RobotsUnittest, ResolvedRobots_ManyRules) {
+  std::string robotstxt = "User-agent: FooBot\n";
+  for (int i = 0; i < 300; ++i) {
+    const std::string n = std::to_string(i);
+    switch (i % 6) {
+      case 0: robotstxt += "Disallow: /a/" + n + "\n"; break;
+      case 1: robotstxt += "Allow: /a/" + n + "/x\n"; break;
+      case 2: robotstxt += "Disallow: /a/%" + n.substr(0, 1) + "A" + n + "\n";
+        break;
+      case 3: robotstxt += "Allow: /a/" + n + "$\n"; break;
+      case 4: robotstxt += "Disallow: /a/*" + n + "*.php$\n"; break;
+      case 5: robotstxt += "Allow: /a/" + n + "*/y\n"; break;
+    }
+  }
+  robotstxt += "Disallow: /a/1\nAllow: /a/1\nDisallow: /\nAllow: /a/index.htm\n";
+
+  const googlebot::CompiledRobots compiled(robotstxt);
+  const std::vector<std::string> agents = {"FooBot"};
+  const googlebot::ResolvedRobots resolved = compiled.Resolve(&agents);
+  googlebot::RobotsMatcher matcher;
+  for (const std::string suffix :
+       {"", "0", "1", "3", "6", "7", "9", "19", "21", "120", "1/x", "7/x",
+        "9/", "10", "%1A10", "%3A32", "%3a32", "34/q.php", "%5A", "11/y",
+        "11/z/y", "12/y", "15", "1/", "index.htm", "index.html", "/"}) {
+    const std::string url = "http://foo.bar/a/" + suffix;
+    SCOPED_TRACE(url);
+    const bool allowed = matcher.AllowedByRobots(robotstxt, &agents, url);
+    const googlebot::CompiledRobots::MatchResult result = resolved.Match(url);
+    EXPECT_EQ(allowed, result.allowed);
+    EXPECT_EQ(matcher.matching_line(), result.matching_line);
+  }
+}
+
+// A PrefixMatcher gives the answers of ResolvedRobots::Match() whatever the
+// order of the URLs, also when consecutive paths part inside a %-escape.
+TEST(RobotsUnittest, ResolvedRobots_PrefixMatcher) {
+  const std::string robotstxt =
+      "User-agent: *\n"
+      "Disallow: /a/\n"
+      "Allow: /a/b\n"
+      "Allow: /a/b/c$\n"
+      "Disallow: /a/%3A\n"
+      "Allow: /a/%3A1\n"
+      "Disallow: /a/%\n"
+      "Allow: /a/*.html\n"
+      "Disallow: /a/b/*x*y$\n"
+      "Allow: /a/b/cd/ef\n";
+  const googlebot::CompiledRobots compiled(robotstxt);
+  const std::vector<std::string> agents = {"FooBot"};
+  const googlebot::ResolvedRobots resolved = compiled.Resolve(&agents);
+  std::vector<std::string> urls;
+  for (const char* path :
+       {"/", "/a", "/a/", "/a/b", "/a/b/", "/a/b/c", "/a/b/cd", "/a/b/cd/ef",
+        "/a/b/cd/ef/g", "/a/b/c.html", "/a/b/xy", "/a/b/x/y", "/a/b/x/y/z",
+        "/a/%", "/a/%3", "/a/%3A", "/a/%3a", "/a/%3A1", "/a/%3A2", "/a/%3G",
+        "/a/%3A1.html", "/a/:", "/a/:1", "/a/%%3A1", "/a/b%2F", "/a/z.html"}) {
+    urls.push_back(std::string("http://foo.bar") + path);
+  }
+  std::sort(urls.begin(), urls.end());
+  for (int order = 0; order < 3; ++order) {
+    googlebot::ResolvedRobots::PrefixMatcher prefix_matcher(resolved);
+    for (const std::string& url : urls) {
+      SCOPED_TRACE(url);
+      const googlebot::CompiledRobots::MatchResult expected =
+          resolved.Match(url);
+      const googlebot::CompiledRobots::MatchResult result =
+          prefix_matcher.Match(url);
+      EXPECT_EQ(expected.allowed, result.allowed);
+      EXPECT_EQ(expected.matching_line, result.matching_line);
+      // The same URL again reuses the whole walk.
+      EXPECT_EQ(expected.matching_line, prefix_matcher.Match(url).matching_line);
+    }
+    // Then in reverse order, then out of order.
+    std::reverse(urls.begin(), urls.end());
+    if (order == 1) std::rotate(urls.begin(), urls.begin() + 7, urls.end());
+  }
+}
+
+// MatchBatch() gives the same results as one Match() per URL, in the order
+// of the URLs, also when URLs repeat or only differ in their host.
+TEST(RobotsUnittest, CompiledRobots_MatchBatch) {
+  const googlebot::CompiledRobots compiled(kCompiledRobotsBodies[2]);
+  const std::vector<std::string> agents = {"FooBot", "BarBot"};
+  const std::vector<std::string> urls = {
+      "http://foo.bar/x/y",   "http://foo.bar/",     "http://foo.bar/x/y",
+      "http://other.bar/x/y", "http://foo.bar/a/b?c", "",
+      "http://foo.bar/x/index.html", "http://foo.bar/x/",
+      "http://foo.bar/"};
+  std::vector<googlebot::CompiledRobots::MatchResult> results(urls.size());
+  compiled.MatchBatch(&agents, urls.data(), urls.size(), results.data());
+  for (size_t i = 0; i < urls.size(); ++i) {
+    SCOPED_TRACE(urls[i]);
+    const googlebot::CompiledRobots::MatchResult expected =
+        compiled.Match(&agents, urls[i]);
+    EXPECT_EQ(expected.allowed, results[i].allowed);
+    EXPECT_EQ(expected.matching_line, results[i].matching_line);
+    EXPECT_EQ(expected.ever_seen_specific_agent,
+              results[i].ever_seen_specific_agent);
+  }
+
+  // An empty batch does nothing.
+  compiled.MatchBatch(&agents, static_cast<const std::string*>(nullptr), 0,
+                      nullptr);
+
+  // Views of the URLs give the same results.
+  std::vector<std::string_view> url_views(urls.begin(), urls.end());
+  std::vector<googlebot::CompiledRobots::MatchResult> view_results(
+      urls.size());
+  compiled.MatchBatch(&agents, url_views.data(), url_views.size(),
+                      view_results.data());
+  for (size_t i = 0; i < urls.size(); ++i) {
+    EXPECT_EQ(results[i].allowed, view_results[i].allowed) << urls[i];
+    EXPECT_EQ(results[i].matching_line, view_results[i].matching_line);
+  }
+}
+
+// MatchAgents() answers for each agent what Match() and the Get*() methods
+// answer for that agent alone, including for more agents than fit in a pass.
+TEST(RobotsUnittest, CompiledRobots_MatchAgents) {
+  std::vector<std::string> agents = {"FooBot",          "BarBot",
+                                     "Googlebot",       "Googlebot-Image",
+                                     "googlebot-image", "UnknownBot",
+                                     ""};
+  for (int i = 0; i < 70; ++i) agents.push_back("Bot" + std::to_string(i));
+  agents.push_back("FooBot");
+  const std::vector<std::string_view> views(agents.begin(), agents.end());
+  const char* const kUrls[] = {
+      "http://foo.bar/",     "http://foo.bar/x/y",  "http://foo.bar/y/z",
+      "http://foo.bar/a",    "http://foo.bar/b",    "http://foo.bar/c",
+      "http://foo.bar/x.php", "http://foo.bar/star", "http://foo.bar/private",
+  };
+  for (const char* robotstxt : kCompiledRobotsBodies) {
+    const googlebot::CompiledRobots compiled(robotstxt);
+    for (const char* url : kUrls) {
+      std::vector<googlebot::CompiledRobots::AgentVerdict> verdicts(
+          views.size());
+      compiled.MatchAgents(views.data(), views.size(), url, verdicts.data());
+      for (size_t i = 0; i < agents.size(); ++i) {
+        const std::vector<std::string> agent = {agents[i]};
+        const googlebot::CompiledRobots::AgentVerdict& verdict = verdicts[i];
+        const googlebot::CompiledRobots::MatchResult expected =
+            compiled.Match(&agent, url);
+        EXPECT_EQ(expected.allowed, verdict.match.allowed)
+            << robotstxt << url << agents[i];
+        EXPECT_EQ(expected.matching_line, verdict.match.matching_line)
+            << robotstxt << url << agents[i];
+        EXPECT_EQ(expected.ever_seen_specific_agent,
+                  verdict.match.ever_seen_specific_agent);
+        EXPECT_EQ(compiled.GetCrawlDelay(&agent), verdict.crawl_delay)
+            << robotstxt << agents[i];
+        const auto rate = compiled.GetRequestRate(&agent);
+        ASSERT_EQ(rate.has_value(), verdict.request_rate.has_value());
+        if (rate.has_value()) {
+          EXPECT_EQ(rate->requests, verdict.request_rate->requests);
+          EXPECT_EQ(rate->seconds, verdict.request_rate->seconds);
+        }
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+        const auto signal = compiled.GetContentSignal(&agent);
+        ASSERT_EQ(signal.has_value(), verdict.content_signal.has_value());
+        if (signal.has_value()) {
+          EXPECT_EQ(signal->ai_train, verdict.content_signal->ai_train);
+          EXPECT_EQ(signal->ai_input, verdict.content_signal->ai_input);
+          EXPECT_EQ(signal->search, verdict.content_signal->search);
+        }
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+      }
+    }
+  }
+
+  // Each agent gets its own group, where AllowedByRobots() collapses them.
+  const googlebot::CompiledRobots compiled(
+      "User-agent: Googlebot\n"
+      "Disallow: /news/\n"
+      "Crawl-delay: 1\n"
+      "User-agent: Googlebot-News\n"
+      "Allow: /news/\n"
+      "Disallow: /\n"
+      "User-agent: *\n"
+      "Disallow: /private/\n"
+      "Content-Signal: ai-train=no\n");
+  const std::string_view personas[] = {"Googlebot", "Googlebot-News",
+                                       "Googlebot-Image"};
+  googlebot::CompiledRobots::AgentVerdict verdicts[3];
+  compiled.MatchAgents(personas, 3, "http://foo.bar/news/today", verdicts);
+  EXPECT_FALSE(verdicts[0].match.allowed);
+  EXPECT_EQ(2, verdicts[0].match.matching_line);
+#if ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+  EXPECT_EQ(1.0, verdicts[0].crawl_delay);
+#endif  // ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES
+  EXPECT_TRUE(verdicts[1].match.allowed);
+  EXPECT_EQ(5, verdicts[1].match.matching_line);
+  EXPECT_EQ(std::nullopt, verdicts[1].crawl_delay);
+  EXPECT_TRUE(verdicts[2].match.allowed);
+  EXPECT_FALSE(verdicts[2].match.ever_seen_specific_agent);
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  ASSERT_TRUE(verdicts[2].content_signal.has_value());
+  EXPECT_FALSE(verdicts[2].content_signal->AllowsAiTrain());
+  // Like GetContentSignal(), the global value applies to all agents.
+  EXPECT_TRUE(verdicts[0].content_signal.has_value());
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  const std::vector<std::string> collapsed = {"Googlebot", "Googlebot-News"};
+  EXPECT_TRUE(compiled.Allowed(&collapsed, "http://foo.bar/news/today"));
+}
+
+// The string_view overloads of AllowedByRobots() give the results of the
+// std::vector<std::string> one, without copying agents or URLs.
+TEST(RobotsUnittest, RobotsMatcher_StringViewAgents) {
+  const std::string_view robotstxt =
+      "user-agent: FooBot\n"
+      "disallow: /foo\n"
+      "allow: /foo/bar$\n"
+      "user-agent: FooBot-Image\n"
+      "disallow: /img\n"
+      "user-agent: *\n"
+      "disallow: /\n"
+      "allow: /public*\n";
+  const std::vector<std::vector<std::string>> agent_lists = {
+      {"FooBot"}, {"foobot-image"}, {"BarBot"}, {"BarBot", "FooBot"}, {}};
+  const std::vector<std::string> urls = {
+      "http://foo.com/",      "http://foo.com/foo/bar", "http://foo.com/foo",
+      "http://foo.com/img/x", "http://foo.com/public?q=1",
+      "http://foo.com/a$b*#frag"};
+
+  RobotsMatcher matcher;
+  for (const auto& agents : agent_lists) {
+    const std::vector<std::string_view> views(agents.begin(), agents.end());
+    for (const std::string& url : urls) {
+      const bool expected = matcher.AllowedByRobots(robotstxt, &agents, url);
+      const int expected_line = matcher.matching_line();
+      // Views are only looked at during the call.
+      const std::string url_copy = url;
+      EXPECT_EQ(expected,
+                matcher.AllowedByRobots(robotstxt, views.data(), views.size(),
+                                        std::string_view(url_copy)))
+          << url;
+      EXPECT_EQ(expected_line, matcher.matching_line()) << url;
+#ifdef ROBOTS_HAVE_SPAN
+      EXPECT_EQ(expected,
+                matcher.AllowedByRobots(
+                    robotstxt, std::span<const std::string_view>(views), url))
+          << url;
+#endif
+      if (agents.size() == 1) {
+        EXPECT_EQ(expected, matcher.OneAgentAllowedByRobots(
+                                robotstxt, views[0], std::string_view(url)))
+            << url;
+      }
+    }
+  }
+}
+
+// The string_view overloads of CompiledRobots give the results of the
+// std::vector<std::string> ones.
+TEST(RobotsUnittest, CompiledRobots_StringViewAgents) {
+  const googlebot::CompiledRobots compiled(
+      "user-agent: FooBot\n"
+      "disallow: /foo\n"
+      "allow: /foo/bar$\n"
+      "user-agent: FooBot-Image\n"
+      "disallow: /img\n"
+      "user-agent: *\n"
+      "disallow: /\n"
+      "allow: /public*\n");
+  const std::vector<std::vector<std::string>> agent_lists = {
+      {"FooBot"}, {"foobot-image"}, {"BarBot"}, {"BarBot", "FooBot"}, {}};
+  const std::vector<std::string_view> urls = {
+      "http://foo.com/",      "http://foo.com/foo/bar", "http://foo.com/foo",
+      "http://foo.com/img/x", "http://foo.com/public?q=1",
+      "http://foo.com/a$b*#frag"};
+  googlebot::MatchBudget budget;
+  budget.max_steps = 4;
+
+  for (const auto& agents : agent_lists) {
+    const std::vector<std::string_view> views(agents.begin(), agents.end());
+    std::vector<googlebot::CompiledRobots::MatchResult> batch(urls.size());
+    compiled.MatchBatch(views.data(), views.size(), urls.data(), urls.size(),
+                        batch.data());
+    const googlebot::ResolvedRobots resolved =
+        compiled.Resolve(views.data(), views.size());
+    for (size_t i = 0; i < urls.size(); ++i) {
+      SCOPED_TRACE(urls[i]);
+      const googlebot::CompiledRobots::MatchResult expected =
+          compiled.Match(&agents, urls[i]);
+      const googlebot::CompiledRobots::MatchResult result =
+          compiled.Match(views.data(), views.size(), urls[i]);
+      EXPECT_EQ(expected.allowed, result.allowed);
+      EXPECT_EQ(expected.matching_line, result.matching_line);
+      EXPECT_EQ(expected.ever_seen_specific_agent,
+                result.ever_seen_specific_agent);
+      EXPECT_EQ(expected.allowed,
+                compiled.Allowed(views.data(), views.size(), urls[i]));
+      EXPECT_EQ(expected.allowed, batch[i].allowed);
+      EXPECT_EQ(expected.matching_line, batch[i].matching_line);
+      EXPECT_EQ(expected.allowed, resolved.Match(urls[i]).allowed);
+
+      const googlebot::CompiledRobots::MatchResult budgeted =
+          compiled.Match(&agents, urls[i], budget);
+      const googlebot::CompiledRobots::MatchResult budgeted_view =
+          compiled.Match(views.data(), views.size(), urls[i], budget);
+      EXPECT_EQ(budgeted.allowed, budgeted_view.allowed);
+      EXPECT_EQ(budgeted.budget_exceeded, budgeted_view.budget_exceeded);
+#ifdef ROBOTS_HAVE_SPAN
+      EXPECT_EQ(expected.allowed,
+                compiled.Allowed(std::span<const std::string_view>(views),
+                                 urls[i]));
+      EXPECT_EQ(expected.matching_line,
+                compiled.Match(std::span<const std::string_view>(views),
+                               urls[i])
+                    .matching_line);
+#endif
+      if (agents.size() == 1) {
+        EXPECT_EQ(expected.allowed,
+                  compiled.OneAgentAllowed(views[0], urls[i]));
+      }
+    }
+#ifdef ROBOTS_HAVE_SPAN
+    std::vector<googlebot::CompiledRobots::MatchResult> span_batch(
+        urls.size());
+    compiled.MatchBatch(std::span<const std::string_view>(views),
+                        std::span<const std::string_view>(urls),
+                        std::span<googlebot::CompiledRobots::MatchResult>(
+                            span_batch));
+    for (size_t i = 0; i < urls.size(); ++i) {
+      EXPECT_EQ(batch[i].allowed, span_batch[i].allowed) << urls[i];
+    }
+#endif
+  }
+}
+
+// CompiledRobots keeps the sitemaps RobotsMatcher collects, also through
+// Serialize() and FromSerialized().
+TEST(RobotsUnittest, CompiledRobots_Sitemaps) {
+  RobotsMatcher matcher;
+  matcher.set_collect_sitemaps(true);
+  matcher.OneAgentAllowedByRobots(kSitemapsRobotsTxt, "FooBot",
+                                  "http://foo.bar/");
+  const googlebot::CompiledRobots compiled(kSitemapsRobotsTxt);
+  const std::optional<googlebot::CompiledRobots> loaded =
+      googlebot::CompiledRobots::FromSerialized(compiled.Serialize());
+  ASSERT_TRUE(loaded.has_value());
+  for (const googlebot::CompiledRobots* robots : {&compiled, &*loaded}) {
+    std::vector<std::string_view> sitemaps;
+    for (size_t i = 0; i < robots->num_sitemaps(); ++i) {
+      sitemaps.push_back(robots->sitemap(i));
+    }
+    EXPECT_EQ(matcher.sitemaps(), sitemaps);
+  }
+  EXPECT_EQ(0u, googlebot::CompiledRobots("User-agent: *\n").num_sitemaps());
+}
+
+// Images are bounds-checked when loaded, and copies of a CompiledRobots own or
+// share their image like the original.
+TEST(RobotsUnittest, CompiledRobots_Serialized) {
+  const googlebot::CompiledRobots compiled(kCompiledRobotsBodies[4]);
+  const std::string_view image = compiled.Serialize();
+  ASSERT_EQ(0u, image.size() % 8);
+
+  std::vector<uint64_t> storage;
+  std::string_view copy = AlignedCopy(image, &storage);
+  EXPECT_TRUE(googlebot::CompiledRobots::FromSerialized(copy).has_value());
+  // Truncated or misaligned.
+  EXPECT_FALSE(googlebot::CompiledRobots::FromSerialized(
+                   copy.substr(0, copy.size() - 8))
+                   .has_value());
+  EXPECT_FALSE(
+      googlebot::CompiledRobots::FromSerialized(copy.substr(1)).has_value());
+  EXPECT_FALSE(googlebot::CompiledRobots::FromSerialized("").has_value());
+  // A string offset pointing out of the image. The last word of the image is
+  // in the string table, every word before it is a candidate offset field.
+  int rejected = 0;
+  for (size_t word = 0; word + 1 < storage.size(); ++word) {
+    const uint64_t saved = storage[word];
+    storage[word] = ~uint64_t{0};
+    if (!googlebot::CompiledRobots::FromSerialized(copy).has_value()) {
+      ++rejected;
+    }
+    storage[word] = saved;
+  }
+  EXPECT_LT(0, rejected);
+
+  // Copies of a loaded image share it; copies of a compiled one own theirs.
+  const std::vector<std::string> agents = {"Googlebot"};
+  googlebot::CompiledRobots loaded =
+      *googlebot::CompiledRobots::FromSerialized(copy);
+  EXPECT_GT(compiled.MemoryUsage(), loaded.MemoryUsage());
+  googlebot::CompiledRobots owned = compiled;
+  EXPECT_NE(compiled.Serialize().data(), owned.Serialize().data());
+  EXPECT_EQ(compiled.Serialize(), owned.Serialize());
+  googlebot::CompiledRobots moved = std::move(owned);
+  EXPECT_EQ(compiled.Allowed(&agents, "http://foo.bar/b"),
+            moved.Allowed(&agents, "http://foo.bar/b"));
+  EXPECT_EQ(compiled.Allowed(&agents, "http://foo.bar/b"),
+            loaded.Allowed(&agents, "http://foo.bar/b"));
+}
+
+// Test vectors of FIPS 180-4.
+TEST(RobotsUnittest, DigestBody) {
+  auto hex = [](const googlebot::BodyDigest& digest) {
+    std::string out;
+    for (const uint8_t byte : digest) {
+      out += "0123456789abcdef"[byte >> 4];
+      out += "0123456789abcdef"[byte & 15];
+    }
+    return out;
+  };
+  EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            hex(googlebot::DigestBody("")));
+  EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            hex(googlebot::DigestBody("abc")));
+  // Padded into a second block.
+  EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            hex(googlebot::DigestBody(
+                "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")));
+  EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+            hex(googlebot::DigestBody(std::string(1000000, 'a'))));
+}
+
+TEST(RobotsUnittest, CompiledRobots_Recompile) {
+  using Diff = googlebot::CompiledRobots::Diff;
+  const std::string body =
+      "user-agent: FooBot\n"
+      "disallow: /foo\n"
+      "allow: /foo/public\n"
+      "\n"
+      "user-agent: BarBot\n"
+      "disallow: /bar\n"
+      "\n"
+      "user-agent: *\n"
+      "disallow: /private\n";
+  const googlebot::CompiledRobots previous(body);
+  const std::vector<std::string> foobot = {"FooBot"};
+  const std::vector<std::string> bazbot = {"BazBot"};
+
+  // The same body is not parsed again, and hashes the same.
+  Diff diff;
+  googlebot::CompiledRobots next =
+      googlebot::CompiledRobots::Recompile(previous, body, &diff);
+  EXPECT_TRUE(diff.identical);
+  EXPECT_TRUE(diff.changes.empty());
+  EXPECT_EQ(previous.Serialize(), next.Serialize());
+  EXPECT_EQ(googlebot::DigestBody(body), previous.body_digest());
+  std::vector<uint64_t> storage;
+  EXPECT_EQ(previous.body_digest(),
+            googlebot::CompiledRobots::FromSerialized(
+                AlignedCopy(previous.Serialize(), &storage))
+                ->body_digest());
+
+  // Comments, moved lines and other directives do not change any rule.
+  next = googlebot::CompiledRobots::Recompile(
+      previous,
+      "# Refetched.\n"
+      "user-agent: barbot\n"
+      "disallow: /bar\n"
+      "\n"
+      "user-agent: FooBot\n"
+      "crawl-delay: 5\n"
+      "allow: /foo/public\n"
+      "disallow: /foo\n"
+      "\n"
+      "user-agent: *\n"
+      "disallow: /private\n"
+      "sitemap: http://foo.bar/sitemap.xml\n",
+      &diff);
+  EXPECT_FALSE(diff.identical);
+  EXPECT_TRUE(diff.changes.empty());
+  EXPECT_NE(previous.body_digest(), next.body_digest());
+  EXPECT_TRUE(next.SameVerdicts(previous, &foobot));
+
+  // BarBot lost its group and falls back to the global rules, which gained
+  // a rule, and BazBot got a group of its own, still empty at the end of the
+  // file.
+  next = googlebot::CompiledRobots::Recompile(
+      previous,
+      "user-agent: FooBot\n"
+      "disallow: /foo\n"
+      "allow: /foo/public\n"
+      "\n"
+      "user-agent: *\n"
+      "disallow: /private\n"
+      "disallow: /tmp\n"
+      "\n"
+      "user-agent: BazBot\n",
+      &diff);
+  EXPECT_FALSE(diff.identical);
+  ASSERT_EQ(3u, diff.changes.size());
+  EXPECT_EQ("*", diff.changes[0].user_agent);
+  EXPECT_TRUE(diff.changes[0].had_group);
+  EXPECT_TRUE(diff.changes[0].has_group);
+  ASSERT_EQ(1u, diff.changes[0].added.size());
+  EXPECT_FALSE(diff.changes[0].added[0].is_allow);
+  EXPECT_EQ("/tmp", diff.changes[0].added[0].pattern);
+  EXPECT_EQ(7, diff.changes[0].added[0].line);
+  EXPECT_TRUE(diff.changes[0].removed.empty());
+  EXPECT_EQ("barbot", diff.changes[1].user_agent);
+  EXPECT_TRUE(diff.changes[1].had_group);
+  EXPECT_FALSE(diff.changes[1].has_group);
+  ASSERT_EQ(1u, diff.changes[1].removed.size());
+  EXPECT_EQ("/bar", diff.changes[1].removed[0].pattern);
+  EXPECT_EQ(6, diff.changes[1].removed[0].line);
+  EXPECT_EQ("bazbot", diff.changes[2].user_agent);
+  EXPECT_FALSE(diff.changes[2].had_group);
+  EXPECT_TRUE(diff.changes[2].has_group);
+  EXPECT_TRUE(diff.changes[2].added.empty());
+
+  // FooBot has its own group, so only BazBot sees a different verdict. Its
+  // empty group now allows everything.
+  EXPECT_TRUE(next.SameVerdicts(previous, &foobot));
+  EXPECT_FALSE(next.SameVerdicts(previous, &bazbot));
+  EXPECT_FALSE(previous.OneAgentAllowed("BazBot", "http://foo.bar/private"));
+  EXPECT_TRUE(next.OneAgentAllowed("BazBot", "http://foo.bar/private"));
+
+  // Without a diff.
+  next = googlebot::CompiledRobots::Recompile(previous, "");
+  EXPECT_EQ(0u, next.num_groups());
+  EXPECT_FALSE(next.SameVerdicts(previous, &foobot));
+}
+
+TEST(RobotsUnittest, RobotsPack_Basics) {
+  googlebot::RobotsPack::Builder builder;
+  builder.Add("http://b.com", "user-agent: *\ndisallow: /b\n");
+  builder.Add("http://a.com", "user-agent: *\ndisallow: /old\n");
+  builder.Add("http://c.com", googlebot::CompiledRobots(""));
+  // Replaces the first entry for the host.
+  builder.Add("http://a.com", "user-agent: *\ndisallow: /a\n");
+  const std::string data = builder.Finish();
+
+  std::vector<uint64_t> storage;
+  const std::optional<googlebot::RobotsPack> pack =
+      googlebot::RobotsPack::Open(AlignedCopy(data, &storage));
+  ASSERT_TRUE(pack.has_value());
+  ASSERT_EQ(3u, pack->size());
+  EXPECT_EQ("http://a.com", pack->host(0));
+  EXPECT_EQ("http://b.com", pack->host(1));
+  EXPECT_EQ("http://c.com", pack->host(2));
+
+  std::optional<googlebot::CompiledRobots> robots = pack->Find("http://a.com");
+  ASSERT_TRUE(robots.has_value());
+  EXPECT_FALSE(robots->OneAgentAllowed("FooBot", "http://a.com/a"));
+  EXPECT_TRUE(robots->OneAgentAllowed("FooBot", "http://a.com/old"));
+  robots = pack->Find("http://b.com");
+  ASSERT_TRUE(robots.has_value());
+  EXPECT_FALSE(robots->OneAgentAllowed("FooBot", "http://b.com/b"));
+  robots = pack->Find("http://c.com");
+  ASSERT_TRUE(robots.has_value());
+  EXPECT_EQ(0u, robots->num_groups());
+  EXPECT_FALSE(pack->Find("http://d.com").has_value());
+  EXPECT_FALSE(pack->Find("").has_value());
+
+  // An empty pack, and data that is not a pack.
+  const std::string empty = googlebot::RobotsPack::Builder().Finish();
+  const std::optional<googlebot::RobotsPack> empty_pack =
+      googlebot::RobotsPack::Open(AlignedCopy(empty, &storage));
+  ASSERT_TRUE(empty_pack.has_value());
+  EXPECT_EQ(0u, empty_pack->size());
+  EXPECT_FALSE(empty_pack->Find("http://a.com").has_value());
+  const googlebot::CompiledRobots compiled("");
+  EXPECT_FALSE(googlebot::RobotsPack::Open(
+                   AlignedCopy(compiled.Serialize(), &storage))
+                   .has_value());
+}
+
+// A single CompiledRobots is queried concurrently by several threads; every
+// thread must see the same answers as a single-threaded query.
+TEST(RobotsUnittest, CompiledRobots_ConcurrentQueries) {
+  const googlebot::CompiledRobots compiled(kCompiledRobotsBodies[4]);
+  const std::vector<std::string> agents = {"Googlebot"};
+  const std::vector<std::string> urls = {
+      "http://foo.bar/a", "http://foo.bar/b", "http://foo.bar/c",
+      "http://foo.bar/d"};
+  std::vector<googlebot::CompiledRobots::MatchResult> expected;
+  for (const auto& url : urls) expected.push_back(compiled.Match(&agents, url));
+
+  constexpr int kNumThreads = 8;
+  std::vector<int> mismatches(kNumThreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 1000; ++i) {
+        const size_t u = (i + t) % urls.size();
+        const auto result = compiled.Match(&agents, urls[u]);
+        if (result.allowed != expected[u].allowed ||
+            result.matching_line != expected[u].matching_line) {
+          ++mismatches[t];
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (int t = 0; t < kNumThreads; ++t) EXPECT_EQ(0, mismatches[t]);
+}
+
+// RobotsStats count the work of the calling thread when built with
+// ROBOTS_ENABLE_STATS=1, and stay zero otherwise.
+TEST(RobotsUnittest, RobotsStats) {
+  const std::string robotstxt =
+      "user-agent: FooBot\n"
+      "disallow: /a*b*c\n"
+      "allow: /x\n"
+      "# comment\n";
+  googlebot::ResetRobotsStats();
+  RobotsMatcher matcher;
+  EXPECT_TRUE(matcher.OneAgentAllowedByRobots(robotstxt, "FooBot",
+                                              "http://foo.bar/aXbXd"));
+  const googlebot::RobotsStats stats = googlebot::GetRobotsStats();
+  if (!googlebot::kRobotsStatsEnabled) {
+    EXPECT_EQ(0u, stats.bytes);
+    EXPECT_EQ(0u, stats.patterns_evaluated);
+    EXPECT_EQ(0u, stats.parse_ns);
+    return;
+  }
+
+  EXPECT_EQ(robotstxt.size(), stats.bytes);
+  // The empty line after the last line ending counts, as it is parsed.
+  EXPECT_EQ(5u, stats.lines);
+  EXPECT_EQ(3u, stats.directives);
+  EXPECT_EQ(1u, stats.urls);
+  EXPECT_EQ(2u, stats.patterns_evaluated);
+  // "/a*b*c" against "/aXbXd": one position for "/" and "a" each, the first
+  // '*' adds 5 positions, "b" examines them, the second '*' adds 3 positions
+  // and "c" examines them. "/x" is a plain prefix and needs no positions.
+  EXPECT_EQ(8u, stats.wildcard_expansions);
+  EXPECT_EQ(18u, stats.match_steps);
+  EXPECT_EQ(18u, stats.max_match_steps);
+  // Classification and matching happen within parsing.
+  EXPECT_GE(stats.parse_ns, stats.classify_ns + stats.match_ns);
+
+  googlebot::RobotsStats merged = stats;
+  merged.Merge(stats);
+  EXPECT_EQ(2 * stats.bytes, merged.bytes);
+  EXPECT_EQ(2 * stats.match_steps, merged.match_steps);
+  EXPECT_EQ(stats.max_match_steps, merged.max_match_steps);
+
+  // Other threads have their own counters.
+  std::thread([&robotstxt] {
+    RobotsMatcher other;
+    other.OneAgentAllowedByRobots(robotstxt, "FooBot", "http://foo.bar/");
+    EXPECT_EQ(robotstxt.size(), googlebot::GetRobotsStats().bytes);
+  }).join();
+  EXPECT_EQ(stats.bytes, googlebot::GetRobotsStats().bytes);
+
+  googlebot::ResetRobotsStats();
+  EXPECT_EQ(0u, googlebot::GetRobotsStats().bytes);
+  EXPECT_EQ(0u, googlebot::GetRobotsStats().max_match_steps);
+}
+
+// A MatchBudget bounds the work of a check on a hostile robots.txt. Checks
+// over the budget return its verdict and say so, in all the matchers.
+TEST(RobotsUnittest, MatchBudget) {
+  const std::string robotstxt =
+      "user-agent: FooBot\n"
+      "allow: /x\n"
+      "disallow: /*a*a*a*a*a*b\n";
+  const std::string url = "http://foo.bar/" + std::string(200, 'a');
+  const std::vector<std::string> agents = {"FooBot"};
+  const googlebot::CompiledRobots compiled(robotstxt);
+
+  // Checks 'url' with 'budget' in all the matchers, expecting 'allowed' and
+  // 'exceeded' from each.
+  auto check = [&](const googlebot::MatchBudget& budget, const std::string& url,
+                   bool allowed, bool exceeded) {
+    RobotsMatcher matcher;
+    matcher.set_match_budget(budget);
+    EXPECT_EQ(allowed,
+              matcher.OneAgentAllowedByRobots(robotstxt, "FooBot", url));
+    EXPECT_EQ(exceeded, matcher.budget_exceeded());
+    if (exceeded) {
+      EXPECT_EQ(0, matcher.matching_line());
+    }
+    const googlebot::CompiledRobots::MatchResult result =
+        compiled.Match(&agents, url, budget);
+    EXPECT_EQ(allowed, result.allowed);
+    EXPECT_EQ(exceeded, result.budget_exceeded);
+    EXPECT_TRUE(result.ever_seen_specific_agent);
+    const googlebot::CompiledRobots::MatchResult resolved =
+        compiled.Resolve(&agents, budget).Match(url);
+    EXPECT_EQ(allowed, resolved.allowed);
+    EXPECT_EQ(exceeded, resolved.budget_exceeded);
+  };
+
+  // No limits by default.
+  check(googlebot::MatchBudget(), url, true, false);
+  check(googlebot::MatchBudget(), url + "b", false, false);
+
+  googlebot::MatchBudget steps;
+  steps.max_steps = 1000;
+  check(steps, url, false, true);
+  // Short paths fit in the same budget.
+  check(steps, "http://foo.bar/aaaaab", false, false);
+  check(steps, "http://foo.bar/aaa", true, false);
+  steps.allow_on_exceeded = true;
+  check(steps, url, true, true);
+
+  googlebot::MatchBudget wildcards;
+  wildcards.max_wildcards = 3;
+  check(wildcards, "http://foo.bar/", false, true);
+  wildcards.max_wildcards = 6;
+  check(wildcards, "http://foo.bar/", true, false);
+
+  googlebot::MatchBudget length;
+  length.max_pattern_length = 8;
+  check(length, "http://foo.bar/x", false, true);
+  length.max_pattern_length = 13;
+  check(length, "http://foo.bar/x", true, false);
+
+  // Only the patterns of the groups for the agents count.
+  googlebot::MatchBudget none;
+  none.max_wildcards = 0;
+  RobotsMatcher matcher;
+  matcher.set_match_budget(none);
+  EXPECT_FALSE(matcher.OneAgentAllowedByRobots(
+      std::string("user-agent: BarBot\n") + "disallow: /*a*b\n" +
+          "user-agent: FooBot\n" + "disallow: /\n",
+      "FooBot", url));
+  EXPECT_FALSE(matcher.budget_exceeded());
+  EXPECT_EQ(4, matcher.matching_line());
+  // A new check starts with a new budget.
+  matcher.set_match_budget(steps);
+  EXPECT_TRUE(matcher.OneAgentAllowedByRobots(robotstxt, "FooBot", url));
+  EXPECT_TRUE(matcher.budget_exceeded());
+  EXPECT_TRUE(matcher.OneAgentAllowedByRobots(robotstxt, "FooBot",
+                                              "http://foo.bar/x"));
+  EXPECT_FALSE(matcher.budget_exceeded());
+  EXPECT_EQ(2, matcher.matching_line());
+}
+
 }  // namespace
 
 // Integrity tests. These functions are available to the linker, but not in the
 // header, because they should only be used for testing.
 namespace googlebot {
 std::string GetPathParamsQuery(const std::string& url);
+std::string_view GetPathParamsQuery(std::string_view url, std::string* buffer);
+std::string_view GetPathParamsQueryOfCanonicalUrl(std::string_view url,
+                                                  std::string* buffer);
 bool MaybeEscapePattern(const char* src, char** dst);
+std::string_view ClassifyRobotsKey(std::string_view key,
+                                   bool* is_acceptable_typo);
 }  // namespace googlebot
 
 void TestPath(const std::string& url, const std::string& expected_path) {
   EXPECT_EQ(expected_path, googlebot::GetPathParamsQuery(url));
+  // The view is either in the url or in the buffer.
+  std::string buffer = "stale";
+  const std::string_view path = googlebot::GetPathParamsQuery(url, &buffer);
+  EXPECT_EQ(expected_path, path);
+  const bool in_url = path.data() >= url.data() &&
+                      path.data() + path.size() <= url.data() + url.size();
+  const bool in_buffer = path.data() == buffer.data();
+  EXPECT_TRUE(in_url || in_buffer || path == "/") << url;
 }
 
 void TestEscape(const std::string& url, const std::string& expected) {
@@ -1542,6 +2978,60 @@ void TestEscape(const std::string& url, const std::string& expected) {
   EXPECT_EQ(expected, escaped);
 }
 
+void TestKey(std::string_view key, std::string_view expected,
+             bool expected_typo) {
+  SCOPED_TRACE(key);
+  bool is_acceptable_typo = !expected_typo;
+  EXPECT_EQ(expected, googlebot::ClassifyRobotsKey(key, &is_acceptable_typo));
+  EXPECT_EQ(expected_typo, is_acceptable_typo);
+}
+
+TEST(RobotsUnittest, TestClassifyRobotsKey) {
+  // Typos only count with ROBOTS_ALLOW_FREQUENT_TYPOS, and Crawl-delay and
+  // Request-rate with ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES.
+  constexpr bool kTypos = ROBOTS_ALLOW_FREQUENT_TYPOS;
+  constexpr bool kDelay = ROBOTS_SUPPORT_NONSTANDARD_DIRECTIVES;
+  TestKey("user-agent", "user-agent", false);
+  TestKey("User-Agent", "user-agent", false);
+  TestKey("USER-AGENTS", "user-agent", false);
+  TestKey("useragent", kTypos ? "user-agent" : "", kTypos);
+  TestKey("user agent", kTypos ? "user-agent" : "", kTypos);
+  TestKey("user_agent", "", false);
+  TestKey("allow", "allow", false);
+  TestKey("ALLOWED", "allow", false);
+  TestKey("alow", "", false);
+  TestKey("disallow", "disallow", false);
+  TestKey("Disallowed", "disallow", false);
+  TestKey("dissallow", kTypos ? "disallow" : "", kTypos);
+  TestKey("dissalow", kTypos ? "disallow" : "", kTypos);
+  TestKey("disalow", kTypos ? "disallow" : "", kTypos);
+  TestKey("DIASLLOW", kTypos ? "disallow" : "", kTypos);
+  TestKey("disallaw", kTypos ? "disallow" : "", kTypos);
+  TestKey("disalloww", "disallow", false);
+  TestKey("dis", "", false);
+  TestKey("sitemap", "sitemap", false);
+  TestKey("site-map", kTypos ? "sitemap" : "", kTypos);
+  TestKey("site map", "", false);
+  TestKey("crawl-delay", kDelay ? "crawl-delay" : "", false);
+  TestKey("crawldelay", kDelay && kTypos ? "crawl-delay" : "",
+          kDelay && kTypos);
+  TestKey("Crawl Delay", kDelay && kTypos ? "crawl-delay" : "",
+          kDelay && kTypos);
+  TestKey("crawl_delay", "", false);
+  TestKey("request-rate", kDelay ? "request-rate" : "", false);
+  TestKey("requestrate", "", false);
+#if ROBOTS_SUPPORT_CONTENT_SIGNAL
+  TestKey("content-signal", "content-signal", false);
+  TestKey("contentsignal", kTypos ? "content-signal" : "", kTypos);
+  TestKey("Content Signal", kTypos ? "content-signal" : "", kTypos);
+#else
+  TestKey("content-signal", "", false);
+#endif  // ROBOTS_SUPPORT_CONTENT_SIGNAL
+  TestKey("c", "", false);
+  TestKey("noindex", "", false);
+  TestKey("", "", false);
+}
+
 TEST(RobotsUnittest, TestGetPathParamsQuery) {
   // Only testing URLs that are already correctly escaped here.
   TestPath("", "/");
@@ -1565,6 +3055,65 @@ TEST(RobotsUnittest, TestGetPathParamsQuery) {
   TestPath("//a/b/c", "/b/c");
 }
 
+void TestCanonicalPath(const std::string& url,
+                       const std::string& expected_path) {
+  std::string buffer;
+  EXPECT_EQ(expected_path,
+            googlebot::GetPathParamsQueryOfCanonicalUrl(url, &buffer));
+  // Same as the full parse for canonical URLs.
+  EXPECT_EQ(expected_path, googlebot::GetPathParamsQuery(url)) << url;
+}
+
+TEST(RobotsUnittest, TestGetPathParamsQueryOfCanonicalUrl) {
+  TestCanonicalPath("http://www.example.com", "/");
+  TestCanonicalPath("http://www.example.com/", "/");
+  TestCanonicalPath("https://www.example.com:8080/a", "/a");
+  TestCanonicalPath("http://www.example.com/a/b?c=http://d.e/",
+                    "/a/b?c=http://d.e/");
+  TestCanonicalPath("http://www.example.com/a/b?c=d&e=f#fragment",
+                    "/a/b?c=d&e=f");
+  TestCanonicalPath("http://www.example.com#fragment", "/");
+  TestCanonicalPath("http://www.example.com?a", "/?a");
+  TestCanonicalPath("http://www.example.com/a;b#c", "/a;b");
+  TestCanonicalPath("http://www.example.com/a*b$c", "/a%2Ab%24c");
+  TestCanonicalPath("http://www.example.com/a#b*c", "/a");
+  // Long enough for the vector loop.
+  TestCanonicalPath(
+      "http://www.example.com/0123456789abcdef0123456789abcdef/x$y#z",
+      "/0123456789abcdef0123456789abcdef/x%24y");
+  TestCanonicalPath(
+      "http://www.example.com/0123456789abcdef0123456789abcdef/xyz",
+      "/0123456789abcdef0123456789abcdef/xyz");
+  // Not absolute, parsed as usual.
+  TestCanonicalPath("/a/b", "/a/b");
+
+  // The matchers give the same verdicts in both modes.
+  const std::string_view robotstxt =
+      "user-agent: FooBot\n"
+      "disallow: /a\n"
+      "allow: /a/b$\n"
+      "disallow: /*.php$\n";
+  googlebot::RobotsMatcher matcher;
+  const googlebot::CompiledRobots compiled(robotstxt);
+  const std::vector<std::string> agents = {"FooBot"};
+  for (const char* url :
+       {"http://foo.com/", "http://foo.com/a", "http://foo.com/a/b",
+        "http://foo.com/a/b?c", "http://foo.com/x.php", "http://foo.com/x.php?",
+        "http://foo.com/x.php#y"}) {
+    matcher.set_url_mode(googlebot::UrlMode::kParse);
+    const bool expected = matcher.OneAgentAllowedByRobots(robotstxt, "FooBot",
+                                                          url);
+    matcher.set_url_mode(googlebot::UrlMode::kTrustedCanonical);
+    EXPECT_EQ(expected,
+              matcher.OneAgentAllowedByRobots(robotstxt, "FooBot", url))
+        << url;
+    EXPECT_EQ(expected,
+              compiled.Allowed(&agents, url,
+                               googlebot::UrlMode::kTrustedCanonical))
+        << url;
+  }
+}
+
 TEST(RobotsUnittest, TestMaybeEscapePattern) {
   TestEscape("http://www.example.com", "http://www.example.com");
   TestEscape("/a/b/c", "/a/b/c");